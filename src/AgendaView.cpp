@@ -0,0 +1,329 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "AgendaView.h"
+
+#include <time.h>
+
+#include <Alert.h>
+#include <LayoutBuilder.h>
+#include <List.h>
+#include <ScrollView.h>
+
+#include "DayView.h"
+#include "Event.h"
+#include "EventListItem.h"
+#include "EventListView.h"
+#include "SQLiteManager.h"
+
+
+AgendaView::AgendaView()
+	:
+	BView("AgendaView", B_WILL_DRAW),
+	fEventList(NULL),
+	fDate(BDate::CurrentDate(B_LOCAL_TIME)),
+	fGeneration(0)
+{
+	fEventListView = new EventListView();
+	fEventListView->SetViewColor(B_TRANSPARENT_COLOR);
+	fEventListView->SetInvocationMessage(new BMessage(kInvokationMessage));
+
+	fEventScroll = new BScrollView("AgendaScroll", fEventListView,
+		B_WILL_DRAW, false, true);
+	fEventScroll->SetExplicitMinSize(BSize(260, 260));
+
+	fDBManager = new SQLiteManager();
+	fReaderManager = new SQLiteManager();
+
+	for (int32 i = 0; i < 2; i++) {
+		fPrefetched[i] = NULL;
+		fLoading[i] = false;
+		fWanted[i] = false;
+		fExhausted[i] = false;
+	}
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL, 0)
+		.Add(fEventScroll)
+	.End();
+}
+
+
+AgendaView::~AgendaView()
+{
+	// Fetches still running see the new generation and drop their page.
+	// The reader connection is leaked on purpose for that reason.
+	fGeneration++;
+	_ClearEvents();
+	delete fDBManager;
+}
+
+
+void
+AgendaView::AttachedToWindow()
+{
+	fEventListView->SetTarget(this);
+}
+
+
+void
+AgendaView::SetDate(const BDate& date)
+{
+	fDate = date;
+}
+
+
+void
+AgendaView::LoadEvents()
+{
+	_ClearEvents();
+	fGeneration++;
+
+	// The first page is read right away so the view isn't empty, the
+	// following ones are fetched in the background while scrolling.
+	time_t start = BDateTime(fDate, BTime(0, 0, 0)).Time_t();
+	BList* events = fDBManager->GetEventsAfter(start, "", kPageSize);
+	_AddPage(events, kForward);
+
+	_RequestPage(kForward);
+	_RequestPage(kBackward);
+}
+
+
+void
+AgendaView::SetEventListPopUpEnabled(bool state)
+{
+	fEventListView->SetPopUpMenuEnabled(state);
+}
+
+
+void
+AgendaView::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+
+		case kEventListScrolled:
+			_CheckScrollPosition();
+			break;
+
+		case kAgendaPageLoaded:
+		{
+			BList* events;
+			int32 direction;
+			int32 generation;
+			message->FindPointer("events", (void**)&events);
+			message->FindInt32("direction", &direction);
+			message->FindInt32("generation", &generation);
+
+			if (generation != fGeneration) {
+				for (int32 i = 0; i < events->CountItems(); i++)
+					delete (Event*)events->ItemAt(i);
+				delete events;
+				break;
+			}
+
+			fLoading[direction] = false;
+			if (events->IsEmpty())
+				fExhausted[direction] = true;
+
+			if (fWanted[direction]) {
+				fWanted[direction] = false;
+				_AddPage(events, (Direction)direction);
+				_RequestPage((Direction)direction);
+			} else
+				fPrefetched[direction] = events;
+			break;
+		}
+
+		case kInvokationMessage:
+		case kEditEventMessage:
+		{
+			int32 selection = fEventListView->CurrentSelection();
+			if (selection >= 0) {
+				Event* event = ((Event*)fEventList->ItemAt(selection));
+				BMessage msg(kLaunchEventManagerToModify);
+				msg.AddPointer("event", event);
+				Window()->PostMessage(&msg);
+			}
+			break;
+		}
+
+		case kDeleteEventMessage:
+		{
+			int32 selection = fEventListView->CurrentSelection();
+			if (selection < 0)
+				break;
+
+			Event* event = ((Event*)fEventList->ItemAt(selection));
+
+			BAlert* alert = new BAlert("Confirm delete",
+				"Are you sure you want to delete the selected event?",
+				NULL, "OK", "Cancel", B_WIDTH_AS_USUAL, B_WARNING_ALERT);
+
+			alert->SetShortcut(1, B_ESCAPE);
+			if (alert->Go() == 0) {
+				fDBManager->RemoveLocalEvent(event);
+
+				delete fEventListView->RemoveItem(selection);
+				delete (Event*)fEventList->RemoveItem(selection);
+			}
+			break;
+		}
+
+		default:
+			BView::MessageReceived(message);
+			break;
+	}
+}
+
+
+void
+AgendaView::_ClearEvents()
+{
+	fEventListView->DeselectAll();
+	for (int32 i = 0; i < fEventListView->CountItems(); i++)
+		delete fEventListView->ItemAt(i);
+	fEventListView->MakeEmpty();
+
+	if (fEventList != NULL) {
+		for (int32 i = 0; i < fEventList->CountItems(); i++)
+			delete (Event*)fEventList->ItemAt(i);
+		delete fEventList;
+	}
+	fEventList = new BList();
+
+	for (int32 i = 0; i < 2; i++) {
+		if (fPrefetched[i] != NULL) {
+			for (int32 j = 0; j < fPrefetched[i]->CountItems(); j++)
+				delete (Event*)fPrefetched[i]->ItemAt(j);
+			delete fPrefetched[i];
+		}
+		fPrefetched[i] = NULL;
+		fLoading[i] = false;
+		fWanted[i] = false;
+		fExhausted[i] = false;
+	}
+}
+
+
+void
+AgendaView::_RequestPage(Direction direction)
+{
+	if (fLoading[direction] || fExhausted[direction]
+		|| fPrefetched[direction] != NULL)
+		return;
+
+	PageRequest* request = new PageRequest;
+	request->target = BMessenger(this);
+	request->manager = fReaderManager;
+	request->direction = direction;
+	request->generation = fGeneration;
+
+	// The cursor is the last row shown on that end of the list.
+	Event* edge = NULL;
+	if (!fEventList->IsEmpty()) {
+		edge = (Event*)(direction == kForward ? fEventList->LastItem()
+			: fEventList->FirstItem());
+	}
+
+	if (edge != NULL) {
+		request->start = edge->GetStartDateTime();
+		request->id = edge->GetId();
+	} else {
+		request->start = BDateTime(fDate, BTime(0, 0, 0)).Time_t();
+		request->id = "";
+	}
+
+	thread_id thread = spawn_thread(_FetchPage, "Agenda page fetcher",
+		B_LOW_PRIORITY, request);
+	if (thread < 0) {
+		delete request;
+		return;
+	}
+
+	fLoading[direction] = true;
+	resume_thread(thread);
+}
+
+
+int32
+AgendaView::_FetchPage(void* data)
+{
+	PageRequest* request = (PageRequest*)data;
+
+	BList* events;
+	if (request->direction == kForward) {
+		events = request->manager->GetEventsAfter(request->start,
+			request->id.String(), kPageSize);
+	} else {
+		events = request->manager->GetEventsBefore(request->start,
+			request->id.String(), kPageSize);
+	}
+
+	BMessage message(kAgendaPageLoaded);
+	message.AddPointer("events", events);
+	message.AddInt32("direction", request->direction);
+	message.AddInt32("generation", request->generation);
+
+	if (request->target.SendMessage(&message) != B_OK) {
+		for (int32 i = 0; i < events->CountItems(); i++)
+			delete (Event*)events->ItemAt(i);
+		delete events;
+	}
+
+	delete request;
+	return 0;
+}
+
+
+void
+AgendaView::_AddPage(BList* events, Direction direction)
+{
+	int32 count = events->CountItems();
+	BList items(count);
+	for (int32 i = 0; i < count; i++)
+		items.AddItem(new EventListItem((Event*)events->ItemAt(i), true));
+
+	if (direction == kForward) {
+		fEventList->AddList(events);
+		fEventListView->AddList(&items);
+	} else {
+		// Keep the rows the user is looking at in place.
+		fEventList->AddList(events, 0);
+		fEventListView->AddList(&items, 0);
+		fEventListView->ScrollBy(0, count * EventListItem::ItemHeight());
+	}
+
+	delete events;
+}
+
+
+void
+AgendaView::_CheckScrollPosition()
+{
+	BRect bounds(fEventListView->Bounds());
+	float pageHeight = kPageSize / 2 * EventListItem::ItemHeight();
+	float listHeight = fEventListView->CountItems()
+		* EventListItem::ItemHeight();
+
+	Direction directions[2] = { kForward, kBackward };
+	bool nearEdge[2] = { listHeight - bounds.bottom < pageHeight,
+		bounds.top < pageHeight };
+
+	for (int32 i = 0; i < 2; i++) {
+		Direction direction = directions[i];
+		if (!nearEdge[i])
+			continue;
+
+		if (fPrefetched[direction] != NULL) {
+			BList* events = fPrefetched[direction];
+			fPrefetched[direction] = NULL;
+			_AddPage(events, direction);
+			_RequestPage(direction);
+		} else if (!fExhausted[direction]) {
+			fWanted[direction] = true;
+			_RequestPage(direction);
+		}
+	}
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef AGENDAVIEW_H
+#define AGENDAVIEW_H
+
+#include <DateTime.h>
+#include <String.h>
+#include <View.h>
+
+
+class BList;
+class BScrollView;
+class Event;
+class EventListView;
+class SQLiteManager;
+
+
+const uint32 kAgendaPageLoaded = 'kapl';
+
+
+class AgendaView: public BView {
+public:
+					AgendaView();
+					~AgendaView();
+
+		void			MessageReceived(BMessage* message);
+		void			AttachedToWindow();
+
+		void			SetDate(const BDate& date);
+		void			LoadEvents();
+		void			SetEventListPopUpEnabled(bool state);
+
+private:
+		enum Direction {
+			kForward,
+			kBackward
+		};
+
+		struct PageRequest {
+			BMessenger		target;
+			SQLiteManager*		manager;
+			time_t			start;
+			BString			id;
+			Direction		direction;
+			int32			generation;
+		};
+
+		static	int32		_FetchPage(void* data);
+
+		void			_ClearEvents();
+		void			_RequestPage(Direction direction);
+		void			_AddPage(BList* events, Direction direction);
+		void			_CheckScrollPosition();
+
+		static const uint32	kInvokationMessage = 1000;
+		static const int32	kPageSize = 100;
+
+		EventListView*		fEventListView;
+		BScrollView*		fEventScroll;
+		BList*			fEventList;
+		BDate			fDate;
+		SQLiteManager*		fDBManager;
+		SQLiteManager*		fReaderManager;
+
+		// Pages fetched ahead of the scroll position but not shown yet.
+		BList*			fPrefetched[2];
+		bool			fLoading[2];
+		bool			fWanted[2];
+		bool			fExhausted[2];
+		int32			fGeneration;
+};
+
+
+#endif
@@ -11,6 +11,7 @@
 #include <File.h>
 #include <FindDirectory.h>
 #include <LocaleRoster.h>
+#include <TimeZone.h>
 
 #include <locale.h>
 
@@ -20,6 +21,8 @@
 #include "MainWindow.h"
 #include "Preferences.h"
 #include "PreferenceWindow.h"
+#include "SubscriptionWindow.h"
+#include "ZoneInfo.h"
 
 const char* kAppName = "Calendar";
 const char* kSignature = "application/x-vnd.calendar";
@@ -31,7 +34,8 @@ App::App()
 	fPreferenceWindow(NULL),
 	fCategoryWindow(NULL),
 	fPreferences(NULL),
-	fEventSyncWindow(NULL)
+	fEventSyncWindow(NULL),
+	fSubscriptionWindow(NULL)
 {
 	BPath settingsPath;
 	find_directory(B_USER_SETTINGS_DIRECTORY, &settingsPath);
@@ -49,6 +53,8 @@ App::App()
 	MainWindow::SetPreferences(fPreferences);
 	EventWindow::SetPreferences(fPreferences);
 
+	_UpdateTimeZone();
+
 	fMainWindow = new MainWindow();
 	fMainWindow->Show();
 }
@@ -143,6 +149,21 @@ App::MessageReceived(BMessage* message)
 			fEventSyncWindow = NULL;
 			break;
 
+		case kMenuSubscriptions:
+		{
+			if (fSubscriptionWindow == NULL) {
+				fSubscriptionWindow = new SubscriptionWindow();
+				fSubscriptionWindow->Show();
+			}
+
+			fSubscriptionWindow->Activate();
+			break;
+		}
+
+		case kSubscriptionWindowQuitting:
+			fSubscriptionWindow = NULL;
+			break;
+
 		case kPreferenceWindowQuitting:
 			fPreferenceWindow = NULL;
 			break;
@@ -152,6 +173,7 @@ App::MessageReceived(BMessage* message)
 			break;
 
 		case B_LOCALE_CHANGED:
+			_UpdateTimeZone();
 			fMainWindow->PostMessage(message);
 			break;
 
@@ -163,6 +185,17 @@ App::MessageReceived(BMessage* message)
 }
 
 
+// Local days are those of the zone set in the Time preferences, not
+// necessarily the one of the TZ variable the process was started with.
+void
+App::_UpdateTimeZone()
+{
+	BTimeZone timeZone;
+	if (BLocaleRoster::Default()->GetDefaultTimeZone(&timeZone) == B_OK)
+		ZoneInfo::SetLocalZone(timeZone.ID().String());
+}
+
+
 int
 main()
 {
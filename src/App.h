@@ -15,6 +15,7 @@ class MainWindow;
 class Preferences;
 class PreferenceWindow;
 class EventSyncWindow;
+class SubscriptionWindow;
 
 
 extern const char* kAppName;
@@ -35,10 +36,13 @@ public:
 
 
 private:
+	void			_UpdateTimeZone();
+
 	MainWindow*		fMainWindow;
 	PreferenceWindow*	fPreferenceWindow;
 	CategoryWindow*		fCategoryWindow;
 	EventSyncWindow*	fEventSyncWindow;
+	SubscriptionWindow*	fSubscriptionWindow;
 
 	Preferences*		fPreferences;
 	BPath			fPreferencesFile;
@@ -11,7 +11,6 @@
 #include <LayoutBuilder.h>
 #include <List.h>
 #include <ScrollView.h>
-#include <TimeFormat.h>
 
 #include "Event.h"
 #include "EventListItem.h"
@@ -21,14 +20,14 @@
 
 DayView::DayView(const BDate& date)
 	:
-	BView("DayView", B_WILL_DRAW)
+	BView("DayView", B_WILL_DRAW),
+	fEventList(NULL)
 {
 	fDate = date;
 
 	fEventListView = new EventListView();
 	fEventListView->SetViewColor(B_TRANSPARENT_COLOR);
 	fEventListView->SetInvocationMessage(new BMessage(kInvokationMessage));
-	fEventList = new BList();
 
 	fEventScroll = new BScrollView("EventScroll", fEventListView,
 		B_WILL_DRAW, false, true);
@@ -43,6 +42,14 @@ DayView::DayView(const BDate& date)
 }
 
 
+DayView::~DayView()
+{
+	_ClearEvents();
+	delete fEventList;
+	delete fDBManager;
+}
+
+
 void
 DayView::AttachedToWindow()
 {
@@ -59,14 +66,13 @@ DayView::SetDate(const BDate& date)
 void
 DayView::LoadEvents()
 {
-	if (!fEventList->IsEmpty()) {
-		fEventList->MakeEmpty();
-		fEventListView->MakeEmpty();
-	}
+	_ClearEvents();
 
-	fEventList = fDBManager->GetEventsOfDay(fDate);
-	fEventList->SortItems((int (*)(const void *, const void *))CompareFunc);
-	_PopulateEvents();
+	// The list starts with the first event of the day, the others are read
+	// as the user scrolls down.
+	fEventListView->ScrollTo(BPoint(0, 0));
+	fExhausted[kBackward] = true;
+	_AddPage(kForward);
 	fEventListView->Invalidate();
 }
 
@@ -76,6 +82,10 @@ DayView::MessageReceived(BMessage* message)
 {
 	switch (message->what) {
 
+		case kEventListScrolled:
+			_CheckScrollPosition();
+			break;
+
 		case kInvokationMessage:
 		case kEditEventMessage:
 		{
@@ -104,13 +114,10 @@ DayView::MessageReceived(BMessage* message)
 				int32 button_index = alert->Go();
 
 				if (button_index == 0) {
-					Event newEvent(*event);
-					newEvent.SetStatus(false);
-					newEvent.SetUpdated(time(NULL));
-					fDBManager->UpdateEvent(event, &newEvent);
-					Window()->LockLooper();
-					LoadEvents();
-					Window()->UnlockLooper();
+					fDBManager->RemoveLocalEvent(event);
+
+					delete fEventListView->RemoveItem(selection);
+					delete (Event*)fEventList->RemoveItem(selection);
 				}
 			}
 
@@ -148,41 +155,115 @@ DayView::CompareFunc(const void* a, const void* b)
 }
 
 
+// Reads the page of events next to the rows on that end of the list, and
+// returns whether there were any.
+bool
+DayView::_AddPage(Direction direction)
+{
+	if (fExhausted[direction])
+		return false;
+
+	Event* cursor = NULL;
+	if (!fEventList->IsEmpty()) {
+		cursor = (Event*)(direction == kForward ? fEventList->LastItem()
+			: fEventList->FirstItem());
+	}
+
+	BList* events;
+	if (direction == kForward)
+		events = fDBManager->GetEventsOfDayAfter(fDate, cursor, kPageSize);
+	else
+		events = fDBManager->GetEventsOfDayBefore(fDate, cursor, kPageSize);
+
+	int32 count = events->CountItems();
+	if (count < kPageSize)
+		fExhausted[direction] = true;
+
+	// Items are added in one go so the list view lays them out once instead
+	// of once per event.
+	BList items(count);
+	for (int32 i = 0; i < count; i++)
+		items.AddItem(new EventListItem((Event*)events->ItemAt(i)));
+
+	if (direction == kForward) {
+		fEventList->AddList(events);
+		fEventListView->AddList(&items);
+	} else {
+		// Keep the rows the user is looking at in place.
+		fEventList->AddList(events, 0);
+		fEventListView->AddList(&items, 0);
+		fEventListView->ScrollBy(0, count * EventListItem::ItemHeight());
+	}
+
+	delete events;
+	return count > 0;
+}
+
+
+// Drops count rows from that end of the list, they are read again when the
+// user scrolls back to them.
 void
-DayView::_PopulateEvents()
+DayView::_RemoveRows(Direction direction, int32 count)
 {
-	Event* event;
-	EventListItem* item;
-	BString startTime;
-	BString endTime;
-	BString eventName;
-	BString timePeriod;
-	BTimeFormat timeFormat;
-
-	for (int32 i = 0; i < fEventList->CountItems(); i++) {
-		event = ((Event*)fEventList->ItemAt(i));
-
-		eventName = "";
-		startTime = "";
-		endTime = "";
-		timePeriod = "";
-
-		if (event->IsAllDay())
-			timePeriod = "All Day";
-		else
-		{
-			timeFormat.Format(startTime, event->GetStartDateTime(),
-				B_SHORT_TIME_FORMAT);
-			timeFormat.Format(endTime, event->GetEndDateTime(),
-				B_SHORT_TIME_FORMAT);
-			timePeriod << startTime << " - " << endTime;
-		}
+	int32 index = direction == kForward
+		? fEventList->CountItems() - count : 0;
+
+	BList items(count);
+	for (int32 i = index; i < index + count; i++)
+		items.AddItem(fEventListView->ItemAt(i));
+	fEventListView->RemoveItems(index, count);
+
+	for (int32 i = 0; i < count; i++) {
+		delete (EventListItem*)items.ItemAt(i);
+		delete (Event*)fEventList->ItemAt(index + i);
+	}
+	fEventList->RemoveItems(index, count);
+	fExhausted[direction] = false;
+
+	if (direction == kBackward)
+		fEventListView->ScrollBy(0, -count * EventListItem::ItemHeight());
+}
+
 
-		eventName << event->GetName();
-		rgb_color color = event->GetCategory()->GetColor();
+void
+DayView::_CheckScrollPosition()
+{
+	float rowHeight = EventListItem::ItemHeight();
+
+	BRect bounds(fEventListView->Bounds());
+	int32 above = (int32)(bounds.top / rowHeight);
+	int32 below = fEventList->CountItems() - 1
+		- (int32)(bounds.bottom / rowHeight);
+	if (below < kPageSize)
+		_AddPage(kForward);
+	if (above < kPageSize)
+		_AddPage(kBackward);
+
+	bounds = fEventListView->Bounds();
+	above = (int32)(bounds.top / rowHeight);
+	below = fEventList->CountItems() - 1 - (int32)(bounds.bottom / rowHeight);
+	if (below > 2 * kPageSize)
+		_RemoveRows(kForward, below - kPageSize);
+	if (above > 2 * kPageSize)
+		_RemoveRows(kBackward, above - kPageSize);
+}
 
-		item = new EventListItem(eventName, timePeriod , color);
-		fEventListView->AddItem(item);
+
+void
+DayView::_ClearEvents()
+{
+	fEventListView->DeselectAll();
+	for (int32 i = 0; i < fEventListView->CountItems(); i++)
+		delete fEventListView->ItemAt(i);
+	fEventListView->MakeEmpty();
+
+	if (fEventList != NULL) {
+		for (int32 i = 0; i < fEventList->CountItems(); i++)
+			delete (Event*)fEventList->ItemAt(i);
+		delete fEventList;
 	}
+	fEventList = new BList();
 
+	fExhausted[kForward] = false;
+	fExhausted[kBackward] = false;
 }
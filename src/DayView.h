@@ -24,6 +24,7 @@ const uint32 kLaunchEventManagerToModify = 'klem';
 class DayView: public BView {
 public:
 					DayView(const BDate& date);
+					~DayView();
 		void			MessageReceived(BMessage* message);
 		void			AttachedToWindow();
 
@@ -33,15 +34,28 @@ public:
 		static	int		CompareFunc(const void* a, const void* b);
 
 private:
-		void			_PopulateEvents();
+		enum Direction {
+			kForward,
+			kBackward
+		};
+
+		bool			_AddPage(Direction direction);
+		void			_RemoveRows(Direction direction, int32 count);
+		void			_CheckScrollPosition();
+		void			_ClearEvents();
 
 		static const uint32 kInvokationMessage = 1000;
+		static const int32	kPageSize = 50;
 
+		// Only the rows around the visible ones are in the list: a page is
+		// read when fewer than kPageSize are left on either side, and rows
+		// beyond twice that are dropped again.
 		BList*			fEventList;
 		EventListView*		fEventListView;
 		BScrollView*		fEventScroll;
 		BDate			fDate;
 		SQLiteManager*		fDBManager;
+		bool			fExhausted[2];
 
 };
 
@@ -6,19 +6,26 @@
 
 #include <Application.h>
 #include <ControlLook.h>
+#include <DateFormat.h>
 #include <Font.h>
 #include <MenuItem.h>
+#include <TimeFormat.h>
 
+#include "Event.h"
 #include "EventListItem.h"
 
 
-EventListItem::EventListItem(BString name, BString timeText, rgb_color color)
+EventListItem::EventListItem(Event* event, bool showDate)
 	:
-	BListItem()
+	BListItem(),
+	fEvent(event),
+	fShowDate(showDate),
+	fMaterialized(false)
 {
-	fName = name;
-	fTimeText = timeText;
-	fColor = color;
+	// Only the event pointer is kept here, the strings are formatted the first
+	// time the item is actually drawn. A day with thousands of events then
+	// costs almost nothing for the rows that are never scrolled into view.
+	SetHeight(ItemHeight());
 }
 
 
@@ -36,6 +43,9 @@ EventListItem::DrawItem(BView* view, BRect rect, bool complete)
 	BFont footerFont;
 	font_height finfo;
 
+	if (!fMaterialized)
+		_Materialize();
+
 	rgb_color bgColor;
 	if (IsSelected())
 		bgColor = ui_color(B_LIST_SELECTED_BACKGROUND_COLOR);
@@ -79,8 +89,9 @@ EventListItem::DrawItem(BView* view, BRect rect, bool complete)
 		- (finfo.ascent + finfo.descent + finfo.leading)) / 2)
 		+ (finfo.ascent + finfo.descent) - headerFont.Size() + 2 + 3);
 
-	view->TruncateString(&fName, B_TRUNCATE_MIDDLE,  rect.Width() - offset - 2);
-	view->DrawString(fName.String());
+	BString name(fName);
+	view->TruncateString(&name, B_TRUNCATE_MIDDLE,  rect.Width() - offset - 2);
+	view->DrawString(name.String());
 
 	// time period
 
@@ -99,8 +110,9 @@ EventListItem::DrawItem(BView* view, BRect rect, bool complete)
 		- (finfo.ascent + finfo.descent + finfo.leading)) / 2)
 		+ (finfo.ascent + finfo.descent));
 
-		view->TruncateString(&fTimeText, B_TRUNCATE_MIDDLE, rect.Width() - offset - 2);
-		view->DrawString(fTimeText.String());
+	BString timeText(fTimeText);
+	view->TruncateString(&timeText, B_TRUNCATE_MIDDLE, rect.Width() - offset - 2);
+	view->DrawString(timeText.String());
 
 	// draw lines
 
@@ -117,6 +129,49 @@ EventListItem::Update(BView* owner, const BFont* finfo)
 	// list item size doesn't change
 	BListItem::Update(owner, finfo);
 
+	SetHeight(ItemHeight());
+}
+
+
+Event*
+EventListItem::GetEvent() const
+{
+	return fEvent;
+}
+
+
+float
+EventListItem::ItemHeight()
+{
 	float spacing = be_control_look->DefaultLabelSpacing();
-	SetHeight(fItemHeight + spacing * 2);
+	return fItemHeight + spacing * 2;
+}
+
+
+void
+EventListItem::_Materialize()
+{
+	fName = fEvent->GetName();
+	fColor = fEvent->GetCategory()->GetColor();
+
+	if (fShowDate) {
+		BDateFormat().Format(fTimeText, fEvent->GetStartDateTime(),
+			B_MEDIUM_DATE_FORMAT);
+		fTimeText << ", ";
+	}
+
+	if (fEvent->IsAllDay())
+		fTimeText << "All Day";
+	else {
+		BString startTime;
+		BString endTime;
+		BTimeFormat timeFormat;
+		timeFormat.Format(startTime, fEvent->GetStartDateTime(),
+			B_SHORT_TIME_FORMAT);
+		timeFormat.Format(endTime, fEvent->GetEndDateTime(),
+			B_SHORT_TIME_FORMAT);
+		fTimeText << startTime << " - " << endTime;
+	}
+
+	fMaterialized = true;
 }
@@ -13,18 +13,31 @@
 #include <String.h>
 
 
+class Event;
+
+
 class EventListItem: public BListItem {
 public:
-				EventListItem(BString name, BString timeText,
-					rgb_color color);
+				EventListItem(Event* event,
+					bool showDate = false);
 				~EventListItem();
 
 	virtual void		DrawItem(BView*, BRect, bool);
 	virtual	void		Update(BView*, const BFont*);
 
+	Event*			GetEvent() const;
+
+	static	float		ItemHeight();
+
 private:
+	void			_Materialize();
+
 	static const int 	fItemHeight	= 40;
 
+	Event*			fEvent;
+	bool			fShowDate;
+	bool			fMaterialized;
+
 	BString			fName;
 	BString			fTimeText;
 	rgb_color		fColor;
@@ -92,9 +92,22 @@ EventListView::FrameResized(float w, float h)
 {
 	BListView::FrameResized(w, h);
 
-	for (int32 i = 0; i < CountItems(); i++) {
-		BListItem* item = ItemAt(i);
-		item->Update(this, be_plain_font);
+	// All rows share the same height, so only the rows intersecting the
+	// visible rect need to be measured again. The others are updated by
+	// BListView when they get scrolled into view.
+	if (!IsEmpty()) {
+		BRect bounds(Bounds());
+		int32 first = IndexOf(bounds.LeftTop());
+		int32 last = IndexOf(bounds.LeftBottom());
+		if (first < 0)
+			first = 0;
+		if (last < 0)
+			last = CountItems() - 1;
+
+		for (int32 i = first; i <= last; i++) {
+			BListItem* item = ItemAt(i);
+			item->Update(this, be_plain_font);
+		}
 	}
 	Invalidate();
 }
@@ -113,20 +126,16 @@ EventListView::MessageReceived(BMessage* message)
 		case kEditActionInvoked:
 		{
 			fShowingPopUpMenu = false;
-			BView* view = Window()->FindView("DayView");
-			BMessenger msgr(view);
 			BMessage msg(kEditEventMessage);
-			msgr.SendMessage(&msg);
+			Messenger().SendMessage(&msg);
 			break;
 		}
 
 		case kDeleteActionInvoked:
 		{
 			fShowingPopUpMenu = false;
-			BView* view = Window()->FindView("DayView");
-			BMessenger msgr(view);
 			BMessage msg(kDeleteEventMessage);
-			msgr.SendMessage(&msg);
+			Messenger().SendMessage(&msg);
 			break;
 		}
 
@@ -137,6 +146,14 @@ EventListView::MessageReceived(BMessage* message)
 }
 
 
+void
+EventListView::ScrollTo(BPoint where)
+{
+	BListView::ScrollTo(where);
+	Messenger().SendMessage(kEventListScrolled);
+}
+
+
 void
 EventListView::MouseDown(BPoint position)
 {
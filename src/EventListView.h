@@ -12,6 +12,10 @@
 
 static const uint32 kPopClosed	= 'kpop';
 
+// Sent to the target whenever the list gets scrolled, so views showing a
+// window of a longer list can load rows before the user reaches its ends.
+static const uint32 kEventListScrolled	= 'kels';
+
 
 class EventListView : public BListView {
 public:
@@ -21,6 +25,7 @@ public:
 	virtual void		Draw(BRect rect);
 	virtual	void		FrameResized(float w, float h);
 	virtual	void		MessageReceived(BMessage* message);
+	virtual	void		ScrollTo(BPoint where);
 	void			MouseDown(BPoint position);
 	void			MouseUp(BPoint position);
 
@@ -41,6 +41,7 @@
 #include "MainWindow.h"
 #include "Preferences.h"
 #include "SQLiteManager.h"
+#include "ZoneInfo.h"
 
 
 Preferences* EventWindow::fPreferences = NULL;
@@ -49,7 +50,8 @@ Preferences* EventWindow::fPreferences = NULL;
 EventWindow::EventWindow()
 	:
 	BWindow(fPreferences->fEventWindowRect, "Event Manager", B_TITLED_WINDOW,
-			B_AUTO_UPDATE_SIZE_LIMITS)
+			B_AUTO_UPDATE_SIZE_LIMITS),
+	fEvent(NULL)
 {
 	_InitInterface();
 
@@ -64,6 +66,7 @@ EventWindow::EventWindow()
 
 EventWindow::~EventWindow()
 {
+	delete fEvent;
 	delete fDBManager;
 	delete fCategoryList;
 }
@@ -174,7 +177,8 @@ EventWindow::FrameMoved(BPoint newPosition)
 void
 EventWindow::SetEvent(Event* event)
 {
-	fEvent = event;
+	// The day view frees its events when it reloads, so keep our own copy.
+	fEvent = (event != NULL) ? new Event(*event) : NULL;
 
 	if (event != NULL) {
 		fTextName->SetText(event->GetName());
@@ -308,13 +312,41 @@ EventWindow::OnSaveClick()
 
 	bool notified = (difftime(start, BDateTime::CurrentDateTime(B_LOCAL_TIME).Time_t()) < 0) ? true : false;
 
-	Event newEvent(fTextName->Text(), fTextPlace->Text(),
-		fTextDescription->Text(), fAllDayCheckBox->Value() == B_CONTROL_ON,
-		start, end, category, notified);
+	bool allDay = fAllDayCheckBox->Value() == B_CONTROL_ON;
+	bool saved;
 
-	if ((fEvent == NULL) && (fDBManager->AddEvent(&newEvent))) {
-		CloseWindow();
-	} else if ((fEvent != NULL) && (fDBManager->UpdateEvent(fEvent, &newEvent))) {
+	if (fEvent == NULL) {
+		Event newEvent(fTextName->Text(), fTextPlace->Text(),
+			fTextDescription->Text(), allDay, start, end, category, notified);
+
+		// Times are entered on the local wall clock.
+		if (!newEvent.IsAllDay())
+			newEvent.SetTimeZone(ZoneInfo::Local()->Name());
+
+		saved = fDBManager->AddLocalEvent(&newEvent);
+	} else {
+		// Only what was edited is written and pushed.
+		Event newEvent(*fEvent);
+		newEvent.ClearChanges();
+		newEvent.SetName(fTextName->Text());
+		newEvent.SetPlace(fTextPlace->Text());
+		newEvent.SetDescription(fTextDescription->Text());
+		newEvent.SetAllDay(allDay);
+		newEvent.SetStartDateTime(start);
+		newEvent.SetEndDateTime(end);
+		newEvent.SetCategory(category);
+		newEvent.SetNotified(notified);
+
+		uint32 timeFields = kEventAllDay | kEventStart | kEventEnd;
+		if ((newEvent.ChangedFields() & timeFields) != 0)
+			newEvent.SetTimeZone(allDay ? "" : ZoneInfo::Local()->Name());
+		if (newEvent.ChangedFields() != 0)
+			newEvent.SetUpdated(time(NULL));
+
+		saved = fDBManager->UpdateLocalEvent(fEvent, &newEvent);
+	}
+
+	if (saved) {
 		CloseWindow();
 	} else {
 		BAlert* alert  = new BAlert("Error",
@@ -337,10 +369,7 @@ EventWindow::OnDeleteClick()
 	int32 button_index = alert->Go();
 
 	if (button_index == 0) {
-		Event newEvent(*fEvent);
-		newEvent.SetStatus(false);
-		newEvent.SetUpdated(time(NULL));
-		fDBManager->UpdateEvent(fEvent, &newEvent);
+		fDBManager->RemoveLocalEvent(fEvent);
 		CloseWindow();
 	}
 }
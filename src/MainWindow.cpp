@@ -5,25 +5,45 @@
 
 #include "MainWindow.h"
 
+#include <limits.h>
+#include <string.h>
+
+#include <Alert.h>
 #include <Application.h>
+#include <CardLayout.h>
+#include <FilePanel.h>
 #include <LayoutBuilder.h>
 #include <LocaleRoster.h>
 #include <Menu.h>
 #include <MenuItem.h>
 #include <MenuBar.h>
+#include <Path.h>
 #include <ToolBar.h>
 
+#include "AgendaView.h"
 #include "CategoryEditWindow.h"
+#include "CivilDate.h"
 #include "DayView.h"
+#include "Category.h"
 #include "Event.h"
+#include "EventCache.h"
 #include "EventListView.h"
+#include "EventLoader.h"
+#include "EventPrefetcher.h"
 #include "EventSyncWindow.h"
 #include "EventWindow.h"
+#include "ICSExporter.h"
+#include "ICSImporter.h"
+#include "ICSImportWindow.h"
 #include "MainView.h"
+#include "MonthView.h"
 #include "Preferences.h"
 #include "PreferenceWindow.h"
 #include "ResourceLoader.h"
 #include "SidePanelView.h"
+#include "SQLiteManager.h"
+#include "WeekView.h"
+#include "ZoneInfo.h"
 
 
 using BPrivate::BToolBar;
@@ -37,10 +57,20 @@ MainWindow::MainWindow()
 	:
 	BWindow(fPreferences->fMainWindowRect, "Calendar", B_TITLED_WINDOW,
 		B_AUTO_UPDATE_SIZE_LIMITS),
-	fEventWindow(NULL)
+	fEventWindow(NULL),
+	fImportPanel(NULL),
+	fExportPanel(NULL),
+	fCurrentView(kDayView),
+	fNavigationRequest(0)
 {
 	SetPulseRate(500000);
 
+	fDBManager = new SQLiteManager();
+	fEventCache = new EventCache(fDBManager);
+	fPrefetcher = new EventPrefetcher(fEventCache);
+	fLoader = new EventLoader(fEventCache, BMessenger(this));
+	fLastDate = BDate::CurrentDate(B_LOCAL_TIME);
+
 	_InitInterface();
 
 	if (fPreferences->fMainWindowRect == BRect()) {
@@ -54,6 +84,19 @@ MainWindow::MainWindow()
 }
 
 
+MainWindow::~MainWindow()
+{
+	// The views keep their buckets alive until they are deleted along with
+	// the window, after this destructor has run.
+	delete fImportPanel;
+	delete fExportPanel;
+	delete fLoader;
+	delete fPrefetcher;
+	delete fEventCache;
+	delete fDBManager;
+}
+
+
 bool
 MainWindow::QuitRequested()
 {
@@ -62,6 +105,31 @@ MainWindow::QuitRequested()
 }
 
 
+void
+MainWindow::MenusBeginning()
+{
+	// Categories may have changed since the menu was last opened.
+	BMenuItem* item;
+	while ((item = fExportCategoryMenu->RemoveItem((int32)0)) != NULL)
+		delete item;
+
+	BList* categories = fDBManager->GetAllCategories();
+	for (int32 i = 0; i < categories->CountItems(); i++) {
+		Category* category = (Category*)categories->ItemAt(i);
+
+		BString label(category->GetName());
+		label << B_UTF8_ELLIPSIS;
+		BMessage* message = new BMessage(kMenuExportICS);
+		message->AddString("category", category->GetId());
+		fExportCategoryMenu->AddItem(new BMenuItem(label.String(), message));
+		delete category;
+	}
+	delete categories;
+
+	BWindow::MenusBeginning();
+}
+
+
 void
 MainWindow::MessageReceived(BMessage* message)
 {
@@ -77,15 +145,28 @@ MainWindow::MessageReceived(BMessage* message)
 
 		case kMenuEventEdit:
 		{
+			if (fCurrentView == kWeekView) {
+				Event* event = fWeekView->SelectedEvent();
+				if (event != NULL)
+					_LaunchEventManager(event);
+				break;
+			}
+
 			BMessage msg(kEditEventMessage);
-			fDayView->MessageReceived(&msg);
+			if (fCurrentView == kAgendaView)
+				fAgendaView->MessageReceived(&msg);
+			else
+				fDayView->MessageReceived(&msg);
 			break;
 		}
 
 		case kMenuEventDelete:
 		{
 			BMessage msg(kDeleteEventMessage);
-			fDayView->MessageReceived(&msg);
+			if (fCurrentView == kAgendaView)
+				fAgendaView->MessageReceived(&msg);
+			else
+				fDayView->MessageReceived(&msg);
 			break;
 		}
 
@@ -97,10 +178,17 @@ MainWindow::MessageReceived(BMessage* message)
 			break;
 		}
 
+		case kDayView:
+		case kWeekView:
+		case kMonthView:
+		case kAgendaView:
+			_ShowView(message->what);
+			break;
+
 		case kEventWindowQuitting:
 		{
 			fEventWindow = NULL;
-			_UpdateDayView();
+			_UpdateMainView();
 			_SetEventListPopUpEnabled(true);
 			fEventMenu->SetEnabled(true);
 			break;
@@ -111,8 +199,26 @@ MainWindow::MessageReceived(BMessage* message)
 			break;
 
 		case kSelectedDateChanged:
-			_UpdateDayView();
+		{
+			_Navigate();
+
+			BDate date = _GetSelectedCalendarDate();
+			int32 direction = date.DateToJulianDay()
+				- fLastDate.DateToJulianDay();
+			fLastDate = date;
+			fPrefetcher->Navigate(date, direction);
 			break;
+		}
+
+		case kEventsLoaded:
+		{
+			// Loads for dates the user has already moved past are dropped.
+			int32 request;
+			if (message->FindInt32("request", &request) == B_OK
+				&& request == fNavigationRequest)
+				_UpdateMainView();
+			break;
+		}
 
 		case kSelectionMessage:
 		{
@@ -126,18 +232,21 @@ MainWindow::MessageReceived(BMessage* message)
 			break;
 
 		case B_LOCALE_CHANGED:
-		{	fSidePanelView->MessageReceived(message);
+		{	// The time zone may have changed, and with it the local days.
+			fEventCache->Invalidate();
+			fSidePanelView->MessageReceived(message);
 			fSidePanelView->SetStartOfWeek(fPreferences->fStartOfWeekOffset);
-			_UpdateDayView();
+			_UpdateMainView();
 			break;
 		}
 
 		case kSynchronizationComplete:
-			_UpdateDayView();
+			_UpdateMainView();
 			break;
 
 		case kAppPreferencesChanged:
 			_SyncWithPreferences();
+			_UpdateMainView();
 			break;
 
 		case kMenuAppPref:
@@ -152,9 +261,64 @@ MainWindow::MessageReceived(BMessage* message)
 			be_app->PostMessage(message);
 			break;
 
+		case kMenuSubscriptions:
+			be_app->PostMessage(message);
+			break;
+
+		case kMenuImportICS:
+		{
+			if (fImportPanel == NULL) {
+				fImportPanel = new BFilePanel(B_OPEN_PANEL,
+					new BMessenger(this), NULL, B_FILE_NODE, false,
+					new BMessage(kImportFileSelected));
+			}
+			fImportPanel->Show();
+			break;
+		}
+
+		case kImportFileSelected:
+		{
+			entry_ref ref;
+			if (message->FindRef("refs", &ref) == B_OK)
+				(new ICSImportWindow(ref, BMessenger(this)))->Show();
+			break;
+		}
+
+		case kICSImportComplete:
+			_UpdateMainView();
+			break;
+
+		case kMenuExportICS:
+			_ShowExportPanel(message);
+			break;
+
+		case kExportFileSelected:
+			_StartExport(message);
+			break;
+
+		case kICSExportComplete:
+		{
+			int32 status = B_ERROR;
+			int32 exported = 0;
+			message->FindInt32("status", &status);
+			message->FindInt32("exported", &exported);
+
+			BString text;
+			if (status == B_OK)
+				text << "Exported " << exported << " events.";
+			else
+				text << "The events could not be exported: " << strerror(status);
+
+			BAlert* alert = new BAlert("Export", text.String(), "OK", NULL,
+				NULL, B_WIDTH_AS_USUAL, status == B_OK ? B_INFO_ALERT
+					: B_WARNING_ALERT);
+			alert->Go(NULL);
+			break;
+		}
+
 		case kRefreshCategoryList:
 		{
-			_UpdateDayView();
+			_UpdateMainView();
 			if (fEventWindow != NULL) {
 				BMessenger msgr(fEventWindow);
 				msgr.SendMessage(message);
@@ -209,7 +373,22 @@ MainWindow::_InitInterface()
 	fAppMenu->AddItem(new BMenuItem("Preferences", new BMessage(kMenuAppPref)));
 	fSyncMenu = new BMenu("Synchronize");
 	fSyncMenu->AddItem(new BMenuItem("Google Calendar", new BMessage(kMenuSyncGCAL)));
+	fSyncMenu->AddItem(new BMenuItem("iCalendar subscriptions" B_UTF8_ELLIPSIS,
+		new BMessage(kMenuSubscriptions)));
 	fAppMenu->AddItem(fSyncMenu);
+	fAppMenu->AddItem(new BMenuItem("Import iCalendar file" B_UTF8_ELLIPSIS,
+		new BMessage(kMenuImportICS)));
+
+	BMessage* exportShown = new BMessage(kMenuExportICS);
+	exportShown->AddBool("shown", true);
+	fExportCategoryMenu = new BMenu("Category");
+	fExportMenu = new BMenu("Export iCalendar file");
+	fExportMenu->AddItem(new BMenuItem("All events" B_UTF8_ELLIPSIS,
+		new BMessage(kMenuExportICS)));
+	fExportMenu->AddItem(new BMenuItem("Shown days" B_UTF8_ELLIPSIS,
+		exportShown));
+	fExportMenu->AddItem(fExportCategoryMenu);
+	fAppMenu->AddItem(fExportMenu);
 	fAppMenu->AddSeparatorItem();
 	fAppMenu->AddItem(new BMenuItem("Quit", new BMessage(kMenuAppQuit), 'Q', B_COMMAND_KEY));
 
@@ -222,7 +401,9 @@ MainWindow::_InitInterface()
 	fCategoryMenu->AddItem(new BMenuItem("Edit categories", new BMessage(kMenuCategoryEdit)));
 	fViewMenu = new BMenu("View");
 	fViewMenu->AddItem(new BMenuItem("Day view", new BMessage(kDayView)));
-	//fViewMenu->AddItem(new BMenuItem("Month view", new BMessage(kMonthView)));
+	fViewMenu->AddItem(new BMenuItem("Week view", new BMessage(kWeekView)));
+	fViewMenu->AddItem(new BMenuItem("Month view", new BMessage(kMonthView)));
+	fViewMenu->AddItem(new BMenuItem("Agenda view", new BMessage(kAgendaView)));
 	fViewMenu->AddSeparatorItem();
 	fViewMenu->AddItem(new BMenuItem("Go to today", new BMessage(kSetCalendarToCurrentDate)));
 
@@ -237,8 +418,12 @@ MainWindow::_InitInterface()
 	fToolBar->AddSeparator();
 	fToolBar->AddAction(new BMessage(kDayView), this, LoadVectorIcon("CALENDAR_ICON"),
 		"Day View", "Day View", true);
-	//fToolBar->AddAction(new BMessage(kMonthView), this, LoadVectorIcon("CALENDAR_ICON"),
-	//	"Month View", "Month View", true);
+	fToolBar->AddAction(new BMessage(kWeekView), this, LoadVectorIcon("CALENDAR_ICON"),
+		"Week View", "Week View", true);
+	fToolBar->AddAction(new BMessage(kMonthView), this, LoadVectorIcon("CALENDAR_ICON"),
+		"Month View", "Month View", true);
+	fToolBar->AddAction(new BMessage(kAgendaView), this, LoadVectorIcon("CALENDAR_ICON"),
+		"Agenda View", "Agenda View", true);
 	fToolBar->AddSeparator();
 	fToolBar->AddAction(new BMessage(kAddEvent), this, LoadVectorIcon("ADD_EVENT"),
 		"Add Event", "Add Event", true);
@@ -246,10 +431,16 @@ MainWindow::_InitInterface()
 
 	fSidePanelView = new SidePanelView();
 	fDayView = new DayView(BDate::CurrentDate(B_LOCAL_TIME));
+	fWeekView = new WeekView(fEventCache);
+	fMonthView = new MonthView(fEventCache);
+	fAgendaView = new AgendaView();
 
-	BLayoutBuilder::Group<>(fMainView, B_VERTICAL, 0.0f)
+	BLayoutBuilder::Cards<>(fMainView)
 		.Add(fDayView)
-	.End();
+		.Add(fWeekView)
+		.Add(fMonthView)
+		.Add(fAgendaView)
+		.SetVisibleItem((int32)0);
 
 	BLayoutBuilder::Group<>(this, B_VERTICAL, 0.0f)
 		.Add(fMenuBar)
@@ -287,6 +478,7 @@ void
 MainWindow::_SetEventListPopUpEnabled(bool state)
 {
 	fDayView->SetEventListPopUpEnabled(state);
+	fAgendaView->SetEventListPopUpEnabled(state);
 }
 
 
@@ -305,18 +497,205 @@ MainWindow::_SyncWithPreferences()
 
 
 void
-MainWindow::_UpdateDayView()
+MainWindow::_UpdateMainView()
 {
 	BDate date = _GetSelectedCalendarDate();
-	fDayView->SetDate(date);
+
+	// Anything still loading is out of date now.
+	fNavigationRequest++;
+
+	// Only the visible view is loaded, the others catch up when shown.
 	LockLooper();
-	fDayView->LoadEvents();
+	switch (fCurrentView) {
+		case kWeekView:
+			fWeekView->SetDate(date, _GetStartOfWeek());
+			fWeekView->LoadEvents();
+			break;
+
+		case kMonthView:
+			fMonthView->SetDate(date, _GetStartOfWeek());
+			fMonthView->LoadEvents();
+			break;
+
+		case kAgendaView:
+			fAgendaView->SetDate(date);
+			fAgendaView->LoadEvents();
+			break;
+
+		default:
+			fDayView->SetDate(date);
+			fDayView->LoadEvents();
+			break;
+	}
 	UnlockLooper();
 }
 
 
+// Shows the selected date right away if its days are cached, otherwise has
+// them loaded off the window thread and shows them once they are in. While
+// the user keeps clicking through dates, only the last one gets loaded.
+void
+MainWindow::_Navigate()
+{
+	// The day and agenda views page through the database themselves.
+	BDate firstDay;
+	int32 dayCount;
+	if (fCurrentView == kDayView || !_GetVisibleRange(firstDay, dayCount)
+		|| fEventCache->Contains(firstDay, dayCount)) {
+		_UpdateMainView();
+		return;
+	}
+
+	fLoader->Load(firstDay, dayCount, ++fNavigationRequest);
+}
+
+
+// Asks where to save the events picked by the export menu item that sent
+// message: all of them, those of the shown days or those of one category.
+void
+MainWindow::_ShowExportPanel(BMessage* message)
+{
+	BMessage panelMessage(kExportFileSelected);
+	panelMessage.AddInt32("start", 0);
+	panelMessage.AddInt32("end", INT_MAX);
+
+	BDate firstDay;
+	int32 dayCount;
+	if (message->GetBool("shown", false)
+		&& _GetVisibleRange(firstDay, dayCount)) {
+		int64 day = DaysFromCivil(firstDay.Year(), firstDay.Month(),
+			firstDay.Day());
+		const ZoneInfo& zone = *ZoneInfo::Local();
+		panelMessage.ReplaceInt32("start", ZonedDayStart(day, zone));
+		panelMessage.ReplaceInt32("end",
+			ZonedDayStart(day + dayCount, zone) - 1);
+	}
+
+	const char* categoryId;
+	if (message->FindString("category", &categoryId) == B_OK)
+		panelMessage.AddString("category", categoryId);
+
+	if (fExportPanel == NULL) {
+		fExportPanel = new BFilePanel(B_SAVE_PANEL, new BMessenger(this),
+			NULL, B_FILE_NODE, false);
+		fExportPanel->SetSaveText("Calendar.ics");
+	}
+	fExportPanel->SetMessage(&panelMessage);
+	fExportPanel->Show();
+}
+
+
+void
+MainWindow::_StartExport(BMessage* message)
+{
+	entry_ref directory;
+	const char* name;
+	if (message->FindRef("directory", &directory) != B_OK
+		|| message->FindString("name", &name) != B_OK)
+		return;
+
+	BPath path(&directory);
+	path.Append(name);
+
+	int32 start = message->GetInt32("start", 0);
+	int32 end = message->GetInt32("end", INT_MAX);
+	const char* categoryId;
+	if (message->FindString("category", &categoryId) != B_OK)
+		categoryId = NULL;
+
+	ICSExporter* exporter = new ICSExporter(path, start, end, categoryId,
+		BMessenger(this));
+	thread_id thread = spawn_thread(_ExportThread, "ICS Export Thread",
+		B_NORMAL_PRIORITY, exporter);
+	if (thread < 0)
+		delete exporter;
+	else
+		resume_thread(thread);
+}
+
+
+int32
+MainWindow::_ExportThread(void* data)
+{
+	ICSExporter* exporter = (ICSExporter*)data;
+	exporter->Run();
+	delete exporter;
+	return 0;
+}
+
+
+// The days the current view shows for the selected date. The agenda isn't
+// backed by the cache and has no such range.
+bool
+MainWindow::_GetVisibleRange(BDate& firstDay, int32& dayCount) const
+{
+	BDate date = _GetSelectedCalendarDate();
+
+	switch (fCurrentView) {
+		case kWeekView:
+			WeekView::GetRange(date, _GetStartOfWeek(), firstDay, dayCount);
+			return true;
+
+		case kMonthView:
+			MonthView::GetRange(date, _GetStartOfWeek(), firstDay, dayCount);
+			return true;
+
+		case kAgendaView:
+			return false;
+
+		default:
+			firstDay = date;
+			dayCount = 1;
+			return true;
+	}
+}
+
+
+void
+MainWindow::_ShowView(int32 view)
+{
+	BCardLayout* layout = (BCardLayout*)fMainView->GetLayout();
+
+	switch (view) {
+		case kWeekView:
+			layout->SetVisibleItem(1);
+			break;
+
+		case kMonthView:
+			layout->SetVisibleItem(2);
+			break;
+
+		case kAgendaView:
+			layout->SetVisibleItem(3);
+			break;
+
+		default:
+			view = kDayView;
+			layout->SetVisibleItem((int32)0);
+			break;
+	}
+
+	fCurrentView = view;
+	_UpdateMainView();
+}
+
+
 BDate
 MainWindow::_GetSelectedCalendarDate() const
 {
 	return fSidePanelView->GetSelectedDate();
 }
+
+
+BWeekday
+MainWindow::_GetStartOfWeek() const
+{
+	// Same mapping from the preference menu index as the calendar widget.
+	BWeekday firstDay;
+	if (fPreferences->fStartOfWeekOffset == 0)
+		BDateFormat().GetStartOfWeek(&firstDay);
+	else
+		firstDay = static_cast<BWeekday>(fPreferences->fStartOfWeekOffset);
+
+	return firstDay;
+}
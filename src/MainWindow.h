@@ -5,19 +5,28 @@
 #ifndef MAIN_WINDOW_H
 #define MAIN_WINDOW_H
 
+#include <DateFormat.h>
 #include <DateTime.h>
 #include <Window.h>
 
 
+class BFilePanel;
 class BMenu;
 class BMenuBar;
+class AgendaView;
 class DayView;
 class Event;
+class EventCache;
+class EventLoader;
+class EventPrefetcher;
 class EventWindow;
 class MainView;
+class MonthView;
 class Preferences;
 class PreferenceWindow;
 class SidePanelView;
+class SQLiteManager;
+class WeekView;
 
 
 namespace BPrivate {
@@ -29,13 +38,16 @@ using BPrivate::BToolBar;
 static const uint32 kMenuAppPref = 'kmap';
 static const uint32 kMenuCategoryEdit = 'kmce';
 static const uint32 kMenuSyncGCAL = 'kmsg';
+static const uint32 kMenuSubscriptions = 'kmsu';
 
 
 class MainWindow: public BWindow {
 public:
 				MainWindow();
+				~MainWindow();
 	virtual void		MessageReceived(BMessage* message);
 	virtual bool		QuitRequested();
+	virtual void		MenusBeginning();
 
 	static void		SetPreferences(Preferences* preferences);
 
@@ -45,16 +57,30 @@ private:
 	void			_InitInterface();
 	void			_LaunchEventManager(Event* event);
 	void			_SyncWithPreferences();
-	void			_UpdateDayView();
+	void			_UpdateMainView();
+	void			_Navigate();
+	bool			_GetVisibleRange(BDate& firstDay,
+						int32& dayCount) const;
+	void			_ShowExportPanel(BMessage* message);
+	void			_StartExport(BMessage* message);
+	static int32		_ExportThread(void* data);
+	void			_ShowView(int32 view);
 	void			_SetEventListPopUpEnabled(bool state);
 	BDate			_GetSelectedCalendarDate() const;
+	BWeekday		_GetStartOfWeek() const;
 
 	static const int	kMenuAppQuit		= 1000;
 	static const int 	kMenuEventEdit 		= 1002;
 	static const int 	kMenuEventDelete	= 1003;
 	static const int 	kAddEvent 		= 1004;
 	static const int 	kDayView 		= 1005;
-	//static const int 	kMonthView		= 1006;
+	static const int 	kMonthView		= 1006;
+	static const int 	kWeekView		= 1007;
+	static const int 	kAgendaView		= 1008;
+	static const int 	kMenuImportICS		= 1009;
+	static const int 	kImportFileSelected	= 1010;
+	static const int 	kMenuExportICS		= 1011;
+	static const int 	kExportFileSelected	= 1012;
 
 
 	static Preferences*	fPreferences;
@@ -67,9 +93,23 @@ private:
 	BMenu*			fCategoryMenu;
 	BMenu*			fViewMenu;
 	BMenu*			fSyncMenu;
+	BMenu*			fExportMenu;
+	BMenu*			fExportCategoryMenu;
 	BToolBar*		fToolBar;
+	BFilePanel*		fImportPanel;
+	BFilePanel*		fExportPanel;
 	SidePanelView*		fSidePanelView;
 	DayView*		fDayView;
+	WeekView*		fWeekView;
+	MonthView*		fMonthView;
+	AgendaView*		fAgendaView;
+	int32			fCurrentView;
+	SQLiteManager*		fDBManager;
+	EventCache*		fEventCache;
+	EventPrefetcher*	fPrefetcher;
+	EventLoader*		fLoader;
+	int32			fNavigationRequest;
+	BDate			fLastDate;
 	thread_id		fNotificationThread;
 };
 
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "MonthView.h"
+
+#include <Window.h>
+
+#include "Category.h"
+#include "Event.h"
+#include "EventCache.h"
+#include "SidePanelView.h"
+
+
+MonthView::MonthView(EventCache* cache)
+	:
+	BView("MonthView", B_WILL_DRAW | B_FRAME_EVENTS | B_FULL_UPDATE_ON_RESIZE),
+	fCache(cache)
+{
+	SetViewUIColor(B_LIST_BACKGROUND_COLOR);
+	SetExplicitMinSize(BSize(260, 260));
+
+	for (int32 i = 0; i < kCells; i++)
+		fBuckets[i] = NULL;
+}
+
+
+MonthView::~MonthView()
+{
+	_ReleaseBuckets();
+}
+
+
+void
+MonthView::SetDate(const BDate& date, BWeekday startOfWeek)
+{
+	fDate = date;
+
+	int32 dayCount;
+	GetRange(date, startOfWeek, fFirstDay, dayCount);
+
+	Invalidate();
+}
+
+
+// The days shown when date is selected. The page starts on the week
+// containing the first day of the month.
+void
+MonthView::GetRange(const BDate& date, BWeekday startOfWeek, BDate& firstDay,
+	int32& dayCount)
+{
+	BDate firstOfMonth(date.Year(), date.Month(), 1);
+	int32 offset = (firstOfMonth.DayOfWeek() - startOfWeek + kDaysInWeek)
+		% kDaysInWeek;
+	firstDay = firstOfMonth;
+	firstDay.AddDays(-offset);
+	dayCount = kCells;
+}
+
+
+void
+MonthView::LoadEvents()
+{
+	// All six weeks come from one range query; days shared with the
+	// previous or next page are reused from the cache.
+	DayEvents* buckets[kCells];
+	fCache->GetRange(fFirstDay, kCells, buckets);
+
+	_ReleaseBuckets();
+	for (int32 i = 0; i < kCells; i++)
+		fBuckets[i] = buckets[i];
+
+	Invalidate();
+}
+
+
+void
+MonthView::Draw(BRect updateRect)
+{
+	SetHighUIColor(B_LIST_BACKGROUND_COLOR);
+	FillRect(updateRect);
+
+	for (int32 cell = 0; cell < kCells; cell++) {
+		BRect frame = _CellFrame(cell);
+		if (frame.Intersects(updateRect))
+			_DrawCell(cell, frame);
+	}
+}
+
+
+void
+MonthView::FrameResized(float width, float height)
+{
+	BView::FrameResized(width, height);
+	Invalidate();
+}
+
+
+void
+MonthView::MouseDown(BPoint where)
+{
+	for (int32 cell = 0; cell < kCells; cell++) {
+		if (!_CellFrame(cell).Contains(where))
+			continue;
+
+		BDate date(fFirstDay);
+		date.AddDays(cell);
+
+		BMessage msg(kSelectionMessage);
+		msg.AddInt32("day", date.Day());
+		msg.AddInt32("month", date.Month());
+		msg.AddInt32("year", date.Year());
+		Window()->PostMessage(&msg);
+		break;
+	}
+}
+
+
+void
+MonthView::_ReleaseBuckets()
+{
+	for (int32 i = 0; i < kCells; i++) {
+		if (fBuckets[i] != NULL)
+			fBuckets[i]->ReleaseReference();
+		fBuckets[i] = NULL;
+	}
+}
+
+
+BRect
+MonthView::_CellFrame(int32 cell) const
+{
+	BRect bounds(Bounds());
+	float width = (bounds.Width() + 1) / kDaysInWeek;
+	float height = (bounds.Height() + 1) / kWeeks;
+
+	int32 column = cell % kDaysInWeek;
+	int32 row = cell / kDaysInWeek;
+
+	return BRect(column * width, row * height, (column + 1) * width - 1,
+		(row + 1) * height - 1);
+}
+
+
+void
+MonthView::_DrawCell(int32 cell, BRect frame)
+{
+	BDate date(fFirstDay);
+	date.AddDays(cell);
+
+	bool selected = date == fDate;
+	bool inMonth = date.Month() == fDate.Month();
+
+	if (selected) {
+		SetHighColor(tint_color(ui_color(B_LIST_SELECTED_BACKGROUND_COLOR),
+			B_LIGHTEN_1_TINT));
+		FillRect(frame);
+	}
+
+	SetHighColor(tint_color(ui_color(B_LIST_BACKGROUND_COLOR),
+		B_DARKEN_1_TINT));
+	StrokeRect(frame);
+
+	font_height fontHeight;
+	GetFontHeight(&fontHeight);
+	float lineHeight = fontHeight.ascent + fontHeight.descent
+		+ fontHeight.leading + 2;
+
+	rgb_color textColor = ui_color(B_LIST_ITEM_TEXT_COLOR);
+	SetHighColor(inMonth ? textColor : tint_color(textColor, 0.5));
+	SetLowColor(selected ? tint_color(ui_color(
+		B_LIST_SELECTED_BACKGROUND_COLOR), B_LIGHTEN_1_TINT)
+		: ui_color(B_LIST_BACKGROUND_COLOR));
+
+	BString day;
+	day << date.Day();
+	DrawString(day.String(), BPoint(frame.left + 4,
+		frame.top + fontHeight.ascent + 2));
+
+	DayEvents* bucket = fBuckets[cell];
+	if (bucket == NULL)
+		return;
+
+	int32 count = bucket->CountEvents();
+	int32 lines = (int32)((frame.Height() - lineHeight - 2) / lineHeight);
+	float y = frame.top + lineHeight + 2;
+
+	for (int32 i = 0; i < count && i < lines; i++) {
+		BString name;
+		if (i == lines - 1 && count > lines)
+			name.SetToFormat("+%d more", (int)(count - i));
+		else
+			name = bucket->EventAt(i)->GetName();
+
+		rgb_color color = bucket->EventAt(i)->GetCategory()->GetColor();
+		BRect dot(frame.left + 4, y + 2, frame.left + 4 + fontHeight.ascent
+			- 4, y + fontHeight.ascent - 2);
+		SetHighColor(color);
+		FillEllipse(dot);
+
+		TruncateString(&name, B_TRUNCATE_END, frame.right - dot.right - 6);
+		SetHighColor(inMonth ? textColor : tint_color(textColor, 0.5));
+		DrawString(name.String(), BPoint(dot.right + 3,
+			y + fontHeight.ascent));
+
+		y += lineHeight;
+	}
+}
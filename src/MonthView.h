@@ -0,0 +1,49 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef MONTHVIEW_H
+#define MONTHVIEW_H
+
+#include <DateFormat.h>
+#include <DateTime.h>
+#include <View.h>
+
+
+class DayEvents;
+class EventCache;
+
+
+class MonthView: public BView {
+public:
+					MonthView(EventCache* cache);
+					~MonthView();
+
+	virtual	void		Draw(BRect updateRect);
+	virtual	void		FrameResized(float width, float height);
+	virtual	void		MouseDown(BPoint where);
+
+		void			SetDate(const BDate& date, BWeekday startOfWeek);
+		void			LoadEvents();
+
+	static	void			GetRange(const BDate& date,
+						BWeekday startOfWeek, BDate& firstDay,
+						int32& dayCount);
+
+private:
+		void			_ReleaseBuckets();
+		BRect			_CellFrame(int32 cell) const;
+		void			_DrawCell(int32 cell, BRect frame);
+
+		static const int32	kWeeks = 6;
+		static const int32	kDaysInWeek = 7;
+		static const int32	kCells = kWeeks * kDaysInWeek;
+
+		EventCache*		fCache;
+		BDate			fDate;
+		BDate			fFirstDay;
+		DayEvents*		fBuckets[kCells];
+};
+
+
+#endif
@@ -0,0 +1,370 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TimelineView.h"
+
+#include <algorithm>
+
+#include <DateFormat.h>
+#include <List.h>
+#include <TimeFormat.h>
+#include <Window.h>
+
+#include "DayView.h"
+#include "Event.h"
+
+
+const float TimelineView::kHourHeight = 40;
+const float TimelineView::kGutterWidth = 50;
+const float TimelineView::kHeaderHeight = 24;
+const float TimelineView::kAllDayRowHeight = 18;
+
+// Short events are laid out and drawn as if they lasted this long, so their
+// label stays readable.
+static const int64_t kMinimumDuration = 30 * 60;
+
+
+TimelineView::TimelineView(const char* name)
+	:
+	BView(name, B_WILL_DRAW | B_FRAME_EVENTS | B_FULL_UPDATE_ON_RESIZE),
+	fFirstDay(BDate::CurrentDate(B_LOCAL_TIME)),
+	fDayCount(0),
+	fSelectedEvent(NULL)
+{
+	SetViewUIColor(B_LIST_BACKGROUND_COLOR);
+	SetRange(fFirstDay, 1);
+}
+
+
+void
+TimelineView::SetRange(const BDate& firstDay, int32 dayCount)
+{
+	fFirstDay = firstDay;
+	fDayCount = dayCount;
+
+	fDayStarts.resize(dayCount + 1);
+	BDate date(firstDay);
+	for (int32 day = 0; day <= dayCount; day++) {
+		fDayStarts[day] = BDateTime(date, BTime(0, 0, 0)).Time_t();
+		date.AddDays(1);
+	}
+
+	ClearEvents();
+}
+
+
+void
+TimelineView::SetEvents(int32 day, BList* events)
+{
+	if (day < 0 || day >= fDayCount)
+		return;
+
+	fDayEvents[day] = events;
+	_LayoutDay(day);
+	Invalidate();
+}
+
+
+void
+TimelineView::ClearEvents()
+{
+	fDayEvents.assign(fDayCount, NULL);
+	fAllDay.assign(fDayCount, std::vector<Event*>());
+	fBlocks.clear();
+	fSelectedEvent = NULL;
+	Invalidate();
+}
+
+
+Event*
+TimelineView::SelectedEvent() const
+{
+	return fSelectedEvent;
+}
+
+
+void
+TimelineView::Draw(BRect updateRect)
+{
+	_DrawGrid(updateRect);
+
+	for (size_t i = 0; i < fBlocks.size(); i++) {
+		if (_BlockFrame(fBlocks[i]).Intersects(updateRect))
+			_DrawBlock(fBlocks[i]);
+	}
+
+	_DrawHeader();
+}
+
+
+void
+TimelineView::FrameResized(float width, float height)
+{
+	BView::FrameResized(width, height);
+	Invalidate();
+}
+
+
+void
+TimelineView::MouseDown(BPoint where)
+{
+	Event* hit = NULL;
+	for (size_t i = 0; i < fBlocks.size(); i++) {
+		if (_BlockFrame(fBlocks[i]).Contains(where)) {
+			hit = fBlocks[i].event;
+			break;
+		}
+	}
+
+	if (hit != fSelectedEvent) {
+		fSelectedEvent = hit;
+		Invalidate();
+	}
+
+	int32 clicks = 1;
+	if (Window()->CurrentMessage() != NULL)
+		Window()->CurrentMessage()->FindInt32("clicks", &clicks);
+
+	if (hit != NULL && clicks == 2) {
+		BMessage msg(kLaunchEventManagerToModify);
+		msg.AddPointer("event", hit);
+		Window()->PostMessage(&msg);
+	}
+}
+
+
+BSize
+TimelineView::MinSize()
+{
+	return BSize(kGutterWidth + 60 * fDayCount, _TimedTop() + 24 * kHourHeight);
+}
+
+
+BSize
+TimelineView::PreferredSize()
+{
+	return MinSize();
+}
+
+
+void
+TimelineView::_LayoutDay(int32 day)
+{
+	for (size_t i = 0; i < fBlocks.size();) {
+		if (fBlocks[i].day == day)
+			fBlocks.erase(fBlocks.begin() + i);
+		else
+			i++;
+	}
+	fAllDay[day].clear();
+
+	BList* events = fDayEvents[day];
+	if (events == NULL)
+		return;
+
+	time_t dayStart = fDayStarts[day];
+	time_t dayEnd = fDayStarts[day + 1];
+
+	std::vector<EventSpan> spans;
+	std::vector<Event*> timed;
+	for (int32 i = 0; i < events->CountItems(); i++) {
+		Event* event = (Event*)events->ItemAt(i);
+		if (event->IsAllDay()) {
+			fAllDay[day].push_back(event);
+			continue;
+		}
+
+		// Events crossing midnight are cut to the part falling on this day.
+		EventSpan span;
+		span.start = std::max((time_t)event->GetStartDateTime(), dayStart);
+		span.end = std::min((time_t)event->GetEndDateTime(), dayEnd);
+		spans.push_back(span);
+		timed.push_back(event);
+	}
+
+	LayoutEvents(spans, kMinimumDuration);
+
+	for (size_t i = 0; i < spans.size(); i++) {
+		Block block;
+		block.event = timed[i];
+		block.day = day;
+		block.span = spans[i];
+		fBlocks.push_back(block);
+	}
+
+	// All day rows take space from the timed area, keep the height in sync.
+	InvalidateLayout();
+}
+
+
+BRect
+TimelineView::_BlockFrame(const Block& block) const
+{
+	float dayWidth = _DayWidth();
+	float columnWidth = dayWidth / block.span.columns;
+	time_t dayStart = fDayStarts[block.day];
+
+	int64_t end = std::max(block.span.end,
+		block.span.start + kMinimumDuration);
+
+	BRect frame;
+	frame.left = kGutterWidth + block.day * dayWidth
+		+ block.span.column * columnWidth;
+	frame.right = frame.left + block.span.span * columnWidth - 2;
+	frame.top = _TimedTop() + (block.span.start - dayStart) * kHourHeight
+		/ 3600;
+	frame.bottom = _TimedTop() + (end - dayStart) * kHourHeight / 3600 - 1;
+	return frame;
+}
+
+
+float
+TimelineView::_DayWidth() const
+{
+	if (fDayCount == 0)
+		return 0;
+	return (Bounds().Width() - kGutterWidth) / fDayCount;
+}
+
+
+float
+TimelineView::_TimedTop() const
+{
+	size_t rows = 0;
+	for (size_t day = 0; day < fAllDay.size(); day++)
+		rows = std::max(rows, fAllDay[day].size());
+	rows = std::min(rows, (size_t)kMaxAllDayRows);
+
+	return kHeaderHeight + rows * kAllDayRowHeight;
+}
+
+
+void
+TimelineView::_DrawGrid(BRect updateRect)
+{
+	SetHighUIColor(B_LIST_BACKGROUND_COLOR);
+	FillRect(updateRect);
+
+	BRect bounds(Bounds());
+	float top = _TimedTop();
+	float dayWidth = _DayWidth();
+
+	rgb_color lineColor = tint_color(ui_color(B_LIST_BACKGROUND_COLOR),
+		B_DARKEN_1_TINT);
+	rgb_color textColor = tint_color(ui_color(B_LIST_ITEM_TEXT_COLOR), 0.6);
+
+	BFont font;
+	GetFont(&font);
+	font_height fontHeight;
+	font.GetHeight(&fontHeight);
+
+	BTimeFormat timeFormat;
+	for (int32 hour = 0; hour < 24; hour++) {
+		float y = top + hour * kHourHeight;
+		if (y > updateRect.bottom || y + kHourHeight < updateRect.top)
+			continue;
+
+		SetHighColor(lineColor);
+		StrokeLine(BPoint(kGutterWidth, y), BPoint(bounds.right, y));
+
+		BString label;
+		timeFormat.Format(label, fDayStarts[0] + hour * 3600,
+			B_SHORT_TIME_FORMAT);
+		SetHighColor(textColor);
+		SetLowUIColor(B_LIST_BACKGROUND_COLOR);
+		DrawString(label.String(), BPoint(4, y + fontHeight.ascent + 2));
+	}
+
+	SetHighColor(lineColor);
+	for (int32 day = 0; day <= fDayCount; day++) {
+		float x = kGutterWidth + day * dayWidth;
+		StrokeLine(BPoint(x, 0), BPoint(x, bounds.bottom));
+	}
+}
+
+
+void
+TimelineView::_DrawHeader()
+{
+	float dayWidth = _DayWidth();
+	float top = _TimedTop();
+
+	BFont font;
+	GetFont(&font);
+	font_height fontHeight;
+	font.GetHeight(&fontHeight);
+
+	rgb_color textColor = ui_color(B_LIST_ITEM_TEXT_COLOR);
+	BDateFormat dateFormat;
+	BDate date(fFirstDay);
+
+	for (int32 day = 0; day < fDayCount; day++) {
+		BRect cell(kGutterWidth + day * dayWidth + 1, 0,
+			kGutterWidth + (day + 1) * dayWidth - 1, kHeaderHeight - 1);
+
+		BString label;
+		dateFormat.GetDayName(date.DayOfWeek(), label, B_SHORT_DATE_FORMAT);
+		label << " " << date.Day();
+		TruncateString(&label, B_TRUNCATE_END, cell.Width() - 4);
+
+		SetHighColor(textColor);
+		DrawString(label.String(), BPoint(cell.left + 4,
+			cell.top + fontHeight.ascent + 4));
+
+		// all day events
+
+		size_t rows = fAllDay[day].size();
+		for (size_t row = 0; row < rows && row < (size_t)kMaxAllDayRows;
+				row++) {
+			Event* event = fAllDay[day][row];
+			BRect frame(cell.left + 1, kHeaderHeight + row * kAllDayRowHeight,
+				cell.right - 1,
+				kHeaderHeight + (row + 1) * kAllDayRowHeight - 2);
+
+			BString name(event->GetName());
+			if (row == kMaxAllDayRows - 1 && rows > (size_t)kMaxAllDayRows)
+				name.SetToFormat("+%d more", (int)(rows - row));
+
+			SetHighColor(event->GetCategory()->GetColor());
+			FillRoundRect(frame, 3, 3);
+			TruncateString(&name, B_TRUNCATE_END, frame.Width() - 6);
+			SetHighColor(textColor);
+			SetLowColor(event->GetCategory()->GetColor());
+			DrawString(name.String(), BPoint(frame.left + 3,
+				frame.top + fontHeight.ascent + 1));
+		}
+
+		date.AddDays(1);
+	}
+
+	SetHighColor(tint_color(ui_color(B_LIST_BACKGROUND_COLOR),
+		B_DARKEN_2_TINT));
+	StrokeLine(BPoint(0, top - 1), BPoint(Bounds().right, top - 1));
+}
+
+
+void
+TimelineView::_DrawBlock(const Block& block)
+{
+	BRect frame = _BlockFrame(block);
+	rgb_color color = block.event->GetCategory()->GetColor();
+	bool selected = block.event == fSelectedEvent;
+
+	SetHighColor(tint_color(color, selected ? B_DARKEN_1_TINT
+		: B_LIGHTEN_1_TINT));
+	FillRoundRect(frame, 3, 3);
+	SetHighColor(tint_color(color, B_DARKEN_2_TINT));
+	StrokeRoundRect(frame, 3, 3);
+
+	font_height fontHeight;
+	GetFontHeight(&fontHeight);
+
+	BString name(block.event->GetName());
+	TruncateString(&name, B_TRUNCATE_END, frame.Width() - 6);
+	SetHighUIColor(B_LIST_ITEM_TEXT_COLOR);
+	SetLowColor(tint_color(color, B_LIGHTEN_1_TINT));
+	DrawString(name.String(), BPoint(frame.left + 3,
+		frame.top + fontHeight.ascent + 2));
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TIMELINEVIEW_H
+#define TIMELINEVIEW_H
+
+
+#include <vector>
+
+#include <DateTime.h>
+#include <View.h>
+
+#include "EventLayout.h"
+
+
+class BList;
+class Event;
+
+
+class TimelineView : public BView {
+public:
+				TimelineView(const char* name);
+
+	virtual void		Draw(BRect updateRect);
+	virtual void		FrameResized(float width, float height);
+	virtual void		MouseDown(BPoint where);
+	virtual BSize		MinSize();
+	virtual BSize		PreferredSize();
+
+	void			SetRange(const BDate& firstDay, int32 dayCount);
+	void			SetEvents(int32 day, BList* events);
+	void			ClearEvents();
+
+	Event*			SelectedEvent() const;
+
+private:
+	struct Block {
+		Event*		event;
+		int32		day;
+		EventSpan	span;
+	};
+
+	void			_LayoutDay(int32 day);
+	BRect			_BlockFrame(const Block& block) const;
+	float			_DayWidth() const;
+	float			_TimedTop() const;
+	void			_DrawGrid(BRect updateRect);
+	void			_DrawHeader();
+	void			_DrawBlock(const Block& block);
+
+	static const float	kHourHeight;
+	static const float	kGutterWidth;
+	static const float	kHeaderHeight;
+	static const float	kAllDayRowHeight;
+	static const int32	kMaxAllDayRows = 3;
+
+	BDate			fFirstDay;
+	int32			fDayCount;
+
+	std::vector<time_t>	fDayStarts;
+	std::vector<BList*>	fDayEvents;
+	std::vector<Block>	fBlocks;
+	std::vector<std::vector<Event*> > fAllDay;
+
+	Event*			fSelectedEvent;
+};
+
+
+#endif // TIMELINEVIEW_H
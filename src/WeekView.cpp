@@ -0,0 +1,98 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "WeekView.h"
+
+#include <LayoutBuilder.h>
+#include <ScrollView.h>
+
+#include "EventCache.h"
+#include "TimelineView.h"
+
+
+WeekView::WeekView(EventCache* cache)
+	:
+	BView("WeekView", B_WILL_DRAW),
+	fCache(cache)
+{
+	for (int32 i = 0; i < kDaysInWeek; i++)
+		fBuckets[i] = NULL;
+
+	fTimelineView = new TimelineView("WeekTimeline");
+	fTimelineScroll = new BScrollView("WeekScroll", fTimelineView,
+		B_WILL_DRAW, false, true);
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL, 0)
+		.Add(fTimelineScroll)
+	.End();
+}
+
+
+WeekView::~WeekView()
+{
+	_ReleaseBuckets();
+}
+
+
+void
+WeekView::SetDate(const BDate& date, BWeekday startOfWeek)
+{
+	BDate firstDay;
+	int32 dayCount;
+	GetRange(date, startOfWeek, firstDay, dayCount);
+
+	if (firstDay != fFirstDay) {
+		fFirstDay = firstDay;
+		fTimelineView->SetRange(fFirstDay, kDaysInWeek);
+	}
+}
+
+
+void
+WeekView::LoadEvents()
+{
+	// The whole week comes from one range query, or straight from the
+	// cache for the days already seen.
+	DayEvents* buckets[kDaysInWeek];
+	fCache->GetRange(fFirstDay, kDaysInWeek, buckets);
+
+	_ReleaseBuckets();
+	fTimelineView->ClearEvents();
+	for (int32 i = 0; i < kDaysInWeek; i++) {
+		fBuckets[i] = buckets[i];
+		fTimelineView->SetEvents(i, fBuckets[i]->Events());
+	}
+}
+
+
+Event*
+WeekView::SelectedEvent() const
+{
+	return fTimelineView->SelectedEvent();
+}
+
+
+// The days shown when date is selected.
+void
+WeekView::GetRange(const BDate& date, BWeekday startOfWeek, BDate& firstDay,
+	int32& dayCount)
+{
+	int32 offset = (date.DayOfWeek() - startOfWeek + kDaysInWeek)
+		% kDaysInWeek;
+	firstDay = date;
+	firstDay.AddDays(-offset);
+	dayCount = kDaysInWeek;
+}
+
+
+void
+WeekView::_ReleaseBuckets()
+{
+	for (int32 i = 0; i < kDaysInWeek; i++) {
+		if (fBuckets[i] != NULL)
+			fBuckets[i]->ReleaseReference();
+		fBuckets[i] = NULL;
+	}
+}
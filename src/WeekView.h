@@ -0,0 +1,46 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef WEEKVIEW_H
+#define WEEKVIEW_H
+
+#include <DateFormat.h>
+#include <DateTime.h>
+#include <View.h>
+
+
+class BScrollView;
+class DayEvents;
+class Event;
+class EventCache;
+class TimelineView;
+
+
+class WeekView: public BView {
+public:
+					WeekView(EventCache* cache);
+					~WeekView();
+
+		void			SetDate(const BDate& date, BWeekday startOfWeek);
+		void			LoadEvents();
+		Event*			SelectedEvent() const;
+
+	static	void			GetRange(const BDate& date,
+						BWeekday startOfWeek, BDate& firstDay,
+						int32& dayCount);
+
+private:
+		void			_ReleaseBuckets();
+
+		static const int32	kDaysInWeek = 7;
+
+		EventCache*		fCache;
+		TimelineView*		fTimelineView;
+		BScrollView*		fTimelineScroll;
+		BDate			fFirstDay;
+		DayEvents*		fBuckets[kDaysInWeek];
+};
+
+
+#endif
@@ -0,0 +1,482 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "EventCache.h"
+
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#include <Autolock.h>
+
+#include "Category.h"
+#include "CivilDate.h"
+#include "Event.h"
+#include "ZoneInfo.h"
+
+
+static int
+CompareEvents(const void* a, const void* b)
+{
+	Event* first = *(Event**)a;
+	Event* second = *(Event**)b;
+
+	if (first->IsAllDay() != second->IsAllDay())
+		return first->IsAllDay() ? -1 : 1;
+	if (first->GetStartDateTime() != second->GetStartDateTime())
+		return first->GetStartDateTime() < second->GetStartDateTime() ? -1 : 1;
+	return 0;
+}
+
+
+DayEvents::DayEvents(int32 day)
+	:
+	fDay(day),
+	fMemorySize(sizeof(DayEvents))
+{
+}
+
+
+DayEvents::~DayEvents()
+{
+	for (int32 i = 0; i < fEvents.CountItems(); i++)
+		delete (Event*)fEvents.ItemAt(i);
+}
+
+
+int32
+DayEvents::Day() const
+{
+	return fDay;
+}
+
+
+int32
+DayEvents::CountEvents() const
+{
+	return fEvents.CountItems();
+}
+
+
+Event*
+DayEvents::EventAt(int32 index) const
+{
+	return (Event*)fEvents.ItemAt(index);
+}
+
+
+BList*
+DayEvents::Events()
+{
+	return &fEvents;
+}
+
+
+// Approximate heap size of the bucket, used against the cache budget.
+size_t
+DayEvents::MemorySize() const
+{
+	return fMemorySize;
+}
+
+
+void
+DayEvents::_AddEvent(Event* event)
+{
+	fEvents.AddItem(event);
+	fMemorySize += sizeof(Event) + sizeof(Category) + sizeof(void*)
+		+ strlen(event->GetName()) + strlen(event->GetPlace())
+		+ strlen(event->GetDescription()) + strlen(event->GetId())
+		+ event->GetCategory()->GetName().Length()
+		+ strlen(event->GetCategory()->GetId());
+}
+
+
+EventCache::EventCache(SQLiteManager* manager, size_t memoryBudget)
+	:
+	fLock("event cache"),
+	fDBManager(manager),
+	fMemoryBudget(memoryBudget),
+	fMemoryUsage(0),
+	fHits(0),
+	fMisses(0)
+{
+	SQLiteManager::AddChangeListener(this);
+}
+
+
+EventCache::~EventCache()
+{
+	SQLiteManager::RemoveChangeListener(this);
+	Invalidate();
+}
+
+
+// Returns the events of date with a reference acquired for the caller.
+DayEvents*
+EventCache::GetDay(const BDate& date)
+{
+	DayEvents* bucket;
+	GetRange(date, 1, &bucket);
+	return bucket;
+}
+
+
+// Fills buckets with the events of dayCount days starting at firstDay, each
+// with a reference acquired for the caller. All days missing from the cache
+// are loaded with one query, and handed out as loaded even if the cache
+// can't keep them all.
+void
+EventCache::GetRange(const BDate& firstDay, int32 dayCount,
+	DayEvents** buckets)
+{
+	int32 firstJulianDay = firstDay.DateToJulianDay();
+	int32 firstMissing;
+	int32 lastMissing;
+
+	fLock.Lock();
+	bool missing = _FindMissing(firstJulianDay, dayCount, firstMissing,
+		lastMissing);
+
+	int32 missingCount = 0;
+	for (int32 i = 0; i < dayCount; i++) {
+		DayMap::iterator entry = fDays.find(firstJulianDay + i);
+		if (entry == fDays.end()) {
+			missingCount++;
+			continue;
+		}
+		if (missing && i >= firstMissing && i <= lastMissing)
+			continue;
+
+		fLRU.splice(fLRU.begin(), fLRU, entry->second.lruPosition);
+		entry->second.bucket->AcquireReference();
+		buckets[i] = entry->second.bucket;
+	}
+	fMisses += missingCount;
+	fHits += dayCount - missingCount;
+	fLock.Unlock();
+
+	if (!missing)
+		return;
+
+	int32 loadCount = lastMissing - firstMissing + 1;
+	if (_Load(fDBManager, firstJulianDay + firstMissing, loadCount,
+			buckets + firstMissing))
+		return;
+
+	// The query failed: hand out empty days without caching them, so the
+	// next call tries again.
+	BAutolock _(fLock);
+	for (int32 i = firstMissing; i <= lastMissing; i++) {
+		DayMap::iterator entry = fDays.find(firstJulianDay + i);
+		if (entry != fDays.end()) {
+			entry->second.bucket->AcquireReference();
+			buckets[i] = entry->second.bucket;
+		} else
+			buckets[i] = new DayEvents(firstJulianDay + i);
+	}
+}
+
+
+// Whether all dayCount days starting at firstDay can be had from GetRange()
+// without a query.
+bool
+EventCache::Contains(const BDate& firstDay, int32 dayCount)
+{
+	BAutolock _(fLock);
+
+	int32 firstMissing;
+	int32 lastMissing;
+	return !_FindMissing(firstDay.DateToJulianDay(), dayCount, firstMissing,
+		lastMissing);
+}
+
+
+// Loads the days missing between firstDay and dayCount days later through
+// manager, without handing out any reference. Meant for background threads.
+// Prefetched days don't count as hits or misses. Returns false if the query
+// failed or was interrupted.
+bool
+EventCache::Prefetch(const BDate& firstDay, int32 dayCount,
+	SQLiteManager* manager)
+{
+	int32 firstJulianDay = firstDay.DateToJulianDay();
+	int32 firstMissing;
+	int32 lastMissing;
+
+	fLock.Lock();
+	bool missing = _FindMissing(firstJulianDay, dayCount, firstMissing,
+		lastMissing);
+	fLock.Unlock();
+
+	if (!missing)
+		return true;
+
+	return _Load(manager, firstJulianDay + firstMissing,
+		lastMissing - firstMissing + 1);
+}
+
+
+// Drops all cached days. Views still holding a bucket keep it alive until
+// they release it.
+void
+EventCache::Invalidate()
+{
+	BAutolock _(fLock);
+
+	while (!fDays.empty())
+		_Remove(fDays.begin());
+	_MarkStale(INT32_MIN, INT32_MAX);
+}
+
+
+// Drops the days an event running from start to end shows up on.
+void
+EventCache::InvalidateRange(time_t start, time_t end)
+{
+	BAutolock _(fLock);
+
+	// An event ending exactly at midnight doesn't show up on the next day.
+	const ZoneInfo& zone = *ZoneInfo::Local();
+	int32 firstDay = ZonedDaysFromTime(start, zone) + kJulianDayOfEpoch;
+	int32 lastDay = ZonedDaysFromTime(end > start ? end - 1 : start, zone)
+		+ kJulianDayOfEpoch;
+
+	DayMap::iterator it = fDays.lower_bound(firstDay);
+	while (it != fDays.end() && it->first <= lastDay) {
+		DayMap::iterator next = it;
+		next++;
+		_Remove(it);
+		it = next;
+	}
+
+	// Loads running right now may have read the rows before the write.
+	_MarkStale(firstDay, lastDay);
+}
+
+
+void
+EventCache::EventsChanged(time_t start, time_t end)
+{
+	InvalidateRange(start, end);
+}
+
+
+void
+EventCache::SetMemoryBudget(size_t budget)
+{
+	BAutolock _(fLock);
+
+	fMemoryBudget = budget;
+	_Evict();
+}
+
+
+size_t
+EventCache::MemoryBudget()
+{
+	BAutolock _(fLock);
+	return fMemoryBudget;
+}
+
+
+size_t
+EventCache::MemoryUsage()
+{
+	BAutolock _(fLock);
+	return fMemoryUsage;
+}
+
+
+// Number of days the views got straight from the cache.
+int64
+EventCache::Hits()
+{
+	BAutolock _(fLock);
+	return fHits;
+}
+
+
+// Number of days the views had to wait for a query for.
+int64
+EventCache::Misses()
+{
+	BAutolock _(fLock);
+	return fMisses;
+}
+
+
+bool
+EventCache::_FindMissing(int32 firstDay, int32 dayCount,
+	int32& firstMissing, int32& lastMissing)
+{
+	firstMissing = -1;
+	lastMissing = -1;
+
+	for (int32 i = 0; i < dayCount; i++) {
+		if (fDays.find(firstDay + i) == fDays.end()) {
+			if (firstMissing < 0)
+				firstMissing = i;
+			lastMissing = i;
+		}
+	}
+
+	return firstMissing >= 0;
+}
+
+
+// Loads dayCount days starting at firstJulianDay into the cache. If buckets
+// isn't NULL, it gets the loaded days with a reference acquired for the
+// caller, whether the cache keeps them or not.
+bool
+EventCache::_Load(SQLiteManager* manager, int32 firstJulianDay,
+	int32 dayCount, DayEvents** buckets)
+{
+	PendingLoad load;
+	load.firstDay = firstJulianDay;
+	load.lastDay = firstJulianDay + dayCount - 1;
+	load.stale = false;
+
+	fLock.Lock();
+	fLoads.push_back(&load);
+	fLock.Unlock();
+
+	std::vector<time_t> dayStarts(dayCount + 1);
+	int64 firstDay = firstJulianDay - kJulianDayOfEpoch;
+	const ZoneInfo& zone = *ZoneInfo::Local();
+	for (int32 i = 0; i <= dayCount; i++)
+		dayStarts[i] = ZonedDayStart(firstDay + i, zone);
+
+	BList* events = manager->GetEventsOfRange(dayStarts[0],
+		dayStarts[dayCount] - 1);
+	if (events == NULL) {
+		BAutolock _(fLock);
+		fLoads.remove(&load);
+		return false;
+	}
+
+	std::vector<DayEvents*> loaded(dayCount);
+	for (int32 i = 0; i < dayCount; i++)
+		loaded[i] = new DayEvents(firstJulianDay + i);
+
+	// The local days the events start on, all at once. The rows come
+	// ordered by start, so the zone is looked up once per transition
+	// rather than once per event.
+	int32 count = events->CountItems();
+	std::vector<int64_t> starts(count);
+	std::vector<int32_t> startDays(count);
+	for (int32 i = 0; i < count; i++)
+		starts[i] = ((Event*)events->ItemAt(i))->GetStartDateTime();
+	zone.DaysFromTimes(starts.data(), startDays.data(), count);
+
+	// Same rule as GetEventsOfDay(): an event belongs to the day it starts
+	// on and to every following day it is still running at midnight.
+	for (int32 i = 0; i < count; i++) {
+		Event* event = (Event*)events->ItemAt(i);
+		time_t start = event->GetStartDateTime();
+		time_t end = event->GetEndDateTime();
+
+		int32 day = std::max<int64>(startDays[i] - firstDay, 0);
+		for (; day < dayCount; day++) {
+			if (start < dayStarts[day] && end <= dayStarts[day])
+				break;
+			loaded[day]->_AddEvent(new Event(*event));
+		}
+
+		delete event;
+	}
+	delete events;
+
+	for (int32 i = 0; i < dayCount; i++)
+		loaded[i]->fEvents.SortItems(CompareEvents);
+
+	// Results read before an invalidation of their days may already be
+	// stale, they are only handed out. Days another thread loaded meanwhile
+	// are kept as they are.
+	BAutolock _(fLock);
+	fLoads.remove(&load);
+	for (int32 i = 0; i < dayCount; i++) {
+		DayMap::iterator entry = fDays.find(firstJulianDay + i);
+		if (entry != fDays.end()) {
+			loaded[i]->ReleaseReference();
+			loaded[i] = entry->second.bucket;
+			if (buckets != NULL)
+				loaded[i]->AcquireReference();
+		} else if (!load.stale) {
+			_Insert(loaded[i]);
+			if (buckets != NULL)
+				loaded[i]->AcquireReference();
+		} else if (buckets == NULL)
+			loaded[i]->ReleaseReference();
+
+		if (buckets != NULL)
+			buckets[i] = loaded[i];
+	}
+
+	// The days asked for stay cached until the next request, even when
+	// they alone are over the budget.
+	if (buckets != NULL)
+		_Evict(load.firstDay, load.lastDay);
+	else
+		_Evict();
+	return true;
+}
+
+
+void
+EventCache::_Insert(DayEvents* bucket)
+{
+	fLRU.push_front(bucket->Day());
+
+	Entry entry;
+	entry.bucket = bucket;
+	entry.lruPosition = fLRU.begin();
+	fDays[bucket->Day()] = entry;
+
+	fMemoryUsage += bucket->MemorySize();
+}
+
+
+void
+EventCache::_Remove(DayMap::iterator entry)
+{
+	fMemoryUsage -= entry->second.bucket->MemorySize();
+	fLRU.erase(entry->second.lruPosition);
+	entry->second.bucket->ReleaseReference();
+	fDays.erase(entry);
+}
+
+
+void
+EventCache::_MarkStale(int32 firstDay, int32 lastDay)
+{
+	std::list<PendingLoad*>::iterator it = fLoads.begin();
+	for (; it != fLoads.end(); it++) {
+		if ((*it)->firstDay <= lastDay && (*it)->lastDay >= firstDay)
+			(*it)->stale = true;
+	}
+}
+
+
+// Drops the least recently used days until the cache is within its budget,
+// other than those from keepFirst to keepLast. The most recently used day
+// always stays, even when it alone is over the budget.
+void
+EventCache::_Evict(int32 keepFirst, int32 keepLast)
+{
+	LRUList::iterator it = fLRU.end();
+	while (fMemoryUsage > fMemoryBudget && fLRU.size() > 1
+		&& it != fLRU.begin()) {
+		it--;
+		int32 day = *it;
+		if (day >= keepFirst && day <= keepLast)
+			continue;
+
+		LRUList::iterator next = it;
+		next++;
+		_Remove(fDays.find(day));
+		it = next;
+	}
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _EVENT_CACHE_H_
+#define _EVENT_CACHE_H_
+
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include <DateTime.h>
+#include <List.h>
+#include <Locker.h>
+#include <Referenceable.h>
+
+#include "SQLiteManager.h"
+
+
+class Event;
+
+
+// The events of one day, in day view order (all day events first, then by
+// start time). A bucket is never modified once it has been handed out, so
+// several views and threads can hold a reference to it at the same time.
+class DayEvents : public BReferenceable {
+public:
+					DayEvents(int32 day);
+					~DayEvents();
+
+		int32		Day() const;
+		int32		CountEvents() const;
+		Event*		EventAt(int32 index) const;
+		BList*		Events();
+		size_t		MemorySize() const;
+
+private:
+		friend class EventCache;
+
+		void		_AddEvent(Event* event);
+
+		int32		fDay;
+		BList		fEvents;
+		size_t		fMemorySize;
+};
+
+
+// Per-day buckets of events, shared by the day, week and month views. Days
+// that aren't cached yet are loaded with a single range query, so paging
+// through weeks or months only fetches the days that weren't seen before.
+//
+// The cache is safe to use from several threads. Queries run outside of the
+// lock, each thread passing its own connection, so a background prefetch
+// never blocks the views. The least recently used days are dropped once the
+// buckets take more than the memory budget. Days are dropped as soon as an
+// event overlapping them is written through any SQLiteManager.
+class EventCache : public EventChangeListener {
+public:
+					EventCache(SQLiteManager* manager,
+						size_t memoryBudget = kDefaultMemoryBudget);
+					~EventCache();
+
+		DayEvents*	GetDay(const BDate& date);
+		void		GetRange(const BDate& firstDay, int32 dayCount,
+						DayEvents** buckets);
+		bool		Contains(const BDate& firstDay, int32 dayCount);
+		bool		Prefetch(const BDate& firstDay, int32 dayCount,
+						SQLiteManager* manager);
+
+		void		Invalidate();
+		void		InvalidateRange(time_t start, time_t end);
+	virtual	void		EventsChanged(time_t start, time_t end);
+
+		void		SetMemoryBudget(size_t budget);
+		size_t		MemoryBudget();
+		size_t		MemoryUsage();
+
+		int64		Hits();
+		int64		Misses();
+
+		static const size_t	kDefaultMemoryBudget = 8 * 1024 * 1024;
+
+private:
+		typedef std::list<int32> LRUList;
+
+		struct Entry {
+			DayEvents*			bucket;
+			LRUList::iterator	lruPosition;
+		};
+
+		typedef std::map<int32, Entry> DayMap;
+
+		// A load running outside of the lock. It turns stale when days it
+		// reads are invalidated before it is done.
+		struct PendingLoad {
+			int32				firstDay;
+			int32				lastDay;
+			bool				stale;
+		};
+
+		bool		_FindMissing(int32 firstDay, int32 dayCount,
+						int32& firstMissing, int32& lastMissing);
+		bool		_Load(SQLiteManager* manager, int32 firstJulianDay,
+						int32 dayCount, DayEvents** buckets = NULL);
+		void		_Insert(DayEvents* bucket);
+		void		_Remove(DayMap::iterator entry);
+		void		_MarkStale(int32 firstDay, int32 lastDay);
+		void		_Evict(int32 keepFirst = 0, int32 keepLast = -1);
+
+		BLocker		fLock;
+		SQLiteManager*	fDBManager;
+		DayMap		fDays;
+		LRUList		fLRU;
+		size_t		fMemoryBudget;
+		size_t		fMemoryUsage;
+		std::list<PendingLoad*>	fLoads;
+		int64		fHits;
+		int64		fMisses;
+};
+
+#endif	// _EVENT_CACHE_H_
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "EventLoader.h"
+
+#include <Autolock.h>
+#include <Message.h>
+
+#include "EventCache.h"
+#include "SQLiteManager.h"
+
+
+EventLoader::EventLoader(EventCache* cache, const BMessenger& target)
+	:
+	fCache(cache),
+	fTarget(target),
+	fLock("event loader"),
+	fQuitting(false),
+	fPending(false),
+	fLoading(false),
+	fDayCount(0),
+	fRequest(0)
+{
+	// Interrupting a query aborts everything running on its connection, so
+	// the loader gets one to itself.
+	fDBManager = new SQLiteManager();
+
+	fRequestSem = create_sem(0, "load requests");
+	fThread = spawn_thread(_LoadThread, "Event Loader Thread",
+		B_NORMAL_PRIORITY, this);
+	if (fThread >= 0)
+		resume_thread(fThread);
+}
+
+
+EventLoader::~EventLoader()
+{
+	fLock.Lock();
+	fQuitting = true;
+	if (fLoading)
+		fDBManager->Interrupt();
+	fLock.Unlock();
+
+	release_sem(fRequestSem);
+	if (fThread >= 0) {
+		status_t result;
+		wait_for_thread(fThread, &result);
+	}
+
+	delete_sem(fRequestSem);
+	delete fDBManager;
+}
+
+
+// Loads dayCount days starting at firstDay, replacing any request that
+// hasn't completed yet.
+void
+EventLoader::Load(const BDate& firstDay, int32 dayCount, int32 request)
+{
+	BAutolock _(fLock);
+
+	fFirstDay = firstDay;
+	fDayCount = dayCount;
+	fRequest = request;
+
+	// The loading flag only changes under the lock, so this can't hit the
+	// query for the request just made.
+	if (fLoading)
+		fDBManager->Interrupt();
+
+	if (!fPending) {
+		fPending = true;
+		release_sem(fRequestSem);
+	}
+}
+
+
+int32
+EventLoader::_LoadThread(void* data)
+{
+	EventLoader* loader = (EventLoader*)data;
+
+	while (acquire_sem(loader->fRequestSem) == B_OK) {
+		loader->fLock.Lock();
+		if (loader->fQuitting) {
+			loader->fLock.Unlock();
+			break;
+		}
+
+		BDate firstDay = loader->fFirstDay;
+		int32 dayCount = loader->fDayCount;
+		int32 request = loader->fRequest;
+		loader->fPending = false;
+		loader->fLoading = true;
+		loader->fLock.Unlock();
+
+		bool loaded = loader->fCache->Prefetch(firstDay, dayCount,
+			loader->fDBManager);
+
+		loader->fLock.Lock();
+		loader->fLoading = false;
+		bool superseded = loader->fPending;
+		loader->fLock.Unlock();
+
+		// An interrupted load always has a newer request pending; the
+		// window only cares about that one.
+		if (loaded && !superseded) {
+			BMessage message(kEventsLoaded);
+			message.AddInt32("request", request);
+			loader->fTarget.SendMessage(&message);
+		}
+	}
+
+	return 0;
+}
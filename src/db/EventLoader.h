@@ -0,0 +1,54 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _EVENT_LOADER_H_
+#define _EVENT_LOADER_H_
+
+
+#include <DateTime.h>
+#include <Locker.h>
+#include <Messenger.h>
+#include <OS.h>
+
+
+class EventCache;
+class SQLiteManager;
+
+
+const uint32 kEventsLoaded = 'kelo';
+
+
+// Loads the days a view is about to show into the event cache on a thread
+// of its own, then sends kEventsLoaded with the "request" number given to
+// Load() to the target. Requests replace each other: when the user skips
+// through dates faster than they load, the query for a date nobody waits
+// for anymore is aborted and only the latest one is loaded.
+class EventLoader {
+public:
+					EventLoader(EventCache* cache,
+						const BMessenger& target);
+					~EventLoader();
+
+		void		Load(const BDate& firstDay, int32 dayCount,
+						int32 request);
+
+private:
+		static	int32	_LoadThread(void* data);
+
+		EventCache*	fCache;
+		SQLiteManager*	fDBManager;
+		BMessenger	fTarget;
+
+		BLocker		fLock;
+		sem_id		fRequestSem;
+		thread_id	fThread;
+		bool		fQuitting;
+		bool		fPending;
+		bool		fLoading;
+		BDate		fFirstDay;
+		int32		fDayCount;
+		int32		fRequest;
+};
+
+#endif	// _EVENT_LOADER_H_
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "EventPrefetcher.h"
+
+#include <Autolock.h>
+
+#include "EventCache.h"
+#include "SQLiteManager.h"
+
+
+EventPrefetcher::EventPrefetcher(EventCache* cache)
+	:
+	fCache(cache),
+	fLock("event prefetcher"),
+	fQuitting(false),
+	fPending(false),
+	fDirection(0)
+{
+	// The thread reads through its own connection, so it never waits on
+	// the one used by the views.
+	fDBManager = new SQLiteManager();
+
+	fRequestSem = create_sem(0, "prefetch requests");
+	fThread = spawn_thread(_PrefetchThread, "Prefetch Thread",
+		B_LOW_PRIORITY, this);
+	if (fThread >= 0)
+		resume_thread(fThread);
+}
+
+
+EventPrefetcher::~EventPrefetcher()
+{
+	fLock.Lock();
+	fQuitting = true;
+	fLock.Unlock();
+
+	release_sem(fRequestSem);
+	if (fThread >= 0) {
+		status_t result;
+		wait_for_thread(fThread, &result);
+	}
+
+	delete_sem(fRequestSem);
+	delete fDBManager;
+}
+
+
+// Tells the prefetcher the views moved to date. A positive direction means
+// the user is going forward in time, a negative one backward.
+void
+EventPrefetcher::Navigate(const BDate& date, int32 direction)
+{
+	BAutolock _(fLock);
+
+	fDate = date;
+	fDirection = direction;
+	if (!fPending) {
+		fPending = true;
+		release_sem(fRequestSem);
+	}
+}
+
+
+int32
+EventPrefetcher::_PrefetchThread(void* data)
+{
+	EventPrefetcher* prefetcher = (EventPrefetcher*)data;
+
+	while (acquire_sem(prefetcher->fRequestSem) == B_OK) {
+		prefetcher->fLock.Lock();
+		if (prefetcher->fQuitting) {
+			prefetcher->fLock.Unlock();
+			break;
+		}
+
+		BDate date = prefetcher->fDate;
+		int32 direction = prefetcher->fDirection;
+		prefetcher->fPending = false;
+		prefetcher->fLock.Unlock();
+
+		prefetcher->_Prefetch(date, direction);
+	}
+
+	return 0;
+}
+
+
+void
+EventPrefetcher::_Prefetch(const BDate& date, int32 direction)
+{
+	// The next few days in the direction of travel and one day behind,
+	// then the adjacent month, widened by a week on both sides so the
+	// month view page is covered too. Each is a single range query.
+	BDate first(date);
+	if (direction >= 0)
+		first.AddDays(-1);
+	else
+		first.AddDays(-kDaysAhead);
+	fCache->Prefetch(first, kDaysAhead + 2, fDBManager);
+
+	BDate month(date.Year(), date.Month(), 1);
+	if (direction >= 0)
+		month.AddMonths(1);
+	else
+		month.AddMonths(-1);
+
+	BDate monthStart(month);
+	monthStart.AddDays(-7);
+	fCache->Prefetch(monthStart, month.DaysInMonth() + 14, fDBManager);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _EVENT_PREFETCHER_H_
+#define _EVENT_PREFETCHER_H_
+
+
+#include <DateTime.h>
+#include <Locker.h>
+#include <OS.h>
+
+
+class EventCache;
+class SQLiteManager;
+
+
+// Loads the days around the one being looked at into the event cache on a
+// background thread, so stepping through days or months is served from the
+// cache. Only the latest navigation is kept, older ones are skipped.
+class EventPrefetcher {
+public:
+					EventPrefetcher(EventCache* cache);
+					~EventPrefetcher();
+
+		void		Navigate(const BDate& date, int32 direction);
+
+private:
+		static	int32	_PrefetchThread(void* data);
+		void		_Prefetch(const BDate& date, int32 direction);
+
+		static const int32	kDaysAhead = 3;
+
+		EventCache*	fCache;
+		SQLiteManager*	fDBManager;
+
+		BLocker		fLock;
+		sem_id		fRequestSem;
+		thread_id	fThread;
+		bool		fQuitting;
+		bool		fPending;
+		BDate		fDate;
+		int32		fDirection;
+};
+
+#endif	// _EVENT_PREFETCHER_H_
@@ -3,10 +3,12 @@
  * All rights reserved. Distributed under the terms of the MIT License.
  */
 
+#include <limits.h>
 #include <stdio.h>
 #include <time.h>
 
 #include <Alert.h>
+#include <Autolock.h>
 #include <Directory.h>
 #include <Entry.h>
 #include <File.h>
@@ -16,27 +18,71 @@
 #include <String.h>
 
 #include "Category.h"
+#include "CivilDate.h"
 #include "Event.h"
 #include "SQLiteManager.h"
+#include "Subscription.h"
+#include "ZoneInfo.h"
 
 
 const char* kDirectoryName	= "Calendar";
 const char* kDatabaseName	= "events.sql";
 
+BLocker SQLiteManager::sListenerLock("event change listeners");
+BList SQLiteManager::sListeners;
+
+// Column list matching _EventFromRow(), for queries joining CATEGORIES.
+static const char* kEventColumns =
+	"EVENTS.ID, EVENTS.NAME, PLACE, DESCRIPTION, ALLDAY, START, END,"
+	" EVENT_NOTIFIED, UPDATED, STATUS, CATEGORIES.ID, CATEGORIES.NAME, COLOR,"
+	" TZID";
+
+// How long a connection waits for another one to be done writing, in ms.
+static const int kBusyTimeout = 10000;
+
+// The column of each EventField, in the order of their flags.
+static const char* kEventFieldColumns[] = {
+	"NAME", "PLACE", "DESCRIPTION", "ALLDAY", "START", "END", "CATEGORY",
+	"EVENT_NOTIFIED", "UPDATED", "STATUS", "TZID"
+};
+
 
 SQLiteManager::SQLiteManager()
+	:
+	fAddEventStmt(NULL),
+	fFindImportedStmt(NULL),
+	fAddImportedStmt(NULL),
+	fInTransaction(false),
+	fChanged(false)
+{
+	_Initialise(NULL);
+}
+
+
+SQLiteManager::SQLiteManager(const char* path)
+	:
+	fAddEventStmt(NULL),
+	fFindImportedStmt(NULL),
+	fAddImportedStmt(NULL),
+	fInTransaction(false),
+	fChanged(false)
 {
-	_Initialise();
+	_Initialise(path);
 }
 
 
 SQLiteManager::~SQLiteManager()
 {
+	if (fInTransaction)
+		RollbackTransaction();
+	sqlite3_finalize(fAddEventStmt);
+	sqlite3_finalize(fFindImportedStmt);
+	sqlite3_finalize(fAddImportedStmt);
 	sqlite3_close(db);
 }
 
 void
-SQLiteManager::_Initialise()
+SQLiteManager::_Initialise(const char* path)
 {
 	BPath databasePath;
 	int rc;
@@ -44,14 +90,18 @@ SQLiteManager::_Initialise()
 	bool exists = true;
 
 
-	find_directory(B_USER_SETTINGS_DIRECTORY, &databasePath);
-	databasePath.Append(kDirectoryName);
-	BDirectory databaseDir(databasePath.Path());
-	if (databaseDir.InitCheck() == B_ENTRY_NOT_FOUND) {
-		databaseDir.CreateDirectory(databasePath.Path(), &databaseDir);
-	}
+	if (path != NULL)
+		fDatabaseFile.SetTo(path);
+	else {
+		find_directory(B_USER_SETTINGS_DIRECTORY, &databasePath);
+		databasePath.Append(kDirectoryName);
+		BDirectory databaseDir(databasePath.Path());
+		if (databaseDir.InitCheck() == B_ENTRY_NOT_FOUND) {
+			databaseDir.CreateDirectory(databasePath.Path(), &databaseDir);
+		}
 
-	fDatabaseFile.SetTo(&databaseDir, kDatabaseName);
+		fDatabaseFile.SetTo(&databaseDir, kDatabaseName);
+	}
 	if (!BEntry(fDatabaseFile.Path()).Exists())
 		exists = false;
 
@@ -66,6 +116,17 @@ SQLiteManager::_Initialise()
 			"OK", NULL, NULL,
 			B_WIDTH_AS_USUAL, B_OFFSET_SPACING, B_WARNING_ALERT);
 			alert->Go();
+	} else {
+		// The views, the prefetcher, imports and the sync each have a
+		// connection of their own. With a write-ahead log, reads don't wait
+		// for a write in progress, and a write waits for the one before it
+		// rather than failing at once.
+		sqlite3_busy_timeout(db, kBusyTimeout);
+		rc = sqlite3_exec(db, "PRAGMA journal_mode=WAL;", 0, 0, &zErrMsg);
+		if (rc != SQLITE_OK) {
+			fprintf(stderr, "SQL error: %s\n", zErrMsg);
+			sqlite3_free(zErrMsg);
+		}
 	}
 
 	if (!exists) {
@@ -73,7 +134,7 @@ SQLiteManager::_Initialise()
 		"CREATE TABLE CATEGORIES(ID TEXT PRIMARY KEY, NAME TEXT NOT NULL UNIQUE, COLOR TEXT NOT NULL UNIQUE);"
 		"CREATE TABLE EVENTS(ID TEXT PRIMARY KEY, NAME TEXT, PLACE TEXT,"
 		"DESCRIPTION TEXT, ALLDAY INTEGER, START INTEGER, END INTEGER, CATEGORY TEXT, EVENT_NOTIFIED INTEGER,"
-		"UPDATED INTEGER, STATUS INTEGER,"
+		"UPDATED INTEGER, STATUS INTEGER, TZID TEXT, HASH INTEGER,"
 		"FOREIGN KEY(CATEGORY) REFERENCES CATEGORIES(ID) ON DELETE RESTRICT);"
 		"INSERT INTO CATEGORIES VALUES('1f1e4ffd-527d-4796-953f-df2e2c600a09', 'Default', '1E90FF');"
 		"INSERT INTO CATEGORIES VALUES('47c30a47-7c79-4d45-883a-8f45b9ddcff4', 'Birthday', 'C25656');"
@@ -92,6 +153,130 @@ SQLiteManager::_Initialise()
 			alert->Go();
 		}
 	}
+
+	// Databases from before events kept their time zone get the column.
+	if (exists && !_HasColumn("EVENTS", "TZID")) {
+		rc = sqlite3_exec(db, "ALTER TABLE EVENTS ADD COLUMN TZID TEXT;", 0, 0,
+			&zErrMsg);
+		if (rc != SQLITE_OK) {
+			fprintf(stderr, "SQL error: %s\n", zErrMsg);
+			sqlite3_free(zErrMsg);
+		}
+	}
+
+	// The hash of the content of each event, so a sync can tell whether an
+	// event it got really changed. Rows from before have none, and are
+	// written once more.
+	if (exists && !_HasColumn("EVENTS", "HASH")) {
+		rc = sqlite3_exec(db, "ALTER TABLE EVENTS ADD COLUMN HASH INTEGER;", 0,
+			0, &zErrMsg);
+		if (rc != SQLITE_OK) {
+			fprintf(stderr, "SQL error: %s\n", zErrMsg);
+			sqlite3_free(zErrMsg);
+		}
+	}
+
+	// Indexes used by the range queries, created on existing databases too.
+	const char* indexes =
+		"DROP INDEX IF EXISTS EVENTS_START_INDEX;"
+		"CREATE INDEX IF NOT EXISTS EVENTS_START_ID_INDEX ON EVENTS(START, ID);"
+		"CREATE INDEX IF NOT EXISTS EVENTS_ALLDAY_START_ID_INDEX"
+		" ON EVENTS(ALLDAY, START, ID);"
+		"CREATE INDEX IF NOT EXISTS EVENTS_DURATION_INDEX"
+		" ON EVENTS(END - START);";
+
+	rc = sqlite3_exec(db, indexes, 0, 0, &zErrMsg);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error: %s\n", zErrMsg);
+		sqlite3_free(zErrMsg);
+	}
+
+	// Subscribed feeds and the hash of each of their events, so a refresh
+	// only writes what changed in the feed.
+	const char* subscriptions =
+		"CREATE TABLE IF NOT EXISTS SUBSCRIPTIONS(ID TEXT PRIMARY KEY,"
+		" NAME TEXT NOT NULL, URL TEXT NOT NULL UNIQUE, CATEGORY TEXT NOT NULL);"
+		"CREATE TABLE IF NOT EXISTS FEED_EVENTS(SUBSCRIPTION TEXT NOT NULL,"
+		" UID TEXT NOT NULL, HASH INTEGER NOT NULL, EVENT TEXT NOT NULL,"
+		" PRIMARY KEY(SUBSCRIPTION, UID)) WITHOUT ROWID;";
+
+	rc = sqlite3_exec(db, subscriptions, 0, 0, &zErrMsg);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error: %s\n", zErrMsg);
+		sqlite3_free(zErrMsg);
+	}
+
+	// The events synced from each Google calendar. Google keeps an event
+	// that is in several calendars under one ID, so the ID is only unique
+	// within its calendar and isn't used as ID either.
+	const char* synced =
+		"CREATE TABLE IF NOT EXISTS SYNCED_EVENTS(CALENDAR TEXT NOT NULL,"
+		" GOOGLE_ID TEXT NOT NULL, EVENT TEXT NOT NULL,"
+		" PRIMARY KEY(CALENDAR, GOOGLE_ID)) WITHOUT ROWID;"
+		"CREATE INDEX IF NOT EXISTS SYNCED_EVENTS_EVENT_INDEX"
+		" ON SYNCED_EVENTS(EVENT);";
+
+	rc = sqlite3_exec(db, synced, 0, 0, &zErrMsg);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error: %s\n", zErrMsg);
+		sqlite3_free(zErrMsg);
+	}
+
+	// The UIDs of the events imported from iCalendar files. A UID is only
+	// unique within its file and can be anything, so it isn't used as ID.
+	const char* imported =
+		"CREATE TABLE IF NOT EXISTS IMPORTED_EVENTS(UID TEXT PRIMARY KEY,"
+		" EVENT TEXT NOT NULL) WITHOUT ROWID;";
+
+	rc = sqlite3_exec(db, imported, 0, 0, &zErrMsg);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error: %s\n", zErrMsg);
+		sqlite3_free(zErrMsg);
+	}
+
+	// Changes made by the user that the sync hasn't pushed yet, one per
+	// event. The category is kept for deletes, whose event may be gone.
+	// FIELDS are the EventField flags of an update, all of them if unknown.
+	const char* outbox =
+		"CREATE TABLE IF NOT EXISTS OUTBOX(EVENT TEXT PRIMARY KEY,"
+		" CATEGORY TEXT NOT NULL, OPERATION INTEGER NOT NULL,"
+		" SEQUENCE INTEGER NOT NULL, ATTEMPTS INTEGER NOT NULL,"
+		" NEXT_ATTEMPT INTEGER NOT NULL, FIELDS INTEGER NOT NULL DEFAULT -1)"
+		" WITHOUT ROWID;";
+
+	rc = sqlite3_exec(db, outbox, 0, 0, &zErrMsg);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error: %s\n", zErrMsg);
+		sqlite3_free(zErrMsg);
+	}
+
+	// Where the sync of each remote calendar stands, written in the same
+	// transactions as the events, so it never gets ahead of them.
+	const char* syncState =
+		"CREATE TABLE IF NOT EXISTS SYNC_STATE(CALENDAR TEXT PRIMARY KEY,"
+		" SYNC_TOKEN TEXT NOT NULL DEFAULT '',"
+		" RESUME_URL TEXT NOT NULL DEFAULT '',"
+		" RESUME_PAGE TEXT NOT NULL DEFAULT '',"
+		" RESUME_BACKFILL INTEGER NOT NULL DEFAULT 0,"
+		" NEEDS_BACKFILL INTEGER NOT NULL DEFAULT 0,"
+		" WINDOW_START INTEGER NOT NULL DEFAULT 0,"
+		" WINDOW_END INTEGER NOT NULL DEFAULT 0,"
+		" HIGH_WATER INTEGER NOT NULL DEFAULT 0) WITHOUT ROWID;";
+
+	rc = sqlite3_exec(db, syncState, 0, 0, &zErrMsg);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error: %s\n", zErrMsg);
+		sqlite3_free(zErrMsg);
+	}
+
+	if (!_HasColumn("OUTBOX", "FIELDS")) {
+		rc = sqlite3_exec(db, "ALTER TABLE OUTBOX ADD COLUMN"
+			" FIELDS INTEGER NOT NULL DEFAULT -1;", 0, 0, &zErrMsg);
+		if (rc != SQLITE_OK) {
+			fprintf(stderr, "SQL error: %s\n", zErrMsg);
+			sqlite3_free(zErrMsg);
+		}
+	}
 }
 
 
@@ -105,15 +290,21 @@ SQLiteManager::AddEvent(Event* event)
 		event->GetEndDateTime()) || (event->GetCategory() == NULL))
 		return false;
 
-	int rc = sqlite3_prepare_v2(db, "INSERT INTO EVENTS VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);"
-		, -1, &stmt, NULL);
+	// The statement is kept around, bulk imports insert through it for
+	// every event.
+	if (fAddEventStmt == NULL) {
+		int rc = sqlite3_prepare_v2(db,
+			"INSERT INTO EVENTS VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);",
+			-1, &fAddEventStmt, NULL);
 
-	if (rc != SQLITE_OK ) {
-		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
-		sqlite3_free(zErrMsg);
-		sqlite3_close(db);
-		return false;
+		if (rc != SQLITE_OK ) {
+			fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+			sqlite3_free(zErrMsg);
+			fAddEventStmt = NULL;
+			return false;
+		}
 	}
+	stmt = fAddEventStmt;
 
 	int allday = (event->IsAllDay())? 1 : 0;
 	int notified = (event->IsNotified())? 1 : 0;
@@ -131,8 +322,11 @@ SQLiteManager::AddEvent(Event* event)
 	sqlite3_bind_int(stmt, 9, notified);
 	sqlite3_bind_int(stmt, 10, event->GetUpdated());
 	sqlite3_bind_int(stmt, 11, status);
+	_BindTimeZone(stmt, 12, event->GetTimeZone());
+	sqlite3_bind_int64(stmt, 13, (sqlite3_int64)event->Hash());
 
-	rc = sqlite3_step(stmt);
+	int rc = sqlite3_step(stmt);
+	sqlite3_reset(stmt);
 
 	if (rc != SQLITE_DONE ) {
 		fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
@@ -140,11 +334,74 @@ SQLiteManager::AddEvent(Event* event)
 		return false;
 	}
 
-	sqlite3_finalize(stmt);
+	_NotifyChange(event);
+	return true;
+}
+
+
+// Imports made before the UIDs were kept apart used them as IDs, those
+// events count as imported too. An imported event the user removed since
+// can be imported again.
+bool
+SQLiteManager::AddImportedEvent(Event* event, const char* uid)
+{
+	if (uid == NULL || uid[0] == '\0')
+		return AddEvent(event);
+
+	// Both statements are kept around, like that of AddEvent().
+	if (fFindImportedStmt == NULL) {
+		int rc = sqlite3_prepare_v2(db,
+			"SELECT EXISTS(SELECT 1 FROM IMPORTED_EVENTS"
+			" JOIN EVENTS ON EVENTS.ID=IMPORTED_EVENTS.EVENT WHERE UID=?1)"
+			" OR EXISTS(SELECT 1 FROM EVENTS WHERE ID=?1);",
+			-1, &fFindImportedStmt, NULL);
+		if (rc != SQLITE_OK) {
+			fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+			fFindImportedStmt = NULL;
+			return false;
+		}
+	}
+	if (fAddImportedStmt == NULL) {
+		int rc = sqlite3_prepare_v2(db,
+			"INSERT OR REPLACE INTO IMPORTED_EVENTS VALUES(?, ?);",
+			-1, &fAddImportedStmt, NULL);
+		if (rc != SQLITE_OK) {
+			fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+			fAddImportedStmt = NULL;
+			return false;
+		}
+	}
+
+	sqlite3_bind_text(fFindImportedStmt, 1, uid, -1, SQLITE_STATIC);
+	int rc = sqlite3_step(fFindImportedStmt);
+	bool imported = rc == SQLITE_ROW
+		&& sqlite3_column_int(fFindImportedStmt, 0) != 0;
+	sqlite3_reset(fFindImportedStmt);
+
+	if (rc != SQLITE_ROW) {
+		fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+	if (imported || !AddEvent(event))
+		return false;
+
+	sqlite3_bind_text(fAddImportedStmt, 1, uid, -1, SQLITE_STATIC);
+	sqlite3_bind_text(fAddImportedStmt, 2, event->GetId(), -1,
+		SQLITE_STATIC);
+	rc = sqlite3_step(fAddImportedStmt);
+	sqlite3_reset(fAddImportedStmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
 	return true;
 }
 
 
+// Only writes the fields changed in newEvent, so that the indexes of the
+// others are left alone. Nothing changed is nothing to write.
 bool
 SQLiteManager::UpdateEvent(Event* event, Event* newEvent)
 {
@@ -155,9 +412,34 @@ SQLiteManager::UpdateEvent(Event* event, Event* newEvent)
 		newEvent->GetEndDateTime()) || (newEvent->GetCategory() == NULL))
 		return false;
 
-	int rc = sqlite3_prepare_v2(db, "UPDATE EVENTS SET NAME=?, PLACE=?, DESCRIPTION=?, \
-		ALLDAY = ?, START=?, END=?, CATEGORY=?, EVENT_NOTIFIED=?, UPDATED=?, STATUS=? WHERE ID=?;",
-		-1, &stmt, NULL);
+	uint32 fields = newEvent->ChangedFields();
+	if (fields == 0)
+		return true;
+
+	// The stored row tells which days the event is leaving, the caller's
+	// copy might be out of date.
+	time_t oldStart;
+	time_t oldEnd;
+	bool existed = _GetEventRange(event->GetId(), oldStart, oldEnd);
+
+	// Parameters keep the numbers of all fields, used or not, followed by
+	// the ID and the hash.
+	BString sql("UPDATE EVENTS SET ");
+	int32 count = sizeof(kEventFieldColumns) / sizeof(kEventFieldColumns[0]);
+	bool first = true;
+	for (int32 i = 0; i < count; i++) {
+		if ((fields & (1 << i)) == 0)
+			continue;
+		if (!first)
+			sql << ", ";
+		sql << kEventFieldColumns[i] << "=?" << i + 1;
+		first = false;
+	}
+	if ((fields & kHashedEventFields) != 0)
+		sql << ", HASH=?" << count + 2;
+	sql << " WHERE ID=?" << count + 1 << ";";
+
+	int rc = sqlite3_prepare_v2(db, sql.String(), -1, &stmt, NULL);
 
 	if (rc != SQLITE_OK ) {
 		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
@@ -181,7 +463,9 @@ SQLiteManager::UpdateEvent(Event* event, Event* newEvent)
 	sqlite3_bind_int(stmt, 8, notified);
 	sqlite3_bind_int(stmt, 9, newEvent->GetUpdated());
 	sqlite3_bind_int(stmt, 10, status);
-	sqlite3_bind_text(stmt, 11, event->GetId(), strlen(event->GetId()), 0);
+	_BindTimeZone(stmt, 11, newEvent->GetTimeZone());
+	sqlite3_bind_text(stmt, 12, event->GetId(), strlen(event->GetId()), 0);
+	sqlite3_bind_int64(stmt, 13, (sqlite3_int64)newEvent->Hash());
 
 	rc = sqlite3_step(stmt);
 	if (rc != SQLITE_DONE ) {
@@ -191,28 +475,36 @@ SQLiteManager::UpdateEvent(Event* event, Event* newEvent)
 	}
 
 	sqlite3_finalize(stmt);
-	return true;;
+
+	if (existed)
+		_NotifyChange(oldStart, oldEnd);
+	_NotifyChange(newEvent);
+	return true;
 }
 
 
 bool
 SQLiteManager::UpdateNotifiedEvent(const char* id)
 {
-	char* zErrMsg = 0;
-	BString sql;
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"UPDATE EVENTS SET EVENT_NOTIFIED=1 WHERE ID=?;", -1, &stmt, NULL);
 
-	sql.SetToFormat("UPDATE EVENTS SET EVENT_NOTIFIED=1 WHERE ID='%s';", id);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
 
-	int rc = sqlite3_exec(db, sql.String(), 0, 0, &zErrMsg);
+	sqlite3_bind_text(stmt, 1, id, -1, SQLITE_STATIC);
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
 
-	if (rc != SQLITE_OK ) {
-		fprintf(stderr, "SQL error: %s\n", zErrMsg);
-		sqlite3_free(zErrMsg);
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
 		return false;
 	}
 
 	return true;
-
 }
 
 
@@ -222,6 +514,10 @@ SQLiteManager::RemoveEvent(Event* event)
 	sqlite3_stmt* stmt;
 	char* zErrMsg = 0;
 
+	time_t start;
+	time_t end;
+	bool existed = _GetEventRange(event->GetId(), start, end);
+
 	int rc = sqlite3_prepare_v2(db, "DELETE FROM EVENTS WHERE ID=?", -1, &stmt, NULL);
 
 	if (rc != SQLITE_OK ) {
@@ -239,6 +535,9 @@ SQLiteManager::RemoveEvent(Event* event)
 	}
 
 	sqlite3_finalize(stmt);
+
+	if (existed)
+		_NotifyChange(start, end);
 	return true;
 }
 
@@ -272,173 +571,148 @@ SQLiteManager::RemoveCancelledEvents()
 }
 
 
-Event*
-SQLiteManager::GetEvent(const char* id)
+bool
+SQLiteManager::AddLocalEvent(Event* event)
 {
-	sqlite3_stmt* stmt;
-	BString sql;
+	if (!BeginTransaction())
+		return false;
 
-	sql.SetToFormat("SELECT * FROM EVENTS WHERE ID = '%s';", id);
+	if (!AddEvent(event) || !_QueueChange(event->GetId(),
+			event->GetCategory()->GetId(), kOutboxInsert, kAllEventFields)) {
+		RollbackTransaction();
+		return false;
+	}
 
-	int rc = sqlite3_prepare_v2(db, sql.String(), -1, &stmt, NULL);
+	return CommitTransaction();
+}
 
-	if (rc != SQLITE_OK) {
-		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
-		return NULL;
+
+// Only the fields changed in newEvent are written and pushed.
+bool
+SQLiteManager::UpdateLocalEvent(Event* event, Event* newEvent)
+{
+	uint32 fields = newEvent->ChangedFields();
+	if (fields == 0)
+		return true;
+
+	if (!BeginTransaction())
+		return false;
+
+	if (!UpdateEvent(event, newEvent) || !_QueueChange(event->GetId(),
+			newEvent->GetCategory()->GetId(), kOutboxUpdate, fields)) {
+		RollbackTransaction();
+		return false;
 	}
 
-	if (rc = sqlite3_step(stmt) == SQLITE_ROW) {
-		const char* uuid = (const char*)sqlite3_column_text(stmt, 0);
-		const char* name = (const char*)sqlite3_column_text(stmt, 1);
-		const char* place = (const char*)sqlite3_column_text(stmt, 2);
-		const char* description = (const char*)sqlite3_column_text(stmt, 3);
-		bool allday = ((int)sqlite3_column_int(stmt, 4))? true : false;
-		time_t start = (time_t)sqlite3_column_int(stmt, 5);
-		time_t end = (time_t)sqlite3_column_int(stmt, 6);
+	return CommitTransaction();
+}
 
-		Category* category = GetCategory((const char*)sqlite3_column_text(stmt, 7));
-		if (category == NULL) {
-			fprintf(stderr, "Error: Received NULL category\n");
-			return NULL;
-		}
 
-		bool notified = ((int)sqlite3_column_int(stmt, 8))? true : false;
-		time_t updated = (time_t)sqlite3_column_int(stmt, 9);
-		bool status = ((int)sqlite3_column_int(stmt, 10))? true : false;
-		Event* event = new Event(name, place, description, allday,
-		start, end, category, notified, updated, status, uuid);
+bool
+SQLiteManager::RemoveLocalEvent(Event* event)
+{
+	Event newEvent(*event);
+	newEvent.ClearChanges();
+	newEvent.SetStatus(false);
+	newEvent.SetUpdated(time(NULL));
 
-		sqlite3_finalize(stmt);
-		return event;
+	if (!BeginTransaction())
+		return false;
+
+	if (!UpdateEvent(event, &newEvent) || !_QueueChange(event->GetId(),
+			event->GetCategory()->GetId(), kOutboxDelete, kAllEventFields)) {
+		RollbackTransaction();
+		return false;
 	}
-	else
-		return NULL;
+
+	return CommitTransaction();
 }
 
 
-BList*
-SQLiteManager::GetEventsOfDay(BDate& date)
+// All pending changes, in the order they were last made.
+bool
+SQLiteManager::GetOutbox(OutboxList& entries)
 {
-	BList* events = new BList();
-
-	BDateTime startOfDay(date, BTime(0, 0, 0));
-	BDateTime endOfDay(date, BTime(23, 59, 59));
+	entries.clear();
 
 	sqlite3_stmt* stmt;
-	int rc = sqlite3_prepare_v2(db, "SELECT * FROM EVENTS WHERE ((START >= ? AND START <= ?) \
-		OR (START < ? AND END > ?)) AND (STATUS=?);", -1, &stmt, NULL);
+	int rc = sqlite3_prepare_v2(db,
+		"SELECT EVENT, CATEGORY, OPERATION, SEQUENCE, ATTEMPTS, NEXT_ATTEMPT,"
+		" FIELDS FROM OUTBOX ORDER BY SEQUENCE;", -1, &stmt, NULL);
 
 	if (rc != SQLITE_OK) {
 		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
-		return events;
+		return false;
 	}
 
-	sqlite3_bind_int(stmt, 1, startOfDay.Time_t());
-	sqlite3_bind_int(stmt, 2, endOfDay.Time_t());
-	sqlite3_bind_int(stmt, 3, startOfDay.Time_t());
-	sqlite3_bind_int(stmt, 4, startOfDay.Time_t());
-	sqlite3_bind_int(stmt, 5, 1);
-
-	while (rc = sqlite3_step(stmt) == SQLITE_ROW) {
-		const char* id = (const char*)sqlite3_column_text(stmt, 0);
-		const char* name = (const char*)sqlite3_column_text(stmt, 1);
-		const char* place = (const char*)sqlite3_column_text(stmt, 2);
-		const char* description = (const char*)sqlite3_column_text(stmt, 3);
-		bool allday = ((int)sqlite3_column_int(stmt, 4))? true : false;
-		time_t start = (time_t)sqlite3_column_int(stmt, 5);
-		time_t end = (time_t)sqlite3_column_int(stmt, 6);
-
-		Category* category = GetCategory((const char*)sqlite3_column_text(stmt, 7));
-		if (category == NULL) {
-			fprintf(stderr, "Error: Received NULL category\n");
-			continue;
-		}
-
-		bool notified = ((int)sqlite3_column_int(stmt, 8))? true : false;
-		time_t updated = (time_t)sqlite3_column_int(stmt, 9);
-		bool status = ((int)sqlite3_column_int(stmt, 10))? true : false;
-		Event* event = new Event(name, place, description, allday,
-		start, end, category, notified, updated, status, id);
-
-		events->AddItem(event);
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		OutboxEntry entry;
+		entry.eventId = (const char*)sqlite3_column_text(stmt, 0);
+		entry.categoryId = (const char*)sqlite3_column_text(stmt, 1);
+		entry.operation = sqlite3_column_int(stmt, 2);
+		entry.sequence = sqlite3_column_int64(stmt, 3);
+		entry.attempts = sqlite3_column_int(stmt, 4);
+		entry.nextAttempt = (time_t)sqlite3_column_int64(stmt, 5);
+		entry.fields = (uint32)sqlite3_column_int(stmt, 6);
+		entries.push_back(entry);
 	}
 
 	sqlite3_finalize(stmt);
-	return events;
+	return rc == SQLITE_DONE;
 }
 
 
-BList*
-SQLiteManager::GetEventsToNotify(BDateTime dateTime)
+// Only if the event didn't change again in the meantime, since then the
+// new change is still to be pushed.
+bool
+SQLiteManager::RemoveOutboxEntry(const OutboxEntry& entry)
 {
-	BList* events = new BList();
 	sqlite3_stmt* stmt;
-
-	time_t timestamp = dateTime.Time_t();
-
-	int rc = sqlite3_prepare_v2(db, "SELECT * FROM EVENTS WHERE EVENT_NOTIFIED = ? AND START < ?\
-		AND STATUS=?;",  -1, &stmt, NULL);
-
+	int rc = sqlite3_prepare_v2(db,
+		"DELETE FROM OUTBOX WHERE EVENT=? AND SEQUENCE=?;", -1, &stmt, NULL);
 
 	if (rc != SQLITE_OK) {
-		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
-		return events;
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
 	}
 
-	sqlite3_bind_int(stmt, 1, 0);
-	sqlite3_bind_int(stmt, 2, timestamp);
-	sqlite3_bind_int(stmt, 3, 1);
-
-	while (rc = sqlite3_step(stmt) == SQLITE_ROW) {
-		const char* id = (const char*)sqlite3_column_text(stmt, 0);
-		const char* name = (const char*)sqlite3_column_text(stmt, 1);
-		const char* place = (const char*)sqlite3_column_text(stmt, 2);
-		const char* description = (const char*)sqlite3_column_text(stmt, 3);
-		bool allday = ((int)sqlite3_column_int(stmt, 4))? true : false;
-		time_t start = (time_t)sqlite3_column_int(stmt, 5);
-		time_t end = (time_t)sqlite3_column_int(stmt, 6);
-
-		Category* category = GetCategory((const char*)sqlite3_column_text(stmt, 7));
-		if (category == NULL) {
-			fprintf(stderr, "Error: Received NULL category\n");
-			continue;
-		}
-
-		bool notified = ((int)sqlite3_column_int(stmt, 8))? true : false;
-		time_t updated = (time_t)sqlite3_column_int(stmt, 9);
-		bool status = ((int)sqlite3_column_int(stmt, 10))? true : false;
+	sqlite3_bind_text(stmt, 1, entry.eventId.String(), -1, SQLITE_STATIC);
+	sqlite3_bind_int64(stmt, 2, entry.sequence);
 
-		Event* event = new Event(name, place, description, allday,
-		start, end, category, notified, updated, status, id);
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
 
-		events->AddItem(event);
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
+		return false;
 	}
 
-	sqlite3_finalize(stmt);
-	return events;
-
+	return true;
 }
 
 
 bool
-SQLiteManager::AddCategory(Category* category)
+SQLiteManager::DeferOutboxEntry(const OutboxEntry& entry, time_t nextAttempt)
 {
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"UPDATE OUTBOX SET ATTEMPTS=ATTEMPTS + 1, NEXT_ATTEMPT=?"
+		" WHERE EVENT=? AND SEQUENCE=?;", -1, &stmt, NULL);
 
-	if (BString(category->GetName()).CountChars() < 3)
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
 		return false;
+	}
 
-	char* zErrMsg = 0;
-	BString sql;
-
-	sql.SetToFormat("INSERT INTO CATEGORIES VALUES('%s', '%s', '%s');",
-		category->GetId(), category->GetName().String(),
-		category->GetHexColor().String());
+	sqlite3_bind_int64(stmt, 1, nextAttempt);
+	sqlite3_bind_text(stmt, 2, entry.eventId.String(), -1, SQLITE_STATIC);
+	sqlite3_bind_int64(stmt, 3, entry.sequence);
 
-	int rc = sqlite3_exec(db, sql.String(), 0, 0, &zErrMsg);
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
 
-	if (rc != SQLITE_OK ) {
-		fprintf(stderr, "SQL error: %s\n", zErrMsg);
-		sqlite3_free(zErrMsg);
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
 		return false;
 	}
 
@@ -446,28 +720,795 @@ SQLiteManager::AddCategory(Category* category)
 }
 
 
+// False if nothing was stored for the calendar yet.
 bool
-SQLiteManager::UpdateCategory(Category* category,
-	Category* newCategory)
+SQLiteManager::GetSyncState(const char* calendar, SyncState& state)
 {
-	if (BString(newCategory->GetName()).CountChars() < 3)
-		return false;
+	state.syncToken = "";
+	state.resumeUrl = "";
+	state.resumePageToken = "";
+	state.resumeBackfill = false;
+	state.needsBackfill = false;
+	state.windowStart = 0;
+	state.windowEnd = 0;
+	state.highWater = 0;
 
-	char* zErrMsg = 0;
-	BString sql;
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"SELECT SYNC_TOKEN, RESUME_URL, RESUME_PAGE, RESUME_BACKFILL,"
+		" NEEDS_BACKFILL, WINDOW_START, WINDOW_END, HIGH_WATER"
+		" FROM SYNC_STATE WHERE CALENDAR=?;", -1, &stmt, NULL);
 
-	sql.SetToFormat("UPDATE CATEGORIES SET NAME='%s', COLOR='%s' WHERE ID='%s';",
-		newCategory->GetName().String(), newCategory->GetHexColor().String(),
-		category->GetId());
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
 
-	int rc = sqlite3_exec(db, sql.String(), 0, 0, &zErrMsg);
+	sqlite3_bind_text(stmt, 1, calendar, -1, SQLITE_STATIC);
+
+	bool found = false;
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		state.syncToken = (const char*)sqlite3_column_text(stmt, 0);
+		state.resumeUrl = (const char*)sqlite3_column_text(stmt, 1);
+		state.resumePageToken = (const char*)sqlite3_column_text(stmt, 2);
+		state.resumeBackfill = sqlite3_column_int(stmt, 3) != 0;
+		state.needsBackfill = sqlite3_column_int(stmt, 4) != 0;
+		state.windowStart = (time_t)sqlite3_column_int64(stmt, 5);
+		state.windowEnd = (time_t)sqlite3_column_int64(stmt, 6);
+		state.highWater = (time_t)sqlite3_column_int64(stmt, 7);
+		found = true;
+	}
 
-	if (rc != SQLITE_OK ) {
-		fprintf(stderr, "SQL error: %s\n", zErrMsg);
-		sqlite3_free(zErrMsg);
+	sqlite3_finalize(stmt);
+	return found;
+}
+
+
+bool
+SQLiteManager::SetSyncState(const char* calendar, const SyncState& state)
+{
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"INSERT OR REPLACE INTO SYNC_STATE VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?);",
+		-1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, calendar, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, state.syncToken.String(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 3, state.resumeUrl.String(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 4, state.resumePageToken.String(), -1,
+		SQLITE_STATIC);
+	sqlite3_bind_int(stmt, 5, state.resumeBackfill ? 1 : 0);
+	sqlite3_bind_int(stmt, 6, state.needsBackfill ? 1 : 0);
+	sqlite3_bind_int64(stmt, 7, state.windowStart);
+	sqlite3_bind_int64(stmt, 8, state.windowEnd);
+	sqlite3_bind_int64(stmt, 9, state.highWater);
+
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	return true;
+}
+
+
+// Only the resume point, the window and the high water mark, which only
+// ever grows; the sync token and the pending backfill stay as they were
+// until the download is complete.
+bool
+SQLiteManager::SetSyncProgress(const char* calendar, const SyncState& state)
+{
+	const char* statements[] = {
+		"INSERT OR IGNORE INTO SYNC_STATE(CALENDAR) VALUES(?1);",
+		"UPDATE SYNC_STATE SET RESUME_URL=?2, RESUME_PAGE=?3,"
+		" RESUME_BACKFILL=?4, WINDOW_START=?5, WINDOW_END=?6,"
+		" HIGH_WATER=MAX(HIGH_WATER, ?7) WHERE CALENDAR=?1;"
+	};
+
+	for (size_t i = 0; i < sizeof(statements) / sizeof(statements[0]); i++) {
+		sqlite3_stmt* stmt;
+		int rc = sqlite3_prepare_v2(db, statements[i], -1, &stmt, NULL);
+		if (rc != SQLITE_OK) {
+			fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+			return false;
+		}
+
+		sqlite3_bind_text(stmt, 1, calendar, -1, SQLITE_STATIC);
+		if (i == 1) {
+			sqlite3_bind_text(stmt, 2, state.resumeUrl.String(), -1,
+				SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 3, state.resumePageToken.String(), -1,
+				SQLITE_STATIC);
+			sqlite3_bind_int(stmt, 4, state.resumeBackfill ? 1 : 0);
+			sqlite3_bind_int64(stmt, 5, state.windowStart);
+			sqlite3_bind_int64(stmt, 6, state.windowEnd);
+			sqlite3_bind_int64(stmt, 7, state.highWater);
+		}
+
+		rc = sqlite3_step(stmt);
+		sqlite3_finalize(stmt);
+		if (rc != SQLITE_DONE) {
+			fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool
+SQLiteManager::GetSyncedEventId(const char* calendar, const char* googleId,
+	BString& eventId)
+{
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"SELECT EVENT FROM SYNCED_EVENTS WHERE CALENDAR=? AND GOOGLE_ID=?;",
+		-1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, calendar, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, googleId, -1, SQLITE_STATIC);
+
+	bool found = false;
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		eventId = (const char*)sqlite3_column_text(stmt, 0);
+		found = true;
+	}
+
+	sqlite3_finalize(stmt);
+	return found;
+}
+
+
+bool
+SQLiteManager::GetGoogleEventId(const char* calendar, const char* eventId,
+	BString& googleId)
+{
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"SELECT GOOGLE_ID FROM SYNCED_EVENTS WHERE CALENDAR=? AND EVENT=?;",
+		-1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, calendar, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, eventId, -1, SQLITE_STATIC);
+
+	bool found = false;
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		googleId = (const char*)sqlite3_column_text(stmt, 0);
+		found = true;
+	}
+
+	sqlite3_finalize(stmt);
+	return found;
+}
+
+
+bool
+SQLiteManager::SetSyncedEvent(const char* calendar, const char* googleId,
+	const char* eventId)
+{
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"INSERT OR REPLACE INTO SYNCED_EVENTS VALUES(?, ?, ?);",
+		-1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, calendar, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, googleId, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 3, eventId, -1, SQLITE_STATIC);
+
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	return true;
+}
+
+
+// Removes the calendar's event along with the record of it. The same
+// event of other calendars stays.
+bool
+SQLiteManager::RemoveSyncedEvent(const char* calendar, const char* googleId,
+	const char* eventId)
+{
+	time_t start;
+	time_t end;
+	bool existed = _GetEventRange(eventId, start, end);
+
+	const char* statements[] = {
+		"DELETE FROM EVENTS WHERE ID=?3;",
+		"DELETE FROM SYNCED_EVENTS WHERE CALENDAR=?1 AND GOOGLE_ID=?2;"
+	};
+
+	for (size_t i = 0; i < sizeof(statements) / sizeof(statements[0]); i++) {
+		sqlite3_stmt* stmt;
+		int rc = sqlite3_prepare_v2(db, statements[i], -1, &stmt, NULL);
+		if (rc != SQLITE_OK) {
+			fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+			return false;
+		}
+
+		sqlite3_bind_text(stmt, 1, calendar, -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 2, googleId, -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 3, eventId, -1, SQLITE_STATIC);
+
+		rc = sqlite3_step(stmt);
+		sqlite3_finalize(stmt);
+		if (rc != SQLITE_DONE) {
+			fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
+			return false;
+		}
+	}
+
+	if (existed)
+		_NotifyChange(start, end);
+	return true;
+}
+
+
+Event*
+SQLiteManager::GetEvent(const char* id)
+{
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db, "SELECT * FROM EVENTS WHERE ID = ?;", -1,
+		&stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return NULL;
+	}
+
+	sqlite3_bind_text(stmt, 1, id, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		const char* uuid = (const char*)sqlite3_column_text(stmt, 0);
+		const char* name = (const char*)sqlite3_column_text(stmt, 1);
+		const char* place = (const char*)sqlite3_column_text(stmt, 2);
+		const char* description = (const char*)sqlite3_column_text(stmt, 3);
+		bool allday = ((int)sqlite3_column_int(stmt, 4))? true : false;
+		time_t start = (time_t)sqlite3_column_int(stmt, 5);
+		time_t end = (time_t)sqlite3_column_int(stmt, 6);
+
+		Category* category = GetCategory((const char*)sqlite3_column_text(stmt, 7));
+		if (category == NULL) {
+			fprintf(stderr, "Error: Received NULL category\n");
+			sqlite3_finalize(stmt);
+			return NULL;
+		}
+
+		bool notified = ((int)sqlite3_column_int(stmt, 8))? true : false;
+		time_t updated = (time_t)sqlite3_column_int(stmt, 9);
+		bool status = ((int)sqlite3_column_int(stmt, 10))? true : false;
+		Event* event = new Event(name, place, description, allday,
+		start, end, category, notified, updated, status, uuid);
+		delete category;
+		event->SetTimeZone((const char*)sqlite3_column_text(stmt, 11));
+
+		sqlite3_finalize(stmt);
+		return event;
+	}
+
+	sqlite3_finalize(stmt);
+	return NULL;
+}
+
+
+// Without loading the event. False if there is none with the ID; a hash of
+// 0 is one not known yet.
+bool
+SQLiteManager::GetEventHash(const char* id, uint64& hash, time_t& updated)
+{
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"SELECT IFNULL(HASH, 0), UPDATED FROM EVENTS WHERE ID=?;", -1, &stmt,
+		NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, id, -1, SQLITE_STATIC);
+
+	bool found = false;
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		hash = (uint64)sqlite3_column_int64(stmt, 0);
+		updated = (time_t)sqlite3_column_int(stmt, 1);
+		found = true;
+	}
+
+	sqlite3_finalize(stmt);
+	return found;
+}
+
+
+BList*
+SQLiteManager::GetEventsOfDay(BDate& date)
+{
+	int64 day = DaysFromCivil(date.Year(), date.Month(), date.Day());
+	const ZoneInfo& zone = *ZoneInfo::Local();
+
+	// Rows come back in display order so the day view doesn't have to sort.
+	BList* events = _GetEventsInRange(ZonedDayStart(day, zone),
+		ZonedDayStart(day + 1, zone) - 1, "ALLDAY DESC, START");
+	return events != NULL ? events : new BList();
+}
+
+
+// Returns the events overlapping [start, end] ordered by start time, or NULL
+// if the query failed or was aborted through Interrupt().
+BList*
+SQLiteManager::GetEventsOfRange(time_t start, time_t end)
+{
+	return _GetEventsInRange(start, end, "START");
+}
+
+
+bool
+SQLiteManager::AddSubscription(Subscription* subscription)
+{
+	if (BString(subscription->GetName()).CountChars() < 3
+		|| BString(subscription->GetUrl()).IsEmpty())
+		return false;
+
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"INSERT INTO SUBSCRIPTIONS VALUES(?, ?, ?, ?);", -1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, subscription->GetId(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, subscription->GetName(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 3, subscription->GetUrl(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 4, subscription->GetCategoryId(), -1,
+		SQLITE_STATIC);
+
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	return true;
+}
+
+
+BList*
+SQLiteManager::GetAllSubscriptions()
+{
+	BList* subscriptions = new BList();
+	sqlite3_stmt* stmt;
+
+	int rc = sqlite3_prepare_v2(db,
+		"SELECT ID, NAME, URL, CATEGORY FROM SUBSCRIPTIONS ORDER BY NAME;",
+		-1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return subscriptions;
+	}
+
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		const char* id = (const char*)sqlite3_column_text(stmt, 0);
+		const char* name = (const char*)sqlite3_column_text(stmt, 1);
+		const char* url = (const char*)sqlite3_column_text(stmt, 2);
+		const char* category = (const char*)sqlite3_column_text(stmt, 3);
+
+		subscriptions->AddItem(new Subscription(name, url, category, id));
+	}
+
+	sqlite3_finalize(stmt);
+	return subscriptions;
+}
+
+
+bool
+SQLiteManager::RemoveSubscription(Subscription* subscription)
+{
+	sqlite3_stmt* stmt;
+	const char* statements[] = {
+		"DELETE FROM EVENTS WHERE ID IN"
+		" (SELECT EVENT FROM FEED_EVENTS WHERE SUBSCRIPTION=?1);",
+		"DELETE FROM FEED_EVENTS WHERE SUBSCRIPTION=?1;",
+		"DELETE FROM SUBSCRIPTIONS WHERE ID=?1;"
+	};
+
+	bool ownTransaction = !fInTransaction;
+	if (ownTransaction && !BeginTransaction())
+		return false;
+
+	for (size_t i = 0; i < sizeof(statements) / sizeof(statements[0]); i++) {
+		int rc = sqlite3_prepare_v2(db, statements[i], -1, &stmt, NULL);
+		if (rc != SQLITE_OK) {
+			fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+			if (ownTransaction)
+				RollbackTransaction();
+			return false;
+		}
+
+		sqlite3_bind_text(stmt, 1, subscription->GetId(), -1, SQLITE_STATIC);
+		rc = sqlite3_step(stmt);
+		sqlite3_finalize(stmt);
+
+		if (rc != SQLITE_DONE) {
+			fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
+			if (ownTransaction)
+				RollbackTransaction();
+			return false;
+		}
+	}
+
+	_NotifyChange(0, INT_MAX);
+
+	if (ownTransaction)
+		return CommitTransaction();
+	return true;
+}
+
+
+bool
+SQLiteManager::GetFeedEntries(const char* subscriptionId,
+	FeedEntryMap& entries)
+{
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"SELECT UID, HASH, EVENT FROM FEED_EVENTS WHERE SUBSCRIPTION=?;",
+		-1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, subscriptionId, -1, SQLITE_STATIC);
+
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		FeedEntry& entry
+			= entries[(const char*)sqlite3_column_text(stmt, 0)];
+		entry.hash = (uint64)sqlite3_column_int64(stmt, 1);
+		entry.eventId = (const char*)sqlite3_column_text(stmt, 2);
+		entry.seen = false;
+	}
+
+	sqlite3_finalize(stmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	return true;
+}
+
+
+// Writes the event, replacing the row with its ID if there is one, and
+// remembers it as the feed's event with that UID.
+bool
+SQLiteManager::SetFeedEvent(const char* subscriptionId, const char* uid,
+	uint64 hash, Event* event)
+{
+	if (event->GetStartDateTime() > event->GetEndDateTime()
+		|| event->GetCategory() == NULL)
+		return false;
+
+	time_t oldStart;
+	time_t oldEnd;
+	bool existed = _GetEventRange(event->GetId(), oldStart, oldEnd);
+
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"INSERT OR REPLACE INTO EVENTS VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?,"
+		" ?, ?);",
+		-1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, event->GetId(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, event->GetName(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 3, event->GetPlace(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 4, event->GetDescription(), -1, SQLITE_STATIC);
+	sqlite3_bind_int(stmt, 5, event->IsAllDay() ? 1 : 0);
+	sqlite3_bind_int(stmt, 6, event->GetStartDateTime());
+	sqlite3_bind_int(stmt, 7, event->GetEndDateTime());
+	sqlite3_bind_text(stmt, 8, event->GetCategory()->GetId(), -1,
+		SQLITE_STATIC);
+	sqlite3_bind_int(stmt, 9, event->IsNotified() ? 1 : 0);
+	sqlite3_bind_int(stmt, 10, event->GetUpdated());
+	sqlite3_bind_int(stmt, 11, event->GetStatus() ? 1 : 0);
+	_BindTimeZone(stmt, 12, event->GetTimeZone());
+	sqlite3_bind_int64(stmt, 13, (sqlite3_int64)event->Hash());
+
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	rc = sqlite3_prepare_v2(db,
+		"INSERT OR REPLACE INTO FEED_EVENTS VALUES(?, ?, ?, ?);",
+		-1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, subscriptionId, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, uid, -1, SQLITE_STATIC);
+	sqlite3_bind_int64(stmt, 3, (sqlite3_int64)hash);
+	sqlite3_bind_text(stmt, 4, event->GetId(), -1, SQLITE_STATIC);
+
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	if (existed)
+		_NotifyChange(oldStart, oldEnd);
+	_NotifyChange(event);
+	return true;
+}
+
+
+bool
+SQLiteManager::RemoveFeedEvent(const char* subscriptionId, const char* uid,
+	const char* eventId)
+{
+	time_t start;
+	time_t end;
+	bool existed = _GetEventRange(eventId, start, end);
+
+	sqlite3_stmt* stmt;
+	const char* statements[] = {
+		"DELETE FROM EVENTS WHERE ID=?3;",
+		"DELETE FROM FEED_EVENTS WHERE SUBSCRIPTION=?1 AND UID=?2;"
+	};
+
+	for (size_t i = 0; i < sizeof(statements) / sizeof(statements[0]); i++) {
+		int rc = sqlite3_prepare_v2(db, statements[i], -1, &stmt, NULL);
+		if (rc != SQLITE_OK) {
+			fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+			return false;
+		}
+
+		sqlite3_bind_text(stmt, 1, subscriptionId, -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 2, uid, -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 3, eventId, -1, SQLITE_STATIC);
+		rc = sqlite3_step(stmt);
+		sqlite3_finalize(stmt);
+
+		if (rc != SQLITE_DONE) {
+			fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
+			return false;
+		}
+	}
+
+	if (existed)
+		_NotifyChange(start, end);
+	return true;
+}
+
+
+// Aborts the query running on this connection, if any. Unlike every other
+// method, this one may be called from another thread than the one using
+// the manager; the aborted query reports a failure.
+void
+SQLiteManager::Interrupt()
+{
+	sqlite3_interrupt(db);
+}
+
+
+// Returns up to count events following the (start, id) cursor in (START, ID)
+// order. Paging with the last row of the previous page as cursor walks
+// EVENTS_START_ID_INDEX directly, so a page deep into the agenda costs the
+// same as the first one, unlike OFFSET. An empty id starts at start itself.
+BList*
+SQLiteManager::GetEventsAfter(time_t start, const char* id, int32 count)
+{
+	return _GetEventsPage(start, id, count, true);
+}
+
+
+// Returns up to count events preceding the (start, id) cursor, in (START, ID)
+// order.
+BList*
+SQLiteManager::GetEventsBefore(time_t start, const char* id, int32 count)
+{
+	BList* events = _GetEventsPage(start, id, count, false);
+
+	// The rows were read backwards from the cursor.
+	int32 last = events->CountItems() - 1;
+	for (int32 i = 0; i < last - i; i++)
+		events->SwapItems(i, last - i);
+
+	return events;
+}
+
+
+// Returns up to count events of the day following cursor, or the first ones
+// if it is NULL, all day events first and then in (START, ID) order. Like
+// GetEventsAfter(), each page seeks to its cursor through
+// EVENTS_ALLDAY_START_ID_INDEX instead of reading the rows before it.
+BList*
+SQLiteManager::GetEventsOfDayAfter(BDate& date, Event* cursor, int32 count)
+{
+	return _GetDayPage(date, cursor, count, true);
+}
+
+
+BList*
+SQLiteManager::GetEventsOfDayBefore(BDate& date, Event* cursor, int32 count)
+{
+	BList* events = _GetDayPage(date, cursor, count, false);
+
+	// The rows were read backwards from the cursor.
+	int32 last = events->CountItems() - 1;
+	for (int32 i = 0; i < last - i; i++)
+		events->SwapItems(i, last - i);
+
+	return events;
+}
+
+
+BList*
+SQLiteManager::GetEventsToNotify(BDateTime dateTime)
+{
+	BList* events = new BList();
+	sqlite3_stmt* stmt;
+
+	time_t timestamp = dateTime.Time_t();
+
+	int rc = sqlite3_prepare_v2(db, "SELECT * FROM EVENTS WHERE EVENT_NOTIFIED = ? AND START < ?\
+		AND STATUS=?;",  -1, &stmt, NULL);
+
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return events;
+	}
+
+	sqlite3_bind_int(stmt, 1, 0);
+	sqlite3_bind_int(stmt, 2, timestamp);
+	sqlite3_bind_int(stmt, 3, 1);
+
+	while (rc = sqlite3_step(stmt) == SQLITE_ROW) {
+		const char* id = (const char*)sqlite3_column_text(stmt, 0);
+		const char* name = (const char*)sqlite3_column_text(stmt, 1);
+		const char* place = (const char*)sqlite3_column_text(stmt, 2);
+		const char* description = (const char*)sqlite3_column_text(stmt, 3);
+		bool allday = ((int)sqlite3_column_int(stmt, 4))? true : false;
+		time_t start = (time_t)sqlite3_column_int(stmt, 5);
+		time_t end = (time_t)sqlite3_column_int(stmt, 6);
+
+		Category* category = GetCategory((const char*)sqlite3_column_text(stmt, 7));
+		if (category == NULL) {
+			fprintf(stderr, "Error: Received NULL category\n");
+			continue;
+		}
+
+		bool notified = ((int)sqlite3_column_int(stmt, 8))? true : false;
+		time_t updated = (time_t)sqlite3_column_int(stmt, 9);
+		bool status = ((int)sqlite3_column_int(stmt, 10))? true : false;
+
+		Event* event = new Event(name, place, description, allday,
+		start, end, category, notified, updated, status, id);
+		delete category;
+		event->SetTimeZone((const char*)sqlite3_column_text(stmt, 11));
+
+		events->AddItem(event);
+	}
+
+	sqlite3_finalize(stmt);
+	return events;
+
+}
+
+
+bool
+SQLiteManager::AddCategory(Category* category)
+{
+	BString name = category->GetName();
+	if (name.CountChars() < 3)
+		return false;
+
+	// Names come from elsewhere too, like the titles of synced calendars.
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"INSERT INTO CATEGORIES VALUES(?, ?, ?);", -1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	BString color = category->GetHexColor();
+	sqlite3_bind_text(stmt, 1, category->GetId(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, name.String(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 3, color.String(), -1, SQLITE_STATIC);
+
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	return true;
+}
+
+
+bool
+SQLiteManager::UpdateCategory(Category* category,
+	Category* newCategory)
+{
+	if (BString(newCategory->GetName()).CountChars() < 3)
+		return false;
+
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"UPDATE CATEGORIES SET NAME=?, COLOR=? WHERE ID=?;", -1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	BString name = newCategory->GetName();
+	BString color = newCategory->GetHexColor();
+	sqlite3_bind_text(stmt, 1, name.String(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, color.String(), -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 3, category->GetId(), -1, SQLITE_STATIC);
+
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
 		return false;
 	}
 
+	// Events carry a copy of their category.
+	_NotifyChange(0, INT_MAX);
 	return true;
 }
 
@@ -476,18 +1517,16 @@ Category*
 SQLiteManager::GetCategory(const char* id)
 {
 	sqlite3_stmt* stmt;
-	BString sql;
-
-	sql.SetToFormat("SELECT * FROM CATEGORIES WHERE ID = '%s';", id);
-
-	int rc = sqlite3_prepare_v2(db, sql.String(), -1, &stmt, NULL);
+	int rc = sqlite3_prepare_v2(db, "SELECT * FROM CATEGORIES WHERE ID = ?;",
+		-1, &stmt, NULL);
 
 	if (rc != SQLITE_OK) {
 		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
 		return NULL;
 	}
 
-	if ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+	sqlite3_bind_text(stmt, 1, id, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
 		const char* uuid = (const char*)sqlite3_column_text(stmt, 0);
 		const char* name = (const char*)sqlite3_column_text(stmt, 1);
 		const char* color = (const char*)sqlite3_column_text(stmt, 2);
@@ -497,8 +1536,8 @@ SQLiteManager::GetCategory(const char* id)
 		return category;
 	}
 
-	else
-		return NULL;
+	sqlite3_finalize(stmt);
+	return NULL;
 }
 
 
@@ -535,18 +1574,511 @@ bool
 SQLiteManager::RemoveCategory(Category* category)
 {
 	char* zErrMsg = 0;
+	int rc = sqlite3_exec(db, "PRAGMA foreign_keys = ON;", 0, 0, &zErrMsg);
+
+	if (rc != SQLITE_OK ) {
+		fprintf(stderr, "SQL error: %s\n", zErrMsg);
+		sqlite3_free(zErrMsg);
+		return false;
+	}
+
+	sqlite3_stmt* stmt;
+	rc = sqlite3_prepare_v2(db, "DELETE FROM CATEGORIES WHERE ID = ?;", -1,
+		&stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, category->GetId(), -1, SQLITE_STATIC);
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	_NotifyChange(0, INT_MAX);
+	return true;
+}
+
+
+// Hands every event overlapping [start, end] to visitor, in start order,
+// straight from the rows as they are read; nothing is kept in memory. Pass
+// 0 and INT_MAX for all events. categoryId restricts the visit to one
+// category.
+bool
+SQLiteManager::VisitEvents(EventRowVisitor* visitor, time_t start,
+	time_t end, const char* categoryId)
+{
+	sqlite3_stmt* stmt;
 	BString sql;
+	sql.SetToFormat("SELECT %s FROM EVENTS JOIN CATEGORIES"
+		" ON EVENTS.CATEGORY = CATEGORIES.ID"
+		" WHERE START <= ?2"
+		" AND START >= ?1 - (SELECT IFNULL(MAX(END - START), 0) FROM EVENTS)"
+		" AND (START >= ?1 OR END > ?1) AND STATUS = 1"
+		" AND (?3 IS NULL OR CATEGORIES.ID = ?3)"
+		" ORDER BY START, EVENTS.ID;",
+		kEventColumns);
+
+	int rc = sqlite3_prepare_v2(db, sql.String(), -1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
 
-	sql.SetToFormat("PRAGMA foreign_keys = ON; DELETE FROM CATEGORIES WHERE ID = '%s';",
-		category->GetId());
+	sqlite3_bind_int(stmt, 1, start);
+	sqlite3_bind_int(stmt, 2, end);
+	if (categoryId != NULL)
+		sqlite3_bind_text(stmt, 3, categoryId, strlen(categoryId), 0);
+
+	EventRow row;
+	bool stopped = false;
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		row.id = (const char*)sqlite3_column_text(stmt, 0);
+		row.name = (const char*)sqlite3_column_text(stmt, 1);
+		row.place = (const char*)sqlite3_column_text(stmt, 2);
+		row.description = (const char*)sqlite3_column_text(stmt, 3);
+		row.allDay = sqlite3_column_int(stmt, 4) != 0;
+		row.start = (time_t)sqlite3_column_int(stmt, 5);
+		row.end = (time_t)sqlite3_column_int(stmt, 6);
+		row.updated = (time_t)sqlite3_column_int(stmt, 8);
+		row.categoryId = (const char*)sqlite3_column_text(stmt, 10);
+		row.categoryName = (const char*)sqlite3_column_text(stmt, 11);
+		row.timeZone = (const char*)sqlite3_column_text(stmt, 13);
+
+		if (!visitor->VisitEvent(row)) {
+			stopped = true;
+			break;
+		}
+	}
 
-	int rc = sqlite3_exec(db, sql, 0, 0, &zErrMsg);
+	sqlite3_finalize(stmt);
 
-	if (rc != SQLITE_OK ) {
+	if (!stopped && rc != SQLITE_DONE) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errstr(rc));
+		return false;
+	}
+
+	return !stopped;
+}
+
+
+Event*
+SQLiteManager::_EventFromRow(sqlite3_stmt* stmt)
+{
+	const char* id = (const char*)sqlite3_column_text(stmt, 0);
+	const char* name = (const char*)sqlite3_column_text(stmt, 1);
+	const char* place = (const char*)sqlite3_column_text(stmt, 2);
+	const char* description = (const char*)sqlite3_column_text(stmt, 3);
+	bool allday = ((int)sqlite3_column_int(stmt, 4))? true : false;
+	time_t start = (time_t)sqlite3_column_int(stmt, 5);
+	time_t end = (time_t)sqlite3_column_int(stmt, 6);
+	bool notified = ((int)sqlite3_column_int(stmt, 7))? true : false;
+	time_t updated = (time_t)sqlite3_column_int(stmt, 8);
+	bool status = ((int)sqlite3_column_int(stmt, 9))? true : false;
+
+	Category category((const char*)sqlite3_column_text(stmt, 11),
+		BString((const char*)sqlite3_column_text(stmt, 12)),
+		(const char*)sqlite3_column_text(stmt, 10));
+
+	Event* event = new Event(name, place, description, allday,
+		start, end, &category, notified, updated, status, id);
+	event->SetTimeZone((const char*)sqlite3_column_text(stmt, 13));
+	return event;
+}
+
+
+BList*
+SQLiteManager::_GetEventsInRange(time_t start, time_t end, const char* order)
+{
+
+	// Events overlapping [start, end]: those starting inside the range and
+	// those starting before it and still running. The lower bound on START,
+	// derived from the longest event through EVENTS_DURATION_INDEX, keeps the
+	// scan over EVENTS_START_ID_INDEX from running back to the first event.
+	// Categories are joined in rather than looked up per row.
+	sqlite3_stmt* stmt;
+	BString sql;
+	sql.SetToFormat("SELECT %s FROM EVENTS JOIN CATEGORIES"
+		" ON EVENTS.CATEGORY = CATEGORIES.ID"
+		" WHERE START <= ?2"
+		" AND START >= ?1 - (SELECT IFNULL(MAX(END - START), 0) FROM EVENTS)"
+		" AND (START >= ?1 OR END > ?1) AND STATUS = 1 ORDER BY %s;",
+		kEventColumns, order);
+
+	int rc = sqlite3_prepare_v2(db, sql.String(), -1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return NULL;
+	}
+
+	sqlite3_bind_int(stmt, 1, start);
+	sqlite3_bind_int(stmt, 2, end);
+
+	BList* events = new BList();
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+		events->AddItem(_EventFromRow(stmt));
+
+	sqlite3_finalize(stmt);
+
+	// A partial result would look like a day without events.
+	if (rc != SQLITE_DONE) {
+		if (rc != SQLITE_INTERRUPT)
+			fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errstr(rc));
+		for (int32 i = 0; i < events->CountItems(); i++)
+			delete (Event*)events->ItemAt(i);
+		delete events;
+		return NULL;
+	}
+
+	return events;
+}
+
+
+BList*
+SQLiteManager::_GetEventsPage(time_t start, const char* id, int32 count,
+	bool forward)
+{
+	BList* events = new BList();
+
+	sqlite3_stmt* stmt;
+	BString sql;
+	if (forward) {
+		sql.SetToFormat("SELECT %s FROM EVENTS JOIN CATEGORIES"
+			" ON EVENTS.CATEGORY = CATEGORIES.ID"
+			" WHERE START >= ?1 AND (START > ?1 OR EVENTS.ID > ?2)"
+			" AND STATUS = 1 ORDER BY START, EVENTS.ID LIMIT ?3;",
+			kEventColumns);
+	} else {
+		sql.SetToFormat("SELECT %s FROM EVENTS JOIN CATEGORIES"
+			" ON EVENTS.CATEGORY = CATEGORIES.ID"
+			" WHERE START <= ?1 AND (START < ?1 OR EVENTS.ID < ?2)"
+			" AND STATUS = 1 ORDER BY START DESC, EVENTS.ID DESC LIMIT ?3;",
+			kEventColumns);
+	}
+
+	int rc = sqlite3_prepare_v2(db, sql.String(), -1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return events;
+	}
+
+	sqlite3_bind_int(stmt, 1, start);
+	sqlite3_bind_text(stmt, 2, id, strlen(id), 0);
+	sqlite3_bind_int(stmt, 3, count);
+
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+		events->AddItem(_EventFromRow(stmt));
+
+	sqlite3_finalize(stmt);
+	return events;
+}
+
+
+// The all day events and the others are two runs of the index, a page
+// read from one goes on into the other. Without a cursor, the bounds of
+// the keyset condition are beyond any time and let every row of the run
+// through.
+BList*
+SQLiteManager::_GetDayPage(BDate& date, Event* cursor, int32 count,
+	bool forward)
+{
+	BList* events = new BList();
+
+	int64 day = DaysFromCivil(date.Year(), date.Month(), date.Day());
+	const ZoneInfo& zone = *ZoneInfo::Local();
+	time_t dayStart = ZonedDayStart(day, zone);
+	time_t dayEnd = ZonedDayStart(day + 1, zone) - 1;
+
+	// Same days as _GetEventsInRange(), with the cursor as the bound on
+	// START on the side the page is read towards.
+	sqlite3_stmt* stmt;
+	BString sql;
+	if (forward) {
+		sql.SetToFormat("SELECT %s FROM EVENTS JOIN CATEGORIES"
+			" ON EVENTS.CATEGORY = CATEGORIES.ID"
+			" WHERE ALLDAY = ?1 AND START <= ?3 AND START >= MAX(?4,"
+			" ?2 - (SELECT IFNULL(MAX(END - START), 0) FROM EVENTS))"
+			" AND (START > ?4 OR EVENTS.ID > ?5)"
+			" AND (START >= ?2 OR END > ?2) AND STATUS = 1"
+			" ORDER BY START, EVENTS.ID LIMIT ?6;", kEventColumns);
+	} else {
+		sql.SetToFormat("SELECT %s FROM EVENTS JOIN CATEGORIES"
+			" ON EVENTS.CATEGORY = CATEGORIES.ID"
+			" WHERE ALLDAY = ?1 AND START <= MIN(?4, ?3) AND START >="
+			" ?2 - (SELECT IFNULL(MAX(END - START), 0) FROM EVENTS)"
+			" AND (START < ?4 OR EVENTS.ID < ?5)"
+			" AND (START >= ?2 OR END > ?2) AND STATUS = 1"
+			" ORDER BY START DESC, EVENTS.ID DESC LIMIT ?6;", kEventColumns);
+	}
+
+	int rc = sqlite3_prepare_v2(db, sql.String(), -1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return events;
+	}
+
+	bool reached = cursor == NULL;
+	for (int32 run = 0; run < 2 && events->CountItems() < count; run++) {
+		bool allDay = forward ? run == 0 : run == 1;
+		bool atCursor = !reached && cursor->IsAllDay() == allDay;
+		if (!reached && !atCursor)
+			continue;
+		reached = true;
+
+		sqlite3_bind_int(stmt, 1, allDay ? 1 : 0);
+		sqlite3_bind_int(stmt, 2, dayStart);
+		sqlite3_bind_int(stmt, 3, dayEnd);
+		if (atCursor) {
+			sqlite3_bind_int(stmt, 4, cursor->GetStartDateTime());
+			sqlite3_bind_text(stmt, 5, cursor->GetId(), -1, SQLITE_STATIC);
+		} else {
+			sqlite3_bind_int64(stmt, 4, forward ? LLONG_MIN : LLONG_MAX);
+			sqlite3_bind_text(stmt, 5, "", -1, SQLITE_STATIC);
+		}
+		sqlite3_bind_int(stmt, 6, count - events->CountItems());
+
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+			events->AddItem(_EventFromRow(stmt));
+		sqlite3_reset(stmt);
+	}
+
+	sqlite3_finalize(stmt);
+	return events;
+}
+
+
+void
+SQLiteManager::AddChangeListener(EventChangeListener* listener)
+{
+	BAutolock _(sListenerLock);
+	sListeners.AddItem(listener);
+}
+
+
+void
+SQLiteManager::RemoveChangeListener(EventChangeListener* listener)
+{
+	BAutolock _(sListenerLock);
+	sListeners.RemoveItem(listener);
+}
+
+
+// Starts a transaction holding all writes until CommitTransaction(), which
+// makes a bulk import one write to disk rather than one per event. Changes
+// are reported to the listeners once, when committing.
+bool
+SQLiteManager::BeginTransaction()
+{
+	char* zErrMsg = 0;
+
+	// Takes the write lock right away: a transaction that only asks for it
+	// on its first write can't wait for it, and fails if another
+	// connection wrote since it began reading.
+	int rc = sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", 0, 0, &zErrMsg);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error: %s\n", zErrMsg);
+		sqlite3_free(zErrMsg);
+		return false;
+	}
+
+	fInTransaction = true;
+	fChanged = false;
+	return true;
+}
+
+
+bool
+SQLiteManager::CommitTransaction()
+{
+	char* zErrMsg = 0;
+
+	int rc = sqlite3_exec(db, "COMMIT;", 0, 0, &zErrMsg);
+	if (rc != SQLITE_OK) {
 		fprintf(stderr, "SQL error: %s\n", zErrMsg);
 		sqlite3_free(zErrMsg);
+		RollbackTransaction();
+		return false;
+	}
+
+	fInTransaction = false;
+	if (fChanged)
+		_BroadcastChange(fChangedStart, fChangedEnd);
+	return true;
+}
+
+
+void
+SQLiteManager::RollbackTransaction()
+{
+	sqlite3_exec(db, "ROLLBACK;", 0, 0, NULL);
+	fInTransaction = false;
+}
+
+
+// Coalesces the change with the one pending for the event, if any: an
+// insert stays an insert until it was pushed, and a delete wins over
+// everything. Deleting an event that never reached the server is still
+// pushed, the insert may already be on its way.
+bool
+SQLiteManager::_QueueChange(const char* id, const char* categoryId,
+	OutboxOperation operation, uint32 fields)
+{
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db,
+		"SELECT OPERATION, FIELDS FROM OUTBOX WHERE EVENT=?;", -1, &stmt,
+		NULL);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, id, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		int32 pending = sqlite3_column_int(stmt, 0);
+		if (pending == kOutboxDelete && operation == kOutboxUpdate) {
+			sqlite3_finalize(stmt);
+			return true;
+		}
+
+		if (pending == kOutboxInsert && operation == kOutboxUpdate)
+			operation = kOutboxInsert;
+		else if (pending == kOutboxDelete && operation == kOutboxInsert)
+			operation = kOutboxUpdate;
+
+		// Updates add up, the one pending may not have been pushed.
+		if (pending == kOutboxUpdate && operation == kOutboxUpdate)
+			fields |= (uint32)sqlite3_column_int(stmt, 1);
+	}
+	sqlite3_finalize(stmt);
+
+	rc = sqlite3_prepare_v2(db,
+		"INSERT OR REPLACE INTO OUTBOX(EVENT, CATEGORY, OPERATION, SEQUENCE,"
+		" ATTEMPTS, NEXT_ATTEMPT, FIELDS) VALUES(?, ?, ?,"
+		" (SELECT IFNULL(MAX(SEQUENCE), 0) + 1 FROM OUTBOX), 0, 0, ?);",
+		-1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error in prepare: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, id, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, categoryId, -1, SQLITE_STATIC);
+	sqlite3_bind_int(stmt, 3, operation);
+	sqlite3_bind_int(stmt, 4, (int)fields);
+
+	rc = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	if (rc != SQLITE_DONE) {
+		fprintf(stderr, "SQL error in commit: %s\n", sqlite3_errmsg(db));
 		return false;
 	}
 
 	return true;
 }
+
+
+void
+SQLiteManager::_NotifyChange(time_t start, time_t end)
+{
+	if (!fInTransaction) {
+		_BroadcastChange(start, end);
+		return;
+	}
+
+	// Other connections only see the writes once they are committed, and
+	// until then the range of all of them is enough.
+	if (!fChanged || start < fChangedStart)
+		fChangedStart = start;
+	if (!fChanged || end > fChangedEnd)
+		fChangedEnd = end;
+	fChanged = true;
+}
+
+
+void
+SQLiteManager::_BroadcastChange(time_t start, time_t end)
+{
+	BAutolock _(sListenerLock);
+	for (int32 i = 0; i < sListeners.CountItems(); i++)
+		((EventChangeListener*)sListeners.ItemAt(i))->EventsChanged(start, end);
+}
+
+
+void
+SQLiteManager::_NotifyChange(Event* event)
+{
+	_NotifyChange(event->GetStartDateTime(), event->GetEndDateTime());
+}
+
+
+bool
+SQLiteManager::_GetEventRange(const char* id, time_t& start, time_t& end)
+{
+	sqlite3_stmt* stmt;
+	int rc = sqlite3_prepare_v2(db, "SELECT START, END FROM EVENTS WHERE ID=?;",
+		-1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	sqlite3_bind_text(stmt, 1, id, strlen(id), 0);
+
+	bool found = false;
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		start = (time_t)sqlite3_column_int(stmt, 0);
+		end = (time_t)sqlite3_column_int(stmt, 1);
+		found = true;
+	}
+
+	sqlite3_finalize(stmt);
+	return found;
+}
+
+
+bool
+SQLiteManager::_HasColumn(const char* table, const char* column)
+{
+	sqlite3_stmt* stmt;
+	BString sql;
+	sql.SetToFormat("PRAGMA table_info(%s);", table);
+
+	int rc = sqlite3_prepare_v2(db, sql.String(), -1, &stmt, NULL);
+
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to fetch data: %s\n", sqlite3_errmsg(db));
+		return false;
+	}
+
+	bool found = false;
+	while (!found && sqlite3_step(stmt) == SQLITE_ROW) {
+		const char* name = (const char*)sqlite3_column_text(stmt, 1);
+		found = name != NULL && strcasecmp(name, column) == 0;
+	}
+
+	sqlite3_finalize(stmt);
+	return found;
+}
+
+
+// Events without a zone, floating and all day ones, store NULL.
+void
+SQLiteManager::_BindTimeZone(sqlite3_stmt* stmt, int index,
+	const char* timeZone)
+{
+	if (timeZone == NULL || timeZone[0] == '\0')
+		sqlite3_bind_null(stmt, index);
+	else
+		sqlite3_bind_text(stmt, index, timeZone, -1, SQLITE_STATIC);
+}
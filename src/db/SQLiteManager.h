@@ -6,13 +6,107 @@
 #define _SQLITE_MANAGER_H_
 
 
+#include <map>
+#include <vector>
+
 #include <DateTime.h>
+#include <List.h>
+#include <Locker.h>
 #include <Path.h>
+#include <String.h>
 #include <sqlite3.h>
 
 
 class Category;
 class Event;
+class Subscription;
+
+
+// Receives the time ranges touched by event writes made through any
+// SQLiteManager of the application, from whichever thread made the write.
+// A category change affects all events and is reported as the full range.
+class EventChangeListener {
+public:
+	virtual				~EventChangeListener() {}
+	virtual	void		EventsChanged(time_t start, time_t end) = 0;
+};
+
+
+// The columns of one event, as handed to an EventRowVisitor. The strings
+// are only valid during the call.
+struct EventRow {
+	const char*	id;
+	const char*	name;
+	const char*	place;
+	const char*	description;
+	bool		allDay;
+	time_t		start;
+	time_t		end;
+	time_t		updated;
+	const char*	categoryId;
+	const char*	categoryName;
+	const char*	timeZone;
+};
+
+
+class EventRowVisitor {
+public:
+	virtual				~EventRowVisitor() {}
+
+	// Returning false stops the visit.
+	virtual	bool		VisitEvent(const EventRow& row) = 0;
+};
+
+
+// What is stored about one event of a subscribed feed: the hash of its
+// content when it was last written, and the ID of its row in EVENTS.
+struct FeedEntry {
+	uint64		hash;
+	BString		eventId;
+	bool		seen;
+};
+
+// Feed entries by UID.
+typedef std::map<BString, FeedEntry> FeedEntryMap;
+
+
+// A change the user made to an event, waiting in the outbox to be pushed to
+// the calendar the event came from. Changes of an event are coalesced into
+// one entry, with a new sequence number each time.
+enum OutboxOperation {
+	kOutboxInsert = 0,
+	kOutboxUpdate,
+	kOutboxDelete
+};
+
+
+struct OutboxEntry {
+	BString		eventId;
+	BString		categoryId;
+	int32		operation;
+	int64		sequence;
+	int32		attempts;
+	time_t		nextAttempt;
+	uint32		fields;		// EventField flags changed by an update
+};
+
+typedef std::vector<OutboxEntry> OutboxList;
+
+
+// What the sync of a remote calendar committed so far. The resume point is
+// where a download that was interrupted goes on, written along with each
+// page of events. The window is that of the last full sync, which a pending
+// backfill completes.
+struct SyncState {
+	BString		syncToken;
+	BString		resumeUrl;
+	BString		resumePageToken;
+	bool		resumeBackfill;
+	bool		needsBackfill;
+	time_t		windowStart;
+	time_t		windowEnd;
+	time_t		highWater;		// newest update of a committed event
+};
 
 
 extern const char* kDirectoryName;
@@ -22,18 +116,69 @@ extern const char* kDatabaseName;
 class SQLiteManager {
 public:
 					SQLiteManager();
+					// Opens the database at path rather than the one in
+					// the settings, for tests.
+					SQLiteManager(const char* path);
 					~SQLiteManager();
 
 		bool		AddEvent(Event* event);
+		// Adds an event of an iCalendar file, with an ID of its own. The
+		// file's UID is kept apart, and an event whose UID was imported
+		// before isn't added again.
+		bool		AddImportedEvent(Event* event, const char* uid);
 		bool		UpdateEvent(Event* event, Event* newEvent);
 		bool		UpdateNotifiedEvent(const char* id);
 
 		Event*		GetEvent(const char* id);
+		bool		GetEventHash(const char* id, uint64& hash,
+						time_t& updated);
 		BList*		GetEventsOfDay(BDate& date);
+		BList*		GetEventsOfRange(time_t start, time_t end);
+		BList*		GetEventsAfter(time_t start, const char* id,
+						int32 count);
+		BList*		GetEventsBefore(time_t start, const char* id,
+						int32 count);
+		// Pages through the events of a day in the order of
+		// GetEventsOfDay(). The cursor is the row next to the page, or
+		// NULL for the first or the last page of the day.
+		BList*		GetEventsOfDayAfter(BDate& date, Event* cursor,
+						int32 count);
+		BList*		GetEventsOfDayBefore(BDate& date, Event* cursor,
+						int32 count);
 		BList*		GetEventsToNotify(BDateTime dateTime);
+		bool		VisitEvents(EventRowVisitor* visitor, time_t start,
+						time_t end, const char* categoryId = NULL);
 		bool		RemoveEvent(Event* event);
 		bool		RemoveCancelledEvents();
 
+		// Writes made by the user, recorded in the outbox along with them.
+		// Removed events are only marked cancelled until the next sync.
+		bool		AddLocalEvent(Event* event);
+		bool		UpdateLocalEvent(Event* event, Event* newEvent);
+		bool		RemoveLocalEvent(Event* event);
+
+		bool		GetOutbox(OutboxList& entries);
+		bool		RemoveOutboxEntry(const OutboxEntry& entry);
+		bool		DeferOutboxEntry(const OutboxEntry& entry,
+						time_t nextAttempt);
+
+		bool		GetSyncState(const char* calendar, SyncState& state);
+		bool		SetSyncState(const char* calendar,
+						const SyncState& state);
+		bool		SetSyncProgress(const char* calendar,
+						const SyncState& state);
+
+		// Events synced from Google, by calendar and Google event ID. An
+		// event in several calendars is kept once for each of them.
+		bool		GetSyncedEventId(const char* calendar,
+						const char* googleId, BString& eventId);
+		bool		GetGoogleEventId(const char* calendar,
+						const char* eventId, BString& googleId);
+		bool		SetSyncedEvent(const char* calendar,
+						const char* googleId, const char* eventId);
+		bool		RemoveSyncedEvent(const char* calendar,
+						const char* googleId, const char* eventId);
+
 		bool		AddCategory(Category* category);
 		bool		UpdateCategory(Category* category,
 						Category* newCategory);
@@ -41,12 +186,60 @@ public:
 		BList*		GetAllCategories();
 		bool		RemoveCategory(Category* category);
 
+		bool		AddSubscription(Subscription* subscription);
+		BList*		GetAllSubscriptions();
+		bool		RemoveSubscription(Subscription* subscription);
+
+		bool		GetFeedEntries(const char* subscriptionId,
+						FeedEntryMap& entries);
+		bool		SetFeedEvent(const char* subscriptionId,
+						const char* uid, uint64 hash, Event* event);
+		bool		RemoveFeedEvent(const char* subscriptionId,
+						const char* uid, const char* eventId);
+
+		void		Interrupt();
+
+		bool		BeginTransaction();
+		bool		CommitTransaction();
+		void		RollbackTransaction();
+
+	static	void		AddChangeListener(EventChangeListener* listener);
+	static	void		RemoveChangeListener(EventChangeListener* listener);
+
 private:
+		void		_NotifyChange(time_t start, time_t end);
+		void		_NotifyChange(Event* event);
+	static	void		_BroadcastChange(time_t start, time_t end);
+		bool		_GetEventRange(const char* id, time_t& start,
+						time_t& end);
+		bool		_HasColumn(const char* table, const char* column);
+		bool		_QueueChange(const char* id, const char* categoryId,
+						OutboxOperation operation, uint32 fields);
+	static	void		_BindTimeZone(sqlite3_stmt* stmt, int index,
+						const char* timeZone);
+
+	static	BLocker		sListenerLock;
+	static	BList		sListeners;
+
 
-	void			_Initialise();
+	void			_Initialise(const char* path);
+	Event*			_EventFromRow(sqlite3_stmt* stmt);
+	BList*			_GetEventsInRange(time_t start, time_t end,
+						const char* order);
+	BList*			_GetEventsPage(time_t start, const char* id,
+						int32 count, bool forward);
+	BList*			_GetDayPage(BDate& date, Event* cursor,
+						int32 count, bool forward);
 
 	sqlite3*		db;
 	BPath			fDatabaseFile;
+	sqlite3_stmt*		fAddEventStmt;
+	sqlite3_stmt*		fFindImportedStmt;
+	sqlite3_stmt*		fAddImportedStmt;
+	bool			fInTransaction;
+	bool			fChanged;
+	time_t			fChangedStart;
+	time_t			fChangedEnd;
 };
 
 #endif //_SQLITE_MANAGER_H_
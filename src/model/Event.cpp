@@ -6,8 +6,12 @@
 
 #include "Event.h"
 
+#include <string.h>
+
 #include <Uuid.h>
 
+#include "ContentHash.h"
+
 
 Event::Event(const char* name,
 	const char* place, const char* description,
@@ -25,6 +29,7 @@ Event::Event(const char* name,
 	fEnd = end;
 	fUpdated = updated;
 	fStatus = status;
+	fChangedFields = kAllEventFields;
 
 	fCategory = new Category(*category);
 
@@ -42,7 +47,7 @@ Event::Event(Event& event)
 	fName = event.GetName();
 	fPlace = event.GetPlace();
 	fId = event.GetId();
-	fCategory = event.GetCategory();
+	fCategory = new Category(*event.GetCategory());
 	fDescription = event.GetDescription();
 	fAllDay = event.IsAllDay();
 	fNotified = event.IsNotified();
@@ -50,6 +55,40 @@ Event::Event(Event& event)
 	fEnd = event.GetEndDateTime();
 	fUpdated = event.GetUpdated();
 	fStatus = event.GetStatus();
+	fTimeZone = event.GetTimeZone();
+	fChangedFields = event.ChangedFields();
+}
+
+
+Event::~Event()
+{
+	delete fCategory;
+}
+
+
+Event&
+Event::operator=(Event& event)
+{
+	if (&event == this)
+		return *this;
+
+	Category* category = new Category(*event.GetCategory());
+	delete fCategory;
+	fCategory = category;
+
+	fName = event.GetName();
+	fPlace = event.GetPlace();
+	fId = event.GetId();
+	fDescription = event.GetDescription();
+	fAllDay = event.IsAllDay();
+	fNotified = event.IsNotified();
+	fStart = event.GetStartDateTime();
+	fEnd = event.GetEndDateTime();
+	fUpdated = event.GetUpdated();
+	fStatus = event.GetStatus();
+	fTimeZone = event.GetTimeZone();
+	fChangedFields = event.ChangedFields();
+	return *this;
 }
 
 
@@ -63,6 +102,8 @@ Event::GetStartDateTime()
 void
 Event::SetStartDateTime(time_t start)
 {
+	if (start != fStart)
+		fChangedFields |= kEventStart;
 	fStart = start;
 }
 
@@ -77,7 +118,8 @@ Event::GetEndDateTime()
 void
 Event::SetEndDateTime(time_t end)
 {
-
+	if (end != fEnd)
+		fChangedFields |= kEventEnd;
 	fEnd = end;
 }
 
@@ -96,9 +138,22 @@ Event::GetCategory()
 }
 
 
+void
+Event::SetCategory(Category* category)
+{
+	if (strcmp(category->GetId(), fCategory->GetId()) != 0)
+		fChangedFields |= kEventCategory;
+
+	delete fCategory;
+	fCategory = new Category(*category);
+}
+
+
 void
 Event::SetName(const char* name)
 {
+	if (fName != name)
+		fChangedFields |= kEventName;
 	fName = name;
 }
 
@@ -113,6 +168,8 @@ Event::GetName()
 void
 Event::SetPlace(const char* place)
 {
+	if (fPlace != place)
+		fChangedFields |= kEventPlace;
 	fPlace = place;
 }
 
@@ -126,6 +183,8 @@ Event::GetPlace()
 void
 Event::SetDescription(const char* description)
 {
+	if (fDescription != description)
+		fChangedFields |= kEventDescription;
 	fDescription = description;
 }
 
@@ -140,6 +199,8 @@ Event::GetDescription()
 void
 Event::SetAllDay(bool allday)
 {
+	if (allday != fAllDay)
+		fChangedFields |= kEventAllDay;
 	fAllDay = allday;
 }
 
@@ -154,6 +215,8 @@ Event::IsAllDay()
 void
 Event::SetNotified(bool notified)
 {
+	if (notified != fNotified)
+		fChangedFields |= kEventNotified;
 	fNotified = notified;
 }
 
@@ -176,6 +239,8 @@ Event::GetStatus()
 void
 Event::SetStatus(bool status)
 {
+	if (status != fStatus)
+		fChangedFields |= kEventStatus;
 	fStatus = status;
 }
 
@@ -183,6 +248,8 @@ Event::SetStatus(bool status)
 void
 Event::SetUpdated(time_t updated)
 {
+	if (updated != fUpdated)
+		fChangedFields |= kEventUpdated;
 	fUpdated = updated;
 }
 
@@ -194,9 +261,56 @@ Event::GetUpdated()
 }
 
 
+const char*
+Event::GetTimeZone()
+{
+	return fTimeZone.String();
+}
+
+
+void
+Event::SetTimeZone(const char* timeZone)
+{
+	if (fTimeZone != timeZone)
+		fChangedFields |= kEventTimeZone;
+	fTimeZone = timeZone;
+}
+
+
 bool
 Event::Equals(Event &e)
 {
     return (fId == e.GetId());
 }
 
+
+uint32
+Event::ChangedFields()
+{
+	return fChangedFields;
+}
+
+
+void
+Event::ClearChanges()
+{
+	fChangedFields = 0;
+}
+
+
+uint64
+Event::Hash()
+{
+	uint64 hash = kContentHashInitial;
+	hash = HashString(hash, fName.String());
+	hash = HashString(hash, fPlace.String());
+	hash = HashString(hash, fDescription.String());
+	hash = HashInt64(hash, fAllDay ? 1 : 0);
+	hash = HashInt64(hash, fStart);
+	hash = HashInt64(hash, fEnd);
+	hash = HashString(hash, fCategory->GetId());
+	hash = HashInt64(hash, fStatus ? 1 : 0);
+	hash = HashString(hash, fTimeZone.String());
+	return hash;
+}
+
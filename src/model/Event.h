@@ -12,6 +12,27 @@
 #include "Category.h"
 
 
+// The fields of an event, as the flags telling which ones changed.
+enum EventField {
+	kEventName			= 1 << 0,
+	kEventPlace			= 1 << 1,
+	kEventDescription	= 1 << 2,
+	kEventAllDay		= 1 << 3,
+	kEventStart			= 1 << 4,
+	kEventEnd			= 1 << 5,
+	kEventCategory		= 1 << 6,
+	kEventNotified		= 1 << 7,
+	kEventUpdated		= 1 << 8,
+	kEventStatus		= 1 << 9,
+	kEventTimeZone		= 1 << 10,
+
+	kAllEventFields		= (1 << 11) - 1,
+
+	// The content of the event, what Hash() covers.
+	kHashedEventFields	= kAllEventFields & ~(kEventNotified | kEventUpdated)
+};
+
+
 class Event {
 public:
 
@@ -22,6 +43,9 @@ public:
 				time_t updated = time(NULL), bool status = true,
 				const char* id = NULL);
 			Event(Event& event);
+			~Event();
+
+	Event&		operator=(Event& event);
 
 	time_t		GetStartDateTime();
 	void		SetStartDateTime(time_t start);
@@ -31,6 +55,7 @@ public:
 
 	const char*	GetId();
 	Category*	GetCategory();
+	void		SetCategory(Category* category);
 
 	const char*	GetName();
 	const char*	GetPlace();
@@ -49,18 +74,35 @@ public:
 	time_t		GetUpdated();
 	void		SetUpdated(time_t updated);
 
+	// IANA name of the zone the event was created in, like "Europe/Berlin",
+	// or empty for floating and all day events. Start and end are UTC
+	// either way.
+	const char*	GetTimeZone();
+	void		SetTimeZone(const char* timeZone);
+
 
 	bool		IsNotified();
 	void		SetNotified(bool notified);
 
 	bool 		Equals(Event& e);
 
+	// The fields set to a new value since the event was created or
+	// ClearChanges() was called. A new event has all of them, since none
+	// of them is stored yet.
+	uint32		ChangedFields();
+	void		ClearChanges();
+
+	// Of the kHashedEventFields, to tell whether the content of an event
+	// changed without comparing it field by field.
+	uint64		Hash();
+
 private:
 
 	BString		fName;
 	BString		fDescription;
 	BString		fPlace;
 	BString		fId;
+	BString		fTimeZone;
 
 	time_t		fStart;
 	time_t		fEnd;
@@ -71,6 +113,7 @@ private:
 	bool		fStatus;
 
 	Category*	fCategory;
+	uint32		fChangedFields;
 
 };
 
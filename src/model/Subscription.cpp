@@ -0,0 +1,59 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "Subscription.h"
+
+#include <Uuid.h>
+
+
+Subscription::Subscription(const char* name, const char* url,
+	const char* categoryId, const char* id /*= NULL*/)
+{
+	fName = name;
+	fUrl = url;
+	fCategoryId = categoryId;
+
+	if (id == NULL)
+		fId = BUuid().SetToRandom().ToString();
+	else
+		fId = id;
+}
+
+
+Subscription::Subscription(Subscription& subscription)
+{
+	fId = subscription.GetId();
+	fName = subscription.GetName();
+	fUrl = subscription.GetUrl();
+	fCategoryId = subscription.GetCategoryId();
+}
+
+
+const char*
+Subscription::GetId()
+{
+	return fId.String();
+}
+
+
+const char*
+Subscription::GetName()
+{
+	return fName.String();
+}
+
+
+const char*
+Subscription::GetUrl()
+{
+	return fUrl.String();
+}
+
+
+const char*
+Subscription::GetCategoryId()
+{
+	return fCategoryId.String();
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef SUBSCRIPTION_H
+#define SUBSCRIPTION_H
+
+#include <String.h>
+
+
+// A read-only iCalendar feed whose events are copied into the database,
+// with the category they are shown in. The URL is either an http(s) URL
+// or the path of a local file.
+class Subscription {
+public:
+		Subscription(const char* name, const char* url,
+			const char* categoryId, const char* id = NULL);
+		Subscription(Subscription& subscription);
+
+		const char* GetId();
+		const char* GetName();
+		const char* GetUrl();
+		const char* GetCategoryId();
+
+private:
+		BString			fId;
+		BString			fName;
+		BString			fUrl;
+		BString			fCategoryId;
+};
+
+#endif
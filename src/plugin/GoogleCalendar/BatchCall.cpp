@@ -0,0 +1,229 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "BatchCall.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include "RequestEngine.h"
+
+
+BatchCall::BatchCall(const char* url)
+	:
+	fUrl(url),
+	fCall(NULL),
+	fStatusCode(0)
+{
+	fBoundary.SetToFormat("batch_%" B_PRIx64 "_%" B_PRIx32,
+		(uint64)system_time(), (uint32)find_thread(NULL));
+}
+
+
+BatchCall::~BatchCall()
+{
+	if (fCall != NULL) {
+		RequestEngine::Default()->Cancel(fCall);
+		fCall->Wait();
+		delete fCall;
+	}
+}
+
+
+int32
+BatchCall::AddPart(const char* method, const BString& path,
+	const BString* json)
+{
+	Part part;
+	part.method = method;
+	part.path = path;
+	part.hasJson = json != NULL;
+	if (json != NULL)
+		part.json = *json;
+	part.statusCode = B_ERROR;
+
+	fParts.push_back(part);
+	return fParts.size() - 1;
+}
+
+
+int32
+BatchCall::CountParts() const
+{
+	return fParts.size();
+}
+
+
+// Every part is an HTTP request of its own, told apart in the response by
+// its Content-ID.
+void
+BatchCall::Send(const BHttpHeaders& headers)
+{
+	BString body;
+	for (size_t i = 0; i < fParts.size(); i++) {
+		const Part& part = fParts[i];
+		body << "--" << fBoundary << "\r\n"
+			<< "Content-Type: application/http\r\n"
+			<< "Content-ID: <item" << (int32)(i + 1) << ">\r\n\r\n"
+			<< part.method << " " << part.path << " HTTP/1.1\r\n";
+		if (part.hasJson) {
+			body << "Content-Type: application/json\r\n\r\n"
+				<< part.json << "\r\n";
+		} else
+			body << "\r\n";
+	}
+	body << "--" << fBoundary << "--\r\n";
+
+	BString contentType("multipart/mixed; boundary=");
+	contentType << fBoundary;
+
+	BHttpHeaders batchHeaders(headers);
+	batchHeaders.AddHeader("Content-Type", contentType.String());
+
+	fCall = new HttpCall(fUrl, B_HTTP_POST);
+	fCall->SetHeaders(batchHeaders);
+	fCall->SetBody(body);
+	RequestEngine::Default()->Queue(fCall);
+}
+
+
+status_t
+BatchCall::Wait()
+{
+	if (fCall == NULL)
+		return B_NO_INIT;
+
+	status_t status = fCall->Wait();
+	if (status != B_OK)
+		return status;
+
+	fStatusCode = fCall->StatusCode();
+	if (fStatusCode != 200)
+		return B_ERROR;
+
+	return _ParseResponse(BString(fCall->Body(), fCall->BodyLength()),
+		fCall->ResponseHeader("Content-Type"));
+}
+
+
+// Of the batch as a whole.
+int32
+BatchCall::StatusCode() const
+{
+	return fStatusCode;
+}
+
+
+int32
+BatchCall::PartStatusCode(int32 index) const
+{
+	return fParts[index].statusCode;
+}
+
+
+const BString&
+BatchCall::PartBody(int32 index) const
+{
+	return fParts[index].body;
+}
+
+
+// The response has its own boundary, given by its Content-Type.
+status_t
+BatchCall::_ParseResponse(const BString& response,
+	const BString& contentType)
+{
+	int32 start = contentType.IFindFirst("boundary=");
+	if (start < 0)
+		return B_BAD_DATA;
+	start += strlen("boundary=");
+
+	int32 end = contentType.FindFirst(';', start);
+	if (end < 0)
+		end = contentType.Length();
+
+	BString boundary;
+	contentType.CopyInto(boundary, start, end - start);
+	boundary.Trim();
+	boundary.RemoveAll("\"");
+
+	BString delimiter("--");
+	delimiter << boundary;
+
+	int32 position = response.FindFirst(delimiter);
+	if (boundary.IsEmpty() || position < 0)
+		return B_BAD_DATA;
+
+	while (true) {
+		position += delimiter.Length();
+		if (response.FindFirst("--", position) == position)
+			break;
+
+		int32 next = response.FindFirst(delimiter, position);
+		if (next < 0)
+			break;
+
+		BString part;
+		response.CopyInto(part, position, next - position);
+		_ParsePart(part);
+		position = next;
+	}
+
+	return B_OK;
+}
+
+
+static int32
+HeadersEnd(const BString& text, int32 from, int32& bodyStart)
+{
+	int32 end = text.FindFirst("\r\n\r\n", from);
+	if (end >= 0) {
+		bodyStart = end + 4;
+		return end;
+	}
+
+	end = text.FindFirst("\n\n", from);
+	if (end >= 0)
+		bodyStart = end + 2;
+	return end;
+}
+
+
+// A part of the response is the response to the part of the request with
+// the same number, like "Content-ID: <response-item3>" for "<item3>".
+void
+BatchCall::_ParsePart(const BString& part)
+{
+	int32 responseStart;
+	int32 headersEnd = HeadersEnd(part, 0, responseStart);
+	if (headersEnd < 0)
+		return;
+
+	int32 id = part.IFindFirst("Content-ID:");
+	if (id < 0 || id > headersEnd)
+		return;
+	id = part.IFindFirst("response-item", id);
+	if (id < 0 || id > headersEnd)
+		return;
+
+	int32 index = atoi(part.String() + id + strlen("response-item")) - 1;
+	if (index < 0 || index >= (int32)fParts.size())
+		return;
+
+	// The status line, like "HTTP/1.1 404 Not Found".
+	int32 code = part.FindFirst(' ', responseStart);
+	if (code < 0)
+		return;
+
+	int32 bodyStart;
+	if (HeadersEnd(part, responseStart, bodyStart) < 0)
+		bodyStart = part.Length();
+
+	fParts[index].statusCode = atoi(part.String() + code + 1);
+	part.CopyInto(fParts[index].body, bodyStart, part.Length() - bodyStart);
+	fParts[index].body.Trim();
+}
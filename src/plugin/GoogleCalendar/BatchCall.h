@@ -0,0 +1,67 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _BATCH_CALL_H_
+#define _BATCH_CALL_H_
+
+
+#include <vector>
+
+#include <HttpHeaders.h>
+#include <String.h>
+
+
+class HttpCall;
+
+
+// Several requests to a Google API sent as the parts of a single
+// multipart/mixed request to its batch endpoint. Google answers every part
+// on its own, so each can succeed or fail whatever the others did.
+class BatchCall {
+public:
+							BatchCall(const char* url);
+							~BatchCall();
+
+			// The path is that of the API, like "/calendar/v3/...". Returns
+			// the index of the part.
+			int32			AddPart(const char* method, const BString& path,
+								const BString* json = NULL);
+			int32			CountParts() const;
+
+			// Queues the batch on the shared RequestEngine.
+			void			Send(const BHttpHeaders& headers);
+
+			// Blocks until the batch is done. B_OK once the response of
+			// the batch was read, even if some of its parts failed.
+			status_t		Wait();
+			int32			StatusCode() const;
+
+			// The status code of a part, or an error if it wasn't answered.
+			int32			PartStatusCode(int32 index) const;
+			const BString&	PartBody(int32 index) const;
+
+	static	const int32		kMaxParts = 50;
+
+private:
+			struct Part {
+				BString		method;
+				BString		path;
+				BString		json;
+				bool		hasJson;
+				int32		statusCode;
+				BString		body;
+			};
+
+			status_t		_ParseResponse(const BString& response,
+								const BString& contentType);
+			void			_ParsePart(const BString& part);
+
+			BString			fUrl;
+			BString			fBoundary;
+			std::vector<Part>	fParts;
+			HttpCall*		fCall;
+			int32			fStatusCode;
+};
+
+#endif	// _BATCH_CALL_H_
@@ -0,0 +1,491 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "CalendarSync.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Url.h>
+
+#include "Category.h"
+#include "JsonReader.h"
+#include "RFC3339.h"
+#include "RequestEngine.h"
+
+
+// Sent for a sync token Google doesn't know anymore.
+static const int32 kGoneStatusCode = 410;
+
+// Sent for a page token that isn't valid anymore.
+static const int32 kBadRequestStatusCode = 400;
+
+// Only what EventListReader keeps, instead of every property of an event.
+static const char* kEventFields = "nextPageToken,nextSyncToken,"
+	"items(id,status,summary,location,description,updated,"
+	"start(date,dateTime,timeZone),end(date,dateTime,timeZone))";
+
+
+CalendarSync::CalendarSync(const char* id, const char* name,
+	const char* color, bool primary)
+	:
+	fId(id),
+	fName(name),
+	fColor(color),
+	fPrimary(primary),
+	fCategory(NULL),
+	fWindowStart(0),
+	fWindowEnd(0),
+	fNeedsBackfill(false),
+	fBackfilling(false),
+	fFailed(0),
+	fResumeBackfill(false),
+	fWriter(NULL),
+	fPage(NULL),
+	fNextPage(NULL)
+{
+}
+
+
+CalendarSync::~CalendarSync()
+{
+	delete fCategory;
+	delete fPage;
+}
+
+
+const char*
+CalendarSync::Id() const
+{
+	return fId.String();
+}
+
+
+const char*
+CalendarSync::Name() const
+{
+	return fName.String();
+}
+
+
+// As Google sends it, like "#9fe1e7".
+const char*
+CalendarSync::Color() const
+{
+	return fColor.String();
+}
+
+
+bool
+CalendarSync::IsPrimary() const
+{
+	return fPrimary;
+}
+
+
+Category*
+CalendarSync::GetCategory() const
+{
+	return fCategory;
+}
+
+
+void
+CalendarSync::SetCategory(Category* category)
+{
+	delete fCategory;
+	fCategory = category;
+}
+
+
+const char*
+CalendarSync::SyncToken() const
+{
+	return fSyncToken.String();
+}
+
+
+void
+CalendarSync::SetSyncToken(const char* token)
+{
+	fSyncToken = token;
+}
+
+
+// Set once the last page was read.
+const char*
+CalendarSync::NextSyncToken() const
+{
+	return fNextSyncToken.String();
+}
+
+
+void
+CalendarSync::SetWindow(time_t start, time_t end)
+{
+	fWindowStart = start;
+	fWindowEnd = end;
+}
+
+
+time_t
+CalendarSync::WindowStart() const
+{
+	return fWindowStart;
+}
+
+
+time_t
+CalendarSync::WindowEnd() const
+{
+	return fWindowEnd;
+}
+
+
+// Set after a full sync of a window, until the rest has been backfilled.
+bool
+CalendarSync::NeedsBackfill() const
+{
+	return fNeedsBackfill;
+}
+
+
+void
+CalendarSync::SetNeedsBackfill(bool needsBackfill)
+{
+	fNeedsBackfill = needsBackfill;
+}
+
+
+// Whether the last download was a backfill.
+bool
+CalendarSync::IsBackfilling() const
+{
+	return fBackfilling;
+}
+
+
+void
+CalendarSync::SetResumePoint(const char* url, const char* pageToken,
+	bool backfill)
+{
+	fResumeUrl = url;
+	fResumePageToken = pageToken;
+	fResumeBackfill = backfill;
+}
+
+
+void
+CalendarSync::SetFailed()
+{
+	atomic_set(&fFailed, 1);
+}
+
+
+bool
+CalendarSync::HasFailed() const
+{
+	return atomic_get((int32*)&fFailed) != 0;
+}
+
+
+// Reads all pages of the calendar and always ends by handing the writer a
+// last page with the status of the download. An interrupted download goes
+// on where it was left, if Google still takes its page token. An expired
+// sync token means starting over with a full sync.
+void
+CalendarSync::Download(const BHttpHeaders& headers, SyncPageWriter* writer)
+{
+	fHeaders = headers;
+	fWriter = writer;
+	fBackfilling = false;
+
+	bool fullSync = fSyncToken.IsEmpty();
+	status_t status = B_BAD_VALUE;
+	if (!fResumeUrl.IsEmpty() && !fResumeBackfill) {
+		fullSync = fResumeUrl.FindFirst("&syncToken=") < 0;
+		status = _Download(fResumeUrl, fResumePageToken);
+	}
+	fResumeUrl = "";
+
+	if (status == B_BAD_VALUE) {
+		fullSync = fSyncToken.IsEmpty();
+		status = _Download(_EventsUrl(fWindowStart, fWindowEnd), "");
+	}
+	if (status == B_ENTRY_NOT_FOUND) {
+		fSyncToken = "";
+		fullSync = true;
+		status = _Download(_EventsUrl(fWindowStart, fWindowEnd), "");
+	}
+
+	if (status == B_OK && fullSync)
+		fNeedsBackfill = fWindowStart != 0 || fWindowEnd != 0;
+
+	_Finish(status);
+}
+
+
+// Gets the events before and after the window of the full sync, without
+// changing the sync token. Changes to those made in the meantime already
+// came with the incremental syncs, and older ones are skipped when the
+// events are stored.
+void
+CalendarSync::Backfill(const BHttpHeaders& headers, SyncPageWriter* writer)
+{
+	fHeaders = headers;
+	fWriter = writer;
+	fBackfilling = true;
+
+	std::vector<BString> urls;
+	if (fWindowStart != 0)
+		urls.push_back(_EventsUrl(0, fWindowStart));
+	if (fWindowEnd != 0)
+		urls.push_back(_EventsUrl(fWindowEnd, 0));
+
+	// An interrupted backfill skips the lists it had already read.
+	size_t first = 0;
+	BString pageToken;
+	for (size_t i = 0; fResumeBackfill && i < urls.size(); i++) {
+		if (urls[i] == fResumeUrl) {
+			first = i;
+			pageToken = fResumePageToken;
+		}
+	}
+	fResumeUrl = "";
+
+	status_t status = B_OK;
+	for (size_t i = first; i < urls.size() && status == B_OK; i++) {
+		status = _Download(urls[i], pageToken);
+		if (status == B_BAD_VALUE)
+			status = _Download(urls[i], "");
+		pageToken = "";
+	}
+
+	if (status == B_OK)
+		fNeedsBackfill = false;
+
+	_Finish(status);
+}
+
+
+// Events go to the writer a few at a time, so that no more than that is
+// kept of a page however long it is.
+bool
+CalendarSync::EventParsed(GoogleEvent& event)
+{
+	fPage->size += sizeof(GoogleEvent) + event.id.size() + event.status.size()
+		+ event.summary.size() + event.location.size()
+		+ event.description.size() + event.updated.size()
+		+ event.start.dateTime.size() + event.start.date.size()
+		+ event.start.timeZone.size() + event.end.dateTime.size()
+		+ event.end.date.size() + event.end.timeZone.size();
+	fPage->events.push_back(GoogleEvent());
+	fPage->events.back().Swap(event);
+
+	if ((int32)fPage->events.size() < (int32)kBatchEvents)
+		return true;
+	return _HandPage(false);
+}
+
+
+bool
+CalendarSync::NextPageTokenParsed(const std::string& token)
+{
+	if (fNextPage != NULL || token.empty())
+		return true;
+
+	fNextPageToken = token.c_str();
+	fNextPage = _RequestPage(fNextPageToken);
+	return true;
+}
+
+
+void
+CalendarSync::_NewPage()
+{
+	fPage = new SyncPage;
+	fPage->calendar = this;
+	fPage->size = 0;
+	fPage->url = fEventsUrl;
+	fPage->pageToken = fPageToken;
+	fPage->pageEnd = false;
+	fPage->last = false;
+	fPage->status = B_OK;
+}
+
+
+// Gives the events read so far to the writer. Those ending a page take the
+// token of the next one along.
+bool
+CalendarSync::_HandPage(bool pageEnd)
+{
+	SyncPage* page = fPage;
+	page->pageEnd = pageEnd;
+	if (pageEnd)
+		page->nextPageToken = fNextPageToken;
+
+	fPage = NULL;
+	if (!fWriter->PageRead(page))
+		return false;
+
+	if (!pageEnd)
+		_NewPage();
+	return true;
+}
+
+
+// Of the list being downloaded, the first one without a token.
+HttpCall*
+CalendarSync::_RequestPage(const BString& pageToken)
+{
+	BString url(fEventsUrl);
+	if (!pageToken.IsEmpty())
+		url << "&pageToken=" << BUrl::UrlEncode(pageToken, true);
+
+	HttpCall* page = new HttpCall(url);
+	page->SetHeaders(fHeaders);
+	page->SetStreamed(true);
+	RequestEngine::Default()->Queue(page);
+	return page;
+}
+
+
+void
+CalendarSync::_CancelPage(HttpCall* page)
+{
+	if (page == NULL)
+		return;
+
+	RequestEngine::Default()->Cancel(page);
+	page->Wait();
+	delete page;
+}
+
+
+// With a sync token only the changes since it was sent, otherwise the
+// events overlapping the given time range.
+BString
+CalendarSync::_EventsUrl(time_t timeMin, time_t timeMax) const
+{
+	BString url("https://www.googleapis.com/calendar/v3/calendars/");
+	url << BUrl::UrlEncode(fId, true) << "/events?fields="
+		<< BUrl::UrlEncode(kEventFields, true);
+
+	if (!fSyncToken.IsEmpty() && !fBackfilling) {
+		url << "&syncToken=" << BUrl::UrlEncode(fSyncToken, true);
+		return url;
+	}
+
+	// A full sync removes what was cancelled since an earlier one, a
+	// backfill only adds events.
+	if (!fBackfilling)
+		url << "&showDeleted=true";
+
+	char buffer[kRFC3339MaxLength + 1];
+	if (timeMin != 0) {
+		FormatRFC3339(timeMin, 0, buffer);
+		url << "&timeMin=" << BUrl::UrlEncode(buffer, true);
+	}
+	if (timeMax != 0) {
+		FormatRFC3339(timeMax, 0, buffer);
+		url << "&timeMax=" << BUrl::UrlEncode(buffer, true);
+	}
+
+	return url;
+}
+
+
+// The request for the next page is started as soon as its token is read,
+// see NextPageTokenParsed(). Returns B_ENTRY_NOT_FOUND if Google doesn't
+// know the sync token anymore, and B_BAD_VALUE if it refused the page token
+// to start from.
+status_t
+CalendarSync::_Download(const BString& url, const BString& pageToken)
+{
+	fNextSyncToken = "";
+	fEventsUrl = url;
+
+	EventListReader reader(this);
+	HttpCall* page = _RequestPage(pageToken);
+	bool resumed = !pageToken.IsEmpty();
+	fPageToken = pageToken;
+
+	while (page != NULL) {
+		reader.Reset();
+		fNextPage = NULL;
+		fNextPageToken = "";
+		_NewPage();
+
+		JsonReader json(&reader);
+		std::string data;
+		bool read = true;
+		while (read && page->Read(data))
+			read = json.Feed(data.data(), data.size());
+
+		if (!read || page->Wait() != B_OK || page->StatusCode() != 200
+			|| !json.Finish()) {
+			status_t status = B_ERROR;
+			if (page->Status() != B_OK) {
+				printf("%s: Request failed: %s\n", fName.String(),
+					strerror(page->Status()));
+			} else if (resumed && (page->StatusCode() == kGoneStatusCode
+					|| page->StatusCode() == kBadRequestStatusCode)) {
+				fprintf(stderr, "%s: Can't resume, starting over.\n",
+					fName.String());
+				status = B_BAD_VALUE;
+			} else if (page->StatusCode() == kGoneStatusCode
+				&& !fSyncToken.IsEmpty()) {
+				status = B_ENTRY_NOT_FOUND;
+			} else if (page->StatusCode() != 200) {
+				printf("%s: Response code:  %d \n", fName.String(),
+					page->StatusCode());
+			} else if (json.HasError()) {
+				printf("%s: Parser choked on JSON at byte %" B_PRIu64 "\n",
+					fName.String(), json.Position());
+			}
+			_CancelPage(fNextPage);
+			_CancelPage(page);
+			fNextPage = NULL;
+			delete fPage;
+			fPage = NULL;
+			return status;
+		}
+
+		delete page;
+		page = fNextPage;
+		resumed = false;
+
+		if (!_HandPage(true)) {
+			_CancelPage(page);
+			fNextPage = NULL;
+			return B_ERROR;
+		}
+		fPageToken = fNextPageToken;
+	}
+
+	if (fBackfilling)
+		return B_OK;
+
+	fNextSyncToken = reader.NextSyncToken().c_str();
+	if (fNextSyncToken.IsEmpty()) {
+		fprintf(stderr, "Error: nextSyncToken not found in API response.\n");
+		return B_ERROR;
+	}
+
+	return B_OK;
+}
+
+
+void
+CalendarSync::_Finish(status_t status)
+{
+	SyncPage* last = new SyncPage;
+	last->calendar = this;
+	last->size = 0;
+	last->pageEnd = false;
+	last->last = true;
+	last->status = status;
+	fWriter->PageRead(last);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _CALENDAR_SYNC_H_
+#define _CALENDAR_SYNC_H_
+
+
+#include <vector>
+
+#include <HttpHeaders.h>
+#include <String.h>
+
+#include "EventListReader.h"
+
+
+class Category;
+class CalendarSync;
+class HttpCall;
+
+
+// A few events of one page of a calendar, read but not written yet, with
+// where the download goes on once they are written: the URL of the list
+// and the token of the page they came from, or, for the events ending the
+// page, of its next page, empty after the last one. The last SyncPage of a
+// download has no events and carries its status.
+struct SyncPage {
+	CalendarSync*			calendar;
+	std::vector<GoogleEvent>	events;
+	size_t					size;		// of the events, in bytes
+	BString					url;
+	BString					pageToken;
+	BString					nextPageToken;
+	bool					pageEnd;
+	bool					last;
+	status_t				status;
+};
+
+
+class SyncPageWriter {
+public:
+	virtual					~SyncPageWriter() {}
+
+	// Takes the page, may block until there is room for it. Returns false
+	// when the download should stop.
+	virtual	bool			PageRead(SyncPage* page) = 0;
+};
+
+
+// Downloads the events of one calendar of the user's calendar list, one
+// page after the other, and hands them to a writer kBatchEvents at a time
+// as they are read. It doesn't touch the database, so downloads of several
+// calendars can run on their own threads.
+class CalendarSync : public GoogleEventListener {
+public:
+							CalendarSync(const char* id, const char* name,
+								const char* color, bool primary);
+							~CalendarSync();
+
+			const char*		Id() const;
+			const char*		Name() const;
+			const char*		Color() const;
+			bool			IsPrimary() const;
+
+			// Where the events of the calendar go, owned by the calendar.
+			Category*		GetCategory() const;
+			void			SetCategory(Category* category);
+
+			// Empty for a full sync.
+			const char*		SyncToken() const;
+			void			SetSyncToken(const char* token);
+			const char*		NextSyncToken() const;
+
+			// Full syncs only get the events overlapping this window, the
+			// others are left to Backfill(). 0 leaves a side open.
+			void			SetWindow(time_t start, time_t end);
+			time_t			WindowStart() const;
+			time_t			WindowEnd() const;
+			bool			NeedsBackfill() const;
+			void			SetNeedsBackfill(bool needsBackfill);
+			bool			IsBackfilling() const;
+
+			// Where an interrupted download or backfill left off, the list
+			// and the token of the page it didn't get.
+			void			SetResumePoint(const char* url,
+								const char* pageToken, bool backfill);
+
+			// Set by the writer when it couldn't store a page.
+			void			SetFailed();
+			bool			HasFailed() const;
+
+			void			Download(const BHttpHeaders& headers,
+								SyncPageWriter* writer);
+			void			Backfill(const BHttpHeaders& headers,
+								SyncPageWriter* writer);
+
+	virtual	bool			EventParsed(GoogleEvent& event);
+	virtual	bool			NextPageTokenParsed(const std::string& token);
+
+	static	const int32		kBatchEvents = 25;
+
+private:
+			void			_NewPage();
+			bool			_HandPage(bool pageEnd);
+			HttpCall*		_RequestPage(const BString& pageToken);
+			void			_CancelPage(HttpCall* page);
+			BString			_EventsUrl(time_t timeMin, time_t timeMax) const;
+			status_t		_Download(const BString& url,
+								const BString& pageToken);
+			void			_Finish(status_t status);
+
+			BString			fId;
+			BString			fName;
+			BString			fColor;
+			bool			fPrimary;
+			Category*		fCategory;
+			BString			fSyncToken;
+			BString			fNextSyncToken;
+			time_t			fWindowStart;
+			time_t			fWindowEnd;
+			bool			fNeedsBackfill;
+			bool			fBackfilling;
+			int32			fFailed;
+			BString			fResumeUrl;
+			BString			fResumePageToken;
+			bool			fResumeBackfill;
+
+			BString			fEventsUrl;
+			BString			fPageToken;
+			BString			fNextPageToken;
+			BHttpHeaders	fHeaders;
+			SyncPageWriter*	fWriter;
+			SyncPage*		fPage;
+			HttpCall*		fNextPage;
+};
+
+#endif	// _CALENDAR_SYNC_H_
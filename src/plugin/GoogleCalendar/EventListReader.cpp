@@ -0,0 +1,259 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "EventListReader.h"
+
+
+// Nesting of the containers the reader looks into: the response object,
+// its "items" array, the event objects and their "start" and "end".
+static const uint32_t kResponseDepth = 1;
+static const uint32_t kItemsDepth = 2;
+static const uint32_t kEventDepth = 3;
+static const uint32_t kTimeDepth = 4;
+
+
+void
+GoogleEventTime::Clear()
+{
+	dateTime.clear();
+	date.clear();
+	timeZone.clear();
+}
+
+
+void
+GoogleEventTime::Swap(GoogleEventTime& other)
+{
+	dateTime.swap(other.dateTime);
+	date.swap(other.date);
+	timeZone.swap(other.timeZone);
+}
+
+
+void
+GoogleEvent::Clear()
+{
+	id.clear();
+	status.clear();
+	summary.clear();
+	location.clear();
+	description.clear();
+	updated.clear();
+	start.Clear();
+	end.Clear();
+}
+
+
+// Lets an event be kept without copying its strings.
+void
+GoogleEvent::Swap(GoogleEvent& other)
+{
+	id.swap(other.id);
+	status.swap(other.status);
+	summary.swap(other.summary);
+	location.swap(other.location);
+	description.swap(other.description);
+	updated.swap(other.updated);
+	start.Swap(other.start);
+	end.Swap(other.end);
+}
+
+
+EventListReader::EventListReader(GoogleEventListener* listener)
+	:
+	fListener(listener)
+{
+	Reset();
+}
+
+
+void
+EventListReader::Reset()
+{
+	fEvent.Clear();
+	fTime = NULL;
+	fKey.clear();
+	fNextPageToken.clear();
+	fNextSyncToken.clear();
+	fDepth = 0;
+	fSkipDepth = 0;
+	fInItems = false;
+	fEventCount = 0;
+}
+
+
+// Empty on the last page.
+const std::string&
+EventListReader::NextPageToken() const
+{
+	return fNextPageToken;
+}
+
+
+// Only set on the last page.
+const std::string&
+EventListReader::NextSyncToken() const
+{
+	return fNextSyncToken;
+}
+
+
+uint32_t
+EventListReader::EventCount() const
+{
+	return fEventCount;
+}
+
+
+bool
+EventListReader::StartObject()
+{
+	return _Start(true);
+}
+
+
+bool
+EventListReader::EndObject()
+{
+	return _End(true);
+}
+
+
+bool
+EventListReader::StartArray()
+{
+	return _Start(false);
+}
+
+
+bool
+EventListReader::EndArray()
+{
+	return _End(false);
+}
+
+
+bool
+EventListReader::Key(const std::string& key)
+{
+	if (fSkipDepth == 0)
+		fKey = key;
+	return true;
+}
+
+
+bool
+EventListReader::String(const std::string& value)
+{
+	if (fSkipDepth != 0)
+		return true;
+
+	if (fDepth == kResponseDepth) {
+		if (fKey == "nextPageToken") {
+			fNextPageToken = value;
+			return fListener->NextPageTokenParsed(value);
+		} else if (fKey == "nextSyncToken")
+			fNextSyncToken = value;
+	} else if (fDepth == kEventDepth && fInItems) {
+		if (fKey == "id")
+			fEvent.id = value;
+		else if (fKey == "status")
+			fEvent.status = value;
+		else if (fKey == "summary")
+			fEvent.summary = value;
+		else if (fKey == "location")
+			fEvent.location = value;
+		else if (fKey == "description")
+			fEvent.description = value;
+		else if (fKey == "updated")
+			fEvent.updated = value;
+	} else if (fDepth == kTimeDepth && fTime != NULL) {
+		if (fKey == "dateTime")
+			fTime->dateTime = value;
+		else if (fKey == "date")
+			fTime->date = value;
+		else if (fKey == "timeZone")
+			fTime->timeZone = value;
+	}
+
+	return true;
+}
+
+
+bool
+EventListReader::Number(const std::string& value)
+{
+	return true;
+}
+
+
+bool
+EventListReader::Boolean(bool value)
+{
+	return true;
+}
+
+
+bool
+EventListReader::Null()
+{
+	return true;
+}
+
+
+// Containers that aren't on the way to a field the calendar keeps are
+// skipped with everything in them.
+bool
+EventListReader::_Start(bool isObject)
+{
+	fDepth++;
+	if (fSkipDepth != 0)
+		return true;
+
+	bool wanted = false;
+	if (fDepth == kResponseDepth)
+		wanted = isObject;
+	else if (fDepth == kItemsDepth) {
+		wanted = !isObject && fKey == "items";
+		fInItems = wanted;
+	} else if (fDepth == kEventDepth && fInItems) {
+		wanted = isObject;
+		fEvent.Clear();
+	} else if (fDepth == kTimeDepth && isObject) {
+		if (fKey == "start")
+			fTime = &fEvent.start;
+		else if (fKey == "end")
+			fTime = &fEvent.end;
+		wanted = fTime != NULL;
+	}
+
+	if (!wanted)
+		fSkipDepth = fDepth;
+	fKey.clear();
+	return true;
+}
+
+
+bool
+EventListReader::_End(bool isObject)
+{
+	uint32_t depth = fDepth--;
+	if (fSkipDepth != 0) {
+		if (fSkipDepth == depth)
+			fSkipDepth = 0;
+		return true;
+	}
+
+	if (depth == kTimeDepth)
+		fTime = NULL;
+	else if (depth == kItemsDepth)
+		fInItems = false;
+	else if (depth == kEventDepth && fInItems) {
+		fEventCount++;
+		return fListener->EventParsed(fEvent);
+	}
+
+	return true;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _EVENT_LIST_READER_H_
+#define _EVENT_LIST_READER_H_
+
+
+#include <string>
+
+#include "JsonReader.h"
+
+
+// The parts of a Google Calendar event resource the calendar keeps, as
+// strings straight from the response. Times are RFC 3339; an event has
+// either a dateTime or, for all day events, a date.
+struct GoogleEventTime {
+	std::string	dateTime;
+	std::string	date;
+	std::string	timeZone;
+
+	void		Clear();
+	void		Swap(GoogleEventTime& other);
+};
+
+
+struct GoogleEvent {
+	std::string	id;
+	std::string	status;
+	std::string	summary;
+	std::string	location;
+	std::string	description;
+	std::string	updated;
+	GoogleEventTime	start;
+	GoogleEventTime	end;
+
+	void		Clear();
+	void		Swap(GoogleEvent& other);
+};
+
+
+class GoogleEventListener {
+public:
+	virtual				~GoogleEventListener() {}
+
+	// Returning false stops the reader.
+	virtual	bool		EventParsed(GoogleEvent& event) = 0;
+
+	// Google sends the token before the items, so the next page can be
+	// asked for while this one is still being read.
+	virtual	bool		NextPageTokenParsed(const std::string& token)
+							{ return true; }
+};
+
+
+// Decodes an events list response ("calendar#events") as it is read: each
+// element of "items" is handed to the listener once its object closes, and
+// everything the calendar doesn't use, like attendees or reminders, is
+// skipped without being stored. Only one event is kept at a time.
+//
+// Only uses the standard library, so it can be built and run on any host.
+class EventListReader : public JsonHandler {
+public:
+					EventListReader(GoogleEventListener* listener);
+
+		void		Reset();
+
+		const std::string&	NextPageToken() const;
+		const std::string&	NextSyncToken() const;
+		uint32_t	EventCount() const;
+
+	virtual	bool		StartObject();
+	virtual	bool		EndObject();
+	virtual	bool		StartArray();
+	virtual	bool		EndArray();
+	virtual	bool		Key(const std::string& key);
+	virtual	bool		String(const std::string& value);
+	virtual	bool		Number(const std::string& value);
+	virtual	bool		Boolean(bool value);
+	virtual	bool		Null();
+
+private:
+		bool		_Start(bool isObject);
+		bool		_End(bool isObject);
+
+		GoogleEventListener*	fListener;
+		GoogleEvent	fEvent;
+		GoogleEventTime*	fTime;
+		std::string	fKey;
+		std::string	fNextPageToken;
+		std::string	fNextSyncToken;
+		uint32_t	fDepth;
+		uint32_t	fSkipDepth;
+		bool		fInItems;
+		uint32_t	fEventCount;
+};
+
+#endif	// _EVENT_LIST_READER_H_
@@ -2,11 +2,12 @@
  * Copyight 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
  * All rights reserved. Distributed under the terms of the MIT License.
  */
-#include <sstream>
+#include <ctype.h>
 #include <time.h>
 
+#include <algorithm>
+
 #include <Button.h>
-#include <DateFormat.h>
 #include <LayoutBuilder.h>
 #include <List.h>
 #include <Key.h>
@@ -18,11 +19,17 @@
 #include <Window.h>
 
 #include "App.h"
+#include "BatchCall.h"
 #include "Category.h"
+#include "CivilDate.h"
+#include "ColorConverter.h"
 #include "Event.h"
 #include "EventSync.h"
+#include "RFC3339.h"
 #include "Requests.h"
 #include "SQLiteManager.h"
+#include "TokenManager.h"
+#include "ZoneInfo.h"
 
 
 // Don't update status property to Google Calendar for active events(status=true)
@@ -35,9 +42,20 @@ static const char* kEventStatusToGCalStatus[] = {
 	"tentative",
 };
 
+// Categories of synced calendars other than the primary one.
+static const char* kCalendarCategoryPrefix = "google:";
+
+// What the API takes as ID of the user's primary calendar.
+static const char* kPrimaryCalendar = "primary";
+
+static const char* kBatchUrl = "https://www.googleapis.com/batch/calendar/v3";
+
+// Not one of the methods HttpRequest.h has a constant for.
+static const char* kHttpPatch = "PATCH";
+
 class LoginDialog : public BWindow {
 	public:
-		LoginDialog(EventSync* sync, BString* authString)
+		LoginDialog(sem_id doneSem, BString* authString)
 			:
 			BWindow(BRect(),"Authorization", B_TITLED_WINDOW,
 				B_NOT_RESIZABLE | B_NOT_ZOOMABLE)
@@ -49,6 +67,7 @@ class LoginDialog : public BWindow {
 				"Google Calendar API Authorization");
 
 			fAuthString = authString;
+			fDoneSem = doneSem;
 
 			BFont font;
 			fLabel->GetFont(&font);
@@ -95,6 +114,7 @@ class LoginDialog : public BWindow {
 				case kAuthCode:
 				{
 					fAuthString->SetTo(fAuthCodeText->Text());
+					release_sem(fDoneSem);
 					Quit();
 					break;
 				}
@@ -106,7 +126,9 @@ class LoginDialog : public BWindow {
 		bool
 		QuitRequested()
 		{
-			fAuthString->SetTo("NOT_FOUND");
+			// Closed without a code.
+			fAuthString->SetTo("");
+			release_sem(fDoneSem);
 			return true;
 		}
 
@@ -116,89 +138,75 @@ class LoginDialog : public BWindow {
 		BTextControl*		fAuthCodeText;
 		BButton*		fLogin;
 		BString*		fAuthString;
+		sem_id			fDoneSem;
 };
 
 
 EventSync::EventSync()
 	:
-	fAuthCode()
+	EventSync(new SQLiteManager())
+{
+}
+
+
+EventSync::EventSync(SQLiteManager* manager)
+	:
+	fAuthCode(),
+	fDBManager(manager),
+	fCalendar(NULL),
+	fWindowStart(0),
+	fWindowEnd(0),
+	fBackfilling(false),
+	fNextCalendar(0),
+	fPagesLock("sync pages")
 {
-	fDBManager = new SQLiteManager();
-	fEvents = new BList();
-	fCancelledEvents = new BStringList();
+	fPagesSem = create_sem(0, "sync pages");
+	fQueuedBytes = 0;
+	fSpaceWaiters = 0;
+	fSpaceSem = create_sem(0, "sync page space");
 }
 
 
 EventSync::~EventSync()
 {
+	for (size_t i = 0; i < fCalendars.size(); i++)
+		delete fCalendars[i];
+	delete_sem(fPagesSem);
+	delete_sem(fSpaceSem);
 	delete fDBManager;
-	delete fEvents;
-	delete fCancelledEvents;
 }
 
 
 status_t
 EventSync::Sync()
 {
-	if (LoadToken() == B_OK ) {
-		if (RequestToken() != B_OK)
-			RequestAuthorizationCode();
-	}
-	else
-		RequestAuthorizationCode();
-
-	if (GetEvents() != B_OK)
+	status_t status = _SetAuthorization();
+	if (status == B_NOT_ALLOWED && RequestAuthorizationCode() == B_OK)
+		status = _SetAuthorization();
+	if (status != B_OK)
 		return B_ERROR;
 
-	if (SyncWithDatabase() !=  B_OK)
-		return B_ERROR;
-
-	return B_OK;
-}
-
+	// Local changes go first, so the pull can't undo them.
+	status_t pushStatus = PushChanges();
+	if (pushStatus == B_NOT_ALLOWED)
+		TokenManager::Default()->Invalidate();
 
-status_t
-EventSync::LoadToken()
-{
-	BPasswordKey key;
-	BKeyStore keyStore;
-	if(keyStore.GetKey(kAppName, B_KEY_TYPE_PASSWORD, "refresh_token", key) == B_OK) {
-		fRefreshToken = key.Password();
-		return B_OK;
+	if (GetEvents() != B_OK) {
+		// Maybe for the token; the next sync gets a new one.
+		TokenManager::Default()->Invalidate();
+		return B_ERROR;
 	}
-	return B_ERROR;
-}
-
 
-status_t
-EventSync::RequestToken()
-{
-	BHttpForm* form = new BHttpForm();
-	form->AddString("refresh_token", fRefreshToken);
-	form->AddString("client_id", CLIENT_ID);
-	form->AddString("client_secret", CLIENT_SECRET);
-	form->AddString("grant_type", "refresh_token");
-	form->SetFormType(B_HTTP_FORM_URL_ENCODED);
-	BString url("https://www.googleapis.com/oauth2/v4/token");
-
-	BMessage refreshJson;
-	Requests::Request(url, B_HTTP_GET, NULL, form, NULL, refreshJson);
-
-	fToken = BString(refreshJson.GetString("access_token", "NOT_FOUND"));
-	if (fToken.Compare("NOT_FOUND") == 0)
-	{
-		BPasswordKey key;
-		BKeyStore keyStore;
-		keyStore.GetKey(kAppName, B_KEY_TYPE_PASSWORD, "refresh_token", key);
-		keyStore.RemoveKey(kAppName, key);
+	if (SyncWithDatabase() !=  B_OK)
 		return B_ERROR;
-	}
 
-	return B_OK;
+	return pushStatus;
 }
 
 
-void
+// Has the user authorize the application in the browser, and waits for the
+// code Google gave them.
+status_t
 EventSync::RequestAuthorizationCode()
 {
 	BString endpoint("https://accounts.google.com/o/oauth2/auth");
@@ -211,348 +219,1088 @@ EventSync::RequestAuthorizationCode()
 	endpoint.Append("&access_type=offline");
 	const char* args[] = { endpoint.String(), 0 };
 	be_roster->Launch("application/x-vnd.Be.URL.http", 1, const_cast<char **>(args));
-	LoginDialog* loginWindow = new LoginDialog(this, &fAuthCode);
+
+	sem_id doneSem = create_sem(0, "authorization code");
+	if (doneSem < B_OK)
+		return doneSem;
+
+	fAuthCode = "";
+	LoginDialog* loginWindow = new LoginDialog(doneSem, &fAuthCode);
 	loginWindow->Show();
 
-	while (fAuthCode.IsEmpty())
-		snooze(1000);
+	status_t status;
+	do {
+		status = acquire_sem(doneSem);
+	} while (status == B_INTERRUPTED);
+	delete_sem(doneSem);
 
-	NextStep();
+	if (status != B_OK)
+		return status;
+	return TokenManager::Default()->Authorize(fAuthCode);
 }
 
 
-void
-EventSync::NextStep()
+// Keystore key of some sync state of a calendar, from before it was kept
+// in the database. The primary calendar kept the keys it had when it was
+// the only one.
+static BString
+StateKey(const char* name, CalendarSync* calendar)
 {
-	BHttpForm* form = new BHttpForm();
-	form->AddString("code",fAuthCode);
-	form->AddString("client_id",CLIENT_ID);
-	form->AddString("client_secret",CLIENT_SECRET);
-	form->AddString("grant_type","authorization_code");
-	form->AddString("redirect_uri",REDIRECT_URI);
-	form->SetFormType(B_HTTP_FORM_URL_ENCODED);
+	BString key(name);
+	if (!calendar->IsPrimary())
+		key << "/" << calendar->Id();
+	return key;
+}
 
-	BString oauth2("https://www.googleapis.com/oauth2/v3/token");
-	BMessage tokenJson;
 
-	Requests::Request(oauth2, B_HTTP_GET, NULL, form, NULL, tokenJson);
+// The calendar synced events are kept under. Changes are pushed before the
+// calendar list is read, when the primary calendar is only known by the
+// ID the API takes for it, so the pulled events are kept under that too.
+static const char*
+SyncedCalendarId(CalendarSync* calendar)
+{
+	return calendar->IsPrimary() ? kPrimaryCalendar : calendar->Id();
+}
 
-	fToken = BString(tokenJson.GetString("access_token","NOT_FOUND"));
-	fRefreshToken = BString(tokenJson.GetString("refresh_token","NOT_FOUND"));
 
-	BPasswordKey key(fRefreshToken, B_KEY_PURPOSE_WEB, "refresh_token");
-	BKeyStore keyStore;
-	keyStore.AddKeyring(kAppName);
-	keyStore.AddKey(kAppName, key);
+// Google only takes lowercase base32hex characters in event IDs, and local
+// IDs are UUIDs; dropping their dashes is enough.
+static BString
+GoogleEventId(const char* id)
+{
+	BString googleId;
+	for (const char* c = id; *c != '\0'; c++) {
+		char lower = tolower(*c);
+		if ((lower >= '0' && lower <= '9') || (lower >= 'a' && lower <= 'v'))
+			googleId << lower;
+	}
+	return googleId;
 }
 
 
+static void
+AppendJsonString(BString& json, const char* string)
+{
+	json << '"';
+	for (const char* c = string; *c != '\0'; c++) {
+		switch (*c) {
+			case '"':
+				json << "\\\"";
+				break;
+			case '\\':
+				json << "\\\\";
+				break;
+			case '\n':
+				json << "\\n";
+				break;
+			case '\r':
+				json << "\\r";
+				break;
+			case '\t':
+				json << "\\t";
+				break;
+			default:
+				if ((unsigned char)*c < 0x20)
+					json << BString().SetToFormat("\\u%04x", *c);
+				else
+					json << *c;
+				break;
+		}
+	}
+	json << '"';
+}
+
+
+// Midnight UTC of the same day months later, or of the last day of that
+// month if it is shorter.
+static time_t
+AddMonths(time_t time, int32 months)
+{
+	CivilDate date = CivilFromDays(DaysFromTime(time));
+	int64 month = (int64)date.year * 12 + date.month - 1 + months;
+	int64 year = FloorDivide(month, 12);
+	int32 monthOfYear = FloorModulo(month, 12) + 1;
+	int32 day = std::min(date.day, DaysInMonth(year, monthOfYear));
+	return DayStart(DaysFromCivil(year, monthOfYear, day));
+}
+
+
+// The sync token and where an interrupted sync left off. Without a sync
+// token, the next sync is a full one.
 status_t
-EventSync::LoadSyncToken()
+EventSync::LoadSyncState(CalendarSync* calendar)
+{
+	SyncState state;
+	if (!fDBManager->GetSyncState(calendar->Id(), state)
+		&& !_ImportKeyStoreState(calendar, state))
+		return B_ERROR;
+
+	calendar->SetSyncToken(state.syncToken.String());
+	if (!state.resumeUrl.IsEmpty() && !state.resumeBackfill) {
+		// The pages read so far were of this window.
+		calendar->SetWindow(state.windowStart, state.windowEnd);
+		calendar->SetResumePoint(state.resumeUrl.String(),
+			state.resumePageToken.String(), false);
+	}
+
+	return state.syncToken.IsEmpty() ? B_ERROR : B_OK;
+}
+
+
+// Moves what older versions kept in the keystore to the database, once.
+bool
+EventSync::_ImportKeyStoreState(CalendarSync* calendar, SyncState& state)
 {
-	BPasswordKey key;
 	BKeyStore keyStore;
-	if(keyStore.GetKey(kAppName, B_KEY_TYPE_PASSWORD, "nextSyncToken", key) == B_OK) {
-		fLastSyncToken = key.Password();
-		if (fLastSyncToken.Compare("NOT_FOUND") == 0)
-			return B_ERROR;
-		return B_OK;
+	BPasswordKey tokenKey;
+	BPasswordKey backfillKey;
+	bool hasToken = keyStore.GetKey(kAppName, B_KEY_TYPE_PASSWORD,
+		StateKey("nextSyncToken", calendar).String(), tokenKey) == B_OK;
+	bool hasBackfill = keyStore.GetKey(kAppName, B_KEY_TYPE_PASSWORD,
+		StateKey("syncBackfill", calendar).String(), backfillKey) == B_OK;
+	if (!hasToken && !hasBackfill)
+		return false;
+
+	// Failed syncs used to store this instead of a token.
+	if (hasToken && strcmp(tokenKey.Password(), "NOT_FOUND") != 0)
+		state.syncToken = tokenKey.Password();
+
+	int64 start;
+	int64 end;
+	if (hasBackfill && sscanf(backfillKey.Password(),
+			"%" B_SCNd64 " %" B_SCNd64, &start, &end) == 2) {
+		state.needsBackfill = true;
+		state.windowStart = start;
+		state.windowEnd = end;
 	}
-	return B_ERROR;
+
+	if (!fDBManager->SetSyncState(calendar->Id(), state))
+		return false;
+
+	if (hasToken)
+		keyStore.RemoveKey(kAppName, tokenKey);
+	if (hasBackfill)
+		keyStore.RemoveKey(kAppName, backfillKey);
+	return true;
 }
 
+
+// Every calendar of the user's calendar list is downloaded on its own
+// thread, see _RunCalendars(). Full syncs only get the events of the sync
+// window, the others are left to Backfill().
 status_t
 EventSync::GetEvents()
 {
-	BString url("https://www.googleapis.com/calendar/v3/calendars/primary/events");
+	if (_SetAuthorization() != B_OK)
+		return B_ERROR;
+
+	OutboxList entries;
+	fDBManager->GetOutbox(entries);
+	fPendingChanges.clear();
+	for (size_t i = 0; i < entries.size(); i++)
+		fPendingChanges.insert(entries[i].eventId);
 
-	if (LoadSyncToken() == B_OK) {
-		url.Append("?syncToken=");
-		url.Append(fLastSyncToken);
+	if (_GetCalendars() != B_OK)
+		return B_ERROR;
+
+	BList* categories = fDBManager->GetAllCategories();
+	for (size_t i = 0; i < fCalendars.size(); i++) {
+		CalendarSync* calendar = fCalendars[i];
+		if (_SetCategory(calendar, categories) != B_OK)
+			calendar->SetFailed();
+		calendar->SetWindow(fWindowStart, fWindowEnd);
+		LoadSyncState(calendar);
+		LoadBackfill(calendar);
 	}
-	else
-		url.Append("?showDeleted=true");
+	for (int32 i = 0; i < categories->CountItems(); i++)
+		delete (Category*)categories->ItemAt(i);
+	delete categories;
 
-	BString  auth;
-	auth.SetToFormat("OAuth %s", fToken.String());
-	BHttpHeaders* headers = new BHttpHeaders();
-	headers->AddHeader("Authorization", auth.String());
+	return _RunCalendars(false);
+}
 
-	BMessage eventJson;
-	BString nextPageToken;
-	BString nextSyncToken;
 
-	do {
-		if (!eventJson.IsEmpty())
-			eventJson.MakeEmpty();
+// The months before and after today full syncs get. 0 syncs everything on
+// that side.
+void
+EventSync::SetSyncWindow(int32 monthsBefore, int32 monthsAfter)
+{
+	time_t now = time(NULL);
+	fWindowStart = monthsBefore > 0 ? AddMonths(now, -monthsBefore) : 0;
+	fWindowEnd = monthsAfter > 0 ? AddMonths(now, monthsAfter) : 0;
+}
 
-		if (Requests::Request(url, B_HTTP_GET, headers, NULL, NULL, eventJson)
-				== B_ERROR)
-			return B_ERROR;
 
-		if (ParseEvent(&eventJson) == B_ERROR)
-			return B_ERROR;
+// Whether a calendar still misses the events outside the window of its full
+// sync, possibly since an earlier sync that was interrupted.
+bool
+EventSync::NeedsBackfill()
+{
+	bool needsBackfill = false;
+	for (size_t i = 0; i < fCalendars.size(); i++) {
+		CalendarSync* calendar = fCalendars[i];
+		if (!calendar->HasFailed() && LoadBackfill(calendar) == B_OK)
+			needsBackfill = true;
+	}
+	return needsBackfill;
+}
 
-		nextPageToken = BString(eventJson.GetString("nextPageToken", "NOT_FOUND"));
-		url.Append("?pageToken=");
-		url.Append(nextPageToken);
 
-	} while (nextPageToken.Compare("NOT_FOUND") != 0);
+// Gets the events left out by the full syncs, after GetEvents().
+status_t
+EventSync::Backfill()
+{
+	if (!NeedsBackfill())
+		return B_OK;
 
-	nextSyncToken  = BString(eventJson.GetString("nextSyncToken", "NOT_FOUND"));
+	// Backfills can come long after the sync, its token may have expired.
+	if (_SetAuthorization() != B_OK)
+		return B_ERROR;
 
-	BPasswordKey key(nextSyncToken, B_KEY_PURPOSE_WEB, "nextSyncToken");
-	BKeyStore keyStore;
-	keyStore.AddKey(kAppName, key);
+	status_t status = _RunCalendars(true);
+	if (SyncWithDatabase() != B_OK)
+		return B_ERROR;
+	return status;
+}
+
+
+// A pending backfill keeps the window of the full sync it completes, and
+// goes on where it was interrupted.
+status_t
+EventSync::LoadBackfill(CalendarSync* calendar)
+{
+	calendar->SetNeedsBackfill(false);
 
-	if (nextSyncToken.Compare("NOT_FOUND") == 0) {
-		fprintf(stderr, "Error: nextSyncToken not found in API response.\n");
+	SyncState state;
+	if (!fDBManager->GetSyncState(calendar->Id(), state)
+		|| !state.needsBackfill)
 		return B_ERROR;
-	}
 
+	calendar->SetWindow(state.windowStart, state.windowEnd);
+	calendar->SetNeedsBackfill(true);
+	if (state.resumeBackfill) {
+		calendar->SetResumePoint(state.resumeUrl.String(),
+			state.resumePageToken.String(), true);
+	}
 	return B_OK;
 }
 
 
+// Downloads the calendars, or backfills those needing it, on up to
+// kMaxWorkers threads. Their requests share the RequestEngine, which
+// bounds the number of connections. This thread is the only one writing
+// to the database: pages are queued for it once they have been read, see
+// PageRead(), and each one is written in a single transaction.
 status_t
-EventSync::ParseEvent(BMessage* eventJson)
+EventSync::_RunCalendars(bool backfill)
 {
-	BMessage items;
-	eventJson->FindMessage("items", &items);
-	int32 eventsCount = items.CountNames(B_ANY_TYPE);
-	if (eventsCount == 0) {
-		fprintf(stderr, "0 items found in API response.\n");
-		return B_OK;
+	fRunList.clear();
+	for (size_t i = 0; i < fCalendars.size(); i++) {
+		CalendarSync* calendar = fCalendars[i];
+		if (!backfill || (calendar->NeedsBackfill() && !calendar->HasFailed()))
+			fRunList.push_back(calendar);
 	}
 
-	for (int32 currentEvent = 0; currentEvent < eventsCount; currentEvent++) {
-		std::ostringstream ss;
-		ss << currentEvent;
-		BMessage event;
-		if (items.FindMessage(ss.str().c_str(), &event) != B_OK) {
-			fprintf(stderr, "Error: Item %d notfound in API response.\n",
-				currentEvent);
-			return B_ERROR;
+	fBackfilling = backfill;
+	fNextCalendar = 0;
+	int32 workerCount = std::min((int32)fRunList.size(), (int32)kMaxWorkers);
+	std::vector<thread_id> workers;
+	for (int32 i = 0; i < workerCount; i++) {
+		thread_id worker = spawn_thread(_Worker, "calendar sync",
+			B_NORMAL_PRIORITY, this);
+		if (worker < 0)
+			break;
+		workers.push_back(worker);
+		resume_thread(worker);
+	}
+
+	if (workers.empty() && !fRunList.empty())
+		return B_ERROR;
+
+	status_t status = B_OK;
+	size_t finished = 0;
+	while (finished < fRunList.size()) {
+		if (acquire_sem(fPagesSem) != B_OK)
+			continue;
+
+		fPagesLock.Lock();
+		SyncPage* page = fPages.front();
+		fPages.pop_front();
+		fPagesLock.Unlock();
+
+		CalendarSync* calendar = page->calendar;
+		if (page->last) {
+			finished++;
+			if (page->status == B_OK && !calendar->HasFailed())
+				_StoreState(calendar);
+			else
+				status = B_ERROR;
+		} else if (!calendar->HasFailed() && _WritePage(page) != B_OK)
+			calendar->SetFailed();
+
+		fPagesLock.Lock();
+		fQueuedBytes -= page->size;
+		if (fSpaceWaiters > 0) {
+			release_sem_etc(fSpaceSem, fSpaceWaiters, 0);
+			fSpaceWaiters = 0;
 		}
+		fPagesLock.Unlock();
+		delete page;
+	}
 
-		const char* name;
-		const char* place;
-		const char* location;
-		const char* description;
-		const char* id;
+	for (size_t i = 0; i < workers.size(); i++)
+		wait_for_thread(workers[i], NULL);
 
-		BString eventStatus;
-		BString updatedString;
-		BString startString;
-		BString endString;
+	return status;
+}
 
-		time_t startDateTime;
-		time_t endDateTime;
-		time_t updated;
 
-		bool status;
-		bool notified;
+// Called from the download threads. Waits while the events the writer has
+// yet to write take more than kMaxQueuedBytes, so memory use doesn't depend
+// on the number of calendars or the size of their pages. A page is always
+// taken when nothing else is queued, however large.
+bool
+EventSync::PageRead(SyncPage* page)
+{
+	if (!page->last && page->calendar->HasFailed()) {
+		delete page;
+		return false;
+	}
 
-		event.FindString("id", &id);
-		event.FindString("status", &eventStatus);
+	fPagesLock.Lock();
+	while (fQueuedBytes > 0 && fQueuedBytes + page->size > kMaxQueuedBytes) {
+		fSpaceWaiters++;
+		fPagesLock.Unlock();
+		while (acquire_sem(fSpaceSem) == B_INTERRUPTED)
+			;
+		fPagesLock.Lock();
+	}
 
-		if (eventStatus == BString(kEventStatusToGCalStatus[kConfirmedEvent])
-			|| eventStatus == BString(kEventStatusToGCalStatus[kTentativeEvent])) {
-			status = kConfirmedEvent;
-		}
-		else if (eventStatus == BString(kEventStatusToGCalStatus[kCancelledEvent]))
-			status = kCancelledEvent;
+	fQueuedBytes += page->size;
+	fPages.push_back(page);
+	fPagesLock.Unlock();
+	release_sem(fPagesSem);
 
-		if (status == kCancelledEvent) {
-			fCancelledEvents->Add(BString(id));
-			continue;
-		}
+	return true;
+}
 
-		if (event.FindString("summary", &name) != B_OK)
-			name = "Untitled Event";
 
-		if (event.FindString("location", &place) != B_OK)
-			place = "";
+int32
+EventSync::_Worker(void* data)
+{
+	((EventSync*)data)->_DownloadCalendars();
+	return 0;
+}
 
-		if (event.FindString("description", &description) != B_OK)
-			description = "";
 
-		event.FindString("updated", &updatedString);
-		updated = RFC3339ToTime(updatedString, kEventUpdateDate);
+void
+EventSync::_DownloadCalendars()
+{
+	while (true) {
+		int32 index = atomic_add(&fNextCalendar, 1);
+		if (index >= (int32)fRunList.size())
+			break;
+
+		if (fBackfilling)
+			fRunList[index]->Backfill(fHeaders, this);
+		else
+			fRunList[index]->Download(fHeaders, this);
+	}
+}
 
-		// TODO:
-		// Check for events having only start date (all day event).
-		// Check whether reminder option is set on or off in GCal event.
-		// Incorporate color IDs of GCal events into Calendar.
-		// Add support for multiple calendar, treat them as a category maybe?
 
-		BMessage start;
-		if (event.FindMessage("start", &start) != B_OK) {
-			fprintf(stderr, "Error: StartTime not found in API response.\n");
-			return B_ERROR;
-		}
-		start.FindString("dateTime", &startString);
-		startDateTime = RFC3339ToTime(startString, kEventStartEndDate);
+// Reads the user's calendar list, which may come in several pages.
+status_t
+EventSync::_GetCalendars()
+{
+	for (size_t i = 0; i < fCalendars.size(); i++)
+		delete fCalendars[i];
+	fCalendars.clear();
 
-		BMessage end;
-		if (event.FindMessage("end", &end) != B_OK) {
-			fprintf(stderr, "Error: EndTime not found in API response.\n");
+	BString pageToken;
+	do {
+		BString url("https://www.googleapis.com/calendar/v3/users/me/calendarList");
+		url << "?fields="
+			<< BUrl::UrlEncode("nextPageToken,items(id,summary,"
+				"summaryOverride,backgroundColor,primary,deleted)", true);
+		if (!pageToken.IsEmpty())
+			url << "&pageToken=" << BUrl::UrlEncode(pageToken, true);
+
+		BMessage reply;
+		if (Requests::Request(url, B_HTTP_GET, &fHeaders, NULL, NULL, reply)
+				!= B_OK)
 			return B_ERROR;
+
+		BMessage items;
+		reply.FindMessage("items", &items);
+		int32 count = items.CountNames(B_ANY_TYPE);
+		for (int32 i = 0; i < count; i++) {
+			BString name;
+			name << i;
+			BMessage item;
+			if (items.FindMessage(name.String(), &item) != B_OK)
+				continue;
+
+			const char* id = item.GetString("id", NULL);
+			if (id == NULL || item.GetBool("deleted", false))
+				continue;
+
+			const char* summary = item.GetString("summaryOverride",
+				item.GetString("summary", id));
+			fCalendars.push_back(new CalendarSync(id, summary,
+				item.GetString("backgroundColor", ""),
+				item.GetBool("primary", false)));
 		}
 
-		end.FindString("dateTime", &endString);
-		endDateTime = RFC3339ToTime(endString, kEventStartEndDate);
+		pageToken = reply.GetString("nextPageToken", "");
+	} while (!pageToken.IsEmpty());
 
-		notified = (difftime(startDateTime, BDateTime::CurrentDateTime(B_LOCAL_TIME).Time_t()) < 0) ? true : false;
+	return B_OK;
+}
 
-		BList* categoryList = fDBManager->GetAllCategories();
-		Category* category;
-		for (int32 i = 0; i < categoryList->CountItems(); i++) {
-			category = ((Category*)categoryList->ItemAt(i));
-			if (BString(category->GetName()) == BString("Default"))
-				break;
+
+// The primary calendar goes to the default category, like when it was the
+// only one synced. The others get a category of their own, identified by
+// the calendar, so it is found again whatever it has been renamed to.
+status_t
+EventSync::_SetCategory(CalendarSync* calendar, BList* categories)
+{
+	BString id;
+	if (!calendar->IsPrimary())
+		id << kCalendarCategoryPrefix << calendar->Id();
+
+	for (int32 i = 0; i < categories->CountItems(); i++) {
+		Category* category = (Category*)categories->ItemAt(i);
+		if ((calendar->IsPrimary() && category->GetName() == "Default")
+			|| (!calendar->IsPrimary() && id == category->GetId())) {
+			calendar->SetCategory(new Category(*category));
+			return B_OK;
+		}
+	}
+
+	if (calendar->IsPrimary())
+		return B_ERROR;
+
+	// Names and colors of categories are unique, and Google's aren't.
+	BString name(calendar->Name());
+	for (int32 i = 0; i < categories->CountItems(); i++) {
+		if (((Category*)categories->ItemAt(i))->GetName() == name) {
+			name << " (Google)";
+			break;
 		}
+	}
+	if (name.CountChars() < 3)
+		name << " (Google)";
+
+	BString color(calendar->Color());
+	color.RemoveAll("#");
+	rgb_color rgb = color.Length() == 6
+		? HexToRGB(color) : HexToRGB(BString("1E90FF"));
+
+	for (int32 attempt = 0; attempt < 16; attempt++) {
+		Category* category = new Category(name, rgb, id.String());
+		if (fDBManager->AddCategory(category)) {
+			calendar->SetCategory(category);
+			return B_OK;
+		}
+		delete category;
+		rgb.blue = rgb.blue < 255 ? rgb.blue + 1 : rgb.blue - 1;
+	}
 
-		Category* newCategory = new Category(*category);
+	fprintf(stderr, "Error: No category for calendar %s.\n", calendar->Name());
+	return B_ERROR;
+}
 
-		Event* newEvent = new Event(name, place, description, false,
-			startDateTime, endDateTime, newCategory, notified, updated,
-			status, id);
 
-		fEvents->AddItem(newEvent);
+// The events of the page and where the download goes on after it are
+// committed together, so an interrupted sync neither skips nor needs to
+// read again what was written.
+status_t
+EventSync::_WritePage(SyncPage* page)
+{
+	if (!fDBManager->BeginTransaction())
+		return B_ERROR;
+
+	// Events in the middle of a page go on from that page.
+	CalendarSync* calendar = page->calendar;
+	SyncState progress;
+	progress.resumePageToken = page->pageEnd
+		? page->nextPageToken : page->pageToken;
+	progress.resumeUrl = progress.resumePageToken.IsEmpty() ? "" : page->url;
+	progress.resumeBackfill = calendar->IsBackfilling();
+	progress.windowStart = calendar->WindowStart();
+	progress.windowEnd = calendar->WindowEnd();
+	progress.highWater = 0;
+
+	fCalendar = calendar;
+	for (size_t i = 0; i < page->events.size(); i++) {
+		const GoogleEvent& event = page->events[i];
+		if (ParseEvent(event) != B_OK) {
+			fDBManager->RollbackTransaction();
+			return B_ERROR;
+		}
+
+		time_t updated;
+		bool isDate;
+		if (RFC3339ToTime(event.updated.c_str(), updated, isDate))
+			progress.highWater = std::max(progress.highWater, updated);
 	}
 
+	if (!fDBManager->SetSyncProgress(calendar->Id(), progress)) {
+		fDBManager->RollbackTransaction();
+		return B_ERROR;
+	}
+
+	if (!fDBManager->CommitTransaction())
+		return B_ERROR;
+
 	return B_OK;
 }
 
 
+// Once a download is complete, it has nothing to resume. A backfill only
+// changes whether another one is needed.
+void
+EventSync::_StoreState(CalendarSync* calendar)
+{
+	SyncState state;
+	fDBManager->GetSyncState(calendar->Id(), state);
+
+	if (!calendar->IsBackfilling())
+		state.syncToken = calendar->NextSyncToken();
+	state.resumeUrl = "";
+	state.resumePageToken = "";
+	state.resumeBackfill = false;
+	state.needsBackfill = calendar->NeedsBackfill();
+	state.windowStart = calendar->WindowStart();
+	state.windowEnd = calendar->WindowEnd();
+
+	if (!fDBManager->SetSyncState(calendar->Id(), state)) {
+		fprintf(stderr, "Error: Sync state of %s not stored.\n",
+			calendar->Name());
+	}
+}
+
+
+// Writes one event of the events list to the database, or removes it if it
+// was cancelled.
 status_t
-EventSync::AddEvent(Event* event)
+EventSync::ParseEvent(const GoogleEvent& event)
 {
-	BString url("https://www.googleapis.com/calendar/v3/calendars/primary/events");
-	BString  auth;
-	auth.SetToFormat("OAuth %s", fToken.String());
-	BHttpHeaders* headers = new BHttpHeaders();
-	headers->AddHeader("Authorization", auth.String());
-	headers->AddHeader("Content-Type", "application/json");
-	BString jsonString;
-	jsonString.Append("{");
-	jsonString += BString().SetToFormat("\"id\":\"%s\",", event->GetId());
-	jsonString += BString().SetToFormat("\"summary\":\"%s\",", event->GetName());
-	jsonString += BString().SetToFormat("\"location\":\"%s\",", event->GetPlace());
-	jsonString += BString().SetToFormat("\"description\":\"%s\",", event->GetDescription());
-
-	EventStatus eventStatus = static_cast<EventStatus>(event->GetStatus());
-	BString statusString = kEventStatusToGCalStatus[eventStatus];
-	jsonString += BString().SetToFormat("\"status\": \"%s\",", statusString);
-
-	BString start = TimeToRFC3339(event->GetStartDateTime());
-	jsonString += BString().SetToFormat("\"start\":{\"dateTime\":\"%s\"},", start.String());
-
-	BString end = TimeToRFC3339(event->GetEndDateTime());
-	jsonString += BString().SetToFormat("\"end\":{\"dateTime\":\"%s\"}", end.String());
-	jsonString.Append("}");
-
-	BMessage reply;
-	if (Requests::Request(url, B_HTTP_POST, headers, NULL, &jsonString, reply)
-		== B_ERROR)
+	const char* googleId = event.id.c_str();
+	BString id;
+	bool known = _SyncedEventId(googleId, id);
+
+	time_t startDateTime;
+	time_t endDateTime;
+	time_t updated;
+
+	bool status = kConfirmedEvent;
+	bool notified;
+	bool allDay;
+	bool isDate;
+
+	if (event.status == kEventStatusToGCalStatus[kCancelledEvent])
+		status = kCancelledEvent;
+
+	if (status == kCancelledEvent)
+		return known ? _RemoveEvent(googleId, id.String()) : B_OK;
+
+	const char* name = event.summary.empty()
+		? "Untitled Event" : event.summary.c_str();
+
+	if (!RFC3339ToTime(event.updated.c_str(), updated, isDate))
+		updated = time(NULL);
+
+	// TODO:
+	// Check whether reminder option is set on or off in GCal event.
+	// Incorporate color IDs of GCal events into Calendar.
+
+	// All day events only have a date.
+	const std::string& startString = event.start.dateTime.empty()
+		? event.start.date : event.start.dateTime;
+	if (startString.empty()) {
+		fprintf(stderr, "Error: StartTime not found in API response.\n");
 		return B_ERROR;
+	}
+	if (!RFC3339ToTime(startString.c_str(), startDateTime, allDay)) {
+		fprintf(stderr, "Error: Invalid StartTime %s.\n",
+			startString.c_str());
+		return B_ERROR;
+	}
+
+	const std::string& endString = event.end.dateTime.empty()
+		? event.end.date : event.end.dateTime;
+	if (endString.empty()) {
+		fprintf(stderr, "Error: EndTime not found in API response.\n");
+		return B_ERROR;
+	}
+	if (!RFC3339ToTime(endString.c_str(), endDateTime, isDate)) {
+		fprintf(stderr, "Error: Invalid EndTime %s.\n", endString.c_str());
+		return B_ERROR;
+	}
+
+	// The end date is exclusive, all day events end on the last second
+	// of the day before.
+	if (isDate)
+		endDateTime--;
+
+	notified = (difftime(startDateTime, BDateTime::CurrentDateTime(B_LOCAL_TIME).Time_t()) < 0) ? true : false;
+
+	Event newEvent(name, event.location.c_str(), event.description.c_str(),
+		allDay, startDateTime, endDateTime, fCalendar->GetCategory(), notified,
+		updated, status, known ? id.String() : NULL);
+
+	// Times are UTC already, the zone only says where the event was
+	// planned. All day events float.
+	const char* timeZone = event.start.timeZone.c_str();
+	if (!allDay && ZoneInfo::Get(timeZone) != NULL)
+		newEvent.SetTimeZone(timeZone);
+
+	return _StoreEvent(&newEvent, googleId);
 }
 
 
+// Sends the changes waiting in the outbox, in batches. A change that can't
+// be sent now is tried again later, after a delay doubling with every
+// attempt; one Google refuses is dropped. Either way the other changes of
+// its batch go on.
 status_t
-EventSync::DeleteEvent(Event* event)
-{
-	BString endpoint("https://www.googleapis.com/calendar/v3/calendars/primary/events/");
-	endpoint.Append(event->GetId());
-	endpoint.Append("?access_token=");
-	endpoint.Append(fToken);
-	BMessage reply;
-	if (Requests::Request(endpoint, B_HTTP_DELETE, NULL, NULL, NULL, reply)
-		== B_ERROR)
+EventSync::PushChanges()
+{
+	status_t authStatus = _SetAuthorization();
+	if (authStatus != B_OK)
+		return authStatus;
+
+	OutboxList entries;
+	if (!fDBManager->GetOutbox(entries))
 		return B_ERROR;
+
+	// The outbox entry of every queued change.
+	std::vector<size_t> changeEntries;
+	time_t now = time(NULL);
+	fChanges.clear();
+	for (size_t i = 0; i < entries.size(); i++) {
+		const OutboxEntry& entry = entries[i];
+		if (entry.nextAttempt > now)
+			continue;
+
+		BString calendar = _CalendarOfCategory(entry.categoryId.String());
+		int32 change = -1;
+		if (!calendar.IsEmpty()) {
+			// Events created here get the ID they are created with.
+			BString id;
+			if (!fDBManager->GetGoogleEventId(calendar.String(),
+					entry.eventId.String(), id))
+				id = GoogleEventId(entry.eventId.String());
+			change = _QueueEntry(entry, id, calendar);
+		}
+
+		// Not in a synced calendar, deleted locally since, or changed in
+		// nothing the calendar keeps.
+		if (change < 0) {
+			fDBManager->RemoveOutboxEntry(entry);
+			continue;
+		}
+		changeEntries.push_back(i);
+	}
+
+	if (fChanges.empty())
+		return B_OK;
+
+	SendChanges();
+
+	// Deleting an event that isn't there counts as done. An insert that
+	// got through earlier without an answer, or an update of an event that
+	// never was pushed, is tried again the other way.
+	bool retry = false;
+	for (size_t i = 0; i < fChanges.size(); i++) {
+		Change& change = fChanges[i];
+		if (change.method == B_HTTP_DELETE
+			&& (change.statusCode == 404 || change.statusCode == 410)) {
+			change.statusCode = kNoContent;
+		} else if (change.method == B_HTTP_POST && change.statusCode == 409) {
+			change.method = B_HTTP_PUT;
+			change.json = change.fullJson;
+			change.statusCode = 0;
+			retry = true;
+		} else if (change.method == kHttpPatch && change.statusCode == 404) {
+			change.method = B_HTTP_POST;
+			change.json = change.fullJson;
+			change.statusCode = 0;
+			retry = true;
+		}
+	}
+	if (retry)
+		SendChanges();
+
+	status_t status = B_OK;
+	for (size_t i = 0; i < fChanges.size(); i++) {
+		const OutboxEntry& entry = entries[changeEntries[i]];
+		const Change& change = fChanges[i];
+		int32 code = change.statusCode;
+		if (code >= 200 && code < 300) {
+			fDBManager->RemoveOutboxEntry(entry);
+			if (change.method == B_HTTP_DELETE) {
+				fDBManager->RemoveSyncedEvent(change.calendar.String(),
+					change.id.String(), entry.eventId.String());
+			} else {
+				fDBManager->SetSyncedEvent(change.calendar.String(),
+					change.id.String(), entry.eventId.String());
+			}
+		} else if (code == 401) {
+			// Kept as it is, everything would fail the same way again.
+			status = B_NOT_ALLOWED;
+		} else if (code < 0 || code == 429 || code >= 500) {
+			int32 shift = std::min(entry.attempts, (int32)16);
+			time_t delay = std::min(kRetryDelay << shift,
+				(time_t)kMaxRetryDelay);
+			fDBManager->DeferOutboxEntry(entry, now + delay);
+			if (status == B_OK)
+				status = B_ERROR;
+		} else {
+			fprintf(stderr, "Error: Change of event %s refused (%" B_PRId32
+				"), dropping it.\n", entry.eventId.String(), code);
+			fDBManager->RemoveOutboxEntry(entry);
+			if (status == B_OK)
+				status = B_ERROR;
+		}
+	}
+
+	if (status == B_NOT_ALLOWED)
+		fprintf(stderr, "Error: Not authorized to push changes.\n");
+
+	fChanges.clear();
+	return status;
 }
 
 
-status_t
-EventSync::SyncWithDatabase()
+// Queues the request for the change of an outbox entry, or returns -1 if
+// the event isn't there anymore or there is nothing to send.
+int32
+EventSync::_QueueEntry(const OutboxEntry& entry, const BString& id,
+	const BString& calendar)
+{
+	if (entry.operation == kOutboxDelete)
+		return DeleteEvent(id, calendar);
+
+	Event* event = fDBManager->GetEvent(entry.eventId.String());
+	if (event == NULL)
+		return -1;
+
+	int32 change;
+	if (entry.operation == kOutboxInsert)
+		change = AddEvent(event, id, calendar);
+	else
+		change = UpdateEvent(event, id, calendar, entry.fields);
+
+	delete event;
+	return change;
+}
+
+
+int32
+EventSync::AddEvent(Event* event, const BString& id, const BString& calendar)
 {
-	Event* newEvent;
-	Event* event;
+	BString json = _EventToJson(event, id, kAllEventFields);
+	return _QueueChange(B_HTTP_POST, id, calendar, &json, &json);
+}
+
+
+// Patches the properties of the given fields only. Returns -1 if Google
+// keeps none of them.
+int32
+EventSync::UpdateEvent(Event* event, const BString& id,
+	const BString& calendar, uint32 fields)
+{
+	BString json = _EventToJson(event, BString(), fields);
+	if (json.IsEmpty())
+		return -1;
+
+	BString fullJson = _EventToJson(event, id, kAllEventFields);
+	return _QueueChange(kHttpPatch, id, calendar, &json, &fullJson);
+}
 
-	for (int32 i = 0; i < fEvents->CountItems(); i++) {
-		newEvent = ((Event*)fEvents->ItemAt(i));
-		event = fDBManager->GetEvent(newEvent->GetId());
 
-		if ((event != NULL) && (difftime(newEvent->GetUpdated(), event->GetUpdated()) > 0)) {
-			if (fDBManager->UpdateEvent(event, newEvent) == false)
-				return B_ERROR;
+int32
+EventSync::DeleteEvent(const BString& id, const BString& calendar)
+{
+	return _QueueChange(B_HTTP_DELETE, id, calendar, NULL);
+}
+
+
+// Sends the changes that weren't sent yet, BatchCall::kMaxParts to a
+// batch. The batches run side by side on the RequestEngine. A batch that
+// fails as a whole fails each of its changes.
+void
+EventSync::SendChanges()
+{
+	std::vector<BatchCall*> batches;
+	std::vector<std::vector<size_t> > batchChanges;
+
+	for (size_t i = 0; i < fChanges.size(); i++) {
+		const Change& change = fChanges[i];
+		if (change.statusCode != 0)
+			continue;
+
+		if (batches.empty()
+			|| batches.back()->CountParts() == BatchCall::kMaxParts) {
+			batches.push_back(new BatchCall(kBatchUrl));
+			batchChanges.push_back(std::vector<size_t>());
 		}
 
-		else if ((event == NULL) && (fDBManager->AddEvent(newEvent) == false))
-			return B_ERROR;
+		BString path("/calendar/v3/calendars/");
+		path << BUrl::UrlEncode(change.calendar, true) << "/events";
+		if (change.method != B_HTTP_POST)
+			path << "/" << BUrl::UrlEncode(change.id, true);
+
+		batches.back()->AddPart(change.method.String(), path,
+			change.method == B_HTTP_DELETE ? NULL : &change.json);
+		batchChanges.back().push_back(i);
 	}
 
-	const char* cancelId;
-	for (int32 i = 0; i < fCancelledEvents->CountStrings(); i++) {
-		cancelId = ((const char*)fCancelledEvents->StringAt(i));
-		event  = fDBManager->GetEvent(cancelId);
-		if (event != NULL)  {
-			if (fDBManager->RemoveEvent(event) == false)
-				return B_ERROR;
+	for (size_t i = 0; i < batches.size(); i++)
+		batches[i]->Send(fHeaders);
+
+	for (size_t i = 0; i < batches.size(); i++) {
+		BatchCall* batch = batches[i];
+		status_t status = batch->Wait();
+
+		// The status code of an answer, or the error of the connection.
+		int32 code = status;
+		if (batch->StatusCode() != 0 && batch->StatusCode() != 200)
+			code = batch->StatusCode();
+		if (status != B_OK)
+			fprintf(stderr, "Batch of changes failed: %" B_PRId32 "\n", code);
+
+		for (int32 part = 0; part < batch->CountParts(); part++) {
+			Change& change = fChanges[batchChanges[i][part]];
+			change.statusCode = status == B_OK
+				? batch->PartStatusCode(part) : code;
 		}
+		delete batch;
 	}
+}
+
+
+int32
+EventSync::ChangeStatusCode(int32 change)
+{
+	return fChanges[change].statusCode;
+}
 
+
+int32
+EventSync::_QueueChange(const char* method, const BString& id,
+	const BString& calendar, const BString* json, const BString* fullJson)
+{
+	Change change;
+	change.method = method;
+	change.id = id;
+	change.calendar = calendar;
+	if (json != NULL)
+		change.json = *json;
+	if (fullJson != NULL)
+		change.fullJson = *fullJson;
+	change.statusCode = 0;
+
+	fChanges.push_back(change);
+	return fChanges.size() - 1;
+}
+
+
+// Events are written as they are read by GetEvents(), what's left is
+// cleaning up.
+status_t
+EventSync::SyncWithDatabase()
+{
 	fDBManager->RemoveCancelledEvents();
 
 	return B_OK;
 }
 
 
-time_t
-EventSync::RFC3339ToTime(const char* timeString, EventDateType type)
+// The local ID of an event of the calendar being written. Events synced
+// before they were kept per calendar have the Google ID as ID; one of them
+// in this calendar's category is taken over as its event.
+bool
+EventSync::_SyncedEventId(const char* googleId, BString& eventId)
+{
+	const char* calendar = SyncedCalendarId(fCalendar);
+	if (fDBManager->GetSyncedEventId(calendar, googleId, eventId))
+		return true;
+
+	Event* event = fDBManager->GetEvent(googleId);
+	bool found = event != NULL && strcmp(event->GetCategory()->GetId(),
+		fCalendar->GetCategory()->GetId()) == 0;
+	delete event;
+
+	if (!found || !fDBManager->SetSyncedEvent(calendar, googleId, googleId))
+		return false;
+
+	eventId = googleId;
+	return true;
+}
+
+
+// Changes still waiting in the outbox win over the pulled ones. Google
+// also marks an event updated for changes of what isn't stored, like its
+// attendees; an event whose content hashes the same isn't written again.
+status_t
+EventSync::_StoreEvent(Event* newEvent, const char* googleId)
+{
+	if (fPendingChanges.find(newEvent->GetId()) != fPendingChanges.end())
+		return B_OK;
+
+	uint64 hash;
+	time_t updated;
+	if (!fDBManager->GetEventHash(newEvent->GetId(), hash, updated)) {
+		return fDBManager->AddEvent(newEvent)
+			&& fDBManager->SetSyncedEvent(SyncedCalendarId(fCalendar),
+				googleId, newEvent->GetId()) ? B_OK : B_ERROR;
+	}
+
+	if (difftime(newEvent->GetUpdated(), updated) <= 0
+		|| hash == newEvent->Hash())
+		return B_OK;
+
+	return fDBManager->UpdateEvent(newEvent, newEvent) ? B_OK : B_ERROR;
+}
+
+
+status_t
+EventSync::_RemoveEvent(const char* googleId, const char* eventId)
 {
-	struct tm timeinfo;
-	int	year = 0;
-	int	month = 0;
-	int	day	= 0;
-	int	hour = 0;
-	int	minute = 0;
-	int	second = 0;
-	int zoneHour = 0;
-	int zoneMinute = 0;
+	if (fPendingChanges.find(eventId) != fPendingChanges.end())
+		return B_OK;
+
+	return fDBManager->RemoveSyncedEvent(SyncedCalendarId(fCalendar), googleId,
+		eventId) ? B_OK : B_ERROR;
+}
+
+
+// Dates and times without an offset are local wall clock time, the others
+// are converted exactly.
+bool
+EventSync::RFC3339ToTime(const char* timeString, time_t& time, bool& isDate)
+{
+	RFC3339Time parsed;
+	if (!ParseRFC3339(timeString, parsed))
+		return false;
+
+	isDate = parsed.isDate;
+	time = parsed.time;
+	if (!parsed.hasOffset)
+		time = ZonedTimeFromLocal(parsed.time, *ZoneInfo::Local());
+
+	return true;
+}
+
 
-	if (static_cast<EventDateType>(type) == kEventStartEndDate) {
-		sscanf (timeString, "%d-%d-%dT%d:%d:%d%d:%d", &year, &month, &day,
-           &hour, &minute, &second, &zoneHour, &zoneMinute);
+// The properties the calendar keeps of the given fields, to insert the
+// event, with its ID, or to patch it, without. Empty if there is none.
+// All day events have dates, with an exclusive end; their days are those
+// of the local zone, where they were entered. The other kind of start and
+// end is cleared, since a patch may switch between them.
+BString
+EventSync::_EventToJson(Event* event, const BString& id, uint32 fields)
+{
+	BString json;
+	if (!id.IsEmpty()) {
+		json << ",\"id\":";
+		AppendJsonString(json, id.String());
+	}
+	if ((fields & kEventName) != 0) {
+		json << ",\"summary\":";
+		AppendJsonString(json, event->GetName());
+	}
+	if ((fields & kEventPlace) != 0) {
+		json << ",\"location\":";
+		AppendJsonString(json, event->GetPlace());
+	}
+	if ((fields & kEventDescription) != 0) {
+		json << ",\"description\":";
+		AppendJsonString(json, event->GetDescription());
 	}
 
-	else if (static_cast<EventDateType>(type) == kEventUpdateDate) {
-		sscanf (timeString, "%d-%d-%dT%d:%d:%d.%d'Z'", &year, &month, &day,
-           &hour, &minute, &second);
+	uint32 timeFields = kEventAllDay | kEventStart | kEventEnd
+		| kEventTimeZone;
+	if ((fields & timeFields) != 0 && event->IsAllDay()) {
+		const ZoneInfo& zone = *ZoneInfo::Local();
+		CivilDate start = CivilFromDays(
+			ZonedDaysFromTime(event->GetStartDateTime(), zone));
+		CivilDate end = CivilFromDays(
+			ZonedDaysFromTime(event->GetEndDateTime(), zone) + 1);
+		json << BString().SetToFormat(",\"start\":{\"date\":"
+			"\"%04" B_PRId32 "-%02" B_PRId32 "-%02" B_PRId32 "\","
+			"\"dateTime\":null,\"timeZone\":null}",
+			start.year, start.month, start.day);
+		json << BString().SetToFormat(",\"end\":{\"date\":"
+			"\"%04" B_PRId32 "-%02" B_PRId32 "-%02" B_PRId32 "\","
+			"\"dateTime\":null,\"timeZone\":null}",
+			end.year, end.month, end.day);
+	} else if ((fields & timeFields) != 0) {
+		BString timeZone(",\"timeZone\":");
+		if (event->GetTimeZone()[0] != '\0')
+			AppendJsonString(timeZone, event->GetTimeZone());
+		else
+			timeZone << "null";
+
+		json << ",\"start\":{\"date\":null,\"dateTime\":\""
+			<< TimeToRFC3339(event->GetStartDateTime()) << "\"" << timeZone
+			<< "}";
+		json << ",\"end\":{\"date\":null,\"dateTime\":\""
+			<< TimeToRFC3339(event->GetEndDateTime()) << "\"" << timeZone
+			<< "}";
 	}
 
-	timeinfo.tm_year = year - 1900;
-	timeinfo.tm_mon = month - 1;
-	timeinfo.tm_mday = day;
-	timeinfo.tm_hour = hour;
-	timeinfo.tm_min = minute;
-	timeinfo.tm_sec = second;
+	if (json.IsEmpty())
+		return json;
+
+	json.Remove(0, 1).Prepend("{");
+	json << "}";
+	return json;
+}
+
+
+status_t
+EventSync::_SetAuthorization()
+{
+	BString token;
+	status_t status = TokenManager::Default()->GetAccessToken(token);
+	if (status != B_OK)
+		return status;
 
-	int offset = (-timezone - (zoneHour* 3600 + zoneMinute * 60));
+	BString  auth;
+	auth.SetToFormat("OAuth %s", token.String());
+	fHeaders.Clear();
+	fHeaders.AddHeader("Authorization", auth.String());
+	return B_OK;
+}
 
-	return mktime(&timeinfo) + offset;
+
+// The primary calendar syncs to the default category, the others to the
+// categories made for them. Events of other categories stay local.
+BString
+EventSync::_CalendarOfCategory(const char* categoryId)
+{
+	BString id(categoryId);
+	if (id.StartsWith(kCalendarCategoryPrefix))
+		return id.Remove(0, strlen(kCalendarCategoryPrefix));
+
+	BString calendar;
+	Category* category = fDBManager->GetCategory(categoryId);
+	if (category != NULL && category->GetName() == "Default")
+		calendar = kPrimaryCalendar;
+	delete category;
+	return calendar;
 }
 
 
 BString
 EventSync::TimeToRFC3339(time_t timeT)
 {
-	BString timeString;
-	BDateFormat dateFormat;
-
-	dateFormat.SetDateFormat(B_SHORT_DATE_FORMAT, "y-MM-dd'T'HH:mm:ssXXX");
-	dateFormat.Format(timeString, timeT,
-		B_SHORT_DATE_FORMAT);
-	return timeString;
+	char buffer[kRFC3339MaxLength + 1];
+	FormatRFC3339(timeT, 0, buffer);
+	return BString(buffer);
 }
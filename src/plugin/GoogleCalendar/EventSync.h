@@ -5,12 +5,23 @@
 #ifndef _EVENT_SYNC_H
 #define _EVENT_SYNC_H
 
+#include <deque>
+#include <set>
+#include <vector>
+
+#include <HttpHeaders.h>
 #include <InterfaceKit.h>
+#include <Locker.h>
 #include <String.h>
 
+#include "CalendarSync.h"
+
 class BList;
+class Category;
 class Event;
 class SQLiteManager;
+struct OutboxEntry;
+struct SyncState;
 
 
 #define CLIENT_SECRET "sH095g9EzY5BxwI-DHIlqVXr"
@@ -20,11 +31,9 @@ class SQLiteManager;
 
 static const uint32 kSyncStatusMessage = 'kssm';
 
-
-enum EventDateType {
-	kEventUpdateDate,
-	kEventStartEndDate,
-};
+// The window of a full sync, around today.
+static const int32 kDefaultSyncMonthsBefore = 12;
+static const int32 kDefaultSyncMonthsAfter = 24;
 
 
 enum EventStatus {
@@ -34,44 +43,122 @@ enum EventStatus {
 };
 
 
-class EventSync {
+class EventSync : public SyncPageWriter {
 	public:
 									EventSync();
-									~EventSync();
+									// Takes over the manager.
+									EventSync(SQLiteManager* manager);
+		virtual						~EventSync();
 
 		void						MessageReceived(BMessage* message);
 
-		status_t					LoadToken();
-		status_t					LoadSyncToken();
-		status_t					RequestToken();
-		void						NextStep();
-		void						RequestAuthorizationCode();
+		status_t					LoadSyncState(CalendarSync* calendar);
+		status_t					LoadBackfill(CalendarSync* calendar);
+		status_t					RequestAuthorizationCode();
 
 		status_t					Sync();
 
 		status_t					SyncWithDatabase();
 
-		status_t					AddEvent(Event* event);
-		status_t					UpdateEvent(Event* event);
-		status_t					DeleteEvent(Event* event);
+		status_t					PushChanges();
+		// Queue a change for SendChanges(), and return its number.
+		int32						AddEvent(Event* event, const BString& id,
+										const BString& calendar);
+		int32						UpdateEvent(Event* event,
+										const BString& id,
+										const BString& calendar,
+										uint32 fields);
+		int32						DeleteEvent(const BString& id,
+										const BString& calendar);
+		virtual	void				SendChanges();
+		// The status code of the response to a change, or an error.
+		int32						ChangeStatusCode(int32 change);
 		status_t					GetEvents();
 
-		status_t					ParseEvent(BMessage* eventJson);
+		void						SetSyncWindow(int32 monthsBefore,
+										int32 monthsAfter);
+		bool						NeedsBackfill();
+		status_t					Backfill();
+
+		virtual	bool				PageRead(SyncPage* page);
+		status_t					ParseEvent(const GoogleEvent& event);
 
 		BString						TimeToRFC3339(time_t timeT);
-		time_t						RFC3339ToTime(const char* timeString,
-										EventDateType type);
+		bool						RFC3339ToTime(const char* timeString,
+										time_t& time, bool& isDate);
+
+	protected:
+		// A change queued for the next batch, and what came of it.
+		struct Change {
+			BString					method;
+			BString					id;
+			BString					calendar;
+			BString					json;
+			BString					fullJson;
+			int32					statusCode;
+		};
+
+		virtual	status_t			_SetAuthorization();
+		status_t					_WritePage(SyncPage* page);
+
+		std::vector<Change>			fChanges;
 
 	private:
+		int32						_QueueChange(const char* method,
+										const BString& id,
+										const BString& calendar,
+										const BString* json,
+										const BString* fullJson = NULL);
+		int32						_QueueEntry(const OutboxEntry& entry,
+										const BString& id,
+										const BString& calendar);
+		BString						_EventToJson(Event* event,
+										const BString& id, uint32 fields);
+		BString						_CalendarOfCategory(
+										const char* categoryId);
+		bool						_SyncedEventId(const char* googleId,
+										BString& eventId);
+		status_t					_StoreEvent(Event* newEvent,
+										const char* googleId);
+		status_t					_RemoveEvent(const char* googleId,
+										const char* eventId);
+		status_t					_GetCalendars();
+		status_t					_SetCategory(CalendarSync* calendar,
+										BList* categories);
+		status_t					_RunCalendars(bool backfill);
+		void						_StoreState(CalendarSync* calendar);
+		bool						_ImportKeyStoreState(
+										CalendarSync* calendar,
+										SyncState& state);
+
+		static	int32				_Worker(void* data);
+		void						_DownloadCalendars();
+
 		static const uint32			fStatus;
+		static const int32			kMaxWorkers = 8;
+		static const size_t			kMaxQueuedBytes = 1024 * 1024;
+		static const time_t			kRetryDelay = 60;
+		static const time_t			kMaxRetryDelay = 6 * 60 * 60;
+		static const int32			kNoContent = 204;
 
-		BString 					fToken;
-		BString 					fRefreshToken;
 		BString						fAuthCode;
 		SQLiteManager*				fDBManager;
-		BString						fLastSyncToken;
-		BList*						fEvents;
-		BStringList*				fCancelledEvents;
+		CalendarSync*				fCalendar;
+		BHttpHeaders				fHeaders;
+		time_t						fWindowStart;
+		time_t						fWindowEnd;
+		std::set<BString>			fPendingChanges;
+
+		std::vector<CalendarSync*>	fCalendars;
+		std::vector<CalendarSync*>	fRunList;
+		bool						fBackfilling;
+		int32						fNextCalendar;
+		BLocker						fPagesLock;
+		std::deque<SyncPage*>		fPages;
+		sem_id						fPagesSem;
+		size_t						fQueuedBytes;
+		int32						fSpaceWaiters;
+		sem_id						fSpaceSem;
 };
 
 #endif
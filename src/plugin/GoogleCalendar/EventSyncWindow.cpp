@@ -27,6 +27,8 @@ EventSyncWindow::EventSyncWindow()
 	:
 	BWindow(BRect(), "Google Calendar Sync", B_TITLED_WINDOW,
 		B_NOT_ZOOMABLE | B_NOT_RESIZABLE),
+	fSyncMonthsBefore(kDefaultSyncMonthsBefore),
+	fSyncMonthsAfter(kDefaultSyncMonthsAfter),
 	fSynchronizationThread(-1)
 {
 	BPath syncDataPath;
@@ -68,6 +70,14 @@ EventSyncWindow::MessageReceived(BMessage* message)
 			message->FindBool("status", &status);
 			_SaveSyncData(status);
 			be_app->WindowAt(0)->PostMessage(kSynchronizationComplete);
+
+			// Events outside the sync window are still coming.
+			if (message->GetBool("backfilling", false)) {
+				fStatusLabel->SetText("Synced, getting older events"
+					B_UTF8_ELLIPSIS);
+				break;
+			}
+
 			_StopSynchronizationThread();
 			break;
 		}
@@ -125,6 +135,8 @@ EventSyncWindow::_StartSynchronizationThread()
 	if (fSynchronizationThread < 0) {
 		fThreadMessage = new BMessage();
 		fThreadMessage->AddPointer("handler", this);
+		fThreadMessage->AddInt32("syncMonthsBefore", fSyncMonthsBefore);
+		fThreadMessage->AddInt32("syncMonthsAfter", fSyncMonthsAfter);
 		fSynchronizationThread = spawn_thread(SynchronizationLoop,
 			"Synchronization Thread", B_NORMAL_PRIORITY, fThreadMessage);
 		resume_thread(fSynchronizationThread);
@@ -136,7 +148,8 @@ void
 EventSyncWindow::_StopSynchronizationThread()
 {
 	if (fSynchronizationThread > 0) {
-		kill_thread(fSynchronizationThread);
+		// It ends right after sending its last status.
+		wait_for_thread(fSynchronizationThread, NULL);
 		delete fThreadMessage;
 		fSynchronizationThread = -1;
 	}
@@ -176,6 +189,10 @@ EventSyncWindow::_LoadSyncData()
 			message->FindData("syncTime", B_RAW_TYPE,
 				(const void**)&lastSyncTime, &size);
 			_SetStatusLabel(lastSyncStatus, *lastSyncTime);
+			fSyncMonthsBefore = message->GetInt32("syncMonthsBefore",
+				kDefaultSyncMonthsBefore);
+			fSyncMonthsAfter = message->GetInt32("syncMonthsAfter",
+				kDefaultSyncMonthsAfter);
 		}
 	}
 
@@ -205,6 +222,8 @@ EventSyncWindow::_SaveSyncData(bool status)
 		message->AddBool("syncStatus", status);
 		message->AddData("syncTime", B_RAW_TYPE, (void*)&syncTime,
 			sizeof(time_t));
+		message->AddInt32("syncMonthsBefore", fSyncMonthsBefore);
+		message->AddInt32("syncMonthsAfter", fSyncMonthsAfter);
 		message->Flatten(file);
 	}
 
@@ -43,6 +43,9 @@ private:
 	BView*			fMainView;
 	BPath			fSyncDataFile;
 
+	int32			fSyncMonthsBefore;
+	int32			fSyncMonthsAfter;
+
 	thread_id		fSynchronizationThread;
 	BMessage*		fThreadMessage;
 };
@@ -0,0 +1,490 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "RequestEngine.h"
+
+#include <algorithm>
+
+#include <Autolock.h>
+#include <HttpRequest.h>
+#include <Json.h>
+#include <Url.h>
+
+
+HttpCall::HttpCall(const BString& url, const char* method)
+	:
+	ProtocolListener(false),
+	fUrl(url),
+	fMethod(method),
+	fForm(NULL),
+	fTimeout(RequestEngine::kDefaultTimeout),
+	fStreamed(false),
+	fEngine(NULL),
+	fListener(NULL),
+	fRequest(NULL),
+	fThread(-1),
+	fDeadline(0),
+	fLock("http call"),
+	fStatusCode(0),
+	fStatus(B_BUSY),
+	fCompleted(false),
+	fSucceeded(false),
+	fCancelled(false),
+	fTimedOut(false)
+{
+	fDoneSem = create_sem(0, "http call done");
+	fDataSem = create_sem(0, "http call data");
+}
+
+
+HttpCall::~HttpCall()
+{
+	if (fThread >= 0)
+		wait_for_thread(fThread, NULL);
+	delete fRequest;
+	delete fForm;
+	delete_sem(fDoneSem);
+	delete_sem(fDataSem);
+}
+
+
+void
+HttpCall::SetHeaders(const BHttpHeaders& headers)
+{
+	fHeaders = headers;
+}
+
+
+void
+HttpCall::SetForm(const BHttpForm& form)
+{
+	delete fForm;
+	fForm = new BHttpForm(form);
+}
+
+
+void
+HttpCall::SetBody(const BString& body)
+{
+	fRequestBody = body;
+}
+
+
+// Counted from the start of the request, not from when it was queued.
+void
+HttpCall::SetTimeout(bigtime_t timeout)
+{
+	fTimeout = timeout;
+}
+
+
+void
+HttpCall::SetStreamed(bool streamed)
+{
+	fStreamed = streamed;
+}
+
+
+status_t
+HttpCall::Wait()
+{
+	while (acquire_sem(fDoneSem) == B_INTERRUPTED)
+		;
+	// Let the next Wait() through as well.
+	release_sem(fDoneSem);
+
+	return Status();
+}
+
+
+status_t
+HttpCall::Status()
+{
+	BAutolock _(fLock);
+	return fStatus;
+}
+
+
+// 0 until the headers have been received.
+int32
+HttpCall::StatusCode()
+{
+	BAutolock _(fLock);
+	return fStatusCode;
+}
+
+
+BString
+HttpCall::ResponseHeader(const char* name)
+{
+	BAutolock _(fLock);
+	return BString(fResponseHeaders[name]);
+}
+
+
+// Only valid once the call is done. Streamed calls only keep the body of
+// an error response.
+const char*
+HttpCall::Body() const
+{
+	return (const char*)fBody.Buffer();
+}
+
+
+size_t
+HttpCall::BodyLength() const
+{
+	return fBody.BufferLength();
+}
+
+
+status_t
+HttpCall::ParseJson(BMessage& message) const
+{
+	BString json(Body(), BodyLength());
+	if (json.IsEmpty())
+		return B_BAD_DATA;
+	return BJson::Parse(json, message);
+}
+
+
+bool
+HttpCall::Read(std::string& data)
+{
+	while (true) {
+		fLock.Lock();
+		if (!fQueue.empty()) {
+			data.swap(fQueue.front());
+			fQueue.pop_front();
+			fLock.Unlock();
+			return true;
+		}
+
+		bool completed = fCompleted;
+		fLock.Unlock();
+		if (completed)
+			return false;
+
+		if (acquire_sem(fDataSem) != B_OK)
+			return false;
+	}
+}
+
+
+void
+HttpCall::HeadersReceived(BUrlRequest* caller, const BUrlResult& result)
+{
+	const BHttpResult* httpResult = dynamic_cast<const BHttpResult*>(&result);
+
+	BAutolock _(fLock);
+	if (httpResult != NULL) {
+		fStatusCode = httpResult->StatusCode();
+		fResponseHeaders = httpResult->Headers();
+	}
+}
+
+
+void
+HttpCall::DataReceived(BUrlRequest* caller, const char* data,
+	off_t position, ssize_t size)
+{
+	BAutolock _(fLock);
+
+	// The body of an error isn't what a reader of the stream expects, it
+	// is kept like that of an unstreamed call. Reading it to its end
+	// rather than stopping the request leaves Status() at B_OK.
+	if (!fStreamed || fStatusCode != 200) {
+		fBody.Write(data, size);
+		return;
+	}
+
+	fQueue.push_back(std::string(data, size));
+	release_sem(fDataSem);
+}
+
+
+void
+HttpCall::RequestCompleted(BUrlRequest* caller, bool success)
+{
+	fLock.Lock();
+	fCompleted = true;
+	fSucceeded = success;
+	fLock.Unlock();
+
+	release_sem(fDataSem);
+	fEngine->_Wake();
+}
+
+
+// #pragma mark -
+
+
+RequestEngine::RequestEngine(int32 maxRunning)
+	:
+	fLock("request engine"),
+	fQuitting(false),
+	fMaxRunning(std::max(maxRunning, (int32)1))
+{
+	fWakeSem = create_sem(0, "request engine wake");
+	fThread = spawn_thread(_Thread, "request engine", B_NORMAL_PRIORITY,
+		this);
+	resume_thread(fThread);
+}
+
+
+// Cancels whatever is still queued or running.
+RequestEngine::~RequestEngine()
+{
+	fLock.Lock();
+	fQuitting = true;
+	fLock.Unlock();
+
+	CancelAll();
+	wait_for_thread(fThread, NULL);
+	delete_sem(fWakeSem);
+}
+
+
+void
+RequestEngine::Queue(HttpCall* call, HttpCallListener* listener)
+{
+	call->fEngine = this;
+	call->fListener = listener;
+
+	fLock.Lock();
+	fQueued.push_back(call);
+	fLock.Unlock();
+
+	_Wake();
+}
+
+
+// A queued call is done at once; a running one is stopped and is done
+// once its thread ended. Either way it ends with B_CANCELED.
+void
+RequestEngine::Cancel(HttpCall* call)
+{
+	BAutolock _(fLock);
+
+	std::deque<HttpCall*>::iterator queued
+		= std::find(fQueued.begin(), fQueued.end(), call);
+	if (queued != fQueued.end()) {
+		fQueued.erase(queued);
+		call->fLock.Lock();
+		call->fCancelled = true;
+		call->fCompleted = true;
+		call->fLock.Unlock();
+		fFinished.push_back(call);
+		_Wake();
+		return;
+	}
+
+	if (std::find(fRunning.begin(), fRunning.end(), call) != fRunning.end()) {
+		call->fLock.Lock();
+		call->fCancelled = true;
+		call->fLock.Unlock();
+		call->fRequest->Stop();
+	}
+}
+
+
+void
+RequestEngine::CancelAll()
+{
+	BAutolock _(fLock);
+
+	while (!fQueued.empty()) {
+		HttpCall* call = fQueued.front();
+		fQueued.pop_front();
+		call->fLock.Lock();
+		call->fCancelled = true;
+		call->fCompleted = true;
+		call->fLock.Unlock();
+		fFinished.push_back(call);
+	}
+
+	for (size_t i = 0; i < fRunning.size(); i++) {
+		HttpCall* call = fRunning[i];
+		call->fLock.Lock();
+		call->fCancelled = true;
+		call->fLock.Unlock();
+		call->fRequest->Stop();
+	}
+
+	_Wake();
+}
+
+
+int32
+RequestEngine::RunningCount()
+{
+	BAutolock _(fLock);
+	return fRunning.size();
+}
+
+
+int32
+RequestEngine::QueuedCount()
+{
+	BAutolock _(fLock);
+	return fQueued.size();
+}
+
+
+RequestEngine*
+RequestEngine::Default()
+{
+	static RequestEngine engine;
+	return &engine;
+}
+
+
+int32
+RequestEngine::_Thread(void* data)
+{
+	((RequestEngine*)data)->_Run();
+	return 0;
+}
+
+
+// Reaps the calls that ended, stops those past their deadline and starts
+// queued ones, then sleeps until a call ends, one is queued or the next
+// deadline comes. Listeners are called without the lock held.
+void
+RequestEngine::_Run()
+{
+	while (true) {
+		std::vector<HttpCall*> done;
+		bigtime_t timeout = B_INFINITE_TIMEOUT;
+
+		fLock.Lock();
+		done.swap(fFinished);
+
+		bigtime_t now = system_time();
+		for (size_t i = 0; i < fRunning.size();) {
+			HttpCall* call = fRunning[i];
+
+			call->fLock.Lock();
+			bool completed = call->fCompleted;
+			if (!completed && !call->fCancelled && !call->fTimedOut
+				&& call->fDeadline <= now) {
+				call->fTimedOut = true;
+				call->fRequest->Stop();
+			}
+			bool stopping = call->fCancelled || call->fTimedOut;
+			call->fLock.Unlock();
+
+			if (completed) {
+				done.push_back(call);
+				fRunning.erase(fRunning.begin() + i);
+				continue;
+			}
+
+			if (!stopping)
+				timeout = std::min(timeout, call->fDeadline - now);
+			i++;
+		}
+
+		while ((int32)fRunning.size() < fMaxRunning && !fQueued.empty()) {
+			HttpCall* call = fQueued.front();
+			fQueued.pop_front();
+
+			if (_Start(call)) {
+				fRunning.push_back(call);
+				timeout = std::min(timeout, call->fDeadline - now);
+			} else
+				done.push_back(call);
+		}
+
+		bool quit = fQuitting && fQueued.empty() && fRunning.empty()
+			&& fFinished.empty();
+		fLock.Unlock();
+
+		for (size_t i = 0; i < done.size(); i++) {
+			HttpCall* call = done[i];
+			if (call->fThread >= 0) {
+				wait_for_thread(call->fThread, NULL);
+				call->fThread = -1;
+			}
+
+			status_t status;
+			call->fLock.Lock();
+			if (call->fCancelled)
+				status = B_CANCELED;
+			else if (call->fTimedOut)
+				status = B_TIMED_OUT;
+			else if (call->fStatus != B_BUSY)
+				status = call->fStatus;
+			else
+				status = call->fSucceeded ? B_OK : B_ERROR;
+			call->fLock.Unlock();
+
+			_Complete(call, status);
+		}
+
+		if (quit)
+			break;
+
+		acquire_sem_etc(fWakeSem, 1, B_RELATIVE_TIMEOUT, timeout);
+	}
+}
+
+
+// Called with the lock held.
+bool
+RequestEngine::_Start(HttpCall* call)
+{
+	BUrl url(call->fUrl);
+	call->fRequest = new BHttpRequest(url, url.Protocol() == "https", "HTTP",
+		call);
+	call->fRequest->SetMethod(call->fMethod.String());
+	call->fRequest->SetHeaders(call->fHeaders);
+
+	if (call->fForm != NULL)
+		call->fRequest->SetPostFields(*call->fForm);
+
+	if (!call->fRequestBody.IsEmpty()) {
+		BMemoryIO* data = new BMemoryIO(call->fRequestBody.String(),
+			call->fRequestBody.Length());
+		call->fRequest->AdoptInputData(data, call->fRequestBody.Length());
+	}
+
+	call->fDeadline = call->fTimeout == B_INFINITE_TIMEOUT
+		? B_INFINITE_TIMEOUT : system_time() + call->fTimeout;
+	call->fThread = call->fRequest->Run();
+	if (call->fThread < 0) {
+		call->fLock.Lock();
+		call->fStatus = call->fThread;
+		call->fCompleted = true;
+		call->fLock.Unlock();
+		return false;
+	}
+
+	return true;
+}
+
+
+void
+RequestEngine::_Complete(HttpCall* call, status_t status)
+{
+	call->fLock.Lock();
+	call->fStatus = status;
+	call->fCompleted = true;
+	HttpCallListener* listener = call->fListener;
+	call->fLock.Unlock();
+
+	release_sem(call->fDataSem);
+	release_sem(call->fDoneSem);
+
+	if (listener != NULL)
+		listener->CallCompleted(call);
+}
+
+
+void
+RequestEngine::_Wake()
+{
+	release_sem(fWakeSem);
+}
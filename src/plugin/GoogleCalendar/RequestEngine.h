@@ -0,0 +1,158 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _REQUEST_ENGINE_H_
+#define _REQUEST_ENGINE_H_
+
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <DataIO.h>
+#include <HttpForm.h>
+#include <HttpHeaders.h>
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+
+#include "Requests.h"
+
+
+class BHttpRequest;
+class HttpCall;
+class RequestEngine;
+
+
+class HttpCallListener {
+public:
+	virtual				~HttpCallListener() {}
+
+	// Called on the engine's thread once the call is done, whichever way.
+	// The call isn't used by the engine anymore and may be deleted.
+	virtual	void		CallCompleted(HttpCall* call) = 0;
+};
+
+
+// One HTTP request run by a RequestEngine. The response body is kept in
+// memory, or, for a streamed call, queued for Read() as it arrives so it
+// can be consumed while the rest is still downloading.
+//
+// A call is owned by whoever created it, and must not be deleted while it
+// is queued or running: wait for it either through Wait() or through the
+// listener, not both.
+class HttpCall : public ProtocolListener {
+public:
+					HttpCall(const BString& url,
+						const char* method = B_HTTP_GET);
+	virtual			~HttpCall();
+
+		void		SetHeaders(const BHttpHeaders& headers);
+		void		SetForm(const BHttpForm& form);
+		void		SetBody(const BString& body);
+		void		SetTimeout(bigtime_t timeout);
+		void		SetStreamed(bool streamed);
+
+		// Blocks until the call is done, and returns Status().
+		status_t	Wait();
+
+		// B_OK when a response was received, whatever its status code,
+		// B_TIMED_OUT, B_CANCELED, or the error of the connection.
+		status_t	Status();
+		int32		StatusCode();
+		// Empty if the response had no such header.
+		BString		ResponseHeader(const char* name);
+
+		const char*	Body() const;
+		size_t		BodyLength() const;
+		status_t	ParseJson(BMessage& message) const;
+
+		// For streamed calls: waits for the next part of the body. Returns
+		// false at its end, or once the call failed or got an error status.
+		// The body of an error is read to its end and left to Body().
+		bool		Read(std::string& data);
+
+	virtual	void	HeadersReceived(BUrlRequest* caller,
+						const BUrlResult& result);
+	virtual	void	DataReceived(BUrlRequest* caller, const char* data,
+						off_t position, ssize_t size);
+	virtual	void	RequestCompleted(BUrlRequest* caller, bool success);
+
+private:
+	friend class RequestEngine;
+
+		BString		fUrl;
+		BString		fMethod;
+		BHttpHeaders	fHeaders;
+		BHttpForm*	fForm;
+		BString		fRequestBody;
+		bigtime_t	fTimeout;
+		bool		fStreamed;
+
+		RequestEngine*	fEngine;
+		HttpCallListener*	fListener;
+		BHttpRequest*	fRequest;
+		thread_id	fThread;
+		bigtime_t	fDeadline;
+
+		BLocker		fLock;
+		sem_id		fDoneSem;
+		sem_id		fDataSem;
+		BMallocIO	fBody;
+		std::deque<std::string>	fQueue;
+		BHttpHeaders	fResponseHeaders;
+		int32		fStatusCode;
+		status_t	fStatus;
+		bool		fCompleted;
+		bool		fSucceeded;
+		bool		fCancelled;
+		bool		fTimedOut;
+};
+
+
+// Runs HttpCalls in the background, at most a fixed number at a time;
+// the others wait in order. Calls that take longer than their timeout are
+// stopped, and any call can be cancelled, queued or running. Completion
+// is reported through the call's listener or HttpCall::Wait().
+//
+// Haiku's HTTP client opens a connection per request, so the number of
+// running calls is also the number of open connections.
+class RequestEngine {
+public:
+					RequestEngine(int32 maxRunning = kDefaultMaxRunning);
+					~RequestEngine();
+
+		void		Queue(HttpCall* call, HttpCallListener* listener = NULL);
+		void		Cancel(HttpCall* call);
+		void		CancelAll();
+
+		int32		RunningCount();
+		int32		QueuedCount();
+
+		// The engine the sync plugin shares, created on first use.
+	static	RequestEngine*	Default();
+
+	static const int32		kDefaultMaxRunning = 6;
+	static const bigtime_t	kDefaultTimeout = 60 * 1000000LL;
+
+private:
+	friend class HttpCall;
+
+	static	int32		_Thread(void* data);
+		void		_Run();
+		bool		_Start(HttpCall* call);
+		void		_Complete(HttpCall* call, status_t status);
+		void		_Wake();
+
+		BLocker		fLock;
+		sem_id		fWakeSem;
+		thread_id	fThread;
+		bool		fQuitting;
+		int32		fMaxRunning;
+		std::deque<HttpCall*>	fQueued;
+		std::vector<HttpCall*>	fRunning;
+		std::vector<HttpCall*>	fFinished;
+};
+
+#endif	// _REQUEST_ENGINE_H_
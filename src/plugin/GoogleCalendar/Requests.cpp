@@ -0,0 +1,59 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "Requests.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "RequestEngine.h"
+
+
+status_t
+Requests::Request(BString url, const char* const method,
+	BHttpHeaders* headers, BHttpForm* form, const BString* jsonString,
+	BMessage& responseMessage)
+{
+	HttpCall call(url, method);
+
+	if (headers != NULL)
+		call.SetHeaders(*headers);
+
+	if (form != NULL)
+		call.SetForm(*form);
+
+	if (jsonString != NULL)
+		call.SetBody(*jsonString);
+
+	RequestEngine::Default()->Queue(&call);
+	status_t status = call.Wait();
+	if (status != B_OK) {
+		printf("Request failed: %s\n", strerror(status));
+		return B_ERROR;
+	}
+
+	int32 statusCode = call.StatusCode();
+	if (statusCode == 204)
+		return B_OK;
+
+	if (statusCode != 200) {
+		printf("Response code:  %d \n", statusCode);
+		return B_ERROR;
+	}
+
+	if (call.BodyLength() == 0) {
+		printf("No Json data found in response \n");
+		return B_ERROR;
+	}
+
+	status = call.ParseJson(responseMessage);
+	if (status == B_BAD_DATA) {
+		printf("Parser choked on JSON:\n%.*s\n", (int)call.BodyLength(),
+			call.Body());
+		return B_ERROR;
+	}
+
+	return B_OK;
+}
@@ -87,59 +87,10 @@ private:
 
 class Requests {
 	public:
+		// Runs a request on the shared RequestEngine and waits for it.
 		static status_t Request(BString url, const char* const method,
 			BHttpHeaders* headers, BHttpForm* form, const BString* jsonString,
-			BMessage& responseMessage)
-		{
-			ProtocolListener listener(true);
-			BHttpRequest request(BUrl(url), true, "HTTP", &listener);
-			request.SetMethod(method);
-
-			if (headers != NULL)
-				request.SetHeaders(*headers);
-
-			if (form != NULL)
-				request.SetPostFields(*form);
-
-			if (jsonString != NULL) {
-				BMemoryIO* data = new BMemoryIO(
-				jsonString->String(), jsonString->Length() - 1);
-				request.AdoptInputData(data, jsonString->Length() - 1);
-			}
-
-			BMallocIO replyData;
-			listener.SetDownloadIO(&replyData);
-
-			thread_id thread = request.Run();
-			wait_for_thread(thread, NULL);
-
-			BString responseJson;
-
-			const BHttpResult& result = dynamic_cast<const BHttpResult&>(
-				request.Result());
-
-			int32 statusCode = result.StatusCode();
-			if (statusCode != 200) {
-				printf("Response code:  %d \n", statusCode);
-				return B_ERROR;
-			}
-
-			responseJson.SetTo(static_cast<const char*>(replyData.Buffer()),
-				replyData.BufferLength());
-
-			if (responseJson.Length() == 0) {
-				printf("No Json data found in response \n");
-				return B_ERROR;
-			}
-
-			status_t status = BJson::Parse(responseJson, responseMessage);
-			if (status == B_BAD_DATA) {
-				printf("Parser choked on JSON:\n%s\n", responseJson.String());
-				return B_ERROR;
-			}
-
-			return B_OK;
-		}
+			BMessage& responseMessage);
 };
 
 #endif
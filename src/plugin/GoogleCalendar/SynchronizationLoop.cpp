@@ -8,6 +8,24 @@
 #include <Handler.h>
 
 
+static void
+SendStatus(BHandler* handler, status_t status, bool backfilling)
+{
+	BMessage statusMessage(kSyncStatusMessage);
+	BMessenger msgr(handler);
+
+	if (status != B_OK)
+		statusMessage.AddBool("status", false);
+	else
+		statusMessage.AddBool("status", true);
+	statusMessage.AddBool("backfilling", backfilling);
+
+	msgr.SendMessage(&statusMessage);
+}
+
+
+// The calendar can be used once the sync window is there, what's outside
+// of it comes after, and is reported with a second status message.
 int32
 SynchronizationLoop(void* data)
 {
@@ -20,15 +38,17 @@ SynchronizationLoop(void* data)
 	status = B_ERROR;
 
 	EventSync* sync = new EventSync();
+	sync->SetSyncWindow(
+		message->GetInt32("syncMonthsBefore", kDefaultSyncMonthsBefore),
+		message->GetInt32("syncMonthsAfter", kDefaultSyncMonthsAfter));
 	status = sync->Sync();
 
-	BMessage statusMessage(kSyncStatusMessage);
-	BMessenger msgr(handler);
+	bool backfilling = status == B_OK && sync->NeedsBackfill();
+	SendStatus(handler, status, backfilling);
 
-	if (status != B_OK)
-		statusMessage.AddBool("status", false);
-	else
-		statusMessage.AddBool("status", true);
+	if (backfilling)
+		SendStatus(handler, sync->Backfill(), false);
 
-	msgr.SendMessage(&statusMessage);
+	delete sync;
+	return 0;
 }
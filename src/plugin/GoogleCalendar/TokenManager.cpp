@@ -0,0 +1,202 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "TokenManager.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Autolock.h>
+#include <HttpForm.h>
+#include <Key.h>
+#include <KeyStore.h>
+
+#include "App.h"
+#include "EventSync.h"
+#include "RequestEngine.h"
+
+
+static const char* kTokenUrl = "https://www.googleapis.com/oauth2/v4/token";
+static const char* kRefreshTokenKey = "refresh_token";
+
+
+TokenManager::TokenManager()
+	:
+	fLock("token manager"),
+	fExpiry(0)
+{
+}
+
+
+TokenManager*
+TokenManager::Default()
+{
+	static TokenManager manager;
+	return &manager;
+}
+
+
+status_t
+TokenManager::GetAccessToken(BString& token)
+{
+	BAutolock _(fLock);
+
+	if (fAccessToken.IsEmpty()
+		|| system_time() >= fExpiry - (bigtime_t)kExpiryMargin) {
+		status_t status = _Refresh();
+		if (status != B_OK)
+			return status;
+	}
+
+	token = fAccessToken;
+	return B_OK;
+}
+
+
+status_t
+TokenManager::Authorize(const BString& code)
+{
+	BAutolock _(fLock);
+
+	if (code.IsEmpty())
+		return B_NOT_ALLOWED;
+
+	BHttpForm form;
+	form.AddString("code", code);
+	form.AddString("client_id", CLIENT_ID);
+	form.AddString("client_secret", CLIENT_SECRET);
+	form.AddString("grant_type", "authorization_code");
+	form.AddString("redirect_uri", REDIRECT_URI);
+
+	status_t status = _RequestTokens(form);
+	if (status != B_OK)
+		return status;
+
+	_StoreRefreshToken();
+	return B_OK;
+}
+
+
+void
+TokenManager::Invalidate()
+{
+	BAutolock _(fLock);
+
+	fAccessToken = "";
+	fExpiry = 0;
+}
+
+
+status_t
+TokenManager::_Refresh()
+{
+	if (fRefreshToken.IsEmpty() && _LoadRefreshToken() != B_OK)
+		return B_NOT_ALLOWED;
+
+	BHttpForm form;
+	form.AddString("refresh_token", fRefreshToken);
+	form.AddString("client_id", CLIENT_ID);
+	form.AddString("client_secret", CLIENT_SECRET);
+	form.AddString("grant_type", "refresh_token");
+
+	status_t status = _RequestTokens(form);
+	if (status == B_NOT_ALLOWED)
+		_RemoveRefreshToken();
+	return status;
+}
+
+
+// Posts the form to the token endpoint. Only a refusal from Google is
+// B_NOT_ALLOWED; a request that didn't get through leaves the refresh
+// token be, to be tried again on the next sync.
+status_t
+TokenManager::_RequestTokens(BHttpForm& form)
+{
+	form.SetFormType(B_HTTP_FORM_URL_ENCODED);
+
+	HttpCall call(kTokenUrl, B_HTTP_POST);
+	call.SetForm(form);
+	RequestEngine::Default()->Queue(&call);
+
+	status_t status = call.Wait();
+	if (status != B_OK) {
+		fprintf(stderr, "TokenManager: token request failed: %s\n",
+			strerror(status));
+		return status;
+	}
+
+	int32 statusCode = call.StatusCode();
+	if (statusCode == 400 || statusCode == 401) {
+		fprintf(stderr, "TokenManager: token refused (%" B_PRId32 ")\n",
+			statusCode);
+		return B_NOT_ALLOWED;
+	}
+
+	BMessage reply;
+	if (statusCode != 200 || call.ParseJson(reply) != B_OK) {
+		fprintf(stderr, "TokenManager: bad token response (%" B_PRId32 ")\n",
+			statusCode);
+		return B_ERROR;
+	}
+
+	const char* accessToken = reply.GetString("access_token", NULL);
+	if (accessToken == NULL)
+		return B_ERROR;
+
+	// Google only sends a refresh token along with the first access token.
+	const char* refreshToken = reply.GetString("refresh_token", NULL);
+	if (refreshToken != NULL)
+		fRefreshToken = refreshToken;
+
+	fAccessToken = accessToken;
+	fExpiry = system_time()
+		+ (bigtime_t)reply.GetDouble("expires_in", 0) * 1000000LL;
+	return B_OK;
+}
+
+
+status_t
+TokenManager::_LoadRefreshToken()
+{
+	BPasswordKey key;
+	BKeyStore keyStore;
+	status_t status = keyStore.GetKey(kAppName, B_KEY_TYPE_PASSWORD,
+		kRefreshTokenKey, key);
+	if (status != B_OK)
+		return status;
+
+	fRefreshToken = key.Password();
+	return fRefreshToken.IsEmpty() ? B_ERROR : B_OK;
+}
+
+
+void
+TokenManager::_StoreRefreshToken()
+{
+	BKeyStore keyStore;
+	BPasswordKey oldKey;
+	if (keyStore.GetKey(kAppName, B_KEY_TYPE_PASSWORD, kRefreshTokenKey,
+			oldKey) == B_OK)
+		keyStore.RemoveKey(kAppName, oldKey);
+
+	BPasswordKey key(fRefreshToken, B_KEY_PURPOSE_WEB, kRefreshTokenKey);
+	keyStore.AddKeyring(kAppName);
+	keyStore.AddKey(kAppName, key);
+}
+
+
+void
+TokenManager::_RemoveRefreshToken()
+{
+	BPasswordKey key;
+	BKeyStore keyStore;
+	if (keyStore.GetKey(kAppName, B_KEY_TYPE_PASSWORD, kRefreshTokenKey,
+			key) == B_OK)
+		keyStore.RemoveKey(kAppName, key);
+
+	fRefreshToken = "";
+	fAccessToken = "";
+	fExpiry = 0;
+}
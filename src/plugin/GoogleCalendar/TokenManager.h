@@ -0,0 +1,54 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _TOKEN_MANAGER_H_
+#define _TOKEN_MANAGER_H_
+
+
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+
+
+class BHttpForm;
+
+
+// Hands out the OAuth access token of the Google account. The token is kept
+// in memory with its expiry, so that syncs following each other share it,
+// and is only refreshed once it is about to expire. The refresh token it is
+// refreshed with is kept in the keystore.
+class TokenManager {
+public:
+							TokenManager();
+
+			// Refreshes the token first if needed. B_NOT_ALLOWED if there is
+			// no refresh token or Google refused it: the user has to
+			// authorize the application again.
+			status_t		GetAccessToken(BString& token);
+
+			// Exchanges the code the user got when authorizing the
+			// application for the tokens.
+			status_t		Authorize(const BString& code);
+
+			// Drops the access token, for one Google didn't take.
+			void			Invalidate();
+
+	static	TokenManager*	Default();
+
+	static const bigtime_t	kExpiryMargin = 5 * 60 * 1000000LL;
+
+private:
+			status_t		_Refresh();
+			status_t		_RequestTokens(BHttpForm& form);
+			status_t		_LoadRefreshToken();
+			void			_StoreRefreshToken();
+			void			_RemoveRefreshToken();
+
+			BLocker			fLock;
+			BString			fAccessToken;
+			bigtime_t		fExpiry;
+			BString			fRefreshToken;
+};
+
+#endif	// _TOKEN_MANAGER_H_
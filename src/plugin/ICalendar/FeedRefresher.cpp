@@ -0,0 +1,364 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "FeedRefresher.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <File.h>
+#include <List.h>
+#include <Uuid.h>
+
+#include "Category.h"
+#include "ContentHash.h"
+#include "Event.h"
+#include "Requests.h"
+#include "Subscription.h"
+
+
+// Hands the body of the feed to the refresher while it downloads, and stops
+// the request when the server doesn't answer with the feed or the refresher
+// gives up.
+class FeedListener : public ProtocolListener {
+public:
+	FeedListener(FeedRefresher* refresher)
+		:
+		ProtocolListener(false),
+		fRefresher(refresher),
+		fStatusCode(0),
+		fFailed(false)
+	{
+	}
+
+	virtual void HeadersReceived(BUrlRequest* caller, const BUrlResult& result)
+	{
+		const BHttpResult* httpResult
+			= dynamic_cast<const BHttpResult*>(&result);
+		if (httpResult != NULL)
+			fStatusCode = httpResult->StatusCode();
+		if (fStatusCode != 200) {
+			fFailed = true;
+			caller->Stop();
+		}
+	}
+
+	virtual void DataReceived(BUrlRequest* caller, const char* data,
+		off_t position, ssize_t size)
+	{
+		if (fFailed)
+			return;
+		if (!fRefresher->Feed(data, size)) {
+			fFailed = true;
+			caller->Stop();
+		}
+	}
+
+	int32 StatusCode() const
+	{
+		return fStatusCode;
+	}
+
+	bool Failed() const
+	{
+		return fFailed;
+	}
+
+private:
+	FeedRefresher*	fRefresher;
+	int32			fStatusCode;
+	bool			fFailed;
+};
+
+
+FeedRefresher::FeedRefresher(SQLiteManager* dbManager,
+	Subscription* subscription)
+	:
+	fDBManager(dbManager),
+	fSubscription(subscription),
+	fCategory(NULL),
+	fReader(this),
+	fParser(&fReader),
+	fWriting(false),
+	fFailed(false),
+	fNow(0),
+	fAdded(0),
+	fChanged(0),
+	fRemoved(0),
+	fUnchanged(0),
+	fCancelled(false)
+{
+	fCategories = fDBManager->GetAllCategories();
+
+	Category* defaultCategory = NULL;
+	for (int32 i = 0; i < fCategories->CountItems(); i++) {
+		Category* category = (Category*)fCategories->ItemAt(i);
+		if (strcmp(category->GetId(), fSubscription->GetCategoryId()) == 0)
+			fCategory = category;
+		if (category->GetName() == "Default")
+			defaultCategory = category;
+	}
+
+	// The category might have been removed since the subscription was made.
+	if (fCategory == NULL)
+		fCategory = defaultCategory;
+}
+
+
+FeedRefresher::~FeedRefresher()
+{
+	for (int32 i = 0; i < fCategories->CountItems(); i++)
+		delete (Category*)fCategories->ItemAt(i);
+	delete fCategories;
+}
+
+
+// Runs the whole refresh, blocking until the feed was read.
+status_t
+FeedRefresher::Run()
+{
+	if (fCategory == NULL)
+		return B_ERROR;
+	if (!fDBManager->GetFeedEntries(fSubscription->GetId(), fEntries))
+		return B_ERROR;
+
+	fNow = time(NULL);
+
+	BString url(fSubscription->GetUrl());
+	status_t status;
+	if (url.IStartsWith("http://") || url.IStartsWith("https://"))
+		status = _ReadUrl(url.String());
+	else {
+		if (url.IStartsWith("file://"))
+			url.Remove(0, strlen("file://"));
+		status = _ReadFile(url.String());
+	}
+
+	if (status == B_OK && !fParser.Finish())
+		status = B_ERROR;
+	if (fCancelled)
+		status = B_CANCELED;
+	else if (fFailed)
+		status = B_ERROR;
+
+	// Only a feed read to its end tells which events are gone.
+	if (status == B_OK && !_RemoveUnseen())
+		status = B_ERROR;
+
+	if (fWriting) {
+		if (status == B_OK) {
+			if (!fDBManager->CommitTransaction())
+				status = B_ERROR;
+		} else
+			fDBManager->RollbackTransaction();
+	}
+
+	if (status != B_OK)
+		fAdded = fChanged = fRemoved = 0;
+	return status;
+}
+
+
+void
+FeedRefresher::Cancel()
+{
+	fCancelled = true;
+}
+
+
+int32
+FeedRefresher::AddedCount() const
+{
+	return fAdded;
+}
+
+
+int32
+FeedRefresher::ChangedCount() const
+{
+	return fChanged;
+}
+
+
+int32
+FeedRefresher::RemovedCount() const
+{
+	return fRemoved;
+}
+
+
+int32
+FeedRefresher::UnchangedCount() const
+{
+	return fUnchanged;
+}
+
+
+bool
+FeedRefresher::EventParsed(ICSEvent& event)
+{
+	if (fCancelled)
+		return false;
+	if (event.cancelled)
+		return true;
+
+	uint64 hash = _Hash(event);
+
+	BString uid(event.uid.c_str());
+	if (uid.IsEmpty())
+		uid.SetToFormat("hash-%016" B_PRIx64, hash);
+
+	FeedEntryMap::iterator found = fEntries.find(uid);
+	if (found == fEntries.end()) {
+		FeedEntry& entry = fEntries[uid];
+		entry.hash = hash;
+		entry.eventId = BUuid().SetToRandom().ToString();
+		entry.seen = true;
+		fAdded++;
+		return _Write(uid.String(), entry, event);
+	}
+
+	FeedEntry& entry = found->second;
+	// A UID showing up twice is a recurrence override, which isn't
+	// supported; the first occurrence is kept.
+	if (entry.seen)
+		return true;
+
+	entry.seen = true;
+	if (entry.hash == hash) {
+		fUnchanged++;
+		return true;
+	}
+
+	entry.hash = hash;
+	fChanged++;
+	return _Write(uid.String(), entry, event);
+}
+
+
+bool
+FeedRefresher::Feed(const char* data, size_t length)
+{
+	if (fCancelled || fFailed)
+		return false;
+	return fParser.Feed(data, length);
+}
+
+
+status_t
+FeedRefresher::_ReadFile(const char* path)
+{
+	BFile file(path, B_READ_ONLY);
+	status_t status = file.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	char* buffer = new char[kChunkSize];
+	ssize_t bytesRead;
+	while ((bytesRead = file.Read(buffer, kChunkSize)) > 0) {
+		if (!Feed(buffer, bytesRead))
+			break;
+	}
+	delete[] buffer;
+
+	return bytesRead < 0 ? (status_t)bytesRead : B_OK;
+}
+
+
+status_t
+FeedRefresher::_ReadUrl(const char* url)
+{
+	FeedListener listener(this);
+	bool ssl = BString(url).IStartsWith("https://");
+	BHttpRequest request(BUrl(url), ssl, "HTTP", &listener);
+	request.SetMethod(B_HTTP_GET);
+
+	thread_id thread = request.Run();
+	if (thread < 0)
+		return thread;
+	wait_for_thread(thread, NULL);
+
+	if (listener.StatusCode() != 200) {
+		fprintf(stderr, "Feed %s: response code %" B_PRId32 "\n", url,
+			listener.StatusCode());
+		return B_ERROR;
+	}
+
+	return listener.Failed() ? B_ERROR : B_OK;
+}
+
+
+bool
+FeedRefresher::_Write(const char* uid, FeedEntry& entry, ICSEvent& icsEvent)
+{
+	if (!fWriting) {
+		if (!fDBManager->BeginTransaction()) {
+			fFailed = true;
+			return false;
+		}
+		fWriting = true;
+	}
+
+	const char* name = icsEvent.summary.empty()
+		? "Untitled Event" : icsEvent.summary.c_str();
+	time_t updated = icsEvent.updated != 0 ? icsEvent.updated : fNow;
+
+	Event event(name, icsEvent.location.c_str(),
+		icsEvent.description.c_str(), icsEvent.allDay, icsEvent.start,
+		icsEvent.end, fCategory, icsEvent.start < fNow, updated, true,
+		entry.eventId.String());
+	event.SetTimeZone(icsEvent.timeZone.c_str());
+
+	if (!fDBManager->SetFeedEvent(fSubscription->GetId(), uid, entry.hash,
+			&event)) {
+		fFailed = true;
+		return false;
+	}
+
+	return true;
+}
+
+
+bool
+FeedRefresher::_RemoveUnseen()
+{
+	FeedEntryMap::iterator it = fEntries.begin();
+	for (; it != fEntries.end(); it++) {
+		if (it->second.seen)
+			continue;
+
+		if (!fWriting) {
+			if (!fDBManager->BeginTransaction())
+				return false;
+			fWriting = true;
+		}
+
+		if (!fDBManager->RemoveFeedEvent(fSubscription->GetId(),
+				it->first.String(), it->second.eventId.String()))
+			return false;
+		fRemoved++;
+	}
+
+	return true;
+}
+
+
+// The stamps (DTSTAMP, LAST-MODIFIED) are left out: servers update them on
+// every download, which would make every event look changed.
+uint64
+FeedRefresher::_Hash(const ICSEvent& event) const
+{
+	uint64 hash = kContentHashInitial;
+	hash = HashString(hash, event.summary.c_str());
+	hash = HashString(hash, event.location.c_str());
+	hash = HashString(hash, event.description.c_str());
+	hash = HashInt64(hash, event.start);
+	hash = HashInt64(hash, event.end);
+	hash = HashInt64(hash, event.allDay ? 1 : 0);
+	hash = HashString(hash, event.timeZone.c_str());
+	hash = HashString(hash, fCategory->GetId());
+	return hash;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _FEED_REFRESHER_H_
+#define _FEED_REFRESHER_H_
+
+
+#include <SupportDefs.h>
+
+#include "ICSEventReader.h"
+#include "ICSParser.h"
+#include "SQLiteManager.h"
+
+
+class BList;
+class Category;
+class Subscription;
+
+
+// Brings the events of a subscribed iCalendar feed up to date.
+//
+// The feed is read again from its URL (http(s), file:// or a plain path)
+// and parsed as it arrives. Every event is hashed, and the hash compared to
+// the one stored for its UID at the last refresh: only added and changed
+// events are written, and events missing from the feed are removed once
+// the whole feed was read. An unchanged feed costs one pass over it and no
+// writes at all. All writes of a refresh go into one transaction, so a
+// failed download leaves the previous state in place.
+//
+// Cancelled events count as missing, events without a UID are identified
+// by their hash.
+class FeedRefresher : public ICSEventListener {
+public:
+					FeedRefresher(SQLiteManager* dbManager,
+						Subscription* subscription);
+	virtual				~FeedRefresher();
+
+		status_t	Run();
+		void		Cancel();
+
+		int32		AddedCount() const;
+		int32		ChangedCount() const;
+		int32		RemovedCount() const;
+		int32		UnchangedCount() const;
+
+	virtual	bool		EventParsed(ICSEvent& event);
+
+		bool		Feed(const char* data, size_t length);
+
+private:
+		status_t	_ReadFile(const char* path);
+		status_t	_ReadUrl(const char* url);
+		bool		_Write(const char* uid, FeedEntry& entry,
+						ICSEvent& event);
+		bool		_RemoveUnseen();
+		uint64		_Hash(const ICSEvent& event) const;
+
+		static const size_t	kChunkSize = 64 * 1024;
+
+		SQLiteManager*	fDBManager;
+		Subscription*	fSubscription;
+		BList*		fCategories;
+		Category*	fCategory;
+
+		ICSEventReader	fReader;
+		ICSParser	fParser;
+		FeedEntryMap	fEntries;
+		bool		fWriting;
+		bool		fFailed;
+		time_t		fNow;
+
+		int32		fAdded;
+		int32		fChanged;
+		int32		fRemoved;
+		int32		fUnchanged;
+		volatile bool	fCancelled;
+};
+
+#endif	// _FEED_REFRESHER_H_
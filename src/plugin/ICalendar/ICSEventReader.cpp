@@ -0,0 +1,276 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ICSEventReader.h"
+
+#include <string.h>
+#include <strings.h>
+
+#include "CivilDate.h"
+#include "ZoneInfo.h"
+
+
+static bool
+ParseDigits(const char* string, int count, int& value)
+{
+	value = 0;
+	for (int i = 0; i < count; i++) {
+		if (string[i] < '0' || string[i] > '9')
+			return false;
+		value = value * 10 + string[i] - '0';
+	}
+
+	return true;
+}
+
+
+void
+ICSEvent::Clear()
+{
+	uid.clear();
+	summary.clear();
+	location.clear();
+	description.clear();
+	category.clear();
+	timeZone.clear();
+	start = 0;
+	end = 0;
+	updated = 0;
+	allDay = false;
+	cancelled = false;
+}
+
+
+ICSEventReader::ICSEventReader(ICSEventListener* listener)
+	:
+	fListener(listener),
+	fInEvent(false),
+	fNestedDepth(0),
+	fInvalidCount(0)
+{
+}
+
+
+bool
+ICSEventReader::ContentLine(const ICSContentLine& line)
+{
+	const std::string& name = line.name;
+
+	if (name == "BEGIN") {
+		if (fInEvent)
+			fNestedDepth++;
+		else if (strcasecmp(line.value.c_str(), "VEVENT") == 0) {
+			fInEvent = true;
+			fNestedDepth = 0;
+			fHasStart = false;
+			fHasEnd = false;
+			fHasDuration = false;
+			fEvent.Clear();
+		}
+		return true;
+	}
+
+	if (!fInEvent)
+		return true;
+
+	if (name == "END") {
+		if (fNestedDepth > 0) {
+			fNestedDepth--;
+			return true;
+		}
+		fInEvent = false;
+		return _EndEvent();
+	}
+
+	if (fNestedDepth > 0)
+		return true;
+
+	if (name == "UID")
+		fEvent.uid = line.value;
+	else if (name == "SUMMARY")
+		ICSParser::Unescape(line.value, fEvent.summary);
+	else if (name == "LOCATION")
+		ICSParser::Unescape(line.value, fEvent.location);
+	else if (name == "DESCRIPTION")
+		ICSParser::Unescape(line.value, fEvent.description);
+	else if (name == "CATEGORIES") {
+		// Only the first category; the calendar has one per event.
+		const std::string& value = line.value;
+		std::string::size_type end = 0;
+		while (end < value.size() && value[end] != ',')
+			end += value[end] == '\\' ? 2 : 1;
+		ICSParser::Unescape(value.substr(0, end), fEvent.category);
+	} else if (name == "STATUS")
+		fEvent.cancelled = strcasecmp(line.value.c_str(), "CANCELLED") == 0;
+	else if (name == "DTSTART")
+		fHasStart = ParseDateTime(line, fEvent.start, fEvent.allDay,
+			&fEvent.timeZone);
+	else if (name == "DTEND")
+		fHasEnd = ParseDateTime(line, fEvent.end, fEndIsDate);
+	else if (name == "DURATION")
+		fHasDuration = ParseDuration(line.value, fDuration);
+	else if (name == "LAST-MODIFIED"
+		|| (name == "DTSTAMP" && fEvent.updated == 0)) {
+		bool isDate;
+		ParseDateTime(line, fEvent.updated, isDate);
+	}
+
+	return true;
+}
+
+
+// Number of events dropped for lacking a valid start.
+uint64_t
+ICSEventReader::InvalidCount() const
+{
+	return fInvalidCount;
+}
+
+
+// Parses a DATE ("19970714") or DATE-TIME ("19970714T173000", with a
+// trailing Z for UTC) value. Dates are local midnight. The name of the zone
+// a TZID resolved to is stored in timeZone, if given.
+bool
+ICSEventReader::ParseDateTime(const ICSContentLine& line, int64_t& time,
+	bool& isDate, std::string* timeZone)
+{
+	const char* value = line.value.c_str();
+	size_t length = line.value.size();
+
+	int year, month, day;
+	int hour = 0, minute = 0, second = 0;
+	if (length < 8 || !ParseDigits(value, 4, year)
+		|| !ParseDigits(value + 4, 2, month) || !ParseDigits(value + 6, 2, day)
+		|| month < 1 || month > 12 || day < 1 || day > 31)
+		return false;
+
+	isDate = length == 8;
+	if (!isDate) {
+		if (length < 15 || value[8] != 'T' || !ParseDigits(value + 9, 2, hour)
+			|| !ParseDigits(value + 11, 2, minute)
+			|| !ParseDigits(value + 13, 2, second))
+			return false;
+	}
+
+	int64_t wallTime = DaysFromCivil(year, month, day) * kSecondsPerDay
+		+ hour * 3600 + minute * 60 + second;
+	if (timeZone != NULL)
+		timeZone->clear();
+
+	if (!isDate && length > 15 && value[15] == 'Z') {
+		time = wallTime;
+		return true;
+	}
+
+	// The VTIMEZONE definitions of the stream aren't read: TZIDs are
+	// nearly always IANA names, sometimes with a leading slash for a
+	// "globally unique" one, and the system's tzdata is more likely to be
+	// right about them.
+	const ZoneInfo* zone = NULL;
+	const char* zoneName = isDate ? NULL : line.Parameter("TZID");
+	if (zoneName != NULL) {
+		if (zoneName[0] == '/')
+			zoneName++;
+		zone = ZoneInfo::Get(zoneName);
+	}
+
+	if (zone != NULL) {
+		if (timeZone != NULL)
+			*timeZone = zone->Name();
+	} else
+		zone = ZoneInfo::Local();
+
+	time = ZonedTimeFromLocal(wallTime, *zone);
+	return true;
+}
+
+
+// Parses a DURATION value such as "PT1H30M", "P1D" or "-P2W".
+bool
+ICSEventReader::ParseDuration(const std::string& value, int64_t& duration)
+{
+	const char* position = value.c_str();
+	int64_t sign = 1;
+	if (*position == '+' || *position == '-') {
+		if (*position == '-')
+			sign = -1;
+		position++;
+	}
+
+	if (*position++ != 'P')
+		return false;
+
+	duration = 0;
+	bool inTime = false;
+	while (*position != '\0') {
+		if (*position == 'T') {
+			inTime = true;
+			position++;
+			continue;
+		}
+
+		int64_t number = 0;
+		const char* digits = position;
+		while (*position >= '0' && *position <= '9')
+			number = number * 10 + *position++ - '0';
+		if (position == digits)
+			return false;
+
+		switch (*position++) {
+			case 'W':
+				duration += number * 7 * kSecondsPerDay;
+				break;
+			case 'D':
+				duration += number * kSecondsPerDay;
+				break;
+			case 'H':
+				duration += number * 3600;
+				break;
+			case 'M':
+				if (!inTime)
+					return false;
+				duration += number * 60;
+				break;
+			case 'S':
+				duration += number;
+				break;
+			default:
+				return false;
+		}
+	}
+
+	duration *= sign;
+	return true;
+}
+
+
+bool
+ICSEventReader::_EndEvent()
+{
+	if (!fHasStart) {
+		fInvalidCount++;
+		return true;
+	}
+
+	ICSEvent& event = fEvent;
+	if (!fHasEnd) {
+		if (fHasDuration)
+			event.end = event.start + fDuration;
+		else if (event.allDay)
+			event.end = event.start + kSecondsPerDay;
+		else
+			event.end = event.start;
+	}
+
+	// DTEND of an all day event is the day after the last one, while the
+	// calendar ends it at the last second of its last day.
+	if (event.allDay && event.end > event.start)
+		event.end--;
+
+	if (event.end < event.start)
+		event.end = event.start;
+
+	return fListener->EventParsed(event);
+}
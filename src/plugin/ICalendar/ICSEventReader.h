@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _ICS_EVENT_READER_H_
+#define _ICS_EVENT_READER_H_
+
+
+#include <stdint.h>
+#include <string>
+
+#include "ICSParser.h"
+
+
+// The parts of a VEVENT the calendar keeps. Times are seconds since the
+// epoch; all day events run from local midnight of their first day to the
+// last second of their last day, as the event window stores them. timeZone
+// is the zone DTSTART was given in, empty for UTC, floating times and
+// dates.
+struct ICSEvent {
+	std::string	uid;
+	std::string	summary;
+	std::string	location;
+	std::string	description;
+	std::string	category;
+	std::string	timeZone;
+
+	int64_t		start;
+	int64_t		end;
+	int64_t		updated;
+
+	bool		allDay;
+	bool		cancelled;
+
+	void		Clear();
+};
+
+
+class ICSEventListener {
+public:
+	virtual				~ICSEventListener() {}
+
+	// Returning false stops the parser.
+	virtual	bool		EventParsed(ICSEvent& event) = 0;
+};
+
+
+// Turns the content lines of an iCalendar stream into ICSEvents. Components
+// nested in a VEVENT, like VALARM, are skipped, and so are events without
+// a usable DTSTART. Recurrence rules aren't expanded: a recurring event is
+// read as its first occurrence.
+//
+// Times with a TZID are converted with the system's zone of that name;
+// floating times, and those with a zone the system doesn't know, are taken
+// as local time.
+class ICSEventReader : public ICSHandler {
+public:
+					ICSEventReader(ICSEventListener* listener);
+
+	virtual	bool		ContentLine(const ICSContentLine& line);
+
+		uint64_t	InvalidCount() const;
+
+	static	bool		ParseDateTime(const ICSContentLine& line,
+						int64_t& time, bool& isDate,
+						std::string* timeZone = NULL);
+	static	bool		ParseDuration(const std::string& value,
+						int64_t& duration);
+
+private:
+		bool		_EndEvent();
+
+		ICSEventListener*	fListener;
+		ICSEvent	fEvent;
+		bool		fInEvent;
+		int32_t		fNestedDepth;
+		bool		fHasStart;
+		bool		fHasEnd;
+		bool		fHasDuration;
+		bool		fEndIsDate;
+		int64_t		fDuration;
+		uint64_t	fInvalidCount;
+};
+
+#endif	// _ICS_EVENT_READER_H_
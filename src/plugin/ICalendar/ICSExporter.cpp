@@ -0,0 +1,137 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ICSExporter.h"
+
+#include <time.h>
+
+#include <File.h>
+#include <Message.h>
+
+
+ICSExporter::ICSExporter(const BPath& path, time_t start, time_t end,
+	const char* categoryId, const BMessenger& target)
+	:
+	fPath(path),
+	fStart(start),
+	fEnd(end),
+	fCategoryId(categoryId),
+	fAllCategories(categoryId == NULL),
+	fTarget(target),
+	fOutput(NULL),
+	fWriter(NULL),
+	fExported(0)
+{
+}
+
+
+ICSExporter::~ICSExporter()
+{
+}
+
+
+// Runs the whole export, meant to be called on a thread of its own.
+status_t
+ICSExporter::Run()
+{
+	BFile file(fPath.Path(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+
+	if (status == B_OK) {
+		BBufferedDataIO output(file, kBufferSize, false);
+		ICSWriter writer(this);
+		fOutput = &output;
+		fWriter = &writer;
+
+		writer.Begin("VCALENDAR");
+		writer.Property("VERSION", "2.0");
+		writer.Property("PRODID", "-//Haiku//Calendar//EN");
+		writer.Property("CALSCALE", "GREGORIAN");
+
+		// Reads through a connection of its own, so the views aren't held
+		// up by the export.
+		SQLiteManager manager;
+		bool visited = manager.VisitEvents(this, fStart, fEnd,
+			fAllCategories ? NULL : fCategoryId.String());
+
+		writer.End("VCALENDAR");
+
+		if (!writer.Status())
+			status = B_IO_ERROR;
+		else if (!visited)
+			status = B_ERROR;
+		else
+			status = output.Flush();
+
+		fWriter = NULL;
+		fOutput = NULL;
+	}
+
+	BMessage message(kICSExportComplete);
+	message.AddInt32("status", status);
+	message.AddInt32("exported", fExported);
+	fTarget.SendMessage(&message);
+
+	return status;
+}
+
+
+bool
+ICSExporter::VisitEvent(const EventRow& row)
+{
+	ICSWriter& writer = *fWriter;
+
+	writer.Begin("VEVENT");
+	writer.Property("UID", row.id);
+	writer.DateTimeProperty("DTSTAMP", row.updated);
+	writer.DateTimeProperty("LAST-MODIFIED", row.updated);
+
+	if (row.allDay) {
+		// All day events end on the last second of their last day, DTEND
+		// is the day after it.
+		struct tm local;
+		localtime_r(&row.start, &local);
+		writer.DateProperty("DTSTART", local.tm_year + 1900,
+			local.tm_mon + 1, local.tm_mday);
+
+		time_t end = row.end + 1;
+		localtime_r(&end, &local);
+		if (local.tm_hour != 0 || local.tm_min != 0 || local.tm_sec != 0) {
+			local.tm_mday++;
+			local.tm_hour = 0;
+			local.tm_min = 0;
+			local.tm_sec = 0;
+			local.tm_isdst = -1;
+			end = mktime(&local);
+			localtime_r(&end, &local);
+		}
+		writer.DateProperty("DTEND", local.tm_year + 1900, local.tm_mon + 1,
+			local.tm_mday);
+	} else {
+		writer.DateTimeProperty("DTSTART", row.start);
+		writer.DateTimeProperty("DTEND", row.end);
+	}
+
+	writer.TextProperty("SUMMARY", row.name != NULL ? row.name : "");
+	if (row.place != NULL && row.place[0] != '\0')
+		writer.TextProperty("LOCATION", row.place);
+	if (row.description != NULL && row.description[0] != '\0')
+		writer.TextProperty("DESCRIPTION", row.description);
+	if (row.categoryName != NULL)
+		writer.TextProperty("CATEGORIES", row.categoryName);
+
+	writer.End("VEVENT");
+	fExported++;
+
+	// Stop reading rows once the disk is full or gone.
+	return writer.Status();
+}
+
+
+bool
+ICSExporter::Write(const char* data, size_t length)
+{
+	return fOutput->Write(data, length) == (ssize_t)length;
+}
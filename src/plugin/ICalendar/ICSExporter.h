@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _ICS_EXPORTER_H_
+#define _ICS_EXPORTER_H_
+
+
+#include <DataIO.h>
+#include <Messenger.h>
+#include <Path.h>
+#include <String.h>
+
+#include "ICSWriter.h"
+#include "SQLiteManager.h"
+
+
+static const uint32 kICSExportComplete = 'kiec';
+
+
+// Writes the events overlapping [start, end], optionally of one category
+// only, to an iCalendar file. Rows go from the database cursor straight to
+// the writer and through a buffer to the file, so memory use is the same
+// for ten events or a million.
+//
+// The end is sent to the target as kICSExportComplete with "status" and
+// "exported".
+class ICSExporter : public EventRowVisitor, public ICSOutput {
+public:
+					ICSExporter(const BPath& path, time_t start,
+						time_t end, const char* categoryId,
+						const BMessenger& target);
+					~ICSExporter();
+
+		status_t	Run();
+
+private:
+	virtual	bool		VisitEvent(const EventRow& row);
+	virtual	bool		Write(const char* data, size_t length);
+
+		static const size_t	kBufferSize = 64 * 1024;
+
+		BPath		fPath;
+		time_t		fStart;
+		time_t		fEnd;
+		BString		fCategoryId;
+		bool		fAllCategories;
+		BMessenger	fTarget;
+
+		BDataIO*	fOutput;
+		ICSWriter*	fWriter;
+		int32		fExported;
+};
+
+#endif	// _ICS_EXPORTER_H_
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ICSImportWindow.h"
+
+#include <Button.h>
+#include <LayoutBuilder.h>
+#include <StatusBar.h>
+#include <String.h>
+
+#include "ICSImporter.h"
+
+
+ICSImportWindow::ICSImportWindow(const entry_ref& ref,
+	const BMessenger& target)
+	:
+	BWindow(BRect(), "Import iCalendar file", B_TITLED_WINDOW,
+		B_NOT_ZOOMABLE | B_NOT_RESIZABLE | B_AUTO_UPDATE_SIZE_LIMITS),
+	fTarget(target),
+	fDone(false)
+{
+	_InitInterface();
+	ResizeTo(320, 80);
+	CenterOnScreen();
+
+	BString label(ref.name);
+	fStatusBar->SetText(label);
+
+	fImporter = new ICSImporter(ref, BMessenger(this));
+	fImportThread = spawn_thread(_ImportThread, "ICS Import Thread",
+		B_NORMAL_PRIORITY, fImporter);
+	resume_thread(fImportThread);
+}
+
+
+ICSImportWindow::~ICSImportWindow()
+{
+	fImporter->Cancel();
+	status_t result;
+	wait_for_thread(fImportThread, &result);
+	delete fImporter;
+}
+
+
+void
+ICSImportWindow::MessageReceived(BMessage* message)
+{
+	switch(message->what) {
+
+		case kICSImportProgress:
+		{
+			int64 read;
+			int64 size;
+			int32 events;
+			if (message->FindInt64("read", &read) != B_OK
+				|| message->FindInt64("size", &size) != B_OK
+				|| message->FindInt32("events", &events) != B_OK)
+				break;
+
+			BString trailing;
+			trailing << events << " events";
+			fStatusBar->SetMaxValue(size > 0 ? size : 1);
+			fStatusBar->Update(read - fStatusBar->CurrentValue(), NULL,
+				trailing.String());
+			break;
+		}
+
+		case kICSImportComplete:
+		{
+			int32 status = B_ERROR;
+			int32 imported = 0;
+			int32 skipped = 0;
+			message->FindInt32("status", &status);
+			message->FindInt32("imported", &imported);
+			message->FindInt32("skipped", &skipped);
+
+			BString text;
+			if (status == B_OK) {
+				text << "Imported " << imported << " events";
+				if (skipped > 0)
+					text << ", skipped " << skipped;
+				text << ".";
+				fTarget.SendMessage(kICSImportComplete);
+			} else {
+				if (status == B_CANCELED)
+					text = "Import cancelled";
+				else
+					text = "The file could not be fully imported";
+
+				// The events committed so far stay.
+				if (imported > 0) {
+					text << " after " << imported << " events";
+					fTarget.SendMessage(kICSImportComplete);
+				}
+				text << ".";
+			}
+
+			fStatusBar->SetText(text.String());
+			fStatusBar->SetTrailingText("");
+			fButton->SetLabel("Close");
+			fDone = true;
+			break;
+		}
+
+		case kCancelPressed:
+			if (fDone)
+				Quit();
+			else
+				fImporter->Cancel();
+			break;
+
+		default:
+			BWindow::MessageReceived(message);
+			break;
+	}
+}
+
+
+bool
+ICSImportWindow::QuitRequested()
+{
+	// Only the events not committed yet are rolled back.
+	fImporter->Cancel();
+	return true;
+}
+
+
+void
+ICSImportWindow::_InitInterface()
+{
+	fStatusBar = new BStatusBar("StatusBar");
+	fButton = new BButton(NULL, "Cancel", new BMessage(kCancelPressed));
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL, B_USE_HALF_ITEM_SPACING)
+		.SetInsets(B_USE_WINDOW_SPACING)
+		.Add(fStatusBar)
+		.AddGroup(B_HORIZONTAL)
+			.AddGlue()
+			.Add(fButton)
+		.End()
+	.End();
+}
+
+
+int32
+ICSImportWindow::_ImportThread(void* data)
+{
+	ICSImporter* importer = (ICSImporter*)data;
+	importer->Run();
+	return 0;
+}
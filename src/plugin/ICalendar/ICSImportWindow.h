@@ -0,0 +1,44 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _ICS_IMPORT_WINDOW_H_
+#define _ICS_IMPORT_WINDOW_H_
+
+
+#include <Entry.h>
+#include <Messenger.h>
+#include <Window.h>
+
+
+class BButton;
+class BStatusBar;
+class ICSImporter;
+
+
+// Shows the progress of an iCalendar import running on its own thread, and
+// tells target when events were added.
+class ICSImportWindow: public BWindow {
+public:
+					ICSImportWindow(const entry_ref& ref,
+						const BMessenger& target);
+					~ICSImportWindow();
+
+	virtual void	MessageReceived(BMessage* message);
+	virtual bool	QuitRequested();
+
+private:
+	void			_InitInterface();
+	static int32	_ImportThread(void* data);
+
+	static const uint32	kCancelPressed = 1000;
+
+	BStatusBar*		fStatusBar;
+	BButton*		fButton;
+	BMessenger		fTarget;
+	ICSImporter*	fImporter;
+	thread_id		fImportThread;
+	bool			fDone;
+};
+
+#endif
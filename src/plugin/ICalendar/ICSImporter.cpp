@@ -0,0 +1,432 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ICSImporter.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <time.h>
+
+#include <File.h>
+#include <List.h>
+#include <Message.h>
+#include <OS.h>
+
+#include "Category.h"
+#include "Event.h"
+#include "ICSParser.h"
+#include "ICSSplitter.h"
+#include "SQLiteManager.h"
+
+
+// Keeps the events of a batch for the inserts, which happen on another
+// thread.
+class EventCollector : public ICSEventListener {
+public:
+	EventCollector(std::vector<ICSEvent>& events)
+		:
+		fEvents(events)
+	{
+	}
+
+	virtual bool EventParsed(ICSEvent& event)
+	{
+		fEvents.push_back(event);
+		return true;
+	}
+
+private:
+	std::vector<ICSEvent>&	fEvents;
+};
+
+
+ICSImporter::ICSImporter(const entry_ref& ref, const BMessenger& target)
+	:
+	fRef(ref),
+	fTarget(target),
+	fDefaultCategory(NULL),
+	fFile(NULL),
+	fLock("ics import"),
+	fBatchCount(0),
+	fReadDone(false),
+	fReadStatus(B_OK),
+	fSize(0),
+	fRead(0),
+	fLastProgress(0),
+	fImported(0),
+	fSkipped(0),
+	fCommitted(0),
+	fUncommitted(0),
+	fWriteStatus(B_OK),
+	fNow(0),
+	fCancelled(false)
+{
+	fDBManager = new SQLiteManager();
+	fCategories = fDBManager->GetAllCategories();
+
+	for (int32 i = 0; i < fCategories->CountItems(); i++) {
+		Category* category = (Category*)fCategories->ItemAt(i);
+		if (category->GetName() == "Default")
+			fDefaultCategory = category;
+	}
+}
+
+
+ICSImporter::~ICSImporter()
+{
+	for (int32 i = 0; i < fCategories->CountItems(); i++)
+		delete (Category*)fCategories->ItemAt(i);
+	delete fCategories;
+	delete fDBManager;
+}
+
+
+// Runs the whole import, meant to be called on a thread of its own.
+status_t
+ICSImporter::Run()
+{
+	BFile file(&fRef, B_READ_ONLY);
+	status_t status = file.InitCheck();
+	if (status == B_OK)
+		status = file.GetSize(&fSize);
+	if (status == B_OK && fDefaultCategory == NULL)
+		status = B_ERROR;
+	if (status == B_OK && !fDBManager->BeginTransaction())
+		status = B_ERROR;
+
+	if (status == B_OK) {
+		fNow = time(NULL);
+		status = _RunPipeline(file);
+
+		if (status == B_OK && !fDBManager->CommitTransaction())
+			status = B_ERROR;
+		else if (status != B_OK)
+			fDBManager->RollbackTransaction();
+	}
+
+	if (status != B_OK)
+		fImported = fCommitted;
+
+	_SendProgress(true);
+
+	BMessage message(kICSImportComplete);
+	message.AddInt32("status", status);
+	message.AddInt32("imported", fImported);
+	message.AddInt32("skipped", fSkipped);
+	fTarget.SendMessage(&message);
+
+	return status;
+}
+
+
+// Stops the import and rolls back the events not committed yet. May be
+// called from any thread.
+void
+ICSImporter::Cancel()
+{
+	fCancelled = true;
+}
+
+
+int32
+ICSImporter::ImportedCount() const
+{
+	return fImported;
+}
+
+
+int32
+ICSImporter::SkippedCount() const
+{
+	return fSkipped;
+}
+
+
+status_t
+ICSImporter::_RunPipeline(BFile& file)
+{
+	system_info info;
+	get_system_info(&info);
+	int32 workerCount = std::min((int32)info.cpu_count, kMaxWorkers);
+	if (workerCount < 1)
+		workerCount = 1;
+
+	// Bounds the batches between the reader and the inserts.
+	fSlotSem = create_sem(workerCount * 2 + 2, "ics import slots");
+	fWorkSem = create_sem(0, "ics import work");
+	fDoneSem = create_sem(0, "ics import done");
+
+	fFile = &file;
+	fBatchCount = 0;
+	fReadDone = false;
+	fReadStatus = B_OK;
+
+	thread_id reader = spawn_thread(_ReaderThread, "ICS Reader Thread",
+		B_NORMAL_PRIORITY, this);
+	resume_thread(reader);
+
+	std::vector<thread_id> workers(workerCount);
+	for (int32 i = 0; i < workerCount; i++) {
+		workers[i] = spawn_thread(_WorkerThread, "ICS Parser Thread",
+			B_NORMAL_PRIORITY, this);
+		resume_thread(workers[i]);
+	}
+
+	// Batches are parsed in any order, but inserted in the order of the
+	// file, so the first of two events with the same UID wins like it
+	// would if the file was read in one go.
+	int32 next = 0;
+	while (!fCancelled) {
+		fLock.Lock();
+		std::map<int32, Batch*>::iterator found = fDone.find(next);
+		if (found == fDone.end()) {
+			bool finished = fReadDone && next == fBatchCount;
+			fLock.Unlock();
+			if (finished)
+				break;
+			acquire_sem(fDoneSem);
+			continue;
+		}
+
+		Batch* batch = found->second;
+		fDone.erase(found);
+		fLock.Unlock();
+
+		for (size_t i = 0; i < batch->events.size() && !fCancelled; i++)
+			_Insert(batch->events[i]);
+		fSkipped += batch->invalid;
+		fRead = batch->end;
+		delete batch;
+		next++;
+
+		// Stopping on a failed write goes the way of a cancel.
+		if (fUncommitted >= kCommitInterval && !_CommitChunk()) {
+			fWriteStatus = B_ERROR;
+			fCancelled = true;
+		}
+
+		release_sem(fSlotSem);
+		_SendProgress(false);
+	}
+
+	// Unblock the reader if it waits for a slot, then stop the workers
+	// with one empty batch each.
+	if (fCancelled)
+		release_sem_etc(fSlotSem, workerCount * 2 + 2, 0);
+
+	status_t result;
+	wait_for_thread(reader, &result);
+
+	fLock.Lock();
+	for (int32 i = 0; i < workerCount; i++)
+		fWork.push_back(NULL);
+	fLock.Unlock();
+	release_sem_etc(fWorkSem, workerCount, 0);
+
+	for (int32 i = 0; i < workerCount; i++)
+		wait_for_thread(workers[i], &result);
+
+	while (!fWork.empty()) {
+		delete fWork.front();
+		fWork.pop_front();
+	}
+	for (std::map<int32, Batch*>::iterator it = fDone.begin();
+			it != fDone.end(); it++)
+		delete it->second;
+	fDone.clear();
+
+	delete_sem(fSlotSem);
+	delete_sem(fWorkSem);
+	delete_sem(fDoneSem);
+	fFile = NULL;
+
+	if (fWriteStatus != B_OK)
+		return fWriteStatus;
+	if (fCancelled)
+		return B_CANCELED;
+	return fReadStatus;
+}
+
+
+int32
+ICSImporter::_ReaderThread(void* data)
+{
+	((ICSImporter*)data)->_Read();
+	return 0;
+}
+
+
+int32
+ICSImporter::_WorkerThread(void* data)
+{
+	((ICSImporter*)data)->_Work();
+	return 0;
+}
+
+
+void
+ICSImporter::_Read()
+{
+	ICSSplitter splitter(kBatchSize);
+	char* buffer = new char[kChunkSize];
+	off_t offset = 0;
+	int32 sequence = 0;
+	status_t status = B_OK;
+
+	while (!fCancelled) {
+		ssize_t bytes = fFile->Read(buffer, kChunkSize);
+		if (bytes < 0)
+			status = bytes;
+		if (bytes <= 0)
+			break;
+
+		offset += bytes;
+		splitter.Feed(buffer, bytes);
+
+		std::string text;
+		while (!fCancelled && splitter.NextBatch(text)) {
+			Batch* batch = new Batch;
+			batch->sequence = sequence++;
+			batch->end = offset;
+			batch->text.swap(text);
+			_Queue(batch);
+		}
+	}
+
+	std::string text;
+	if (status == B_OK && !fCancelled && splitter.Finish(text)) {
+		Batch* batch = new Batch;
+		batch->sequence = sequence++;
+		batch->end = offset;
+		batch->text.swap(text);
+		_Queue(batch);
+	}
+
+	delete[] buffer;
+
+	fLock.Lock();
+	fReadStatus = status;
+	fBatchCount = sequence;
+	fReadDone = true;
+	fLock.Unlock();
+	release_sem(fDoneSem);
+}
+
+
+void
+ICSImporter::_Queue(Batch* batch)
+{
+	acquire_sem(fSlotSem);
+
+	fLock.Lock();
+	fWork.push_back(batch);
+	fLock.Unlock();
+	release_sem(fWorkSem);
+}
+
+
+void
+ICSImporter::_Work()
+{
+	while (acquire_sem(fWorkSem) == B_OK) {
+		fLock.Lock();
+		Batch* batch = fWork.front();
+		fWork.pop_front();
+		fLock.Unlock();
+
+		if (batch == NULL)
+			break;
+
+		if (!fCancelled) {
+			EventCollector collector(batch->events);
+			ICSEventReader reader(&collector);
+			ICSParser parser(&reader);
+			parser.Feed(batch->text.data(), batch->text.size());
+			parser.Finish();
+			batch->invalid = reader.InvalidCount();
+		} else
+			batch->invalid = 0;
+		std::string().swap(batch->text);
+
+		fLock.Lock();
+		fDone[batch->sequence] = batch;
+		fLock.Unlock();
+		release_sem(fDoneSem);
+	}
+}
+
+
+void
+ICSImporter::_Insert(ICSEvent& icsEvent)
+{
+	if (icsEvent.cancelled) {
+		fSkipped++;
+		return;
+	}
+
+	const char* name = icsEvent.summary.empty()
+		? "Untitled Event" : icsEvent.summary.c_str();
+	time_t updated = icsEvent.updated != 0 ? icsEvent.updated : fNow;
+	bool notified = icsEvent.start < fNow;
+
+	Event event(name, icsEvent.location.c_str(),
+		icsEvent.description.c_str(), icsEvent.allDay, icsEvent.start,
+		icsEvent.end, _CategoryFor(icsEvent.category), notified, updated,
+		true);
+	event.SetTimeZone(icsEvent.timeZone.c_str());
+
+	// Events already imported before, or with a name the event window
+	// wouldn't accept, are left out.
+	if (fDBManager->AddImportedEvent(&event, icsEvent.uid.c_str())) {
+		fImported++;
+		fUncommitted++;
+	}
+	else
+		fSkipped++;
+}
+
+
+// Commits the events inserted so far and starts the next transaction.
+bool
+ICSImporter::_CommitChunk()
+{
+	if (!fDBManager->CommitTransaction())
+		return false;
+
+	fCommitted = fImported;
+	fUncommitted = 0;
+	return fDBManager->BeginTransaction();
+}
+
+
+Category*
+ICSImporter::_CategoryFor(const std::string& name)
+{
+	if (!name.empty()) {
+		for (int32 i = 0; i < fCategories->CountItems(); i++) {
+			Category* category = (Category*)fCategories->ItemAt(i);
+			if (category->GetName().ICompare(name.c_str()) == 0)
+				return category;
+		}
+	}
+
+	return fDefaultCategory;
+}
+
+
+void
+ICSImporter::_SendProgress(bool force)
+{
+	bigtime_t now = system_time();
+	if (!force && now - fLastProgress < kProgressInterval)
+		return;
+	fLastProgress = now;
+
+	BMessage message(kICSImportProgress);
+	message.AddInt64("read", fRead);
+	message.AddInt64("size", fSize);
+	message.AddInt32("events", fImported);
+	fTarget.SendMessage(&message);
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _ICS_IMPORTER_H_
+#define _ICS_IMPORTER_H_
+
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Entry.h>
+#include <Locker.h>
+#include <Messenger.h>
+#include <OS.h>
+#include <String.h>
+
+#include "ICSEventReader.h"
+
+
+class BFile;
+class BList;
+class Category;
+class SQLiteManager;
+
+
+static const uint32 kICSImportProgress = 'kiip';
+static const uint32 kICSImportComplete = 'kiic';
+
+
+// Imports the events of an iCalendar file into the database.
+//
+// The import is a pipeline. A reader thread cuts the file into batches of
+// whole events (see ICSSplitter), a pool of worker threads, one per CPU,
+// parses them, and the thread calling Run() inserts the parsed events batch
+// by batch in file order. Only a few batches are in flight at any time, so
+// memory use doesn't depend on the size of the file.
+//
+// The events are committed every kCommitInterval of them, so the views and
+// the sync can get at the database in between. A failed or cancelled import
+// keeps the events committed so far, and importing the file again adds the
+// rest.
+//
+// Events are matched to categories by name, falling back to "Default". An
+// event gets an ID of its own, and the UID it had in the file is kept along
+// with it, so importing a file twice doesn't duplicate anything.
+//
+// Progress is sent to the target as kICSImportProgress with "read" and
+// "size" (bytes) and "events", the end as kICSImportComplete with
+// "status", "imported" and "skipped".
+class ICSImporter {
+public:
+					ICSImporter(const entry_ref& ref,
+						const BMessenger& target);
+					~ICSImporter();
+
+		status_t	Run();
+		void		Cancel();
+
+		int32		ImportedCount() const;
+		int32		SkippedCount() const;
+
+private:
+		struct Batch {
+			int32				sequence;
+			off_t				end;
+			std::string			text;
+			std::vector<ICSEvent>	events;
+			uint64				invalid;
+		};
+
+		status_t	_RunPipeline(BFile& file);
+		static	int32	_ReaderThread(void* data);
+		static	int32	_WorkerThread(void* data);
+		void		_Read();
+		void		_Work();
+		void		_Queue(Batch* batch);
+
+		void		_Insert(ICSEvent& event);
+		bool		_CommitChunk();
+		Category*	_CategoryFor(const std::string& name);
+		void		_SendProgress(bool force);
+
+		static const size_t	kChunkSize = 64 * 1024;
+		static const size_t	kBatchSize = 256 * 1024;
+		static const int32	kMaxWorkers = 8;
+		static const bigtime_t	kProgressInterval = 100000;
+		static const int32	kCommitInterval = 5000;
+
+		entry_ref	fRef;
+		BMessenger	fTarget;
+		SQLiteManager*	fDBManager;
+		BList*		fCategories;
+		Category*	fDefaultCategory;
+
+		BFile*		fFile;
+		BLocker		fLock;
+		sem_id		fSlotSem;
+		sem_id		fWorkSem;
+		sem_id		fDoneSem;
+		std::deque<Batch*>	fWork;
+		std::map<int32, Batch*>	fDone;
+		int32		fBatchCount;
+		bool		fReadDone;
+		status_t	fReadStatus;
+
+		off_t		fSize;
+		off_t		fRead;
+		bigtime_t	fLastProgress;
+		int32		fImported;
+		int32		fSkipped;
+		int32		fCommitted;
+		int32		fUncommitted;
+		status_t	fWriteStatus;
+		time_t		fNow;
+		volatile bool	fCancelled;
+};
+
+#endif	// _ICS_IMPORTER_H_
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ICSParser.h"
+
+#include <string.h>
+#include <strings.h>
+
+
+static void
+ToUpper(std::string& string)
+{
+	for (size_t i = 0; i < string.size(); i++) {
+		if (string[i] >= 'a' && string[i] <= 'z')
+			string[i] -= 'a' - 'A';
+	}
+}
+
+
+const char*
+ICSContentLine::Parameter(const char* name) const
+{
+	for (size_t i = 0; i < parameterCount; i++) {
+		if (strcasecmp(parameters[i].name.c_str(), name) == 0)
+			return parameters[i].value.c_str();
+	}
+
+	return NULL;
+}
+
+
+ICSParser::ICSParser(ICSHandler* handler)
+	:
+	fHandler(handler)
+{
+	Reset();
+}
+
+
+// Parses the next length bytes of the stream. Returns false once the
+// handler has asked to stop.
+bool
+ICSParser::Feed(const char* data, size_t length)
+{
+	const char* end = data + length;
+
+	while (data < end && !fStopped) {
+		if (fLineEnded) {
+			// A line break followed by a space or tab is a fold, anything
+			// else starts the next content line.
+			if (*data == ' ' || *data == '\t')
+				data++;
+			else if (!_EndLine())
+				break;
+			fLineEnded = false;
+			continue;
+		}
+
+		const char* lineBreak = (const char*)memchr(data, '\n', end - data);
+		if (lineBreak == NULL) {
+			_Append(data, end - data);
+			break;
+		}
+
+		_Append(data, lineBreak - data);
+		if (!fLine.empty() && fLine[fLine.size() - 1] == '\r')
+			fLine.resize(fLine.size() - 1);
+		fLineEnded = true;
+		data = lineBreak + 1;
+	}
+
+	return !fStopped;
+}
+
+
+// Hands the last line to the handler, the stream having no more data.
+bool
+ICSParser::Finish()
+{
+	if (!fStopped) {
+		if (!fLine.empty() && fLine[fLine.size() - 1] == '\r')
+			fLine.resize(fLine.size() - 1);
+		_EndLine();
+	}
+	fLineEnded = false;
+
+	return !fStopped;
+}
+
+
+void
+ICSParser::Reset()
+{
+	fLine.clear();
+	fLineEnded = false;
+	fStopped = false;
+	fLineCount = 0;
+	fContentLine.parameterCount = 0;
+}
+
+
+uint64_t
+ICSParser::LineCount() const
+{
+	return fLineCount;
+}
+
+
+// Decodes the TEXT value escapes: \n, \N, \, \; and \\.
+void
+ICSParser::Unescape(const std::string& value, std::string& text)
+{
+	text.clear();
+
+	size_t length = value.size();
+	for (size_t i = 0; i < length; i++) {
+		char c = value[i];
+		if (c == '\\' && i + 1 < length) {
+			c = value[++i];
+			if (c == 'n' || c == 'N')
+				c = '\n';
+		}
+		text += c;
+	}
+}
+
+
+void
+ICSParser::_Append(const char* data, size_t length)
+{
+	size_t room = kMaxLineLength - fLine.size();
+	fLine.append(data, length < room ? length : room);
+}
+
+
+bool
+ICSParser::_EndLine()
+{
+	bool result = true;
+	if (!fLine.empty()) {
+		fLineCount++;
+		result = _ParseLine();
+	}
+
+	fLine.clear();
+	if (!result)
+		fStopped = true;
+	return result;
+}
+
+
+bool
+ICSParser::_ParseLine()
+{
+	const char* line = fLine.c_str();
+	const char* end = line + fLine.size();
+	ICSContentLine& contentLine = fContentLine;
+
+	const char* nameEnd = line + strcspn(line, ";:");
+	contentLine.name.assign(line, nameEnd);
+	ToUpper(contentLine.name);
+	contentLine.parameterCount = 0;
+
+	// The value starts after the first colon that isn't inside a quoted
+	// parameter value.
+	const char* position = nameEnd;
+	while (position < end && *position == ';') {
+		position++;
+		const char* nameStart = position;
+		while (position < end && *position != '=' && *position != ';'
+			&& *position != ':')
+			position++;
+
+		if (contentLine.parameterCount == contentLine.parameters.size())
+			contentLine.parameters.resize(contentLine.parameterCount + 1);
+		ICSParameter& parameter
+			= contentLine.parameters[contentLine.parameterCount++];
+		parameter.name.assign(nameStart, position);
+		ToUpper(parameter.name);
+		parameter.value.clear();
+
+		if (position == end || *position != '=')
+			continue;
+		position++;
+
+		while (position < end && *position != ';' && *position != ':') {
+			if (*position == '"') {
+				const char* quoteEnd = (const char*)memchr(position + 1, '"',
+					end - position - 1);
+				if (quoteEnd == NULL)
+					quoteEnd = end;
+				parameter.value.append(position + 1, quoteEnd);
+				position = quoteEnd < end ? quoteEnd + 1 : end;
+			} else
+				parameter.value += *position++;
+		}
+	}
+
+	if (position < end && *position == ':')
+		position++;
+	contentLine.value.assign(position, end);
+
+	return fHandler->ContentLine(contentLine);
+}
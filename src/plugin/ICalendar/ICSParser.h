@@ -0,0 +1,77 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _ICS_PARSER_H_
+#define _ICS_PARSER_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+struct ICSParameter {
+	std::string	name;
+	std::string	value;
+};
+
+
+// One unfolded RFC 5545 content line, "NAME;PARAM=VALUE:value". Names are
+// upper-cased, parameter values are unquoted and the value is left escaped,
+// see ICSParser::Unescape().
+struct ICSContentLine {
+	std::string					name;
+	std::vector<ICSParameter>	parameters;
+	size_t						parameterCount;
+	std::string					value;
+
+	const char*	Parameter(const char* name) const;
+};
+
+
+class ICSHandler {
+public:
+	virtual				~ICSHandler() {}
+
+	// Returning false stops the parser.
+	virtual	bool		ContentLine(const ICSContentLine& line) = 0;
+};
+
+
+// Push parser for iCalendar streams. Input is fed in chunks of any size,
+// split anywhere, and every complete content line is handed to the handler
+// as soon as the start of the next one shows it isn't folded any further.
+// Only the line being assembled is kept, so memory doesn't grow with the
+// size of the stream; lines longer than kMaxLineLength are cut short.
+//
+// Only uses the standard library, so it can be built and run on any host.
+class ICSParser {
+public:
+					ICSParser(ICSHandler* handler);
+
+		bool		Feed(const char* data, size_t length);
+		bool		Finish();
+		void		Reset();
+
+		uint64_t	LineCount() const;
+
+	static	void		Unescape(const std::string& value, std::string& text);
+
+	static const size_t	kMaxLineLength = 1024 * 1024;
+
+private:
+		void		_Append(const char* data, size_t length);
+		bool		_EndLine();
+		bool		_ParseLine();
+
+		ICSHandler*	fHandler;
+		std::string	fLine;
+		bool		fLineEnded;
+		bool		fStopped;
+		uint64_t	fLineCount;
+		ICSContentLine	fContentLine;
+};
+
+#endif	// _ICS_PARSER_H_
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ICSSplitter.h"
+
+#include <string.h>
+#include <strings.h>
+
+
+static const char kEventStart[] = "\nBEGIN:VEVENT";
+static const size_t kEventStartLength = sizeof(kEventStart) - 1;
+
+
+ICSSplitter::ICSSplitter(size_t batchSize)
+	:
+	fBatchSize(batchSize),
+	fSearchFrom(batchSize)
+{
+}
+
+
+void
+ICSSplitter::Feed(const char* data, size_t length)
+{
+	fPending.append(data, length);
+}
+
+
+// Takes the next batch out of the data fed so far. Returns false if there
+// isn't enough data for a full one yet.
+bool
+ICSSplitter::NextBatch(std::string& batch)
+{
+	// The cut goes before the first event starting past the batch size.
+	// Names are case insensitive, so the line is compared as such.
+	const char* data = fPending.c_str();
+	size_t length = fPending.size();
+
+	while (fSearchFrom < length) {
+		const char* lineBreak = (const char*)memchr(data + fSearchFrom, '\n',
+			length - fSearchFrom);
+		if (lineBreak == NULL) {
+			fSearchFrom = length;
+			return false;
+		}
+
+		// Look at this line again once its end is there.
+		size_t position = lineBreak - data;
+		if (position + kEventStartLength >= length) {
+			fSearchFrom = position;
+			return false;
+		}
+
+		char terminator = lineBreak[kEventStartLength];
+		if (strncasecmp(lineBreak, kEventStart, kEventStartLength) == 0
+			&& (terminator == '\r' || terminator == '\n')) {
+			batch.assign(fPending, 0, position + 1);
+			fPending.erase(0, position + 1);
+			fSearchFrom = fBatchSize;
+			return true;
+		}
+
+		fSearchFrom = position + 1;
+	}
+
+	return false;
+}
+
+
+// Returns whatever is left once the stream has ended.
+bool
+ICSSplitter::Finish(std::string& batch)
+{
+	batch.swap(fPending);
+	fPending.clear();
+	fSearchFrom = fBatchSize;
+	return !batch.empty();
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _ICS_SPLITTER_H_
+#define _ICS_SPLITTER_H_
+
+
+#include <stddef.h>
+#include <string>
+
+
+// Cuts an iCalendar stream into batches of about batchSize bytes that can
+// be parsed independently of each other. Every batch but the first starts
+// with a BEGIN:VEVENT line and every batch but the last ends with a line
+// break, so no event or folded line is ever split across two batches.
+// Batches come out in stream order.
+//
+// Only uses the standard library, so it can be built and run on any host.
+class ICSSplitter {
+public:
+					ICSSplitter(size_t batchSize);
+
+		void		Feed(const char* data, size_t length);
+		bool		NextBatch(std::string& batch);
+		bool		Finish(std::string& batch);
+
+private:
+		size_t		fBatchSize;
+		size_t		fSearchFrom;
+		std::string	fPending;
+};
+
+#endif	// _ICS_SPLITTER_H_
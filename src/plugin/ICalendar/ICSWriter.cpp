@@ -0,0 +1,195 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ICSWriter.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "CivilDate.h"
+
+
+static void
+FormatDigits(char* buffer, int64_t value, int count)
+{
+	for (int i = count - 1; i >= 0; i--) {
+		buffer[i] = '0' + value % 10;
+		value /= 10;
+	}
+}
+
+
+ICSWriter::ICSWriter(ICSOutput* output)
+	:
+	fOutput(output),
+	fLength(0),
+	fStatus(true)
+{
+}
+
+
+void
+ICSWriter::Begin(const char* component)
+{
+	Property("BEGIN", component);
+}
+
+
+void
+ICSWriter::End(const char* component)
+{
+	Property("END", component);
+}
+
+
+// Writes value as it is, for values that need no escaping.
+void
+ICSWriter::Property(const char* name, const char* value)
+{
+	_Start(name);
+	_Put(":", 1);
+	_Put(value, strlen(value));
+	_EndLine();
+}
+
+
+void
+ICSWriter::TextProperty(const char* name, const char* text)
+{
+	_Start(name);
+	_Put(":", 1);
+	_PutText(text);
+	_EndLine();
+}
+
+
+// Writes time, in seconds since the epoch, as a UTC DATE-TIME.
+void
+ICSWriter::DateTimeProperty(const char* name, int64_t time)
+{
+	int64_t days = DaysFromTime(time);
+	int64_t seconds = time - DayStart(days);
+	CivilDate date = CivilFromDays(days);
+
+	char value[16];
+	FormatDigits(value, date.year, 4);
+	FormatDigits(value + 4, date.month, 2);
+	FormatDigits(value + 6, date.day, 2);
+	value[8] = 'T';
+	FormatDigits(value + 9, seconds / 3600, 2);
+	FormatDigits(value + 11, seconds / 60 % 60, 2);
+	FormatDigits(value + 13, seconds % 60, 2);
+	value[15] = 'Z';
+
+	_Start(name);
+	_Put(":", 1);
+	_Put(value, sizeof(value));
+	_EndLine();
+}
+
+
+void
+ICSWriter::DateProperty(const char* name, int year, int month, int day)
+{
+	char value[32];
+	snprintf(value, sizeof(value), "%04d%02d%02d", year, month, day);
+
+	_Start(name);
+	_Put(";VALUE=DATE:", 12);
+	_Put(value, strlen(value));
+	_EndLine();
+}
+
+
+// Whether everything written so far reached the output.
+bool
+ICSWriter::Status() const
+{
+	return fStatus;
+}
+
+
+void
+ICSWriter::_Start(const char* name)
+{
+	fLength = 0;
+	_Put(name, strlen(name));
+}
+
+
+void
+ICSWriter::_Put(const char* data, size_t length)
+{
+	// Most values fit on the line they start on.
+	if (fLength + length <= kMaxLineLength) {
+		memcpy(fLine + fLength, data, length);
+		fLength += length;
+		return;
+	}
+
+	for (size_t i = 0; i < length; i++) {
+		// A line is folded before a UTF-8 sequence that doesn't fit on it
+		// anymore, never inside one.
+		unsigned char byte = data[i];
+		size_t needed = 1;
+		if ((byte & 0xe0) == 0xc0)
+			needed = 2;
+		else if ((byte & 0xf0) == 0xe0)
+			needed = 3;
+		else if ((byte & 0xf8) == 0xf0)
+			needed = 4;
+
+		if (fLength + needed > kMaxLineLength) {
+			fLine[fLength++] = '\r';
+			fLine[fLength++] = '\n';
+			if (fStatus)
+				fStatus = fOutput->Write(fLine, fLength);
+			fLine[0] = ' ';
+			fLength = 1;
+		}
+
+		fLine[fLength++] = byte;
+	}
+}
+
+
+void
+ICSWriter::_PutText(const char* text)
+{
+	while (true) {
+		size_t run = strcspn(text, "\\;,\n\r");
+		_Put(text, run);
+		text += run;
+
+		switch (*text) {
+			case '\0':
+				return;
+			case '\\':
+				_Put("\\\\", 2);
+				break;
+			case ';':
+				_Put("\\;", 2);
+				break;
+			case ',':
+				_Put("\\,", 2);
+				break;
+			case '\n':
+				_Put("\\n", 2);
+				break;
+		}
+		text++;
+	}
+}
+
+
+void
+ICSWriter::_EndLine()
+{
+	fLine[fLength++] = '\r';
+	fLine[fLength++] = '\n';
+	if (fStatus)
+		fStatus = fOutput->Write(fLine, fLength);
+	fLength = 0;
+}
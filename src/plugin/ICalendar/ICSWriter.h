@@ -0,0 +1,56 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _ICS_WRITER_H_
+#define _ICS_WRITER_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+class ICSOutput {
+public:
+	virtual				~ICSOutput() {}
+
+	virtual	bool		Write(const char* data, size_t length) = 0;
+};
+
+
+// Writes iCalendar content lines. TEXT values are escaped and lines are
+// folded at 75 octets, without splitting UTF-8 sequences, while they are
+// written, so nothing but the current line is ever kept. Whether all
+// writes went through is known from Status().
+//
+// Only uses the standard library, so it can be built and run on any host.
+class ICSWriter {
+public:
+					ICSWriter(ICSOutput* output);
+
+		void		Begin(const char* component);
+		void		End(const char* component);
+
+		void		Property(const char* name, const char* value);
+		void		TextProperty(const char* name, const char* text);
+		void		DateTimeProperty(const char* name, int64_t time);
+		void		DateProperty(const char* name, int year, int month,
+						int day);
+
+		bool		Status() const;
+
+	static const size_t	kMaxLineLength = 75;
+
+private:
+		void		_Start(const char* name);
+		void		_Put(const char* data, size_t length);
+		void		_PutText(const char* text);
+		void		_EndLine();
+
+		ICSOutput*	fOutput;
+		char		fLine[kMaxLineLength + 2];
+		size_t		fLength;
+		bool		fStatus;
+};
+
+#endif	// _ICS_WRITER_H_
@@ -0,0 +1,359 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "SubscriptionWindow.h"
+
+#include <Application.h>
+#include <Autolock.h>
+#include <Button.h>
+#include <LayoutBuilder.h>
+#include <ListView.h>
+#include <MenuField.h>
+#include <MenuItem.h>
+#include <PopUpMenu.h>
+#include <ScrollView.h>
+#include <String.h>
+#include <StringView.h>
+#include <TextControl.h>
+
+#include "App.h"
+#include "Category.h"
+#include "EventSyncWindow.h"
+#include "FeedRefresher.h"
+#include "MainWindow.h"
+#include "SQLiteManager.h"
+#include "Subscription.h"
+
+
+SubscriptionWindow::SubscriptionWindow()
+	:
+	BWindow(BRect(), "iCalendar Subscriptions", B_TITLED_WINDOW,
+		B_AUTO_UPDATE_SIZE_LIMITS),
+	fSubscriptionList(NULL),
+	fRefreshThread(-1),
+	fRefreshLock("feed refresh"),
+	fRefresher(NULL),
+	fCancelled(false)
+{
+	fDBManager = new SQLiteManager();
+	fCategoryList = fDBManager->GetAllCategories();
+
+	_InitInterface();
+	_LoadSubscriptions();
+	CenterOnScreen();
+}
+
+
+SubscriptionWindow::~SubscriptionWindow()
+{
+	_StopRefresh();
+
+	for (int32 i = 0; i < fSubscriptionList->CountItems(); i++)
+		delete (Subscription*)fSubscriptionList->ItemAt(i);
+	delete fSubscriptionList;
+
+	for (int32 i = 0; i < fCategoryList->CountItems(); i++)
+		delete (Category*)fCategoryList->ItemAt(i);
+	delete fCategoryList;
+
+	delete fDBManager;
+}
+
+
+void
+SubscriptionWindow::MessageReceived(BMessage* message)
+{
+	switch(message->what) {
+
+		case kAddPressed:
+			_AddSubscription();
+			break;
+
+		case kRemovePressed:
+			_RemoveSubscription();
+			break;
+
+		case kRefreshPressed:
+			_Refresh();
+			break;
+
+		case kRefreshComplete:
+		{
+			int32 added = 0;
+			int32 changed = 0;
+			int32 removed = 0;
+			int32 unchanged = 0;
+			int32 failed = 0;
+			message->FindInt32("added", &added);
+			message->FindInt32("changed", &changed);
+			message->FindInt32("removed", &removed);
+			message->FindInt32("unchanged", &unchanged);
+			message->FindInt32("failed", &failed);
+
+			BString text;
+			text << added << " added, " << changed << " changed, "
+				<< removed << " removed, " << unchanged << " unchanged";
+			if (failed > 0)
+				text << ", " << failed << " feeds failed";
+			fStatusView->SetText(text.String());
+
+			_StopRefresh();
+			fRefreshButton->SetEnabled(true);
+
+			if (added + changed + removed > 0) {
+				((App*)be_app)->mainWindow()->PostMessage(
+					kSynchronizationComplete);
+			}
+			break;
+		}
+
+		default:
+			BWindow::MessageReceived(message);
+			break;
+	}
+}
+
+
+bool
+SubscriptionWindow::QuitRequested()
+{
+	// A refresh in progress is rolled back rather than left half done.
+	_StopRefresh();
+	be_app->PostMessage(kSubscriptionWindowQuitting);
+	return true;
+}
+
+
+void
+SubscriptionWindow::_InitInterface()
+{
+	fListView = new BListView("SubscriptionListView", B_SINGLE_SELECTION_LIST,
+		B_WILL_DRAW);
+	BScrollView* scrollView = new BScrollView("SubscriptionScroll", fListView,
+		B_WILL_DRAW, false, true);
+	scrollView->SetExplicitMinSize(BSize(360, 160));
+
+	fNameText = new BTextControl("NameText", "Name:", NULL, NULL);
+	fUrlText = new BTextControl("UrlText", "URL:", NULL, NULL);
+
+	fCategoryMenu = new BPopUpMenu("CategoryMenu");
+	for (int32 i = 0; i < fCategoryList->CountItems(); i++) {
+		Category* category = (Category*)fCategoryList->ItemAt(i);
+		fCategoryMenu->AddItem(new BMenuItem(category->GetName(), NULL));
+	}
+	if (fCategoryMenu->CountItems() > 0)
+		fCategoryMenu->ItemAt(0)->SetMarked(true);
+	BMenuField* categoryField = new BMenuField("CategoryMenuField",
+		"Category:", fCategoryMenu);
+
+	BButton* addButton = new BButton("AddButton", "Add",
+		new BMessage(kAddPressed));
+	fRemoveButton = new BButton("RemoveButton", "Remove",
+		new BMessage(kRemovePressed));
+	fRefreshButton = new BButton("RefreshButton", "Refresh all",
+		new BMessage(kRefreshPressed));
+
+	fStatusView = new BStringView("StatusView", "");
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL, B_USE_HALF_ITEM_SPACING)
+		.SetInsets(B_USE_WINDOW_SPACING)
+		.Add(scrollView)
+		.AddGrid(B_USE_HALF_ITEM_SPACING, B_USE_HALF_ITEM_SPACING)
+			.AddTextControl(fNameText, 0, 0)
+			.AddTextControl(fUrlText, 0, 1)
+			.AddMenuField(categoryField, 0, 2)
+		.End()
+		.AddGroup(B_HORIZONTAL)
+			.Add(fStatusView)
+			.AddGlue()
+			.Add(addButton)
+			.Add(fRemoveButton)
+			.Add(fRefreshButton)
+		.End()
+	.End();
+}
+
+
+void
+SubscriptionWindow::_LoadSubscriptions()
+{
+	if (fSubscriptionList != NULL) {
+		for (int32 i = 0; i < fSubscriptionList->CountItems(); i++)
+			delete (Subscription*)fSubscriptionList->ItemAt(i);
+		delete fSubscriptionList;
+	}
+
+	fSubscriptionList = fDBManager->GetAllSubscriptions();
+
+	for (int32 i = fListView->CountItems() - 1; i >= 0; i--)
+		delete fListView->RemoveItem(i);
+
+	for (int32 i = 0; i < fSubscriptionList->CountItems(); i++) {
+		Subscription* subscription
+			= (Subscription*)fSubscriptionList->ItemAt(i);
+		BString label;
+		label << subscription->GetName() << " (" << subscription->GetUrl()
+			<< ")";
+		fListView->AddItem(new BStringItem(label.String()));
+	}
+}
+
+
+void
+SubscriptionWindow::_AddSubscription()
+{
+	int32 index = fCategoryMenu->IndexOf(fCategoryMenu->FindMarked());
+	Category* category = (Category*)fCategoryList->ItemAt(index);
+	if (category == NULL)
+		return;
+
+	Subscription subscription(fNameText->Text(), fUrlText->Text(),
+		category->GetId());
+	if (!fDBManager->AddSubscription(&subscription)) {
+		fStatusView->SetText("The subscription could not be added.");
+		return;
+	}
+
+	fNameText->SetText("");
+	fUrlText->SetText("");
+	fStatusView->SetText("");
+	_LoadSubscriptions();
+}
+
+
+void
+SubscriptionWindow::_RemoveSubscription()
+{
+	int32 selection = fListView->CurrentSelection();
+	if (selection < 0 || fRefreshThread >= 0)
+		return;
+
+	Subscription* subscription
+		= (Subscription*)fSubscriptionList->ItemAt(selection);
+	if (fDBManager->RemoveSubscription(subscription)) {
+		_LoadSubscriptions();
+		((App*)be_app)->mainWindow()->PostMessage(kSynchronizationComplete);
+	}
+}
+
+
+void
+SubscriptionWindow::_Refresh()
+{
+	if (fRefreshThread >= 0 || fSubscriptionList->IsEmpty())
+		return;
+
+	// The thread gets copies, the list is reloaded when subscriptions are
+	// added or removed meanwhile.
+	BList* subscriptions = new BList();
+	for (int32 i = 0; i < fSubscriptionList->CountItems(); i++) {
+		subscriptions->AddItem(new Subscription(
+			*(Subscription*)fSubscriptionList->ItemAt(i)));
+	}
+
+	BMessage* data = new BMessage();
+	data->AddPointer("window", this);
+	data->AddPointer("subscriptions", subscriptions);
+
+	fCancelled = false;
+	fRefreshThread = spawn_thread(_RefreshThread, "Feed Refresh Thread",
+		B_LOW_PRIORITY, data);
+	if (fRefreshThread < 0) {
+		delete data;
+		for (int32 i = 0; i < subscriptions->CountItems(); i++)
+			delete (Subscription*)subscriptions->ItemAt(i);
+		delete subscriptions;
+		return;
+	}
+
+	fRefreshButton->SetEnabled(false);
+	fStatusView->SetText("Refreshing" B_UTF8_ELLIPSIS);
+	resume_thread(fRefreshThread);
+}
+
+
+void
+SubscriptionWindow::_StopRefresh()
+{
+	if (fRefreshThread < 0)
+		return;
+
+	fRefreshLock.Lock();
+	fCancelled = true;
+	if (fRefresher != NULL)
+		fRefresher->Cancel();
+	fRefreshLock.Unlock();
+
+	status_t result;
+	wait_for_thread(fRefreshThread, &result);
+	fRefreshThread = -1;
+}
+
+
+int32
+SubscriptionWindow::_RefreshThread(void* data)
+{
+	BMessage* message = (BMessage*)data;
+	SubscriptionWindow* window;
+	BList* subscriptions;
+	if (message->FindPointer("window", (void**)&window) == B_OK
+		&& message->FindPointer("subscriptions", (void**)&subscriptions)
+			== B_OK) {
+		window->_RefreshAll(subscriptions);
+
+		for (int32 i = 0; i < subscriptions->CountItems(); i++)
+			delete (Subscription*)subscriptions->ItemAt(i);
+		delete subscriptions;
+	}
+
+	delete message;
+	return 0;
+}
+
+
+void
+SubscriptionWindow::_RefreshAll(BList* subscriptions)
+{
+	SQLiteManager dbManager;
+	int32 added = 0;
+	int32 changed = 0;
+	int32 removed = 0;
+	int32 unchanged = 0;
+	int32 failed = 0;
+
+	for (int32 i = 0; i < subscriptions->CountItems() && !fCancelled; i++) {
+		Subscription* subscription = (Subscription*)subscriptions->ItemAt(i);
+		FeedRefresher refresher(&dbManager, subscription);
+
+		fRefreshLock.Lock();
+		fRefresher = &refresher;
+		fRefreshLock.Unlock();
+		if (fCancelled)
+			refresher.Cancel();
+
+		if (refresher.Run() == B_OK) {
+			added += refresher.AddedCount();
+			changed += refresher.ChangedCount();
+			removed += refresher.RemovedCount();
+			unchanged += refresher.UnchangedCount();
+		} else
+			failed++;
+
+		fRefreshLock.Lock();
+		fRefresher = NULL;
+		fRefreshLock.Unlock();
+	}
+
+	if (fCancelled)
+		return;
+
+	BMessage message(kRefreshComplete);
+	message.AddInt32("added", added);
+	message.AddInt32("changed", changed);
+	message.AddInt32("removed", removed);
+	message.AddInt32("unchanged", unchanged);
+	message.AddInt32("failed", failed);
+	BMessenger(this).SendMessage(&message);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _SUBSCRIPTION_WINDOW_H_
+#define _SUBSCRIPTION_WINDOW_H_
+
+
+#include <Locker.h>
+#include <Messenger.h>
+#include <Window.h>
+
+
+class BButton;
+class BList;
+class BListView;
+class BMenu;
+class BStringView;
+class BTextControl;
+class FeedRefresher;
+class SQLiteManager;
+
+
+const uint32 kSubscriptionWindowQuitting = 'kswq';
+
+
+// Lists the subscribed iCalendar feeds, adds and removes them, and
+// refreshes them on a thread of its own (see FeedRefresher).
+class SubscriptionWindow: public BWindow {
+public:
+					SubscriptionWindow();
+					~SubscriptionWindow();
+
+	virtual void	MessageReceived(BMessage* message);
+	virtual bool	QuitRequested();
+
+private:
+	void			_InitInterface();
+	void			_LoadSubscriptions();
+	void			_AddSubscription();
+	void			_RemoveSubscription();
+	void			_Refresh();
+	void			_StopRefresh();
+
+	static int32	_RefreshThread(void* data);
+	void			_RefreshAll(BList* subscriptions);
+
+	static const uint32	kAddPressed		= 1000;
+	static const uint32	kRemovePressed		= 1001;
+	static const uint32	kRefreshPressed		= 1002;
+	static const uint32	kRefreshComplete	= 1003;
+
+	BListView*		fListView;
+	BTextControl*	fNameText;
+	BTextControl*	fUrlText;
+	BMenu*			fCategoryMenu;
+	BButton*		fRemoveButton;
+	BButton*		fRefreshButton;
+	BStringView*	fStatusView;
+
+	BList*			fSubscriptionList;
+	BList*			fCategoryList;
+	SQLiteManager*	fDBManager;
+
+	thread_id		fRefreshThread;
+	BLocker			fRefreshLock;
+	FeedRefresher*	fRefresher;
+	volatile bool	fCancelled;
+};
+
+#endif	// _SUBSCRIPTION_WINDOW_H_
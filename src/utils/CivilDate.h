@@ -0,0 +1,211 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _CIVIL_DATE_H_
+#define _CIVIL_DATE_H_
+
+
+#include <stdint.h>
+#include <time.h>
+
+
+// Proleptic Gregorian calendar arithmetic on day numbers counted from
+// 1970-01-01, without tables, allocation or the C library. Everything that
+// doesn't need a time zone is constexpr, so it can be used in constant
+// expressions as well as in loops over many events.
+//
+// Only uses the standard library, so it can be built and run on any host.
+
+static const int64_t kSecondsPerDay = 24 * 60 * 60;
+
+// BDate::DateToJulianDay() of 1970-01-01.
+static const int64_t kJulianDayOfEpoch = 2440588;
+
+
+struct CivilDate {
+	int32_t		year;
+	int32_t		month;
+	int32_t		day;
+};
+
+
+struct IsoWeek {
+	int32_t		year;
+	int32_t		week;
+};
+
+
+// Division rounding towards minus infinity, for times before the epoch.
+constexpr int64_t
+FloorDivide(int64_t value, int64_t divisor)
+{
+	return value / divisor - (value % divisor < 0);
+}
+
+
+constexpr int64_t
+FloorModulo(int64_t value, int64_t divisor)
+{
+	return value - FloorDivide(value, divisor) * divisor;
+}
+
+
+constexpr bool
+IsLeapYear(int64_t year)
+{
+	return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+
+constexpr int32_t
+DaysInMonth(int64_t year, int32_t month)
+{
+	return month == 2 ? (IsLeapYear(year) ? 29 : 28)
+		: 30 + ((month + (month >> 3)) & 1);
+}
+
+
+constexpr int64_t
+DaysFromCivil(int64_t year, int32_t month, int32_t day)
+{
+	year -= month <= 2;
+	int64_t era = FloorDivide(year, 400);
+	int64_t yearOfEra = year - era * 400;
+	int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5
+		+ day - 1;
+	int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100
+		+ dayOfYear;
+	return era * 146097 + dayOfEra - 719468;
+}
+
+
+constexpr CivilDate
+CivilFromDays(int64_t days)
+{
+	days += 719468;
+	int64_t era = FloorDivide(days, 146097);
+	int64_t dayOfEra = days - era * 146097;
+	int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524
+		- dayOfEra / 146096) / 365;
+	int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4
+		- yearOfEra / 100);
+	int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+
+	CivilDate date = {};
+	date.day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+	date.month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+	date.year = yearOfEra + era * 400 + (date.month <= 2);
+	return date;
+}
+
+
+// 1 for Monday to 7 for Sunday, as BDate::DayOfWeek().
+constexpr int32_t
+WeekdayFromDays(int64_t days)
+{
+	return FloorModulo(days + 3, 7) + 1;
+}
+
+
+// The ISO 8601 week: weeks start on Monday, and the first week of a year
+// is the one with its Thursday.
+constexpr IsoWeek
+IsoWeekFromDays(int64_t days)
+{
+	int64_t thursday = days - WeekdayFromDays(days) + 4;
+	IsoWeek week = {};
+	week.year = CivilFromDays(thursday).year;
+	week.week = (thursday - DaysFromCivil(week.year, 1, 1)) / 7 + 1;
+	return week;
+}
+
+
+// Day of a time as seen at offset seconds east of UTC.
+constexpr int64_t
+DaysFromTime(int64_t time, int32_t offset = 0)
+{
+	return FloorDivide(time + offset, kSecondsPerDay);
+}
+
+
+// First and last second of a day in a zone with a fixed offset.
+constexpr int64_t
+DayStart(int64_t days, int32_t offset = 0)
+{
+	return days * kSecondsPerDay - offset;
+}
+
+
+constexpr int64_t
+DayEnd(int64_t days, int32_t offset = 0)
+{
+	return DayStart(days + 1, offset) - 1;
+}
+
+
+// A zone is anything returning the offset east of UTC in effect at a time.
+// This one asks the C library for the process' local zone.
+struct LocalTimeZone {
+	int32_t operator()(int64_t time) const
+	{
+		time_t value = (time_t)time;
+		struct tm local;
+		localtime_r(&value, &local);
+		return local.tm_gmtoff;
+	}
+};
+
+
+// The time a wall clock in a zone whose offset changes, like at daylight
+// saving time transitions, shows local, in seconds since the local epoch.
+// It is tried with the offsets in effect a day before and a day after. When
+// it shows the time twice, the first is taken; when the time falls into the
+// gap of a transition, it is moved forward by the length of the gap, as
+// mktime() does.
+template<typename Zone>
+inline int64_t
+ZonedTimeFromLocal(int64_t local, const Zone& zone)
+{
+	int64_t before = local - zone(local - kSecondsPerDay);
+	int64_t after = local - zone(local + kSecondsPerDay);
+	bool beforeValid = before + zone(before) == local;
+	bool afterValid = after + zone(after) == local;
+
+	if (beforeValid && afterValid)
+		return before < after ? before : after;
+	if (beforeValid || afterValid)
+		return beforeValid ? before : after;
+	return before > after ? before : after;
+}
+
+
+// Start of a day in a zone whose offset changes. When midnight falls into
+// the gap of a transition, the day starts at the transition.
+template<typename Zone>
+inline int64_t
+ZonedDayStart(int64_t days, const Zone& zone)
+{
+	return ZonedTimeFromLocal(days * kSecondsPerDay, zone);
+}
+
+
+template<typename Zone>
+inline int64_t
+ZonedDaysFromTime(int64_t time, const Zone& zone)
+{
+	return DaysFromTime(time, zone(time));
+}
+
+
+static_assert(DaysFromCivil(1970, 1, 1) == 0, "epoch");
+static_assert(DaysFromCivil(2000, 3, 1) == 11017, "after a leap day");
+static_assert(CivilFromDays(-1).year == 1969, "before the epoch");
+static_assert(WeekdayFromDays(0) == 4, "1970-01-01 was a Thursday");
+static_assert(IsoWeekFromDays(DaysFromCivil(2021, 1, 3)).week == 53,
+	"2021-01-03 is in week 53 of 2020");
+static_assert(DaysInMonth(2000, 2) == 29 && DaysInMonth(1900, 2) == 28
+	&& DaysInMonth(2017, 7) == 31 && DaysInMonth(2017, 9) == 30,
+	"month lengths");
+
+#endif	// _CIVIL_DATE_H_
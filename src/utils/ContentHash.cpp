@@ -0,0 +1,44 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ContentHash.h"
+
+#include <string.h>
+
+
+static const uint64_t kContentHashPrime = 1099511628211ULL;
+
+
+uint64_t
+HashBytes(uint64_t hash, const void* data, size_t length)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= bytes[i];
+		hash *= kContentHashPrime;
+	}
+
+	return hash;
+}
+
+
+uint64_t
+HashString(uint64_t hash, const char* string)
+{
+	return HashBytes(hash, string, strlen(string) + 1);
+}
+
+
+uint64_t
+HashInt64(uint64_t hash, int64_t value)
+{
+	// Byte by byte, so the hash doesn't depend on the byte order.
+	for (int i = 0; i < 8; i++) {
+		hash ^= (uint64_t)value >> (i * 8) & 0xff;
+		hash *= kContentHashPrime;
+	}
+
+	return hash;
+}
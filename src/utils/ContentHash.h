@@ -0,0 +1,25 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _CONTENT_HASH_H_
+#define _CONTENT_HASH_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// 64 bit FNV-1a, to tell whether content changed without keeping a copy of
+// it. Not meant to resist deliberate collisions.
+static const uint64_t kContentHashInitial = 14695981039346656037ULL;
+
+uint64_t HashBytes(uint64_t hash, const void* data, size_t length);
+
+// Hashes the string including its terminator, so "ab" + "c" and "a" + "bc"
+// don't hash the same.
+uint64_t HashString(uint64_t hash, const char* string);
+
+uint64_t HashInt64(uint64_t hash, int64_t value);
+
+#endif	// _CONTENT_HASH_H_
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "EventLayout.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+
+namespace {
+
+struct Interval {
+	int64_t		start;
+	int64_t		end;
+};
+
+
+struct StartOrder {
+	StartOrder(const std::vector<Interval>& intervals)
+		:
+		fIntervals(intervals)
+	{
+	}
+
+	bool operator()(size_t a, size_t b) const
+	{
+		if (fIntervals[a].start != fIntervals[b].start)
+			return fIntervals[a].start < fIntervals[b].start;
+		// Longer events first, so they end up in the leftmost columns.
+		if (fIntervals[a].end != fIntervals[b].end)
+			return fIntervals[a].end > fIntervals[b].end;
+		return a < b;
+	}
+
+	const std::vector<Interval>& fIntervals;
+};
+
+
+typedef std::pair<int64_t, int32_t> ActiveEntry;
+	// end time, column
+
+
+// The leftmost column in use somewhere in a range of time units, out of the
+// columns painted so far. Columns are painted from the right, so a unit
+// only ever gets a lower column.
+//
+// A bottom-up segment tree: painting a range lowers the nodes covering it,
+// and the ancestors of its ends, which hold the minimum below them.
+class NearestColumn {
+public:
+	NearestColumn(size_t units, int32_t none)
+		:
+		fLeaves(1),
+		fNone(none)
+	{
+		while (fLeaves < units)
+			fLeaves *= 2;
+		fMin.assign(2 * fLeaves, none);
+		fAll.assign(fLeaves, none);
+	}
+
+	void Paint(size_t first, size_t last, int32_t column)
+	{
+		size_t low = first + fLeaves;
+		size_t high = last + fLeaves + 1;
+		for (; low < high; low /= 2, high /= 2) {
+			if (low % 2 == 1)
+				_Lower(low++, column);
+			if (high % 2 == 1)
+				_Lower(--high, column);
+		}
+
+		for (size_t node = (first + fLeaves) / 2; node > 0; node /= 2)
+			fMin[node] = std::min(fMin[node], column);
+		for (size_t node = (last + fLeaves) / 2; node > 0; node /= 2)
+			fMin[node] = std::min(fMin[node], column);
+	}
+
+	int32_t Find(size_t first, size_t last) const
+	{
+		int32_t column = fNone;
+		size_t low = first + fLeaves;
+		size_t high = last + fLeaves + 1;
+		for (; low < high; low /= 2, high /= 2) {
+			if (low % 2 == 1)
+				column = std::min(column, fMin[low++]);
+			if (high % 2 == 1)
+				column = std::min(column, fMin[--high]);
+		}
+
+		for (size_t node = (first + fLeaves) / 2; node > 0; node /= 2)
+			column = std::min(column, fAll[node]);
+		for (size_t node = (last + fLeaves) / 2; node > 0; node /= 2)
+			column = std::min(column, fAll[node]);
+		return column;
+	}
+
+private:
+	void _Lower(size_t node, int32_t column)
+	{
+		fMin[node] = std::min(fMin[node], column);
+		if (node < fLeaves)
+			fAll[node] = std::min(fAll[node], column);
+	}
+
+	size_t					fLeaves;
+	int32_t					fNone;
+	std::vector<int32_t>	fMin;
+		// of the units below the node
+	std::vector<int32_t>	fAll;
+		// painted over all units below the node
+};
+
+
+// Widens every event up to the nearest column to the right that is in use
+// while it lasts. Going through the columns from the right, that column is
+// looked up before the event's own column is painted.
+//
+// The group's times are each a time unit, and so is the gap after each of
+// them. An event holds the units strictly between its start and end, which
+// another event overlaps exactly when it holds one of them too. An event
+// without duration only overlaps those holding the unit of its time; it is
+// kept apart so that two of them at the same time don't.
+void
+FinishGroup(std::vector<EventSpan>& spans,
+	const std::vector<Interval>& intervals,
+	std::vector<std::vector<size_t> >& columns)
+{
+	int32_t columnCount = columns.size();
+
+	std::vector<int64_t> times;
+	for (int32_t column = 0; column < columnCount; column++) {
+		for (size_t i = 0; i < columns[column].size(); i++) {
+			times.push_back(intervals[columns[column][i]].start);
+			times.push_back(intervals[columns[column][i]].end);
+		}
+	}
+	std::sort(times.begin(), times.end());
+	times.erase(std::unique(times.begin(), times.end()), times.end());
+
+	// The unit of the start and end of every event, by column.
+	std::vector<std::vector<Interval> > units(columnCount);
+	bool instants = false;
+	for (int32_t column = 0; column < columnCount; column++) {
+		for (size_t i = 0; i < columns[column].size(); i++) {
+			const Interval& interval = intervals[columns[column][i]];
+			Interval unit;
+			unit.start = 2 * (std::lower_bound(times.begin(), times.end(),
+				interval.start) - times.begin());
+			unit.end = 2 * (std::lower_bound(times.begin(), times.end(),
+				interval.end) - times.begin());
+			instants = instants || unit.end <= unit.start;
+			units[column].push_back(unit);
+		}
+	}
+
+	size_t unitCount = 2 * times.size() - 1;
+	NearestColumn ranges(unitCount, columnCount);
+	NearestColumn points(instants ? unitCount : 1, columnCount);
+
+	for (int32_t column = columnCount - 1; column >= 0; column--) {
+		const std::vector<size_t>& members = columns[column];
+
+		for (size_t i = 0; i < members.size(); i++) {
+			const Interval& unit = units[column][i];
+
+			int32_t nearest;
+			if (unit.end <= unit.start)
+				nearest = ranges.Find(unit.start, unit.start);
+			else {
+				nearest = ranges.Find(unit.start + 1, unit.end - 1);
+				if (instants) {
+					nearest = std::min(nearest,
+						points.Find(unit.start + 1, unit.end - 1));
+				}
+			}
+
+			EventSpan& span = spans[members[i]];
+			span.columns = columnCount;
+			span.span = nearest - column;
+		}
+
+		for (size_t i = 0; i < members.size(); i++) {
+			const Interval& unit = units[column][i];
+			if (unit.end <= unit.start)
+				points.Paint(unit.start, unit.start, column);
+			else
+				ranges.Paint(unit.start + 1, unit.end - 1, column);
+		}
+	}
+
+	columns.clear();
+}
+
+}	// namespace
+
+
+void
+LayoutEvents(std::vector<EventSpan>& spans, int64_t minimumDuration)
+{
+	size_t count = spans.size();
+	if (count == 0)
+		return;
+
+	std::vector<Interval> intervals(count);
+	std::vector<size_t> order(count);
+	for (size_t i = 0; i < count; i++) {
+		intervals[i].start = spans[i].start;
+		intervals[i].end = std::max(spans[i].end,
+			spans[i].start + minimumDuration);
+		order[i] = i;
+	}
+
+	std::sort(order.begin(), order.end(), StartOrder(intervals));
+
+	std::priority_queue<ActiveEntry, std::vector<ActiveEntry>,
+		std::greater<ActiveEntry> > active;
+	std::priority_queue<int32_t, std::vector<int32_t>,
+		std::greater<int32_t> > freeColumns;
+	std::vector<std::vector<size_t> > columns;
+
+	for (size_t i = 0; i < count; i++) {
+		size_t index = order[i];
+		const Interval& interval = intervals[index];
+
+		while (!active.empty() && active.top().first <= interval.start) {
+			freeColumns.push(active.top().second);
+			active.pop();
+		}
+
+		if (active.empty() && !columns.empty()) {
+			// Nothing overlaps anymore, the group is complete.
+			FinishGroup(spans, intervals, columns);
+			freeColumns = std::priority_queue<int32_t,
+				std::vector<int32_t>, std::greater<int32_t> >();
+		}
+
+		int32_t column;
+		if (freeColumns.empty()) {
+			column = columns.size();
+			columns.push_back(std::vector<size_t>());
+		} else {
+			column = freeColumns.top();
+			freeColumns.pop();
+		}
+
+		spans[index].column = column;
+		columns[column].push_back(index);
+		active.push(ActiveEntry(interval.end, column));
+	}
+
+	FinishGroup(spans, intervals, columns);
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _EVENT_LAYOUT_H_
+#define _EVENT_LAYOUT_H_
+
+
+#include <stdint.h>
+#include <vector>
+
+
+// One event on a timeline. start and end are filled in by the caller, the
+// remaining fields are set by LayoutEvents().
+struct EventSpan {
+	int64_t		start;
+	int64_t		end;
+
+	int32_t		column;
+	int32_t		span;
+	int32_t		columns;
+};
+
+
+// Packs overlapping events into side-by-side columns. Every event gets the
+// leftmost column that is free over its whole duration, and then widens to
+// the right over columns that stay free while it lasts. columns is the
+// number of columns used by the group of transitively overlapping events
+// the event belongs to, so a renderer only has to divide its width by it.
+//
+// Events shorter than minimumDuration are treated as lasting that long, so
+// events drawn with a minimum height don't paint over each other.
+//
+// Column assignment is a sweep over start times with two heaps, and widening
+// a sweep over the columns with a segment tree over the group's times; both
+// run in O(n log n).
+// Only uses the standard library, so it can be built and run on any host.
+void LayoutEvents(std::vector<EventSpan>& spans,
+	int64_t minimumDuration = 0);
+
+#endif	// _EVENT_LAYOUT_H_
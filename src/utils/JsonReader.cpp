@@ -0,0 +1,468 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "JsonReader.h"
+
+#include <string.h>
+
+
+static const uint32_t kReplacementCharacter = 0xfffd;
+
+
+static bool
+IsWhitespace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+
+static bool
+IsNumberCharacter(char c)
+{
+	return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.'
+		|| c == 'e' || c == 'E';
+}
+
+
+static int
+HexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+
+static void
+AppendUTF8(std::string& string, uint32_t code)
+{
+	if (code < 0x80)
+		string += (char)code;
+	else if (code < 0x800) {
+		string += (char)(0xc0 | code >> 6);
+		string += (char)(0x80 | (code & 0x3f));
+	} else if (code < 0x10000) {
+		string += (char)(0xe0 | code >> 12);
+		string += (char)(0x80 | (code >> 6 & 0x3f));
+		string += (char)(0x80 | (code & 0x3f));
+	} else {
+		string += (char)(0xf0 | code >> 18);
+		string += (char)(0x80 | (code >> 12 & 0x3f));
+		string += (char)(0x80 | (code >> 6 & 0x3f));
+		string += (char)(0x80 | (code & 0x3f));
+	}
+}
+
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool
+IsValidNumber(const std::string& number)
+{
+	const char* c = number.c_str();
+	if (*c == '-')
+		c++;
+	if (*c == '0')
+		c++;
+	else if (*c >= '1' && *c <= '9') {
+		while (*c >= '0' && *c <= '9')
+			c++;
+	} else
+		return false;
+
+	if (*c == '.') {
+		c++;
+		if (*c < '0' || *c > '9')
+			return false;
+		while (*c >= '0' && *c <= '9')
+			c++;
+	}
+
+	if (*c == 'e' || *c == 'E') {
+		c++;
+		if (*c == '+' || *c == '-')
+			c++;
+		if (*c < '0' || *c > '9')
+			return false;
+		while (*c >= '0' && *c <= '9')
+			c++;
+	}
+
+	return *c == '\0';
+}
+
+
+JsonReader::JsonReader(JsonHandler* handler)
+	:
+	fHandler(handler)
+{
+	Reset();
+}
+
+
+// Reads the next length bytes of the document. Returns false once the
+// handler has asked to stop or the document turned out to be malformed.
+bool
+JsonReader::Feed(const char* data, size_t length)
+{
+	const char* start = data;
+	const char* end = data + length;
+
+	while (data < end && !fStopped) {
+		char c = *data;
+
+		switch (fState) {
+			case kString:
+				data = _ReadString(data, end);
+				continue;
+
+			case kEscape:
+			{
+				if (c != 'u' && fHighSurrogate != 0) {
+					AppendUTF8(fToken, kReplacementCharacter);
+					fHighSurrogate = 0;
+				}
+
+				const char* escaped = strchr("\"\\/bfnrt", c);
+				if (c == 'u') {
+					fUnicode = 0;
+					fUnicodeDigits = 0;
+					fState = kUnicode;
+				} else if (c != '\0' && escaped != NULL) {
+					fToken += "\"\\/\b\f\n\r\t"[escaped - "\"\\/bfnrt"];
+					fState = kString;
+				} else
+					_Fail();
+				data++;
+				continue;
+			}
+
+			case kUnicode:
+				_Unicode(c);
+				data++;
+				continue;
+
+			case kNumber:
+				if (IsNumberCharacter(c)) {
+					fToken += c;
+					data++;
+				} else
+					_EndNumber();
+				continue;
+
+			case kLiteral:
+				if (c >= 'a' && c <= 'z' && fToken.size() < 5) {
+					fToken += c;
+					data++;
+				} else
+					_EndLiteral();
+				continue;
+
+			default:
+				break;
+		}
+
+		data++;
+		if (IsWhitespace(c))
+			continue;
+
+		switch (fState) {
+			case kFirstValue:
+				if (c == ']') {
+					fContainers.pop_back();
+					if (_Stop(fHandler->EndArray()))
+						_EndValue();
+					break;
+				}
+				// fall through
+			case kValue:
+				_StartValue(c);
+				break;
+
+			case kFirstKey:
+				if (c == '}') {
+					fContainers.pop_back();
+					if (_Stop(fHandler->EndObject()))
+						_EndValue();
+					break;
+				}
+				// fall through
+			case kKey:
+				if (c != '"') {
+					_Fail();
+					break;
+				}
+				fToken.clear();
+				fTokenIsKey = true;
+				fState = kString;
+				break;
+
+			case kColon:
+				if (c == ':')
+					fState = kValue;
+				else
+					_Fail();
+				break;
+
+			case kAfterValue:
+			{
+				char container = fContainers.back();
+				if (c == ',')
+					fState = container == '{' ? kKey : kValue;
+				else if (c == '}' && container == '{') {
+					fContainers.pop_back();
+					if (_Stop(fHandler->EndObject()))
+						_EndValue();
+				} else if (c == ']' && container == '[') {
+					fContainers.pop_back();
+					if (_Stop(fHandler->EndArray()))
+						_EndValue();
+				} else
+					_Fail();
+				break;
+			}
+
+			default:
+				// Anything but whitespace after the document.
+				_Fail();
+				break;
+		}
+	}
+
+	fPosition += data - start;
+	return !fStopped;
+}
+
+
+// Ends the document, the stream having no more data. Returns whether it was
+// complete.
+bool
+JsonReader::Finish()
+{
+	if (!fStopped) {
+		if (fState == kNumber)
+			_EndNumber();
+		else if (fState == kLiteral)
+			_EndLiteral();
+	}
+
+	if (!fStopped && fState != kDone)
+		_Fail();
+
+	return !fStopped;
+}
+
+
+void
+JsonReader::Reset()
+{
+	fState = kValue;
+	fContainers.clear();
+	fToken.clear();
+	fTokenIsKey = false;
+	fUnicode = 0;
+	fUnicodeDigits = 0;
+	fHighSurrogate = 0;
+	fStopped = false;
+	fError = false;
+	fPosition = 0;
+}
+
+
+bool
+JsonReader::HasError() const
+{
+	return fError;
+}
+
+
+// Number of bytes read, up to where the reader stopped.
+uint64_t
+JsonReader::Position() const
+{
+	return fPosition;
+}
+
+
+// Copies the characters up to the next quote or escape at once.
+const char*
+JsonReader::_ReadString(const char* data, const char* end)
+{
+	if (fHighSurrogate != 0 && *data != '\\') {
+		AppendUTF8(fToken, kReplacementCharacter);
+		fHighSurrogate = 0;
+	}
+
+	const char* position = data;
+	while (position < end && *position != '"' && *position != '\\'
+		&& (unsigned char)*position >= 0x20)
+		position++;
+
+	if (fToken.size() + (position - data) > kMaxStringLength) {
+		_Fail();
+		return position;
+	}
+	fToken.append(data, position);
+
+	if (position == end)
+		return position;
+
+	if (*position == '\\') {
+		fState = kEscape;
+		return position + 1;
+	}
+
+	if (*position != '"') {
+		// Control characters have to be escaped.
+		_Fail();
+		return position;
+	}
+
+	if (fTokenIsKey) {
+		fTokenIsKey = false;
+		if (_Stop(fHandler->Key(fToken)))
+			fState = kColon;
+	} else if (_Stop(fHandler->String(fToken)))
+		_EndValue();
+
+	return position + 1;
+}
+
+
+// Takes one digit of a \uXXXX escape. Characters outside the basic plane
+// come as a pair of them; a half of a pair on its own becomes U+FFFD.
+bool
+JsonReader::_Unicode(char c)
+{
+	int value = HexValue(c);
+	if (value < 0)
+		return _Fail();
+
+	fUnicode = fUnicode << 4 | value;
+	if (++fUnicodeDigits < 4)
+		return true;
+
+	fState = kString;
+	uint32_t code = fUnicode;
+	if (code >= 0xdc00 && code <= 0xdfff) {
+		if (fHighSurrogate != 0) {
+			code = 0x10000 + ((fHighSurrogate - 0xd800) << 10)
+				+ (code - 0xdc00);
+		} else
+			code = kReplacementCharacter;
+		fHighSurrogate = 0;
+	} else {
+		if (fHighSurrogate != 0) {
+			AppendUTF8(fToken, kReplacementCharacter);
+			fHighSurrogate = 0;
+		}
+		if (code >= 0xd800 && code <= 0xdbff) {
+			fHighSurrogate = code;
+			return true;
+		}
+	}
+
+	AppendUTF8(fToken, code);
+	return true;
+}
+
+
+bool
+JsonReader::_StartValue(char c)
+{
+	switch (c) {
+		case '{':
+		case '[':
+			if (fContainers.size() >= kMaxDepth)
+				return _Fail();
+			fContainers.push_back(c);
+			if (c == '{') {
+				fState = kFirstKey;
+				return _Stop(fHandler->StartObject());
+			}
+			fState = kFirstValue;
+			return _Stop(fHandler->StartArray());
+
+		case '"':
+			fToken.clear();
+			fTokenIsKey = false;
+			fState = kString;
+			return true;
+
+		case 't':
+		case 'f':
+		case 'n':
+			fToken.assign(1, c);
+			fState = kLiteral;
+			return true;
+
+		default:
+			if (c == '-' || (c >= '0' && c <= '9')) {
+				fToken.assign(1, c);
+				fState = kNumber;
+				return true;
+			}
+			return _Fail();
+	}
+}
+
+
+bool
+JsonReader::_EndValue()
+{
+	fState = fContainers.empty() ? kDone : kAfterValue;
+	return true;
+}
+
+
+bool
+JsonReader::_EndNumber()
+{
+	if (!IsValidNumber(fToken))
+		return _Fail();
+	if (!_Stop(fHandler->Number(fToken)))
+		return false;
+	return _EndValue();
+}
+
+
+bool
+JsonReader::_EndLiteral()
+{
+	bool proceed;
+	if (fToken == "true")
+		proceed = fHandler->Boolean(true);
+	else if (fToken == "false")
+		proceed = fHandler->Boolean(false);
+	else if (fToken == "null")
+		proceed = fHandler->Null();
+	else
+		return _Fail();
+
+	if (!_Stop(proceed))
+		return false;
+	return _EndValue();
+}
+
+
+bool
+JsonReader::_Fail()
+{
+	fError = true;
+	fStopped = true;
+	return false;
+}
+
+
+bool
+JsonReader::_Stop(bool proceed)
+{
+	if (!proceed)
+		fStopped = true;
+	return proceed;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _JSON_READER_H_
+#define _JSON_READER_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+// Receives the values of a JSON document in the order they appear. Strings
+// and keys are unescaped UTF-8; numbers are passed as written, the handler
+// knows which type it wants. The references are only valid during the call.
+class JsonHandler {
+public:
+	virtual				~JsonHandler() {}
+
+	// Returning false from any of these stops the reader.
+	virtual	bool		StartObject() = 0;
+	virtual	bool		EndObject() = 0;
+	virtual	bool		StartArray() = 0;
+	virtual	bool		EndArray() = 0;
+	virtual	bool		Key(const std::string& key) = 0;
+	virtual	bool		String(const std::string& value) = 0;
+	virtual	bool		Number(const std::string& value) = 0;
+	virtual	bool		Boolean(bool value) = 0;
+	virtual	bool		Null() = 0;
+};
+
+
+// Push reader for one JSON document (RFC 8259). Input is fed in chunks of
+// any size, split anywhere, and every value is handed to the handler as
+// soon as it is complete; nothing but the token being read and the nesting
+// of the containers around it is kept. Strings longer than
+// kMaxStringLength and documents nested deeper than kMaxDepth are errors.
+//
+// Only uses the standard library, so it can be built and run on any host.
+class JsonReader {
+public:
+					JsonReader(JsonHandler* handler);
+
+		bool		Feed(const char* data, size_t length);
+		bool		Finish();
+		void		Reset();
+
+		// Whether the document was malformed, rather than stopped by the
+		// handler.
+		bool		HasError() const;
+		uint64_t	Position() const;
+
+	static const size_t	kMaxStringLength = 16 * 1024 * 1024;
+	static const size_t	kMaxDepth = 512;
+
+private:
+		enum State {
+			kValue,
+			kFirstValue,
+			kKey,
+			kFirstKey,
+			kColon,
+			kAfterValue,
+			kString,
+			kEscape,
+			kUnicode,
+			kNumber,
+			kLiteral,
+			kDone
+		};
+
+		const char*	_ReadString(const char* data, const char* end);
+		bool		_Unicode(char c);
+		bool		_StartValue(char c);
+		bool		_EndValue();
+		bool		_EndNumber();
+		bool		_EndLiteral();
+		bool		_Fail();
+		bool		_Stop(bool proceed);
+
+		JsonHandler*	fHandler;
+		State		fState;
+		std::vector<char>	fContainers;
+		std::string	fToken;
+		bool		fTokenIsKey;
+		uint32_t	fUnicode;
+		int			fUnicodeDigits;
+		uint32_t	fHighSurrogate;
+		bool		fStopped;
+		bool		fError;
+		uint64_t	fPosition;
+};
+
+#endif	// _JSON_READER_H_
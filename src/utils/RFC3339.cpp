@@ -0,0 +1,225 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "RFC3339.h"
+
+#include <string.h>
+
+#include "CivilDate.h"
+
+
+// Two digits, checked without branching: a byte that isn't a digit makes
+// its unsigned difference to '0' 10 or more.
+static inline bool
+Parse2(const char* string, int& value)
+{
+	unsigned tens = (unsigned char)string[0] - '0';
+	unsigned ones = (unsigned char)string[1] - '0';
+	value = tens * 10 + ones;
+	return (tens < 10) & (ones < 10);
+}
+
+
+static inline bool
+Parse4(const char* string, int& value)
+{
+	int high;
+	int low;
+	bool valid = Parse2(string, high) & Parse2(string + 2, low);
+	value = high * 100 + low;
+	return valid;
+}
+
+
+static inline void
+Format2(char* buffer, int value)
+{
+	buffer[0] = '0' + value / 10;
+	buffer[1] = '0' + value % 10;
+}
+
+
+static inline bool
+IsDigit(char c)
+{
+	return (unsigned)((unsigned char)c - '0') < 10;
+}
+
+
+bool
+ParseRFC3339(const char* string, size_t length, RFC3339Time& result)
+{
+	const char* end = string + length;
+	int year;
+	int month;
+	int day;
+
+	// The date decides between extended and basic format for the rest.
+	bool extended = length >= 10 && string[4] == '-';
+	if (extended) {
+		if (!(Parse4(string, year) & (string[7] == '-')
+				& Parse2(string + 5, month) & Parse2(string + 8, day)))
+			return false;
+		string += 10;
+	} else {
+		if (length < 8 || !(Parse4(string, year) & Parse2(string + 4, month)
+				& Parse2(string + 6, day)))
+			return false;
+		string += 8;
+	}
+
+	if (month < 1 || month > 12 || day < 1 || day > DaysInMonth(year, month))
+		return false;
+
+	int64_t days = DaysFromCivil(year, month, day);
+	result.nanoseconds = 0;
+	result.offset = 0;
+	result.hasOffset = false;
+
+	if (string == end) {
+		result.time = days * kSecondsPerDay;
+		result.isDate = true;
+		return true;
+	}
+
+	if (*string != 'T' && *string != 't' && *string != ' ')
+		return false;
+	string++;
+
+	int hour;
+	int minute;
+	int second;
+	size_t timeLength = extended ? 8 : 6;
+	if ((size_t)(end - string) < timeLength)
+		return false;
+	if (extended) {
+		if (!(Parse2(string, hour) & (string[2] == ':')
+				& Parse2(string + 3, minute) & (string[5] == ':')
+				& Parse2(string + 6, second)))
+			return false;
+	} else {
+		if (!(Parse2(string, hour) & Parse2(string + 2, minute)
+				& Parse2(string + 4, second)))
+			return false;
+	}
+	string += timeLength;
+
+	// 60 is a leap second, which time_t can't tell from the one after.
+	if (hour > 23 || minute > 59 || second > 60)
+		return false;
+
+	if (string < end && (*string == '.' || *string == ',')) {
+		string++;
+		if (string == end || !IsDigit(*string))
+			return false;
+
+		int32_t nanoseconds = 0;
+		int32_t scale = 100000000;
+		for (; string < end && IsDigit(*string); string++) {
+			nanoseconds += (*string - '0') * scale;
+			scale /= 10;
+		}
+		result.nanoseconds = nanoseconds;
+	}
+
+	int32_t offset = 0;
+	if (string < end) {
+		if (*string == 'Z' || *string == 'z') {
+			string++;
+		} else if (*string == '+' || *string == '-') {
+			int sign = *string == '-' ? -1 : 1;
+			int offsetHour;
+			int offsetMinute = 0;
+			string++;
+
+			size_t left = end - string;
+			bool valid;
+			if (left == 2)
+				valid = Parse2(string, offsetHour);
+			else if (left == 4 && !extended)
+				valid = Parse2(string, offsetHour)
+					& Parse2(string + 2, offsetMinute);
+			else if (left == 5 && extended)
+				valid = Parse2(string, offsetHour) & (string[2] == ':')
+					& Parse2(string + 3, offsetMinute);
+			else
+				return false;
+
+			if (!valid || offsetHour > 23 || offsetMinute > 59)
+				return false;
+
+			offset = sign * (offsetHour * 3600 + offsetMinute * 60);
+			string = end;
+		} else
+			return false;
+
+		result.hasOffset = true;
+	}
+
+	if (string != end)
+		return false;
+
+	result.time = days * kSecondsPerDay + hour * 3600 + minute * 60 + second
+		- offset;
+	result.offset = offset;
+	result.isDate = false;
+	return true;
+}
+
+
+bool
+ParseRFC3339(const char* string, RFC3339Time& result)
+{
+	return ParseRFC3339(string, strlen(string), result);
+}
+
+
+size_t
+FormatRFC3339Date(int64_t time, int32_t offset, char* buffer)
+{
+	CivilDate date = CivilFromDays(DaysFromTime(time, offset));
+	if (date.year < 0 || date.year > 9999)
+		return 0;
+
+	Format2(buffer, date.year / 100);
+	Format2(buffer + 2, date.year % 100);
+	buffer[4] = '-';
+	Format2(buffer + 5, date.month);
+	buffer[7] = '-';
+	Format2(buffer + 8, date.day);
+	buffer[10] = '\0';
+	return 10;
+}
+
+
+size_t
+FormatRFC3339(int64_t time, int32_t offset, char* buffer)
+{
+	if (FormatRFC3339Date(time, offset, buffer) == 0)
+		return 0;
+
+	int64_t secondOfDay = FloorModulo(time + offset, kSecondsPerDay);
+
+	buffer[10] = 'T';
+	Format2(buffer + 11, secondOfDay / 3600);
+	buffer[13] = ':';
+	Format2(buffer + 14, secondOfDay / 60 % 60);
+	buffer[16] = ':';
+	Format2(buffer + 17, secondOfDay % 60);
+
+	if (offset == 0) {
+		buffer[19] = 'Z';
+		buffer[20] = '\0';
+		return 20;
+	}
+
+	int32_t absolute = offset < 0 ? -offset : offset;
+	buffer[19] = offset < 0 ? '-' : '+';
+	Format2(buffer + 20, absolute / 3600);
+	buffer[22] = ':';
+	Format2(buffer + 23, absolute / 60 % 60);
+	buffer[25] = '\0';
+	return kRFC3339MaxLength;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _RFC3339_H_
+#define _RFC3339_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// A parsed RFC 3339 / ISO 8601 timestamp. time is in seconds since the
+// epoch, computed with offset applied; a value without an offset (a date,
+// or a floating date-time) is taken as UTC and hasOffset is false, so the
+// caller can decide which zone it belongs to.
+struct RFC3339Time {
+	int64_t		time;
+	int32_t		nanoseconds;
+	int32_t		offset;
+	bool		isDate;
+	bool		hasOffset;
+};
+
+
+// Longest output of FormatRFC3339(), without the terminator:
+// "YYYY-MM-DDTHH:MM:SS+HH:MM".
+static const size_t kRFC3339MaxLength = 25;
+
+
+// Accepts dates ("2017-06-01", "20170601") and date-times in extended or
+// basic format, with 'T', 't' or a space as separator, optional fractional
+// seconds, and "Z", "+HH:MM", "+HHMM", "+HH" or no offset. The whole string
+// must match. Nothing is allocated, and the time is computed without going
+// through the C library, so the process time zone doesn't matter.
+//
+// Only uses the standard library, so it can be built and run on any host.
+bool ParseRFC3339(const char* string, size_t length, RFC3339Time& result);
+bool ParseRFC3339(const char* string, RFC3339Time& result);
+
+// Writes time as seen at offset seconds east of UTC, with "Z" for a zero
+// offset, and terminates buffer, which needs kRFC3339MaxLength + 1 bytes.
+// Returns the length written. Years outside 0 - 9999 can't be written and
+// return 0.
+size_t FormatRFC3339(int64_t time, int32_t offset, char* buffer);
+
+// Writes the "YYYY-MM-DD" date of time at offset, as FormatRFC3339().
+size_t FormatRFC3339Date(int64_t time, int32_t offset, char* buffer);
+
+#endif	// _RFC3339_H_
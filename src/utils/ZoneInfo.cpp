@@ -0,0 +1,519 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+#include "ZoneInfo.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CivilDate.h"
+
+
+static const char* kZoneDirectories[] = {
+	"/boot/system/data/zoneinfo",
+	"/usr/share/zoneinfo",
+	"/usr/lib/zoneinfo",
+	NULL
+};
+
+static const size_t kMaxZoneFileSize = 1024 * 1024;
+static const size_t kHeaderSize = 44;
+
+
+static std::mutex sZoneLock;
+static std::map<std::string, const ZoneInfo*> sZones;
+static std::string sLocalName;
+static const ZoneInfo* sLocal = NULL;
+static ZoneInfo* sLibraryZone = NULL;
+
+
+static uint32_t
+ReadUInt32(const uint8_t* data)
+{
+	return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16
+		| (uint32_t)data[2] << 8 | data[3];
+}
+
+
+static int64_t
+ReadInt64(const uint8_t* data)
+{
+	return (int64_t)((uint64_t)ReadUInt32(data) << 32 | ReadUInt32(data + 4));
+}
+
+
+static bool
+ReadFile(const char* path, std::vector<uint8_t>& data)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return false;
+
+	uint8_t buffer[4096];
+	size_t bytesRead;
+	while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0
+		&& data.size() < kMaxZoneFileSize)
+		data.insert(data.end(), buffer, buffer + bytesRead);
+
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
+
+
+// A POSIX TZ time, "[+-]hh[:mm[:ss]]", in seconds.
+static bool
+ParsePosixTime(const char*& string, const char* end, int32_t& seconds)
+{
+	int32_t sign = 1;
+	if (string < end && (*string == '+' || *string == '-')) {
+		sign = *string == '-' ? -1 : 1;
+		string++;
+	}
+
+	int32_t parts[3] = { 0, 0, 0 };
+	for (int part = 0; part < 3; part++) {
+		if (string == end || *string < '0' || *string > '9')
+			return false;
+		while (string < end && *string >= '0' && *string <= '9')
+			parts[part] = parts[part] * 10 + *string++ - '0';
+		if (parts[part] > 167 || string == end || *string != ':')
+			break;
+		string++;
+	}
+
+	seconds = sign * (parts[0] * 3600 + parts[1] * 60 + parts[2]);
+	return true;
+}
+
+
+static bool
+ParsePosixName(const char*& string, const char* end)
+{
+	const char* start = string;
+	if (string < end && *string == '<') {
+		while (string < end && *string != '>')
+			string++;
+		if (string == end)
+			return false;
+		string++;
+		return true;
+	}
+
+	while (string < end && ((*string >= 'a' && *string <= 'z')
+			|| (*string >= 'A' && *string <= 'Z')))
+		string++;
+	return string - start >= 3;
+}
+
+
+namespace {
+
+// One end of daylight saving time in a POSIX TZ rule.
+struct PosixDate {
+	char		kind;
+	int32_t		month;
+	int32_t		week;
+	int32_t		day;
+	int32_t		time;
+
+	bool Parse(const char*& string, const char* end)
+	{
+		time = 2 * 3600;
+		kind = *string;
+		if (kind == 'M') {
+			string++;
+			int32_t values[3] = { 0, 0, 0 };
+			for (int i = 0; i < 3; i++) {
+				if (string == end || *string < '0' || *string > '9')
+					return false;
+				while (string < end && *string >= '0' && *string <= '9')
+					values[i] = values[i] * 10 + *string++ - '0';
+				if (i < 2 && (string == end || *string++ != '.'))
+					return false;
+			}
+			month = values[0];
+			week = values[1];
+			day = values[2];
+			if (month < 1 || month > 12 || week < 1 || week > 5 || day > 6)
+				return false;
+		} else {
+			if (kind == 'J')
+				string++;
+			else
+				kind = 'n';
+			day = 0;
+			if (string == end || *string < '0' || *string > '9')
+				return false;
+			while (string < end && *string >= '0' && *string <= '9')
+				day = day * 10 + *string++ - '0';
+			if (day > 365)
+				return false;
+		}
+
+		if (string < end && *string == '/') {
+			string++;
+			return ParsePosixTime(string, end, time);
+		}
+		return true;
+	}
+
+	// Seconds from the epoch to the local time this date means in year.
+	int64_t LocalTime(int32_t year) const
+	{
+		int64_t days;
+		if (kind == 'M') {
+			int64_t first = DaysFromCivil(year, month, 1);
+			int32_t weekday = WeekdayFromDays(first) % 7;
+			days = first + (day - weekday + 7) % 7 + (week - 1) * 7;
+			while (days >= first + DaysInMonth(year, month))
+				days -= 7;
+		} else if (kind == 'J') {
+			// Julian days don't count February 29.
+			days = DaysFromCivil(year, 1, 1) + day - 1
+				+ (IsLeapYear(year) && day >= 60);
+		} else
+			days = DaysFromCivil(year, 1, 1) + day;
+
+		return days * kSecondsPerDay + time;
+	}
+};
+
+}	// namespace
+
+
+// #pragma mark - ZoneInfo
+
+
+ZoneInfo::ZoneInfo()
+	:
+	fUseLibrary(false)
+{
+	fOffsets.push_back(0);
+}
+
+
+const ZoneInfo*
+ZoneInfo::Get(const char* name)
+{
+	if (name == NULL || name[0] == '\0')
+		return NULL;
+
+	std::lock_guard<std::mutex> _(sZoneLock);
+	return _Load(name, false);
+}
+
+
+const ZoneInfo*
+ZoneInfo::Local()
+{
+	std::lock_guard<std::mutex> _(sZoneLock);
+	if (sLocal != NULL)
+		return sLocal;
+
+	std::string name = sLocalName;
+	if (name.empty()) {
+		const char* variable = getenv("TZ");
+		if (variable != NULL && variable[0] == ':')
+			variable++;
+		if (variable != NULL)
+			name = variable;
+	}
+
+	sLocal = _Load(name, true);
+	return sLocal;
+}
+
+
+void
+ZoneInfo::SetLocalZone(const char* name)
+{
+	std::lock_guard<std::mutex> _(sZoneLock);
+	if (name == NULL)
+		name = "";
+	if (sLocalName == name && sLocal != NULL)
+		return;
+
+	sLocalName = name;
+	sLocal = NULL;
+}
+
+
+// Reads a TZif file (RFC 8536), preferring the 64 bit data of version 2
+// and later, followed by the rule for the times after the last transition.
+bool
+ZoneInfo::SetTo(const void* buffer, size_t length)
+{
+	const uint8_t* data = (const uint8_t*)buffer;
+	const uint8_t* end = data + length;
+
+	fTransitions.clear();
+	fOffsets.assign(1, 0);
+	fUseLibrary = false;
+
+	if (length < kHeaderSize || memcmp(data, "TZif", 4) != 0)
+		return false;
+
+	int version = data[4];
+	size_t timeSize = 4;
+	for (int pass = 0; pass < 2; pass++) {
+		if (end - data < (ptrdiff_t)kHeaderSize)
+			return false;
+
+		uint32_t isUtCount = ReadUInt32(data + 20);
+		uint32_t isStdCount = ReadUInt32(data + 24);
+		uint32_t leapCount = ReadUInt32(data + 28);
+		uint32_t timeCount = ReadUInt32(data + 32);
+		uint32_t typeCount = ReadUInt32(data + 36);
+		uint32_t charCount = ReadUInt32(data + 40);
+		data += kHeaderSize;
+
+		uint64_t blockSize = (uint64_t)timeCount * (timeSize + 1)
+			+ (uint64_t)typeCount * 6 + charCount
+			+ (uint64_t)leapCount * (timeSize + 4) + isStdCount + isUtCount;
+		if (typeCount == 0 || blockSize > (uint64_t)(end - data))
+			return false;
+
+		// Version 1 data is only used when there is nothing else.
+		if (pass == 0 && version >= '2') {
+			data += blockSize;
+			timeSize = 8;
+			continue;
+		}
+
+		const uint8_t* times = data;
+		const uint8_t* indices = times + timeCount * timeSize;
+		const uint8_t* types = indices + timeCount;
+
+		// Times before the first transition use the first type.
+		fOffsets[0] = (int32_t)ReadUInt32(types);
+		for (uint32_t i = 0; i < timeCount; i++) {
+			int64_t time = timeSize == 8 ? ReadInt64(times + i * 8)
+				: (int32_t)ReadUInt32(times + i * 4);
+			if (indices[i] >= typeCount)
+				return false;
+			_AddTransition(time,
+				(int32_t)ReadUInt32(types + indices[i] * 6));
+		}
+
+		data += blockSize;
+		break;
+	}
+
+	// The footer: "\n<POSIX TZ rule>\n", only in version 2 and later.
+	if (timeSize == 8 && data < end && *data == '\n') {
+		const char* rule = (const char*)data + 1;
+		const char* ruleEnd = (const char*)memchr(rule, '\n',
+			(const char*)end - rule);
+		if (ruleEnd != NULL && ruleEnd > rule)
+			_ParseRule(rule, ruleEnd - rule);
+	}
+
+	return true;
+}
+
+
+const char*
+ZoneInfo::Name() const
+{
+	return fName.c_str();
+}
+
+
+int32_t
+ZoneInfo::Offset(int64_t time) const
+{
+	if (fUseLibrary)
+		return LocalTimeZone()(time);
+	return fOffsets[_FindSpan(time)];
+}
+
+
+void
+ZoneInfo::DaysFromTimes(const int64_t* times, int32_t* days,
+	size_t count) const
+{
+	if (fUseLibrary) {
+		LocalTimeZone zone;
+		for (size_t i = 0; i < count; i++)
+			days[i] = ZonedDaysFromTime(times[i], zone);
+		return;
+	}
+
+	size_t i = 0;
+	while (i < count) {
+		size_t span = _FindSpan(times[i]);
+		int32_t offset = fOffsets[span];
+		int64_t low = span > 0 ? fTransitions[span - 1] : INT64_MIN;
+		int64_t high = span < fTransitions.size()
+			? fTransitions[span] : INT64_MAX;
+
+		// The run is counted from the start of the first time's day, and
+		// is kept short enough for the distance to fit 32 bits.
+		int64_t baseDay = DaysFromTime(times[i], offset);
+		int64_t base = DayStart(baseDay, offset);
+		low = std::max(low, base);
+		high = std::min(high, base + INT32_MAX);
+
+		size_t end = i + 1;
+		while (end < count && times[end] >= low && times[end] < high)
+			end++;
+
+		const uint32_t secondsPerDay = kSecondsPerDay;
+		for (size_t j = i; j < end; j++) {
+			days[j] = (int32_t)baseDay
+				+ (int32_t)((uint32_t)(times[j] - base) / secondsPerDay);
+		}
+		i = end;
+	}
+}
+
+
+size_t
+ZoneInfo::_FindSpan(int64_t time) const
+{
+	return std::upper_bound(fTransitions.begin(), fTransitions.end(), time)
+		- fTransitions.begin();
+}
+
+
+// Expands a POSIX TZ rule, like "CET-1CEST,M3.5.0,M10.5.0/3", into
+// transitions from the last one in the table up to kLastExpandedYear.
+bool
+ZoneInfo::_ParseRule(const char* rule, size_t length)
+{
+	const char* string = rule;
+	const char* end = rule + length;
+
+	int32_t standardOffset;
+	if (!ParsePosixName(string, end)
+		|| !ParsePosixTime(string, end, standardOffset))
+		return false;
+
+	// POSIX counts offsets west of UTC.
+	standardOffset = -standardOffset;
+	if (string == end) {
+		_AddTransition(fTransitions.empty() ? INT64_MIN
+			: fTransitions.back() + 1, standardOffset);
+		return true;
+	}
+
+	if (!ParsePosixName(string, end))
+		return false;
+
+	int32_t daylightOffset = standardOffset + 3600;
+	if (string < end && *string != ',') {
+		if (!ParsePosixTime(string, end, daylightOffset))
+			return false;
+		daylightOffset = -daylightOffset;
+	}
+
+	PosixDate start;
+	PosixDate stop;
+	if (string == end || *string++ != ','
+		|| !start.Parse(string, end)
+		|| string == end || *string++ != ','
+		|| !stop.Parse(string, end) || string != end)
+		return false;
+
+	int32_t firstYear = 1970;
+	if (!fTransitions.empty())
+		firstYear = CivilFromDays(DaysFromTime(fTransitions.back())).year;
+
+	int64_t last = fTransitions.empty() ? INT64_MIN : fTransitions.back();
+	for (int32_t year = firstYear; year <= kLastExpandedYear; year++) {
+		// The start is given in standard time, the end in daylight time.
+		int64_t daylightStart = start.LocalTime(year) - standardOffset;
+		int64_t daylightEnd = stop.LocalTime(year) - daylightOffset;
+
+		if (daylightStart < daylightEnd) {
+			if (daylightStart > last)
+				_AddTransition(daylightStart, daylightOffset);
+			if (daylightEnd > last)
+				_AddTransition(daylightEnd, standardOffset);
+		} else {
+			// Southern hemisphere: daylight time spans the new year.
+			if (daylightEnd > last)
+				_AddTransition(daylightEnd, standardOffset);
+			if (daylightStart > last)
+				_AddTransition(daylightStart, daylightOffset);
+		}
+	}
+
+	return true;
+}
+
+
+void
+ZoneInfo::_AddTransition(int64_t time, int32_t offset)
+{
+	if (offset == fOffsets.back())
+		return;
+
+	if (time == INT64_MIN) {
+		fOffsets.back() = offset;
+		return;
+	}
+
+	fTransitions.push_back(time);
+	fOffsets.push_back(offset);
+}
+
+
+// Called with sZoneLock held. A local zone that can't be loaded is left to
+// the C library, which knows it even where there's no tzdata.
+const ZoneInfo*
+ZoneInfo::_Load(const std::string& name, bool local)
+{
+	if (local && sLibraryZone == NULL) {
+		sLibraryZone = new ZoneInfo;
+		sLibraryZone->fUseLibrary = true;
+	}
+
+	// /etc/localtime is cached under the empty name, Get() never asks for
+	// it.
+	const std::string& key = name;
+	std::map<std::string, const ZoneInfo*>::iterator found = sZones.find(key);
+	if (found != sZones.end()) {
+		if (found->second == NULL && local)
+			return sLibraryZone;
+		return found->second;
+	}
+
+	// Names come from files and servers, don't let them leave the
+	// directory.
+	bool valid = !name.empty() && name[0] != '/'
+		&& name.find("..") == std::string::npos;
+
+	std::vector<uint8_t> data;
+	bool read = false;
+	if (valid) {
+		const char* directory = getenv("TZDIR");
+		if (directory != NULL)
+			read = ReadFile((std::string(directory) + "/" + name).c_str(), data);
+		for (int i = 0; !read && kZoneDirectories[i] != NULL; i++) {
+			data.clear();
+			read = ReadFile((std::string(kZoneDirectories[i]) + "/"
+				+ name).c_str(), data);
+		}
+	} else if (local && name.empty())
+		read = ReadFile("/etc/localtime", data);
+
+	ZoneInfo* zone = new ZoneInfo;
+	zone->fName = name;
+	if (!read || !zone->SetTo(data.data(), data.size())) {
+		delete zone;
+		sZones[key] = NULL;
+		return local ? sLibraryZone : NULL;
+	}
+
+	sZones[key] = zone;
+	return zone;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef _ZONE_INFO_H_
+#define _ZONE_INFO_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+// The UTC offsets of a time zone, read from the system's compiled tzdata
+// (TZif files) into a table of transitions. The rule at the end of the file
+// is expanded up to kLastExpandedYear when loading, so a lookup is always a
+// binary search and never goes through the C library.
+//
+// Zones are loaded once and kept for the life of the process: the pointers
+// handed out by Get() and Local() stay valid and can be shared by threads.
+// A ZoneInfo is a zone for the functions of CivilDate.h.
+//
+// Only uses the standard library, so it can be built and run on any host.
+class ZoneInfo {
+public:
+	// The zone with the given IANA name, like "Europe/Berlin", or NULL if
+	// there is no such zone on this system.
+	static	const ZoneInfo*	Get(const char* name);
+
+	// The zone local times are shown in. It is the one set through
+	// SetLocalZone(), or else the one TZ or /etc/localtime names. If that
+	// can't be loaded, the C library is asked instead.
+	static	const ZoneInfo*	Local();
+	static	void		SetLocalZone(const char* name);
+
+					ZoneInfo();
+
+		bool		SetTo(const void* data, size_t length);
+
+		// Empty for a local zone that wasn't loaded by name, like the one
+		// of /etc/localtime.
+		const char*	Name() const;
+
+		int32_t		Offset(int64_t time) const;
+		int32_t		operator()(int64_t time) const
+						{ return Offset(time); }
+
+		// Local day numbers of count times. Times sorted by value, like
+		// events ordered by start, are handled in runs between two
+		// transitions, where the offset is fixed and the days are computed
+		// by a loop without branches the compiler can vectorize.
+		void		DaysFromTimes(const int64_t* times, int32_t* days,
+						size_t count) const;
+
+	static const int32_t	kLastExpandedYear = 2100;
+
+private:
+		size_t		_FindSpan(int64_t time) const;
+		bool		_ParseRule(const char* rule, size_t length);
+		void		_AddTransition(int64_t time, int32_t offset);
+
+	static	const ZoneInfo*	_Load(const std::string& name, bool local);
+
+		std::string	fName;
+		std::vector<int64_t>	fTransitions;
+		// fOffsets[i] is in effect from fTransitions[i - 1] up to
+		// fTransitions[i]; there is one more offset than transitions.
+		std::vector<int32_t>	fOffsets;
+		bool		fUseLibrary;
+};
+
+#endif	// _ZONE_INFO_H_
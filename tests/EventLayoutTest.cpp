@@ -0,0 +1,257 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+// Checks LayoutEvents() against a layout worked out by hand and against a
+// brute force widening, and times it on groups built to be slow to widen.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "EventLayout.h"
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, \
+				__LINE__, #condition); \
+			return false; \
+		} \
+	} while (false)
+
+
+static EventSpan
+Span(int64_t start, int64_t end)
+{
+	EventSpan span;
+	span.start = start;
+	span.end = end;
+	span.column = -1;
+	span.span = -1;
+	span.columns = -1;
+	return span;
+}
+
+
+static bool
+CheckSpan(const EventSpan& span, int32_t column, int32_t width,
+	int32_t columns)
+{
+	CHECK(span.column == column);
+	CHECK(span.span == width);
+	CHECK(span.columns == columns);
+	return true;
+}
+
+
+// The span every event gets by probing the columns to its right one by one.
+static int32_t
+ProbedSpan(const std::vector<EventSpan>& spans, size_t index,
+	int64_t minimumDuration)
+{
+	const EventSpan& span = spans[index];
+	int64_t end = std::max(span.end, span.start + minimumDuration);
+
+	int32_t nearest = span.columns;
+	for (size_t i = 0; i < spans.size(); i++) {
+		const EventSpan& other = spans[i];
+		int64_t otherEnd = std::max(other.end, other.start + minimumDuration);
+		if (other.column > span.column && other.column < nearest
+			&& other.start < end && span.start < otherEnd)
+			nearest = other.column;
+	}
+	return nearest - span.column;
+}
+
+
+static double
+Seconds(clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+// #pragma mark -
+
+
+static bool
+TestEmpty()
+{
+	std::vector<EventSpan> spans;
+	LayoutEvents(spans);
+	CHECK(spans.empty());
+	return true;
+}
+
+
+static bool
+TestColumns()
+{
+	std::vector<EventSpan> spans;
+	spans.push_back(Span(0, 10));
+	spans.push_back(Span(0, 5));
+	spans.push_back(Span(5, 10));
+	spans.push_back(Span(20, 30));
+	LayoutEvents(spans);
+
+	CHECK(CheckSpan(spans[0], 0, 1, 2));
+	CHECK(CheckSpan(spans[1], 1, 1, 2));
+	CHECK(CheckSpan(spans[2], 1, 1, 2));
+	CHECK(CheckSpan(spans[3], 0, 1, 1));
+	return true;
+}
+
+
+// An event widens over the columns that are free while it lasts, up to the
+// first one that isn't.
+static bool
+TestWidening()
+{
+	std::vector<EventSpan> spans;
+	spans.push_back(Span(0, 10));
+	spans.push_back(Span(0, 4));
+	spans.push_back(Span(0, 4));
+	spans.push_back(Span(4, 10));
+	spans.push_back(Span(2, 4));
+	LayoutEvents(spans);
+
+	CHECK(CheckSpan(spans[0], 0, 1, 4));
+	CHECK(CheckSpan(spans[1], 1, 1, 4));
+	CHECK(CheckSpan(spans[2], 2, 1, 4));
+	CHECK(CheckSpan(spans[3], 1, 3, 4));
+	CHECK(CheckSpan(spans[4], 3, 1, 4));
+	return true;
+}
+
+
+// Events without duration overlap only the events they are strictly within:
+// not each other, nor one starting at the same time. They can be given a
+// minimum duration instead.
+static bool
+TestNoDuration()
+{
+	std::vector<EventSpan> spans;
+	spans.push_back(Span(0, 10));
+	spans.push_back(Span(5, 5));
+	spans.push_back(Span(5, 5));
+	spans.push_back(Span(5, 8));
+	LayoutEvents(spans);
+
+	CHECK(CheckSpan(spans[0], 0, 1, 3));
+	CHECK(CheckSpan(spans[1], 2, 1, 3));
+	CHECK(CheckSpan(spans[2], 2, 1, 3));
+	CHECK(CheckSpan(spans[3], 1, 2, 3));
+
+	LayoutEvents(spans, 2);
+	CHECK(CheckSpan(spans[0], 0, 1, 4));
+	CHECK(CheckSpan(spans[1], 2, 1, 4));
+	CHECK(CheckSpan(spans[2], 3, 1, 4));
+	CHECK(CheckSpan(spans[3], 1, 1, 4));
+	return true;
+}
+
+
+static bool
+TestRandom()
+{
+	srand(1);
+	for (int round = 0; round < 500; round++) {
+		std::vector<EventSpan> spans;
+		int count = 1 + rand() % 60;
+		for (int i = 0; i < count; i++) {
+			int64_t start = rand() % 100;
+			spans.push_back(Span(start, start + rand() % 20));
+		}
+		int64_t minimumDuration = round % 2 == 0 ? 0 : rand() % 5;
+		LayoutEvents(spans, minimumDuration);
+
+		for (size_t i = 0; i < spans.size(); i++) {
+			CHECK(spans[i].column >= 0);
+			CHECK(spans[i].column + spans[i].span <= spans[i].columns);
+			CHECK(spans[i].span == ProbedSpan(spans, i, minimumDuration));
+		}
+	}
+	return true;
+}
+
+
+// One long event, count events starting along with it, and count short ones
+// after each other. Every short event gets column 1 and can widen over all
+// the columns of the others.
+static bool
+TestStackedBenchmark()
+{
+	const int32_t counts[] = { 1000, 10000, 40000 };
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		int32_t count = counts[c];
+		std::vector<EventSpan> spans;
+		spans.push_back(Span(0, 2 * count + 2));
+		for (int32_t i = 0; i < count; i++)
+			spans.push_back(Span(0, 1));
+		for (int32_t i = 0; i < count; i++)
+			spans.push_back(Span(1 + i, 2 + i));
+
+		clock_t start = clock();
+		LayoutEvents(spans);
+		double seconds = Seconds(start);
+		printf("  %" PRId32 " stacked: %.3f s\n", count, seconds);
+
+		CHECK(CheckSpan(spans[0], 0, 1, count + 1));
+		CHECK(CheckSpan(spans[count + 1], 1, count, count + 1));
+		CHECK(CheckSpan(spans[2 * count], 1, count, count + 1));
+		CHECK(seconds < 1.0);
+	}
+	return true;
+}
+
+
+static bool
+TestDayBenchmark()
+{
+	srand(2);
+	std::vector<EventSpan> spans;
+	for (int i = 0; i < 100000; i++) {
+		int64_t start = rand() % (365 * 24 * 60);
+		spans.push_back(Span(start, start + 15 + rand() % 180));
+	}
+
+	clock_t start = clock();
+	LayoutEvents(spans, 30);
+	printf("  100000 over a year: %.3f s\n", Seconds(start));
+	return true;
+}
+
+
+int
+main()
+{
+	struct {
+		const char*	name;
+		bool		(*run)();
+	} tests[] = {
+		{ "empty", TestEmpty },
+		{ "columns", TestColumns },
+		{ "widening", TestWidening },
+		{ "no duration", TestNoDuration },
+		{ "random", TestRandom },
+		{ "stacked benchmark", TestStackedBenchmark },
+		{ "day benchmark", TestDayBenchmark },
+	};
+
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		bool passed = tests[i].run();
+		printf("%s: %s\n", tests[i].name, passed ? "passed" : "FAILED");
+		if (!passed)
+			failed++;
+	}
+
+	return failed == 0 ? 0 : 1;
+}
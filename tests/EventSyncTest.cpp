@@ -0,0 +1,314 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+// Syncs a database of its own with a stand-in for Google that keeps the
+// IDs of the events it has and answers changes the way the API does.
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <set>
+#include <vector>
+
+#include <List.h>
+#include <String.h>
+
+#include "CalendarSync.h"
+#include "Category.h"
+#include "Event.h"
+#include "EventSync.h"
+#include "SQLiteManager.h"
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, \
+				__LINE__, #condition); \
+			return false; \
+		} \
+	} while (false)
+
+
+const char* kAppName = "Calendar tests";
+
+static const char* kDatabasePath = "/tmp/EventSyncTest.sql";
+static const char* kPrimaryId = "someone@example.com";
+
+// The day of the test events, 2017-06-01 UTC.
+static const time_t kDayStart = 1496275200;
+static const time_t kDayEnd = kDayStart + 24 * 60 * 60;
+
+
+class FakeGoogle : public EventSync {
+public:
+							FakeGoogle(SQLiteManager* manager);
+
+			status_t		Pull(CalendarSync* calendar,
+								const GoogleEvent& event);
+
+	virtual	void			SendChanges();
+
+			// Google's events, by calendar and ID.
+			std::set<BString>	fEvents;
+			// "METHOD calendar/id" of every change sent.
+			std::vector<BString> fRequests;
+
+protected:
+	virtual	status_t		_SetAuthorization();
+};
+
+
+FakeGoogle::FakeGoogle(SQLiteManager* manager)
+	:
+	EventSync(manager)
+{
+}
+
+
+// Writes the event as one page of the calendar's events list.
+status_t
+FakeGoogle::Pull(CalendarSync* calendar, const GoogleEvent& event)
+{
+	SyncPage page;
+	page.calendar = calendar;
+	page.events.push_back(event);
+	page.size = 0;
+	page.url = "events";
+	page.pageEnd = true;
+	page.last = false;
+	page.status = B_OK;
+	return _WritePage(&page);
+}
+
+
+void
+FakeGoogle::SendChanges()
+{
+	for (size_t i = 0; i < fChanges.size(); i++) {
+		Change& change = fChanges[i];
+		if (change.statusCode != 0)
+			continue;
+
+		BString key(change.calendar);
+		key << "/" << change.id;
+		fRequests.push_back(BString(change.method) << " " << key);
+
+		bool exists = fEvents.find(key) != fEvents.end();
+		if (change.method == "POST") {
+			change.statusCode = exists ? 409 : 200;
+			fEvents.insert(key);
+		} else if (change.method == "DELETE") {
+			change.statusCode = exists ? 204 : 404;
+			fEvents.erase(key);
+		} else
+			change.statusCode = exists ? 200 : 404;
+	}
+}
+
+
+status_t
+FakeGoogle::_SetAuthorization()
+{
+	return B_OK;
+}
+
+
+// Along with its write-ahead log.
+static void
+RemoveDatabase()
+{
+	const char* suffixes[] = { "", "-wal", "-shm" };
+	for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+		BString path(kDatabasePath);
+		path << suffixes[i];
+		unlink(path.String());
+	}
+}
+
+
+static GoogleEvent
+MakeEvent(const char* id, const char* summary, const char* updated)
+{
+	GoogleEvent event;
+	event.id = id;
+	event.status = "confirmed";
+	event.summary = summary;
+	event.updated = updated;
+	event.start.dateTime = "2017-06-01T10:00:00Z";
+	event.end.dateTime = "2017-06-01T11:00:00Z";
+	return event;
+}
+
+
+static void
+DeleteEvents(BList* events)
+{
+	for (int32 i = 0; i < events->CountItems(); i++)
+		delete (Event*)events->ItemAt(i);
+	delete events;
+}
+
+
+static int32
+CountEvents(SQLiteManager& database)
+{
+	BList* events = database.GetEventsOfRange(kDayStart, kDayEnd);
+	int32 count = events->CountItems();
+	DeleteEvents(events);
+	return count;
+}
+
+
+static Category*
+DefaultCategory(SQLiteManager& database)
+{
+	Category* defaultCategory = NULL;
+	BList* categories = database.GetAllCategories();
+	for (int32 i = 0; i < categories->CountItems(); i++) {
+		Category* category = (Category*)categories->ItemAt(i);
+		if (defaultCategory == NULL && category->GetName() == "Default")
+			defaultCategory = category;
+		else
+			delete category;
+	}
+	delete categories;
+	return defaultCategory;
+}
+
+
+// #pragma mark -
+
+
+// Changes to the primary calendar are pushed to "primary", while its
+// events are pulled under the ID the calendar list has for it. An event
+// pulled, edited and pushed, or made here, pushed and pulled back, still is
+// only one event.
+static bool
+TestPrimaryRoundTrip()
+{
+	RemoveDatabase();
+	FakeGoogle google(new SQLiteManager(kDatabasePath));
+	SQLiteManager database(kDatabasePath);
+
+	Category* category = DefaultCategory(database);
+	CHECK(category != NULL);
+	CalendarSync calendar(kPrimaryId, kPrimaryId, "#9fc6e7", true);
+	calendar.SetCategory(category);
+
+	// Pulled, edited here and pushed.
+	google.fEvents.insert("primary/meeting1");
+	CHECK(google.Pull(&calendar,
+		MakeEvent("meeting1", "Meeting", "2017-05-01T00:00:00Z")) == B_OK);
+	CHECK(CountEvents(database) == 1);
+
+	BList* events = database.GetEventsOfRange(kDayStart, kDayEnd);
+	Event* event = (Event*)events->ItemAt(0);
+	Event edited(*event);
+	edited.ClearChanges();
+	edited.SetName("Edited meeting");
+	bool updated = database.UpdateLocalEvent(event, &edited);
+	DeleteEvents(events);
+	CHECK(updated);
+
+	CHECK(google.PushChanges() == B_OK);
+	CHECK(google.fRequests.size() == 1);
+	CHECK(google.fRequests[0] == "PATCH primary/meeting1");
+
+	CHECK(google.Pull(&calendar,
+		MakeEvent("meeting1", "Edited meeting", "2017-05-02T00:00:00Z"))
+		== B_OK);
+	CHECK(CountEvents(database) == 1);
+
+	// Created here, pushed and pulled back.
+	Event created("Lunch", "", "", false, kDayStart + 12 * 3600,
+		kDayStart + 13 * 3600, category, false);
+	CHECK(database.AddLocalEvent(&created));
+
+	google.fRequests.clear();
+	CHECK(google.PushChanges() == B_OK);
+	CHECK(google.fRequests.size() == 1);
+	CHECK(google.fRequests[0].StartsWith("POST primary/"));
+
+	BString googleId(google.fRequests[0]);
+	googleId.Remove(0, strlen("POST primary/"));
+	GoogleEvent lunch = MakeEvent(googleId.String(), "Lunch",
+		"2017-05-03T00:00:00Z");
+	lunch.start.dateTime = "2017-06-01T12:00:00Z";
+	lunch.end.dateTime = "2017-06-01T13:00:00Z";
+	CHECK(google.Pull(&calendar, lunch) == B_OK);
+	CHECK(CountEvents(database) == 2);
+
+	RemoveDatabase();
+	return true;
+}
+
+
+// An event edited after it was deleted here, say by a window still showing
+// it, is still deleted on the next push.
+static bool
+TestDeleteWinsOverUpdate()
+{
+	RemoveDatabase();
+	FakeGoogle google(new SQLiteManager(kDatabasePath));
+	SQLiteManager database(kDatabasePath);
+
+	Category* category = DefaultCategory(database);
+	CHECK(category != NULL);
+	CalendarSync calendar(kPrimaryId, kPrimaryId, "#9fc6e7", true);
+	calendar.SetCategory(category);
+
+	google.fEvents.insert("primary/meeting1");
+	CHECK(google.Pull(&calendar,
+		MakeEvent("meeting1", "Meeting", "2017-05-01T00:00:00Z")) == B_OK);
+
+	BList* events = database.GetEventsOfRange(kDayStart, kDayEnd);
+	CHECK(events->CountItems() == 1);
+	Event event(*(Event*)events->ItemAt(0));
+	DeleteEvents(events);
+
+	CHECK(database.RemoveLocalEvent(&event));
+	Event edited(event);
+	edited.ClearChanges();
+	edited.SetName("Edited meeting");
+	CHECK(database.UpdateLocalEvent(&event, &edited));
+
+	OutboxList entries;
+	CHECK(database.GetOutbox(entries));
+	CHECK(entries.size() == 1);
+	CHECK(entries[0].operation == kOutboxDelete);
+
+	CHECK(google.PushChanges() == B_OK);
+	CHECK(google.fRequests.size() == 1);
+	CHECK(google.fRequests[0] == "DELETE primary/meeting1");
+	CHECK(google.fEvents.empty());
+
+	RemoveDatabase();
+	return true;
+}
+
+
+int
+main()
+{
+	struct {
+		const char*	name;
+		bool		(*run)();
+	} tests[] = {
+		{ "primary round trip", TestPrimaryRoundTrip },
+		{ "delete wins over update", TestDeleteWinsOverUpdate },
+	};
+
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		bool passed = tests[i].run();
+		printf("%s: %s\n", tests[i].name, passed ? "passed" : "FAILED");
+		if (!passed)
+			failed++;
+	}
+
+	return failed == 0 ? 0 : 1;
+}
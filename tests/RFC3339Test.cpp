@@ -0,0 +1,273 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+// Round trips times through FormatRFC3339() and ParseRFC3339(), checks the
+// forms Google and iCalendar files use, and times both against the C
+// library functions they replace.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CivilDate.h"
+#include "RFC3339.h"
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, \
+				__LINE__, #condition); \
+			return false; \
+		} \
+	} while (false)
+
+
+static const int kBenchmarkRounds = 1000000;
+
+
+static bool
+RoundTrip(int64_t time, int32_t offset)
+{
+	char buffer[kRFC3339MaxLength + 1];
+	size_t length = FormatRFC3339(time, offset, buffer);
+	CHECK(length > 0 && length == strlen(buffer));
+
+	RFC3339Time parsed;
+	CHECK(ParseRFC3339(buffer, parsed));
+	CHECK(parsed.time == time);
+	CHECK(parsed.offset == offset);
+	CHECK(parsed.hasOffset);
+	CHECK(!parsed.isDate);
+	return true;
+}
+
+
+static double
+Nanoseconds(clock_t start, int rounds)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / rounds;
+}
+
+
+// #pragma mark -
+
+
+// One random time and offset on every day from 0000 to 9999.
+static bool
+TestEveryDay()
+{
+	srand(1);
+	int64_t first = DaysFromCivil(0, 1, 1);
+	int64_t last = DaysFromCivil(9999, 12, 31);
+	for (int64_t days = first; days <= last; days++) {
+		int32_t offset = (rand() % (2 * 24 * 60 - 1) - (24 * 60 - 1)) * 60;
+		int64_t time = days * kSecondsPerDay + rand() % kSecondsPerDay
+			- offset;
+		if (!RoundTrip(time, offset))
+			return false;
+
+		char buffer[kRFC3339MaxLength + 1];
+		CHECK(FormatRFC3339Date(time, offset, buffer) == 10);
+		RFC3339Time parsed;
+		CHECK(ParseRFC3339(buffer, parsed));
+		CHECK(parsed.isDate);
+		CHECK(parsed.time == days * kSecondsPerDay);
+	}
+	return true;
+}
+
+
+static bool
+TestEverySecond()
+{
+	int64_t day = DaysFromCivil(2017, 6, 1) * kSecondsPerDay;
+	for (int64_t second = 0; second < kSecondsPerDay; second++) {
+		if (!RoundTrip(day + second, 0) || !RoundTrip(day + second, -25200))
+			return false;
+	}
+	return true;
+}
+
+
+static bool
+TestForms()
+{
+	struct {
+		const char*	string;
+		int64_t		time;
+		int32_t		nanoseconds;
+		bool		isDate;
+		bool		hasOffset;
+	} forms[] = {
+		{ "2017-06-01", 1496275200, 0, true, false },
+		{ "20170601", 1496275200, 0, true, false },
+		{ "2017-06-01T10:30:00Z", 1496313000, 0, false, true },
+		{ "2017-06-01t10:30:00z", 1496313000, 0, false, true },
+		{ "2017-06-01 10:30:00Z", 1496313000, 0, false, true },
+		{ "2017-06-01T10:30:00.250Z", 1496313000, 250000000, false, true },
+		{ "2017-06-01T10:30:00,5Z", 1496313000, 500000000, false, true },
+		{ "2017-06-01T12:30:00+02:00", 1496313000, 0, false, true },
+		{ "2017-06-01T03:30:00-07:00", 1496313000, 0, false, true },
+		{ "2017-06-01T12:30:00+02", 1496313000, 0, false, true },
+		{ "2017-06-01T10:30:00", 1496313000, 0, false, false },
+		{ "20170601T103000Z", 1496313000, 0, false, true },
+		{ "20170601T123000+0200", 1496313000, 0, false, true },
+		{ "20170601T103000", 1496313000, 0, false, false },
+		{ "2016-12-31T23:59:60Z", 1483228800, 0, false, true },
+		{ "1969-12-31T23:59:59Z", -1, 0, false, true },
+	};
+
+	for (size_t i = 0; i < sizeof(forms) / sizeof(forms[0]); i++) {
+		RFC3339Time parsed;
+		if (!ParseRFC3339(forms[i].string, parsed)) {
+			fprintf(stderr, "  not parsed: %s\n", forms[i].string);
+			return false;
+		}
+		CHECK(parsed.time == forms[i].time);
+		CHECK(parsed.nanoseconds == forms[i].nanoseconds);
+		CHECK(parsed.isDate == forms[i].isDate);
+		CHECK(parsed.hasOffset == forms[i].hasOffset);
+	}
+	return true;
+}
+
+
+static bool
+TestInvalid()
+{
+	const char* invalid[] = {
+		"",
+		"2017",
+		"2017-06",
+		"2017-6-01",
+		"2017-13-01",
+		"2017-02-29",
+		"2017-06-00",
+		"2017-06-01T",
+		"2017-06-01T10:30",
+		"2017-06-01T24:00:00Z",
+		"2017-06-01T10:60:00Z",
+		"2017-06-01T10:30:61Z",
+		"2017-06-01T10:30:00.Z",
+		"2017-06-01T10:30:00+2",
+		"2017-06-01T10:30:00+0200",
+		"2017-06-01T10:30:00+24:00",
+		"2017-06-01T10:30:00Zjunk",
+		"2017-06-01X10:30:00Z",
+		"20170601T10:30:00Z",
+		"20170601T103000+02:00",
+		"2017-06-01T1a:30:00Z",
+	};
+
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		RFC3339Time parsed;
+		if (ParseRFC3339(invalid[i], parsed)) {
+			fprintf(stderr, "  parsed: \"%s\"\n", invalid[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// Years that don't fit four digits can't be written.
+static bool
+TestOutOfRange()
+{
+	char buffer[kRFC3339MaxLength + 1];
+	CHECK(FormatRFC3339(DaysFromCivil(10000, 1, 1) * kSecondsPerDay, 0,
+		buffer) == 0);
+	CHECK(FormatRFC3339(DaysFromCivil(-1, 12, 31) * kSecondsPerDay, 0,
+		buffer) == 0);
+	CHECK(FormatRFC3339(0, 3600, buffer) == kRFC3339MaxLength);
+	CHECK(strcmp(buffer, "1970-01-01T01:00:00+01:00") == 0);
+	return true;
+}
+
+
+static bool
+TestBenchmark()
+{
+	const char* string = "2017-06-01T12:30:00+02:00";
+	int64_t sum = 0;
+
+	clock_t start = clock();
+	for (int i = 0; i < kBenchmarkRounds; i++) {
+		RFC3339Time parsed;
+		ParseRFC3339(string, parsed);
+		sum += parsed.time;
+	}
+	double parse = Nanoseconds(start, kBenchmarkRounds);
+
+	start = clock();
+	for (int i = 0; i < kBenchmarkRounds; i++) {
+		struct tm fields;
+		memset(&fields, 0, sizeof(fields));
+		int offsetHour;
+		int offsetMinute;
+		sscanf(string, "%d-%d-%dT%d:%d:%d+%d:%d", &fields.tm_year,
+			&fields.tm_mon, &fields.tm_mday, &fields.tm_hour, &fields.tm_min,
+			&fields.tm_sec, &offsetHour, &offsetMinute);
+		fields.tm_year -= 1900;
+		fields.tm_mon -= 1;
+		fields.tm_isdst = -1;
+		sum += mktime(&fields);
+	}
+	double scan = Nanoseconds(start, kBenchmarkRounds);
+
+	start = clock();
+	for (int i = 0; i < kBenchmarkRounds; i++) {
+		char buffer[kRFC3339MaxLength + 1];
+		sum += FormatRFC3339(1496313000 + i, 7200, buffer);
+	}
+	double format = Nanoseconds(start, kBenchmarkRounds);
+
+	start = clock();
+	for (int i = 0; i < kBenchmarkRounds; i++) {
+		char buffer[64];
+		time_t time = 1496313000 + i;
+		struct tm fields;
+		localtime_r(&time, &fields);
+		sum += strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S%z",
+			&fields);
+	}
+	double print = Nanoseconds(start, kBenchmarkRounds);
+
+	printf("  parse: %.0f ns, sscanf and mktime: %.0f ns\n", parse, scan);
+	printf("  format: %.0f ns, localtime_r and strftime: %.0f ns\n", format,
+		print);
+
+	// Keeps the loops from being optimized away.
+	return sum != 0;
+}
+
+
+int
+main()
+{
+	struct {
+		const char*	name;
+		bool		(*run)();
+	} tests[] = {
+		{ "every day", TestEveryDay },
+		{ "every second", TestEverySecond },
+		{ "forms", TestForms },
+		{ "invalid", TestInvalid },
+		{ "out of range", TestOutOfRange },
+		{ "benchmark", TestBenchmark },
+	};
+
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		bool passed = tests[i].run();
+		printf("%s: %s\n", tests[i].name, passed ? "passed" : "FAILED");
+		if (!passed)
+			failed++;
+	}
+
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,367 @@
+/*
+ * Copyright 2017 Akshay Agarwal, agarwal.akshay.akshay8@gmail.com
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+// Runs HttpCalls against a local stand-in for the Google API, which answers
+// every path with a canned response.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <OS.h>
+#include <String.h>
+
+#include "RequestEngine.h"
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, \
+				__LINE__, #condition); \
+			return false; \
+		} \
+	} while (false)
+
+
+static const char* kGoneBody
+	= "{\"error\":{\"code\":410,\"message\":\"Sync token is no longer valid\"}}";
+static const char* kEventsBody = "{\"items\":[],\"nextSyncToken\":\"token\"}";
+
+static const bigtime_t kServerDelay = 300000;
+
+
+class TestServer {
+public:
+							TestServer();
+							~TestServer();
+
+			status_t		Start();
+			BString			Url(const char* path) const;
+
+			void			SetDelay(bigtime_t delay);
+			int32			MaxOpen() const;
+			void			ResetMaxOpen();
+
+private:
+	static	int32			_AcceptThread(void* data);
+	static	int32			_ConnectionThread(void* data);
+			void			_Serve(int connection);
+
+			int				fSocket;
+			uint16			fPort;
+			thread_id		fThread;
+			bigtime_t		fDelay;
+			int32			fOpen;
+			int32			fMaxOpen;
+};
+
+
+struct Connection {
+	TestServer*	server;
+	int			socket;
+};
+
+
+TestServer::TestServer()
+	:
+	fSocket(-1),
+	fPort(0),
+	fThread(-1),
+	fDelay(0),
+	fOpen(0),
+	fMaxOpen(0)
+{
+}
+
+
+TestServer::~TestServer()
+{
+	// Ends the accept thread.
+	if (fSocket >= 0) {
+		shutdown(fSocket, SHUT_RDWR);
+		close(fSocket);
+	}
+}
+
+
+status_t
+TestServer::Start()
+{
+	fSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (fSocket < 0)
+		return errno;
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	if (bind(fSocket, (sockaddr*)&address, sizeof(address)) != 0
+		|| listen(fSocket, 32) != 0)
+		return errno;
+
+	socklen_t length = sizeof(address);
+	getsockname(fSocket, (sockaddr*)&address, &length);
+	fPort = ntohs(address.sin_port);
+
+	fThread = spawn_thread(_AcceptThread, "test server", B_NORMAL_PRIORITY,
+		this);
+	return resume_thread(fThread);
+}
+
+
+BString
+TestServer::Url(const char* path) const
+{
+	BString url;
+	url.SetToFormat("http://127.0.0.1:%u%s", fPort, path);
+	return url;
+}
+
+
+// How long every response is held back.
+void
+TestServer::SetDelay(bigtime_t delay)
+{
+	fDelay = delay;
+}
+
+
+// The most connections that were open at the same time.
+int32
+TestServer::MaxOpen() const
+{
+	return atomic_get((int32*)&fMaxOpen);
+}
+
+
+void
+TestServer::ResetMaxOpen()
+{
+	atomic_set(&fMaxOpen, 0);
+}
+
+
+int32
+TestServer::_AcceptThread(void* data)
+{
+	TestServer* server = (TestServer*)data;
+	while (true) {
+		int socket = accept(server->fSocket, NULL, NULL);
+		if (socket < 0)
+			break;
+
+		Connection* connection = new Connection;
+		connection->server = server;
+		connection->socket = socket;
+		resume_thread(spawn_thread(_ConnectionThread, "test connection",
+			B_NORMAL_PRIORITY, connection));
+	}
+	return 0;
+}
+
+
+int32
+TestServer::_ConnectionThread(void* data)
+{
+	Connection* connection = (Connection*)data;
+	connection->server->_Serve(connection->socket);
+	close(connection->socket);
+	delete connection;
+	return 0;
+}
+
+
+void
+TestServer::_Serve(int connection)
+{
+	int32 open = atomic_add(&fOpen, 1) + 1;
+	int32 maxOpen = atomic_get(&fMaxOpen);
+	while (open > maxOpen
+		&& atomic_test_and_set(&fMaxOpen, open, maxOpen) != maxOpen)
+		maxOpen = atomic_get(&fMaxOpen);
+
+	std::string request;
+	char buffer[1024];
+	while (request.find("\r\n\r\n") == std::string::npos) {
+		ssize_t bytes = recv(connection, buffer, sizeof(buffer), 0);
+		if (bytes <= 0)
+			break;
+		request.append(buffer, bytes);
+	}
+
+	if (fDelay > 0)
+		snooze(fDelay);
+
+	// "GET /path HTTP/1.1"
+	size_t pathStart = request.find(' ') + 1;
+	std::string path = request.substr(pathStart,
+		request.find(' ', pathStart) - pathStart);
+
+	int code = 200;
+	const char* reason = "OK";
+	const char* body = kEventsBody;
+	if (path == "/gone") {
+		code = 410;
+		reason = "Gone";
+		body = kGoneBody;
+	}
+
+	BString response;
+	response.SetToFormat("HTTP/1.1 %d %s\r\n"
+		"Content-Type: application/json\r\n"
+		"Content-Length: %" B_PRIuSIZE "\r\n"
+		"Connection: close\r\n\r\n%s", code, reason, strlen(body), body);
+	send(connection, response.String(), response.Length(), 0);
+
+	atomic_add(&fOpen, -1);
+}
+
+
+// #pragma mark -
+
+
+// A streamed sync page that gets an error status is read to its end: the
+// call still succeeds, so CalendarSync can tell an expired sync token (410)
+// from a failed request.
+static bool
+TestStreamedError(TestServer& server)
+{
+	RequestEngine engine;
+	HttpCall call(server.Url("/gone"));
+	call.SetStreamed(true);
+	engine.Queue(&call);
+
+	std::string data;
+	CHECK(!call.Read(data));
+	CHECK(call.Wait() == B_OK);
+	CHECK(call.StatusCode() == 410);
+	CHECK(BString(call.Body(), call.BodyLength()) == kGoneBody);
+	return true;
+}
+
+
+static bool
+TestStreamed(TestServer& server)
+{
+	RequestEngine engine;
+	HttpCall call(server.Url("/events"));
+	call.SetStreamed(true);
+	engine.Queue(&call);
+
+	std::string body;
+	std::string data;
+	while (call.Read(data))
+		body += data;
+
+	CHECK(call.Wait() == B_OK);
+	CHECK(call.StatusCode() == 200);
+	CHECK(body == kEventsBody);
+	CHECK(call.BodyLength() == 0);
+	return true;
+}
+
+
+// Calls up to the engine's limit run at the same time: N calls held back
+// by the server for the same delay all end about one delay later.
+static bool
+TestParallel(TestServer& server)
+{
+	const int32 count = RequestEngine::kDefaultMaxRunning;
+	server.SetDelay(kServerDelay);
+
+	RequestEngine engine(count);
+	HttpCall* calls[count];
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < count; i++) {
+		calls[i] = new HttpCall(server.Url("/events"));
+		engine.Queue(calls[i]);
+	}
+
+	bool succeeded = true;
+	for (int32 i = 0; i < count; i++) {
+		succeeded = succeeded && calls[i]->Wait() == B_OK
+			&& calls[i]->StatusCode() == 200;
+		delete calls[i];
+	}
+	bigtime_t elapsed = system_time() - start;
+
+	printf("  %" B_PRId32 " calls in %" B_PRId64 " ms, at most %" B_PRId32
+		" at a time\n", count, elapsed / 1000, server.MaxOpen());
+	CHECK(succeeded);
+	CHECK(server.MaxOpen() == count);
+	CHECK(elapsed < 2 * kServerDelay);
+	return true;
+}
+
+
+// Beyond the limit calls wait in the queue for a free slot.
+static bool
+TestBounded(TestServer& server)
+{
+	const int32 count = 6;
+	const int32 maxRunning = 2;
+	server.SetDelay(kServerDelay);
+
+	RequestEngine engine(maxRunning);
+	HttpCall* calls[count];
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < count; i++) {
+		calls[i] = new HttpCall(server.Url("/events"));
+		engine.Queue(calls[i]);
+	}
+
+	bool succeeded = true;
+	for (int32 i = 0; i < count; i++) {
+		succeeded = succeeded && calls[i]->Wait() == B_OK;
+		delete calls[i];
+	}
+	bigtime_t elapsed = system_time() - start;
+
+	CHECK(succeeded);
+	CHECK(server.MaxOpen() <= maxRunning);
+	CHECK(elapsed >= count / maxRunning * kServerDelay);
+	return true;
+}
+
+
+int
+main()
+{
+	TestServer server;
+	if (server.Start() != B_OK) {
+		fprintf(stderr, "Could not start the test server.\n");
+		return 1;
+	}
+
+	struct {
+		const char*	name;
+		bool		(*run)(TestServer&);
+	} tests[] = {
+		{ "streamed error", TestStreamedError },
+		{ "streamed", TestStreamed },
+		{ "parallel", TestParallel },
+		{ "bounded", TestBounded },
+	};
+
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		server.SetDelay(0);
+		server.ResetMaxOpen();
+		bool passed = tests[i].run(server);
+		printf("%s: %s\n", tests[i].name, passed ? "passed" : "FAILED");
+		if (!passed)
+			failed++;
+	}
+
+	return failed == 0 ? 0 : 1;
+}